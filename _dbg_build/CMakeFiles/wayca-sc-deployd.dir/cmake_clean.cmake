@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca-sc-deployd.dir/deployd.c.o"
+  "CMakeFiles/wayca-sc-deployd.dir/deployd.c.o.d"
+  "wayca-sc-deployd"
+  "wayca-sc-deployd.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/wayca-sc-deployd.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca-sc-deployer.dir/deployer.c.o"
+  "CMakeFiles/wayca-sc-deployer.dir/deployer.c.o.d"
+  "wayca-sc-deployer"
+  "wayca-sc-deployer.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/wayca-sc-deployer.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca-sc-irqdeploy.dir/irqdeploy.c.o"
+  "CMakeFiles/wayca-sc-irqdeploy.dir/irqdeploy.c.o.d"
+  "wayca-sc-irqdeploy"
+  "wayca-sc-irqdeploy.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/wayca-sc-irqdeploy.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca-sc-irqdump.dir/irqdump.c.o"
+  "CMakeFiles/wayca-sc-irqdump.dir/irqdump.c.o.d"
+  "wayca-sc-irqdump"
+  "wayca-sc-irqdump.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/wayca-sc-irqdump.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca-sc-taskdeploy.dir/deployer.c.o"
+  "CMakeFiles/wayca-sc-taskdeploy.dir/deployer.c.o.d"
+  "wayca-sc-taskdeploy"
+  "wayca-sc-taskdeploy.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/wayca-sc-taskdeploy.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,42 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/lib/cpu_util.c" "CMakeFiles/waycascheduler.dir/lib/cpu_util.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/cpu_util.c.o.d"
+  "/root/repo/lib/group.c" "CMakeFiles/waycascheduler.dir/lib/group.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/group.c.o.d"
+  "/root/repo/lib/id_table.c" "CMakeFiles/waycascheduler.dir/lib/id_table.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/id_table.c.o.d"
+  "/root/repo/lib/irq.c" "CMakeFiles/waycascheduler.dir/lib/irq.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/irq.c.o.d"
+  "/root/repo/lib/load_tree.c" "CMakeFiles/waycascheduler.dir/lib/load_tree.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/load_tree.c.o.d"
+  "/root/repo/lib/log.c" "CMakeFiles/waycascheduler.dir/lib/log.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/log.c.o.d"
+  "/root/repo/lib/managed_threads.c" "CMakeFiles/waycascheduler.dir/lib/managed_threads.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/managed_threads.c.o.d"
+  "/root/repo/lib/mem.c" "CMakeFiles/waycascheduler.dir/lib/mem.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/mem.c.o.d"
+  "/root/repo/lib/threads.c" "CMakeFiles/waycascheduler.dir/lib/threads.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/threads.c.o.d"
+  "/root/repo/lib/topo.c" "CMakeFiles/waycascheduler.dir/lib/topo.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/topo.c.o.d"
+  "/root/repo/lib/topo_hotplug.c" "CMakeFiles/waycascheduler.dir/lib/topo_hotplug.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/topo_hotplug.c.o.d"
+  "/root/repo/lib/topo_index.c" "CMakeFiles/waycascheduler.dir/lib/topo_index.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/topo_index.c.o.d"
+  "/root/repo/lib/topo_meminfo.c" "CMakeFiles/waycascheduler.dir/lib/topo_meminfo.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/topo_meminfo.c.o.d"
+  "/root/repo/lib/topo_notify.c" "CMakeFiles/waycascheduler.dir/lib/topo_notify.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/topo_notify.c.o.d"
+  "/root/repo/lib/topo_snapshot.c" "CMakeFiles/waycascheduler.dir/lib/topo_snapshot.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/topo_snapshot.c.o.d"
+  "/root/repo/lib/topo_sysfs.c" "CMakeFiles/waycascheduler.dir/lib/topo_sysfs.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/topo_sysfs.c.o.d"
+  "/root/repo/lib/topo_walk.c" "CMakeFiles/waycascheduler.dir/lib/topo_walk.c.o" "gcc" "CMakeFiles/waycascheduler.dir/lib/topo_walk.c.o.d"
+  )
+
+# Pairs of files generated by the same build rule.
+set(CMAKE_MULTIPLE_OUTPUT_PAIRS
+  "/root/repo/_dbg_build/libwaycascheduler.so" "/root/repo/_dbg_build/libwaycascheduler.so.1.0"
+  "/root/repo/_dbg_build/libwaycascheduler.so.1" "/root/repo/_dbg_build/libwaycascheduler.so.1.0"
+  )
+
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
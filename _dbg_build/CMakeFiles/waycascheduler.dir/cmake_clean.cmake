@@ -0,0 +1,45 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/waycascheduler.dir/lib/cpu_util.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/cpu_util.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/group.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/group.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/id_table.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/id_table.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/irq.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/irq.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/load_tree.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/load_tree.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/log.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/log.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/managed_threads.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/managed_threads.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/mem.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/mem.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/threads.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/threads.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/topo.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/topo.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/topo_hotplug.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/topo_hotplug.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/topo_index.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/topo_index.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/topo_meminfo.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/topo_meminfo.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/topo_notify.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/topo_notify.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/topo_snapshot.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/topo_snapshot.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/topo_sysfs.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/topo_sysfs.c.o.d"
+  "CMakeFiles/waycascheduler.dir/lib/topo_walk.c.o"
+  "CMakeFiles/waycascheduler.dir/lib/topo_walk.c.o.d"
+  "libwaycascheduler.pdb"
+  "libwaycascheduler.so"
+  "libwaycascheduler.so.1"
+  "libwaycascheduler.so.1.0"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/waycascheduler.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca_sc_test_attach_bench.dir/wayca_attach_bench.c.o"
+  "CMakeFiles/wayca_sc_test_attach_bench.dir/wayca_attach_bench.c.o.d"
+  "wayca_sc_test_attach_bench"
+  "wayca_sc_test_attach_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/wayca_sc_test_attach_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
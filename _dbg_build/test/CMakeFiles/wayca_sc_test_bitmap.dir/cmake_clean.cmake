@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca_sc_test_bitmap.dir/wayca_bitmap.c.o"
+  "CMakeFiles/wayca_sc_test_bitmap.dir/wayca_bitmap.c.o.d"
+  "wayca_sc_test_bitmap"
+  "wayca_sc_test_bitmap.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/wayca_sc_test_bitmap.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca_sc_test_group.dir/wayca_sc_group.c.o"
+  "CMakeFiles/wayca_sc_test_group.dir/wayca_sc_group.c.o.d"
+  "wayca_sc_test_group"
+  "wayca_sc_test_group.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/wayca_sc_test_group.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca_sc_test_thread.dir/wayca_thread.c.o"
+  "CMakeFiles/wayca_sc_test_thread.dir/wayca_thread.c.o.d"
+  "wayca_sc_test_thread"
+  "wayca_sc_test_thread.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/wayca_sc_test_thread.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca_sc_test_threadpool.dir/wayca_threadpool.c.o"
+  "CMakeFiles/wayca_sc_test_threadpool.dir/wayca_threadpool.c.o.d"
+  "wayca_sc_test_threadpool"
+  "wayca_sc_test_threadpool.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/wayca_sc_test_threadpool.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
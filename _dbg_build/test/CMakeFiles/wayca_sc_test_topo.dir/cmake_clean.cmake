@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca_sc_test_topo.dir/wayca_topo.c.o"
+  "CMakeFiles/wayca_sc_test_topo.dir/wayca_topo.c.o.d"
+  "wayca_sc_test_topo"
+  "wayca_sc_test_topo.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/wayca_sc_test_topo.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca-memory-bench.dir/wayca-memory-bench/wayca-memory-bench.c.o"
+  "CMakeFiles/wayca-memory-bench.dir/wayca-memory-bench/wayca-memory-bench.c.o.d"
+  "wayca-memory-bench"
+  "wayca-memory-bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/wayca-memory-bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,22 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/lib/log.c" "tools/CMakeFiles/wayca-sc-info.dir/__/lib/log.c.o" "gcc" "tools/CMakeFiles/wayca-sc-info.dir/__/lib/log.c.o.d"
+  "/root/repo/tools/wayca-sc-info/wayca_sc_info.c" "tools/CMakeFiles/wayca-sc-info.dir/wayca-sc-info/wayca_sc_info.c.o" "gcc" "tools/CMakeFiles/wayca-sc-info.dir/wayca-sc-info/wayca_sc_info.c.o.d"
+  "/root/repo/tools/wayca-sc-info/wayca_sc_topo.c" "tools/CMakeFiles/wayca-sc-info.dir/wayca-sc-info/wayca_sc_topo.c.o" "gcc" "tools/CMakeFiles/wayca-sc-info.dir/wayca-sc-info/wayca_sc_topo.c.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  "/root/repo/_dbg_build/CMakeFiles/waycascheduler.dir/DependInfo.cmake"
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
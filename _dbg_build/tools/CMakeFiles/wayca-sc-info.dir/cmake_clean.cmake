@@ -0,0 +1,15 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca-sc-info.dir/__/lib/log.c.o"
+  "CMakeFiles/wayca-sc-info.dir/__/lib/log.c.o.d"
+  "CMakeFiles/wayca-sc-info.dir/wayca-sc-info/wayca_sc_info.c.o"
+  "CMakeFiles/wayca-sc-info.dir/wayca-sc-info/wayca_sc_info.c.o.d"
+  "CMakeFiles/wayca-sc-info.dir/wayca-sc-info/wayca_sc_topo.c.o"
+  "CMakeFiles/wayca-sc-info.dir/wayca-sc-info/wayca_sc_topo.c.o.d"
+  "wayca-sc-info"
+  "wayca-sc-info.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang C)
+  include(CMakeFiles/wayca-sc-info.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,8 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/wayca_calibration.py"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang )
+  include(CMakeFiles/wayca_calibration.py.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -37,38 +37,108 @@ static enum CPUBIND default_task_bind = AUTO;
 /* default memory bandwidth requirement of the application */
 static enum MEMBAND default_mem_bandwidth = ALL;
 
-#define NR_CPUS 1024
-
-static int ccl_cpus_load[NR_CPUS];
-static int node_cpus_load[NR_CPUS];
+/* Sized to the system by init_cpus_load() */
+static int nr_cpus, nr_ccls, nr_nodes;
+static size_t cpusetsize;
+static int *ccl_cpus_load;
+static int *node_cpus_load;
 static int socket_fd;
 
+static int init_cpus_load(void)
+{
+	nr_cpus = wayca_sc_cpus_in_total();
+	nr_nodes = wayca_sc_nodes_in_total();
+	nr_ccls = wayca_sc_ccls_in_total();
+	if (nr_cpus <= 0 || nr_nodes <= 0)
+		return -1;
+
+	/* CCL may not be reported, the CPUs are then not in any CCL */
+	if (nr_ccls < 0)
+		nr_ccls = 0;
+
+	cpusetsize = CPU_ALLOC_SIZE(nr_cpus);
+	ccl_cpus_load = calloc(nr_ccls + 1, sizeof(int));
+	node_cpus_load = calloc(nr_nodes, sizeof(int));
+	if (!ccl_cpus_load || !node_cpus_load)
+		return -1;
+
+	return 0;
+}
+
+/*
+ * The number of CPUs in @mask weighted by the capacity, so a little CPU
+ * serves a smaller part of the cpu_util than a big one.
+ */
+static int mask_cpu_cores(cpu_set_t *mask)
+{
+	long long capacity = 0;
+
+	for (int i = 0; i < nr_cpus; i++) {
+		int cap = wayca_sc_get_cpu_capacity(i);
+
+		if (CPU_ISSET_S(i, cpusetsize, mask) && cap > 0)
+			capacity += cap;
+	}
+
+	return capacity / WAYCA_SC_CPU_CAPACITY_SCALE;
+}
+
 static int ccl_idle_cpu_cores(int ccl)
 {
-	return wayca_sc_cpus_in_ccl() - ccl_cpus_load[ccl];
+	cpu_set_t *mask = CPU_ALLOC(nr_cpus);
+	int cores = 0;
+
+	if (mask && !wayca_sc_ccl_cpu_mask(ccl, cpusetsize, mask))
+		cores = mask_cpu_cores(mask) - ccl_cpus_load[ccl];
+	CPU_FREE(mask);
+	return cores;
 }
 
 static int node_idle_cpu_cores(int node)
 {
-	return wayca_sc_cpus_in_node() - node_cpus_load[node];
+	cpu_set_t *mask = CPU_ALLOC(nr_cpus);
+	int cores = 0;
+
+	if (mask && !wayca_sc_node_cpu_mask(node, cpusetsize, mask))
+		cores = mask_cpu_cores(mask) - node_cpus_load[node];
+	CPU_FREE(mask);
+	return cores;
 }
 
-static int process_cpulist_bind(struct program *prog)
+/* Account @load to the CCL and the node where @cpu is in */
+static void cpu_add_load(int cpu, int load)
+{
+	int ccl = wayca_sc_get_ccl_id(cpu);
+	int node = wayca_sc_get_node_id(cpu);
+
+	if (ccl >= 0 && ccl < nr_ccls)
+		ccl_cpus_load[ccl] += load;
+	if (node >= 0 && node < nr_nodes)
+		node_cpus_load[node] += load;
+}
+
+/* Account one CPU of load to each CPU in the list @s */
+static int cpulist_to_load(char *s)
 {
-	cpu_set_t mask;
+	cpu_set_t *mask = CPU_ALLOC(nr_cpus);
 
-	int cr_in_total = wayca_sc_cpus_in_total();
-	int cr_in_ccl = wayca_sc_cpus_in_ccl();
-	int cr_in_node = wayca_sc_cpus_in_node();
+	if (!mask)
+		return -1;
 
-	list_to_mask(prog->cpu_list, sizeof(cpu_set_t), &mask);
-	for (int i = 0; i < cr_in_total; i++) {
-		if (CPU_ISSET(i, &mask)) {
-			ccl_cpus_load[i / cr_in_ccl]++;
-			node_cpus_load[i / cr_in_node]++;
+	if (!list_to_mask(s, cpusetsize, mask)) {
+		for (int i = 0; i < nr_cpus; i++) {
+			if (CPU_ISSET_S(i, cpusetsize, mask))
+				cpu_add_load(i, 1);
 		}
 	}
 
+	CPU_FREE(mask);
+	return 0;
+}
+
+static int process_cpulist_bind(struct program *prog)
+{
+	cpulist_to_load(prog->cpu_list);
 	thread_bind_cpulist(prog->pid, prog->cpu_list);
 	return 0;
 }
@@ -92,16 +162,14 @@ static int process_managed_threads_bind(struct program *prog)
 			int cpus = CPU_COUNT(&maps[i].cpus);
 
 			if (nodes > 0) {
-				for (j = 0; j < wayca_sc_nodes_in_total(); j++) {
+				for (j = 0; j < nr_nodes; j++) {
 					if (NODE_ISSET(j, &maps[i].nodes))
 						node_cpus_load[j] += maps[i].cpu_util / nodes;
 				}
 			} else {
-				for (j = 0; j < wayca_sc_cpus_in_total(); j++) {
-					if (CPU_ISSET(j, &maps[i].cpus)) {
-						node_cpus_load[j / wayca_sc_cpus_in_node()] += maps[i].cpu_util / cpus;
-						ccl_cpus_load[j / wayca_sc_cpus_in_ccl()] += maps[i].cpu_util / cpus;
-					}
+				for (j = 0; j < nr_cpus; j++) {
+					if (CPU_ISSET(j, &maps[i].cpus))
+						cpu_add_load(j, maps[i].cpu_util / cpus);
 				}
 			}
 		}
@@ -114,68 +182,97 @@ static int process_managed_threads_bind(struct program *prog)
 
 static int occupied_cpu_to_load(char *s)
 {
-	cpu_set_t mask;
-
-	int cr_in_total = wayca_sc_cpus_in_total();
-	int cr_in_ccl = wayca_sc_cpus_in_ccl();
-	int cr_in_node = wayca_sc_cpus_in_node();
+	return cpulist_to_load(s);
+}
 
-	list_to_mask(s, sizeof(cpu_set_t), &mask);
-	for (int i = 0; i < cr_in_total; i++) {
-		if (CPU_ISSET(i, &mask)) {
-			ccl_cpus_load[i / cr_in_ccl]++;
-			node_cpus_load[i / cr_in_node]++;
+/*
+ * Try to bind @prog to an idle CCL in @mask, in the order of the CPUs.
+ * The CCLs already tried are recorded in @tried.
+ */
+static bool bind_idle_ccl(struct program *prog, cpu_set_t *mask, bool *tried)
+{
+	for (int i = 0; i < nr_cpus; i++) {
+		int ccl = wayca_sc_get_ccl_id(i);
+		int node = wayca_sc_get_node_id(i);
+
+		if (!CPU_ISSET_S(i, cpusetsize, mask) || ccl < 0 ||
+		    ccl >= nr_ccls || tried[ccl])
+			continue;
+
+		tried[ccl] = true;
+		if (ccl_idle_cpu_cores(ccl) >= prog->cpu_util) {
+			thread_bind_ccl(prog->pid, ccl);
+			ccl_cpus_load[ccl] += prog->cpu_util;
+			if (node >= 0)
+				node_cpus_load[node] += prog->cpu_util;
+			return true;
 		}
 	}
 
-	return 0;
+	return false;
 }
 
 static int process_auto_bind(struct program *prog)
 {
-	int cr_in_pack = wayca_sc_cpus_in_package();
-	int cr_in_ccl = wayca_sc_cpus_in_ccl();
-	int cr_in_node = wayca_sc_cpus_in_node();
-	int cpu = cr_in_node * prog->io_node;
+	cpu_set_t *node_mask, *package_mask;
+	bool *tried;
+	int package = -1;
 
-	if (prog->io_node < 0)
+	if (prog->io_node < 0 || prog->io_node >= nr_nodes)
 		return 0;
 
+	node_mask = CPU_ALLOC(nr_cpus);
+	package_mask = CPU_ALLOC(nr_cpus);
+	tried = calloc(nr_ccls + 1, sizeof(bool));
+	if (!node_mask || !package_mask || !tried)
+		goto out;
+
+	/* The io node may have no CPUs, then the package is unknown */
+	CPU_ZERO_S(cpusetsize, node_mask);
+	CPU_ZERO_S(cpusetsize, package_mask);
+	if (!wayca_sc_node_cpu_mask(prog->io_node, cpusetsize, node_mask)) {
+		for (int i = 0; package < 0 && i < nr_cpus; i++) {
+			if (CPU_ISSET_S(i, cpusetsize, node_mask))
+				package = wayca_sc_get_package_id(i);
+		}
+	}
+	if (package >= 0)
+		wayca_sc_package_cpu_mask(package, cpusetsize, package_mask);
+
 	switch (prog->mem_band) {
 		/*
 		 * For a process which is not sensitive to memory bandwidth, try to put them in same CCL
-		 * if no idle CCL available, put it in same DIE
+		 * if no idle CCL available, put it in same DIE. The CCLs near the io node come first,
+		 * then the rest of the package.
 		 */
 	case LOW:
-		for (int i = 0; i < cr_in_pack; i += cr_in_ccl) {
-			int ccl = (i + cpu) / cr_in_ccl;
-			if (ccl_idle_cpu_cores(ccl) >= prog->cpu_util) {
-				thread_bind_ccl(prog->pid, i + cpu);
-				ccl_cpus_load[ccl] += prog->cpu_util;
-				node_cpus_load[(i + cpu) / cr_in_node] +=
-				    prog->cpu_util;
-				return 0;
-			}
-		}
+		if (bind_idle_ccl(prog, node_mask, tried) ||
+		    bind_idle_ccl(prog, package_mask, tried))
+			break;
+		/* fall through */
 	case DIE:
 		if (node_idle_cpu_cores(prog->io_node) >= prog->cpu_util) {
 			thread_bind_node(prog->pid, prog->io_node);
 			node_cpus_load[prog->io_node] += prog->cpu_util;
-		} else {
-			thread_bind_package(prog->pid, prog->io_node);
+			break;
 		}
-		break;
+		/* fall through */
 	case PACKAGE:
-		thread_bind_package(prog->pid, prog->io_node);
-		break;
+	default:		/* cfg has no memory_bandwidth parameter */
+		if (package >= 0) {
+			thread_bind_package(prog->pid, package);
+			break;
+		}
+		/* fall through */
 	case ALL:
 		thread_unbind(prog->pid);
 		break;
-	default:		/* cfg has no memory_bandwidth parameter */
-		thread_bind_package(prog->pid, prog->io_node);
-		break;
 	}
 
+out:
+	free(tried);
+	CPU_FREE(package_mask);
+	CPU_FREE(node_mask);
 	return 0;
 }
 
@@ -330,6 +427,10 @@ int main(int argc, char **argv)
 	int i;
 
 	parse_command_line(argc, argv);
+	if (init_cpus_load()) {
+		fprintf(stderr, "Failed to get the CPU topology\n");
+		return -1;
+	}
 	parse_cfg_file();
 
 	ret = init_socket();
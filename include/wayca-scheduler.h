@@ -320,6 +320,63 @@ int wayca_sc_get_ccl_id(int cpu_id);
 int wayca_sc_get_node_id(int cpu_id);
 int wayca_sc_get_package_id(int cpu_id);
 
+/* The capacity of the most performant cpus in the system */
+#define WAYCA_SC_CPU_CAPACITY_SCALE	1024
+
+/**
+ * wayca_sc_get_cpu_capacity - get the relative performance of a cpu
+ * @cpu_id: the target cpu
+ *
+ * The capacity is scaled to WAYCA_SC_CPU_CAPACITY_SCALE for the most
+ * performant cpus, a little cpu of a big.LITTLE system has a smaller one.
+ * All cpus have WAYCA_SC_CPU_CAPACITY_SCALE if the kernel doesn't report
+ * the capacity.
+ *
+ * Return the capacity on success, or a negative error number.
+ */
+int wayca_sc_get_cpu_capacity(int cpu_id);
+
+/**
+ * struct wayca_sc_cpu_ids - the topology structure IDs of a cpu
+ * @cpu: the cpu ID
+ * @core_id: the core which the cpu belongs to
+ * @ccl_id: the cluster which the cpu belongs to
+ * @node_id: the NUMA node which the cpu belongs to
+ * @package_id: the package which the cpu belongs to
+ * @l2_id: the group of cpus sharing the L2 cache with the cpu
+ * @l3_id: the group of cpus sharing the L3 cache with the cpu
+ *
+ * Each ID is the same as the one returned by the wayca_sc_get_*_id()
+ * family, a negative error number if there's none. The IDs of an offline
+ * cpu are -ENOENT except @node_id.
+ */
+struct wayca_sc_cpu_ids {
+	int cpu;
+	int core_id;
+	int ccl_id;
+	int node_id;
+	int package_id;
+	int l2_id;
+	int l3_id;
+};
+
+/**
+ * wayca_sc_get_cpu_ids - retrieve the topology structure IDs of a cpuset
+ * @cpusetsize: size of @cpuset
+ * @cpuset: the cpus to look up
+ * @ids: the array to receive the IDs, in ascending order of the cpus
+ * @num: the element number of @ids
+ *
+ * The IDs of all the cpus in @cpuset are filled in one call. It's
+ * intended for the hot paths which would otherwise call the
+ * wayca_sc_get_*_id() family for each cpu.
+ *
+ * Return the number of cpus filled on success, or a negative error
+ * number if @cpuset contains invalid cpus or @ids is too small.
+ */
+int wayca_sc_get_cpu_ids(size_t cpusetsize, const cpu_set_t *cpuset,
+			 struct wayca_sc_cpu_ids *ids, size_t num);
+
 /**
  * The following family of functions retrieve size of specific level
  * cache of a certain cpu.
@@ -339,6 +396,103 @@ int wayca_sc_get_l1i_size(int cpu_id);
 int wayca_sc_get_l2_size(int cpu_id);
 int wayca_sc_get_l3_size(int cpu_id);
 
+/**
+ * struct wayca_sc_cache_info - cache domain descriptor
+ * @level: the level of the cache
+ * @size: the size of the cache in KiB
+ * @line_size: the size of a cache line in bytes
+ * @ways: the ways of associativity
+ * @sets: the number of sets
+ * @n_cpus: the number of online cpus sharing the cache
+ */
+struct wayca_sc_cache_info {
+	int level;
+	unsigned int size;
+	unsigned int line_size;
+	unsigned int ways;
+	unsigned int sets;
+	unsigned int n_cpus;
+};
+
+/**
+ * The following family of functions treat the groups of cpus sharing a
+ * data or unified cache as domains. Only the level 2 and level 3 caches
+ * are supported. The domains of a level are numbered from 0, in the order
+ * of their first cpu.
+ *
+ * wayca_sc_cache_domains_in_total - get the number of domains at @level
+ * Return the number on success, or a negative error number.
+ */
+int wayca_sc_cache_domains_in_total(int level);
+
+/**
+ * wayca_sc_get_cache_domain_id - get the cache domain of a cpu
+ * @cpu_id: the target cpu
+ * @level: the level of the cache
+ *
+ * Return the domain ID on success, or a negative error number.
+ */
+int wayca_sc_get_cache_domain_id(int cpu_id, int level);
+
+/**
+ * wayca_sc_cache_domain_cpu_mask - retrieve the online cpus of a cache domain
+ * @level: the level of the cache
+ * @domain_id: the target domain ID
+ * @cpusetsize: size of @mask
+ * @mask: the cpu mask to receive the result
+ *
+ * Return 0 on success and a negative error number on failure.
+ */
+int wayca_sc_cache_domain_cpu_mask(int level, int domain_id,
+				   size_t cpusetsize, cpu_set_t *mask);
+
+/**
+ * wayca_sc_get_cache_domain_info - get the geometry of a cache domain
+ * @level: the level of the cache
+ * @domain_id: the target domain ID
+ * @cache_info: the returned information of the cache
+ *
+ * Return 0 on success, otherwise a negative error number.
+ */
+int wayca_sc_get_cache_domain_info(int level, int domain_id,
+				   struct wayca_sc_cache_info *cache_info);
+
+/* The levels of the domains of cpus */
+enum wayca_sc_topo_level {
+	WAYCA_SC_TOPO_LEVEL_CORE,
+	WAYCA_SC_TOPO_LEVEL_CCL,
+	WAYCA_SC_TOPO_LEVEL_NODE,
+	WAYCA_SC_TOPO_LEVEL_PACKAGE,
+	WAYCA_SC_TOPO_LEVEL_L2,
+	WAYCA_SC_TOPO_LEVEL_L3,
+	WAYCA_SC_TOPO_LEVEL_LLC,	/* the L3 domains, or L2 without L3 */
+	WAYCA_SC_TOPO_LEVEL_MAX,
+};
+
+/**
+ * wayca_sc_topo_domain_masks - retrieve the cpu masks of all the domains
+ * of a level
+ * @level: the level of the domains
+ * @cpusetsize: size of each mask in @masks
+ * @masks: the array of the masks to receive the result, each of
+ *	   @cpusetsize bytes, NULL to get the number of the domains
+ * @num: the element number of @masks
+ * @generation: if not NULL, receives the generation of the topology which
+ *		the masks are taken from
+ *
+ * The mask of domain i is the same as the one returned by the per-domain
+ * getter of @level, e.g. wayca_sc_ccl_cpu_mask() or
+ * wayca_sc_cache_domain_cpu_mask(), and all of them come from one
+ * version of the topology, which a series of per-domain calls can't
+ * guarantee across the CPU hotplug.
+ *
+ * Return the number of the domains on success, or a negative error number
+ * if @level is invalid or @masks is too small.
+ */
+int wayca_sc_topo_domain_masks(enum wayca_sc_topo_level level,
+			       size_t cpusetsize, cpu_set_t *masks, size_t num,
+			       unsigned long *generation);
+
 /**
  * wayca_sc_get_node_mem_size - get the memory size on a certain NUMA node
  * @node: node ID
@@ -348,6 +502,214 @@ int wayca_sc_get_l3_size(int cpu_id);
  */
 int wayca_sc_get_node_mem_size(int node_id, unsigned long *size);
 
+/**
+ * struct wayca_sc_node_mem_stat - memory usage of a NUMA node
+ * @total: the total memory in kB
+ * @free: the free memory in kB
+ * @file: the memory of the page cache in kB
+ * @anon: the anonymous memory in kB
+ * @shmem: the shared memory and tmpfs in kB
+ * @dirty: the memory waiting to be written back in kB
+ * @writeback: the memory being written back in kB
+ * @slab_reclaimable: the reclaimable slab memory in kB
+ * @huge_total: the number of the default sized huge pages
+ * @huge_free: the number of the free default sized huge pages
+ */
+struct wayca_sc_node_mem_stat {
+	unsigned long total;
+	unsigned long free;
+	unsigned long file;
+	unsigned long anon;
+	unsigned long shmem;
+	unsigned long dirty;
+	unsigned long writeback;
+	unsigned long slab_reclaimable;
+	unsigned long huge_total;
+	unsigned long huge_free;
+};
+
+/**
+ * wayca_sc_get_node_mem_stat - get the current memory usage of a NUMA node
+ * @node_id: node ID
+ * @max_age_ms: the maximum age in milliseconds of the values to accept
+ * @stat: the returned memory usage
+ *
+ * The values are read from the kernel if @max_age_ms is 0. Otherwise the
+ * values read by any thread within the last @max_age_ms are returned
+ * without a syscall, and they're only read again once they're older,
+ * which bounds the cost of calling it in the hot paths.
+ *
+ * Return 0 on success, or a negative error number on failure.
+ */
+int wayca_sc_get_node_mem_stat(int node_id, unsigned int max_age_ms,
+			       struct wayca_sc_node_mem_stat *stat);
+
+/**
+ * wayca_sc_node_distance - get the distance between two NUMA nodes
+ * @node_a: node ID
+ * @node_b: node ID
+ *
+ * The distance is the one reported by the firmware (SLIT), 10 for the
+ * local node and larger for the farther ones.
+ *
+ * Return the distance on success, or a negative error number on failure.
+ */
+int wayca_sc_node_distance(int node_a, int node_b);
+
+/**
+ * wayca_sc_node_distance_matrix - get the distances between all NUMA nodes
+ * @num: the number of the nodes
+ * @matrix: the array to receive the @num * @num distances
+ *
+ * The distance from node a to node b is returned in @matrix[a * @num + b].
+ * The caller can get @num first by passing NULL to @matrix, and then get
+ * the whole matrix by passing both @num and @matrix.
+ *
+ * Return 0 on success, otherwise a negative error number.
+ */
+int wayca_sc_node_distance_matrix(size_t *num, int *matrix);
+
+/**
+ * wayca_sc_nearest_nodes - get the NUMA nodes ordered by distance
+ * @node_id: the node to measure the distance from
+ * @num: the element number of @nodes
+ * @nodes: the array to receive the node IDs
+ *
+ * The nodes are returned in ascending distance from @node_id, @node_id
+ * itself first and the nodes at the same distance in the order of their
+ * IDs. Only the @num nearest nodes are returned if @num is less than the
+ * number of the nodes, e.g. to build a fallback chain of a given length.
+ *
+ * Return the number of the node IDs returned, or a negative error number.
+ */
+int wayca_sc_nearest_nodes(int node_id, size_t num, int *nodes);
+
+/**
+ * wayca_sc_cpu_nearest_nodes - get the NUMA nodes ordered by distance
+ *				from a cpu
+ * @cpu_id: the cpu whose node to measure the distance from
+ * @num: the element number of @nodes
+ * @nodes: the array to receive the node IDs
+ *
+ * The same as wayca_sc_nearest_nodes() for the node of @cpu_id.
+ *
+ * Return the number of the node IDs returned, or a negative error number.
+ */
+int wayca_sc_cpu_nearest_nodes(int cpu_id, size_t num, int *nodes);
+
+/**
+ * struct wayca_sc_mem_node_info - memory node descriptor
+ * @phys_node: the NUMA node number of the kernel, as mbind() takes it
+ * @node_id: the node ID of the cpus in the same NUMA node, -1 if the
+ *	     memory node has no cpu, e.g. a CXL or HBM node
+ * @initiator: the node ID of the cpus with the best access to the memory
+ * @tier: the memory tier of the node, a lower tier is faster, -1 if unknown
+ * @size: the size of the memory in kB
+ * @read_bandwidth: the read bandwidth from @initiator in MB/s
+ * @write_bandwidth: the write bandwidth from @initiator in MB/s
+ * @read_latency: the read latency from @initiator in nanoseconds
+ * @write_latency: the write latency from @initiator in nanoseconds
+ * @cache_size: the size of the memory-side cache in bytes, 0 if none
+ * @cache_line_size: the line size of the memory-side cache in bytes
+ *
+ * The bandwidth and latency come from the ACPI HMAT, they're 0 if the
+ * firmware doesn't provide them.
+ */
+struct wayca_sc_mem_node_info {
+	int phys_node;
+	int node_id;
+	int initiator;
+	int tier;
+	unsigned long size;
+	unsigned int read_bandwidth;
+	unsigned int write_bandwidth;
+	unsigned int read_latency;
+	unsigned int write_latency;
+	unsigned long long cache_size;
+	unsigned int cache_line_size;
+};
+
+/* The attributes to order the memory nodes by, the best first */
+enum wayca_sc_mem_attr {
+	WAYCA_SC_MEM_READ_BANDWIDTH,
+	WAYCA_SC_MEM_WRITE_BANDWIDTH,
+	WAYCA_SC_MEM_READ_LATENCY,
+	WAYCA_SC_MEM_WRITE_LATENCY,
+	WAYCA_SC_MEM_TIER,
+};
+
+/**
+ * The following family of functions describe the NUMA nodes with memory,
+ * including the ones without cpu. The memory nodes are numbered from 0,
+ * in the order of their NUMA node numbers.
+ *
+ * wayca_sc_mem_nodes_in_total - get the number of the memory nodes
+ * Return the number on success, or a negative error number.
+ */
+int wayca_sc_mem_nodes_in_total(void);
+
+/**
+ * wayca_sc_get_mem_node_info - get the attributes of a memory node
+ * @mem_node: the target memory node ID
+ * @info: the returned information of the memory node
+ *
+ * Return 0 on success, otherwise a negative error number.
+ */
+int wayca_sc_get_mem_node_info(int mem_node,
+			       struct wayca_sc_mem_node_info *info);
+
+/**
+ * wayca_sc_mem_node_distance - get the distance from the cpus of a node
+ *				to a memory node
+ * @node_id: node ID of the cpus
+ * @mem_node: the memory node ID
+ *
+ * Return the distance on success, or a negative error number on failure.
+ */
+int wayca_sc_mem_node_distance(int node_id, int mem_node);
+
+/**
+ * wayca_sc_get_mem_node_stat - get the current memory usage of a memory node
+ * @mem_node: the memory node ID
+ * @max_age_ms: the maximum age in milliseconds of the values to accept
+ * @stat: the returned memory usage
+ *
+ * The same as wayca_sc_get_node_mem_stat() for the memory nodes, which
+ * also covers the nodes without cpu.
+ *
+ * Return 0 on success, or a negative error number on failure.
+ */
+int wayca_sc_get_mem_node_stat(int mem_node, unsigned int max_age_ms,
+			       struct wayca_sc_node_mem_stat *stat);
+
+/**
+ * wayca_sc_mem_nodes_by_attr - get the memory nodes ordered by an attribute
+ * @attr: the attribute in enum wayca_sc_mem_attr to order by
+ * @num: the element number of @mem_nodes
+ * @mem_nodes: the array to receive the memory node IDs
+ *
+ * The memory nodes are returned best first, i.e. the highest bandwidth,
+ * the lowest latency or the lowest tier. The nodes whose @attr is unknown
+ * come last and the nodes of the same @attr keep the order of their IDs.
+ * Only the @num best nodes are returned if @num is less than the number
+ * of the memory nodes, e.g. to pick the node for the hot data.
+ *
+ * Return the number of the memory node IDs returned, or a negative error
+ * number.
+ */
+int wayca_sc_mem_nodes_by_attr(int attr, size_t num, int *mem_nodes);
+
+/**
+ * wayca_sc_topo_generation - get the generation of the topology
+ *
+ * The generation is increased each time the topology changes, e.g. a CPU
+ * goes online or offline. The callers can cache what they derive from the
+ * topology, like the CPU masks, and refresh it when the generation changes.
+ *
+ * Return the generation of the current topology.
+ */
+unsigned long wayca_sc_topo_generation(void);
+
 /* The type of the interrupt */
 enum wayca_sc_irq_type {
 	WAYCA_SC_TOPO_TYPE_INVAL,
@@ -427,6 +789,12 @@ enum wayca_sc_device_type {
  * @class: the class ID of PCI/PCIe device
  * @irq_numbers: the IRQ number array of the device
  * @nb_irq: the number of the IRQs in the IRQ number array
+ * @parent: the name of the upstream bridge of PCI/PCIe device, e.g. the
+ *	    root port or the switch port, NULL if it's below the host bridge
+ * @root: the host bridge (root complex) of PCI/PCIe device, e.g. pci0000:00
+ * @depth: the number of the bridges between the device and @root
+ * @link_speed: the current link speed of PCIe device in MT/s, 0 if unknown
+ * @link_width: the current link width of PCIe device, 0 if unknown
  */
 struct wayca_sc_device_info {
 	const char *name; /* name which used to find the device in wayca_sc */
@@ -444,6 +812,11 @@ struct wayca_sc_device_info {
 			uint32_t class;
 			const uint32_t *irq_numbers;
 			int nb_irq;
+			const char *parent;
+			const char *root;
+			int depth;
+			int link_speed;
+			int link_width;
 		};
 	};
 };
@@ -486,6 +859,113 @@ int wayca_sc_get_device_list(int numa_node, size_t *num, const char **name);
  */
 int wayca_sc_get_device_info(const char *name, struct wayca_sc_device_info *dev_info);
 
+/**
+ * wayca_sc_get_device_info_list - get the detailed information of all the
+ *                                 devices on certain NUMA node or in the system
+ * @numa_node: the ID of the NUMA node to query. if node id < 0, then
+ *             return all the devices in system
+ * @num: the number of the devices
+ * @dev_info: the array of the information of the devices
+ *
+ * The same as calling wayca_sc_get_device_info() on each device returned
+ * by wayca_sc_get_device_list(), in the same order, including the IRQs of
+ * the PCI devices. The caller should make sure @dev_info can hold all the
+ * devices on the node, which can be got by calling this function with a
+ * NULL @dev_info first.
+ *
+ * Return 0 on success, or a negative error number on failure.
+ */
+int wayca_sc_get_device_info_list(int numa_node, size_t *num,
+				  struct wayca_sc_device_info *dev_info);
+
+/* skip the CPUs which the wayca threads are placed on */
+#define WAYCA_SC_NEAR_EXCLUDE_LOADED	0x1
+
+/**
+ * wayca_sc_device_near_cpus - get the CPUs nearest to a device
+ * @name: the name of the device
+ * @n: the number of the CPUs wanted
+ * @flags: WAYCA_SC_NEAR_* flags
+ * @cpusetsize: the size of @mask
+ * @mask: the cpumask to receive the CPUs
+ *
+ * The online CPUs are ranked by their locality to the device @name: first
+ * the CPUs in the clusters handling more of the IRQs of the device, then
+ * the CPUs in the NUMA node or the local CPUs of the device, then the
+ * CPUs in the same package, and the rest by their NUMA distance to the
+ * device. The @n best ranked ones are returned in @mask, e.g. to place
+ * the polling threads of a NIC or an NVMe device.
+ *
+ * Return the number of the CPUs in @mask, which is less than @n if there
+ * are not enough CPUs, or a negative error number on failure.
+ */
+int wayca_sc_device_near_cpus(const char *name, size_t n, unsigned int flags,
+			      size_t cpusetsize, cpu_set_t *mask);
+
+typedef int (*wayca_sc_pci_walk_fn)(const struct wayca_sc_device_info *dev_info,
+				    void *data);
+
+/**
+ * wayca_sc_pci_walk - walk the PCI hierarchy
+ * @name: the PCI device to walk from, NULL to walk all the host bridges
+ * @fn: the function called on each device
+ * @data: the data passed to @fn
+ *
+ * Call @fn on the PCI device @name and all the devices below it, depth
+ * first, so a bridge is visited before the devices below it, and the
+ * devices below one bridge in the order of their addresses. The devices
+ * sharing the bandwidth of a root port are the subtree of the port, and
+ * the @parent and @depth of @dev_info tell where a device is in the tree.
+ * The walk stops if @fn returns non-zero.
+ *
+ * Return 0 on success, the non-zero return of @fn, or a negative error
+ * number on failure.
+ */
+int wayca_sc_pci_walk(const char *name, wayca_sc_pci_walk_fn fn, void *data);
+
+/* events of the topology notifiers */
+#define WAYCA_SC_TOPO_EV_CPU_ONLINE	0x1	/* a CPU goes online */
+#define WAYCA_SC_TOPO_EV_CPU_OFFLINE	0x2	/* a CPU goes offline */
+#define WAYCA_SC_TOPO_EV_MEM_ONLINE	0x4	/* memory of a node goes online */
+#define WAYCA_SC_TOPO_EV_MEM_OFFLINE	0x8	/* memory of a node goes offline */
+#define WAYCA_SC_TOPO_EV_ALL		0xf
+
+/*
+ * @event: one WAYCA_SC_TOPO_EV_* event
+ * @id: the CPU of a CPU event, or the NUMA node of a memory event
+ * @data: the data passed to wayca_sc_topo_register_notifier()
+ */
+typedef void (*wayca_sc_topo_notifier_t)(unsigned int event, int id,
+					 void *data);
+
+/**
+ * wayca_sc_topo_register_notifier - get notified of the topology changes
+ * @cb: the function called on each event
+ * @events: the mask of WAYCA_SC_TOPO_EV_* events wanted
+ * @data: the data passed to @cb
+ *
+ * @cb is called from a thread of the library once the change is visible
+ * to the queries, one event at a time and in order. A change found by a
+ * query, e.g. when the uevents can't be received, is notified after that
+ * query. @cb may register or unregister notifiers, but shouldn't block.
+ *
+ * Return 0 on success, or a negative error number on failure.
+ */
+int wayca_sc_topo_register_notifier(wayca_sc_topo_notifier_t cb,
+				    unsigned int events, void *data);
+
+/**
+ * wayca_sc_topo_unregister_notifier - stop getting notified
+ * @cb: the function registered
+ * @data: the data registered along with @cb
+ *
+ * Once it returns @cb won't be called any more, unless it's called from
+ * @cb itself, which then returns first.
+ *
+ * Return 0 on success, or -ENOENT if there's no such notifier.
+ */
+int wayca_sc_topo_unregister_notifier(wayca_sc_topo_notifier_t cb, void *data);
+
 int wayca_managed_thread_create(int id, pthread_t *thread, const pthread_attr_t *attr,
 				void *(*start_routine) (void *), void *arg);
 
@@ -495,6 +975,11 @@ int wayca_managed_threadpool_create(int id, int num, pthread_t *thread[],
 /*
  * The identifier of wayca scheduler thread
  *
+ * An identifier is an opaque 64-bit handle. Its high 32 bits hold a
+ * generation, so the identifier of a destroyed thread never finds the
+ * thread created after it. It's not an index, callers using it to index
+ * an array will break, keep the identifiers in a map instead.
+ *
  * The maximum wayca scheduler threads user can created simultaneously
  * is default to 32765. It can be modified by passing the desired
  * upper limits to environment variable WAYCA_SC_THREADS_NUMBER.
@@ -602,6 +1087,10 @@ int wayca_sc_pid_detach_thread(wayca_sc_thread_t wthread);
  *    attribute, or if it has no father it will cover all the
  *    cpus in the system
  *
+ * The identifier is an opaque 64-bit handle with a generation in the high
+ * 32 bits, like wayca_sc_thread_t. It's not an index, callers using it to
+ * index an array will break.
+ *
  * The maximum wayca scheduler groups user can created simultaneously
  * is default to 256. It can be modified by passing the desired
  * upper limits to environment variable WAYCA_SC_GROUPS_NUMBER.
@@ -622,8 +1111,12 @@ typedef unsigned long long	wayca_sc_group_t;
  *            will determine the cpu range assigned to each members from
  *            the father group
  * Bit[16:19]: Group thread's binding style, per-CPU or not
- * Bit[20:32]: Group thread's relationship, whether the member threads bind
+ * Bit[20:23]: Group thread's relationship, whether the member threads bind
  *             as sparsely as possible or not.
+ * Bit[24:31]: How the group follows the topology changes. A top level
+ *             group with WT_GF_REARRANGE only takes the online CPUs, and
+ *             rearranges its members when a CPU of it goes offline or a
+ *             CPU comes online.
  *
  * The binding style and relationship only affects thread members.
  *
@@ -644,15 +1137,24 @@ typedef unsigned long long	wayca_sc_group_t;
  * affinity:     0 - 3        0 - 3       0 - 3        0 - 3         4 - 7   WT_GF_CCL|WT_GF_COMPACT
  * affinity:       0            1           2            3             4     WT_GF_CCL|WT_GF_PERCPU|
  *                                                                           WT_GF_COMPACT
+ *
+ * With 2 SMT siblings in each core, cpu 0/1 in core 0, 2/3 in core 1 and
+ * so on, WT_GF_CORE_FIRST takes a cpu of each core before the siblings:
+ * affinity:       0            2           4            6             8     WT_GF_CPU|WT_GF_PERCPU|
+ *                                                                           WT_GF_COMPACT|
+ *                                                                           WT_GF_CORE_FIRST
  */
 typedef unsigned long long	wayca_sc_group_attr_t;
 #define WT_GF_CPU	0x00000001	/* Each thread/group accepts per-CPU affinity */
+#define WT_GF_CORE	0x00000002	/* Each thread/group accepts per-Core affinity */
 #define WT_GF_CCL	0x00000004	/* Each thread/group accepts per-CCL affinity */
 #define WT_GF_NUMA	0x00000020	/* Each thread/group accepts per-NUMA affinity */
 #define WT_GF_PACKAGE	0x00000040	/* Each thread/group accepts per-Package affinity */
 #define WT_GF_ALL	0x00000400	/* Each thread/group doesn't have an affinity hint */
 #define WT_GF_PERCPU	0x00010000	/* Each thread will bind to the CPU */
 #define WT_GF_COMPACT	0x00100000	/* The threads in this group will be compact */
+#define WT_GF_CORE_FIRST 0x00200000	/* One thread per core before the SMT siblings */
+#define WT_GF_REARRANGE	0x01000000	/* Rearrange the group on CPU hotplug */
 
 /**
  * wayca_sc_group_set_attr - set the attribute of wayca scheduler group
@@ -807,7 +1309,8 @@ int wayca_sc_is_thread_in_group(wayca_sc_thread_t thread, wayca_sc_group_t group
 int wayca_sc_is_group_in_group(wayca_sc_group_t target, wayca_sc_group_t group);
 
 /*
- * The identifier of the wayca scheduler threadpool
+ * The identifier of the wayca scheduler threadpool, an opaque 64-bit
+ * handle like wayca_sc_thread_t rather than an index
  *
  * The maximum wayca scheduler threadpools user can created simultaneously
  * is default to 256. It can be modified by passing the desired
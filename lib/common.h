@@ -71,6 +71,9 @@ extern char *wayca_scheduler_socket_path;
 
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
 
+/* alignment of the hot tables, keeping the CPUs off each other's lines */
+#define WAYCA_SC_CACHELINE_SIZE	(64)
+
 #define WAYCA_SC_PRIO_TOPO 101
 #define WAYCA_SC_PRIO_THREAD 120
 #define WAYCA_SC_PRIO_MANAGED_THREAD 110
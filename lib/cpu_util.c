@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2021 HiSilicon Technologies Co., Ltd.
+ * Wayca scheduler is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ *
+ * See the Mulan PSL v2 for more details.
+ */
+
+/* cpu_util.c - the utilization of the cpus by any task
+ *
+ * The loads of the cpus only count the wayca threads bound to them. So
+ * the busy time of each cpu is sampled from /proc/stat as well. The
+ * utilization decays by half each period, so it follows the recent
+ * busy time. A fully busy cpu weighs as much as a wayca thread bound to
+ * it, which makes the new threads avoid the cpus busy with the other
+ * processes too.
+ *
+ * The busy time counts the running wayca threads as well, so a cpu is
+ * placed by the larger of its load and its utilization rather than by
+ * the sum, see wayca_cpu_busy_load(). A cpu with a busy wayca thread
+ * then weighs as one thread rather than two, and a cpu with an idle one
+ * still weighs as the thread which may wake up on it.
+ *
+ * There is no sampling thread. The sample is taken on the path attaching
+ * a thread to a group, wayca_group_assign_thread_resource() in group.c,
+ * at most once a period and skipped while another thread samples. So
+ * the utilization is as old as the last placement.
+ *
+ * The period is WAYCA_SC_UTIL_PERIOD_MS, 0 disables the sampling. It's
+ * disabled as well if /proc/stat can't be read.
+ */
+
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "topo.h"
+#include "wayca_thread.h"
+
+#define WAYCA_UTIL_PERIOD_MS	100
+/* Decaying further than this leaves nothing of the old utilization */
+#define WAYCA_UTIL_MAX_DECAY	16
+
+struct cpu_util_stat {
+	unsigned long long busy;
+	unsigned long long total;
+	long long util;			/* decayed, in WAYCA_SC_CPU_CAPACITY_SCALE */
+	bool sampled;			/* whether @busy and @total are set */
+};
+
+static struct cpu_util_stat *cpu_util_stats;
+static pthread_mutex_t cpu_util_mutex = PTHREAD_MUTEX_INITIALIZER;
+static long long cpu_util_period;	/* in ns, 0 if disabled */
+static long long cpu_util_last;		/* when last sampled, in ns */
+
+static long long cpu_util_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Fold the busy time of @cpu into its utilization, @decay periods later */
+static void cpu_util_account(int cpu, unsigned long long busy,
+			     unsigned long long total, int decay)
+{
+	struct cpu_util_stat *stat = &cpu_util_stats[cpu];
+	long long util, load;
+
+	if (stat->sampled && total > stat->total && busy >= stat->busy) {
+		util = (busy - stat->busy) * WAYCA_SC_CPU_CAPACITY_SCALE /
+		       (total - stat->total);
+		stat->util = util + (stat->util - util) / (1LL << decay);
+
+		/* as the load of a wayca thread bound to @cpu */
+		load = stat->util * wayca_sc_cpus_in_total() /
+		       WAYCA_SC_CPU_CAPACITY_SCALE;
+		wayca_cpu_util_set(cpu, load);
+	}
+
+	stat->busy = busy;
+	stat->total = total;
+	stat->sampled = true;
+}
+
+static int cpu_util_sample(int decay)
+{
+	unsigned long long user, nice, system, idle, iowait, irq, softirq;
+	unsigned long long steal, busy;
+	char path[PATH_MAX];
+	char line[256];
+	FILE *fp;
+	int cpu;
+
+	snprintf(path, sizeof(path), "%s/stat", topo_fs_procfs_root());
+	fp = fopen(path, "r");
+	if (!fp)
+		return -errno;
+
+	/* the offline cpus are not listed, their utilization is kept */
+	while (fgets(line, sizeof(line), fp)) {
+		/* not the line of all the cpus */
+		if (strncmp(line, "cpu", 3) || !isdigit(line[3]))
+			continue;
+
+		steal = 0;
+		if (sscanf(line, "cpu%d %llu %llu %llu %llu %llu %llu %llu %llu",
+			   &cpu, &user, &nice, &system, &idle, &iowait, &irq,
+			   &softirq, &steal) < 8)
+			continue;
+		if (cpu < 0 || cpu >= nr_cpumask_bits)
+			continue;
+
+		/* the guest time is counted in the user time already */
+		busy = user + nice + system + irq + softirq + steal;
+		cpu_util_account(cpu, busy, busy + idle + iowait, decay);
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+/*
+ * wayca_cpu_util_update - sample the utilization of the cpus if a period
+ * has passed. It's skipped if another thread is sampling, the loads of
+ * the last sample are good enough.
+ */
+void wayca_cpu_util_update(void)
+{
+	long long now, elapsed;
+
+	if (!__atomic_load_n(&cpu_util_period, __ATOMIC_RELAXED))
+		return;
+
+	now = cpu_util_now();
+	if (now - __atomic_load_n(&cpu_util_last, __ATOMIC_RELAXED) <
+	    cpu_util_period)
+		return;
+
+	if (pthread_mutex_trylock(&cpu_util_mutex))
+		return;
+
+	elapsed = now - cpu_util_last;
+	if (cpu_util_period && elapsed >= cpu_util_period) {
+		if (cpu_util_sample(min(elapsed / cpu_util_period,
+					WAYCA_UTIL_MAX_DECAY)))
+			__atomic_store_n(&cpu_util_period, 0, __ATOMIC_RELAXED);
+		__atomic_store_n(&cpu_util_last, now, __ATOMIC_RELAXED);
+	}
+
+	pthread_mutex_unlock(&cpu_util_mutex);
+}
+
+/* Take the first sample, which the utilization is measured from */
+void wayca_cpu_util_init(void)
+{
+	char *p = secure_getenv("WAYCA_SC_UTIL_PERIOD_MS");
+	long long period = WAYCA_UTIL_PERIOD_MS;
+
+	if (p) {
+		errno = 0;
+		period = strtoll(p, NULL, 0);
+		if (errno || period < 0)
+			period = WAYCA_UTIL_PERIOD_MS;
+	}
+	if (!period)
+		return;
+
+	cpu_util_stats = calloc(nr_cpumask_bits, sizeof(*cpu_util_stats));
+	if (!cpu_util_stats)
+		return;
+
+	if (cpu_util_sample(0)) {
+		free(cpu_util_stats);
+		cpu_util_stats = NULL;
+		return;
+	}
+
+	cpu_util_last = cpu_util_now();
+	cpu_util_period = period * 1000000;
+}
+
+void wayca_cpu_util_exit(void)
+{
+	pthread_mutex_lock(&cpu_util_mutex);
+	__atomic_store_n(&cpu_util_period, 0, __ATOMIC_RELAXED);
+	free(cpu_util_stats);
+	cpu_util_stats = NULL;
+	pthread_mutex_unlock(&cpu_util_mutex);
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2021 HiSilicon Technologies Co., Ltd.
+ * Wayca scheduler is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ *
+ * See the Mulan PSL v2 for more details.
+ */
+
+/*
+ * Dynamically sized CPU masks for the thread and group internals.
+ *
+ * A cpumask is a cpu_set_t of cpumask_size() bytes rather than of the
+ * fixed CPU_SETSIZE bits, so it can be passed to the sched_*affinity()
+ * syscalls and the topology getters directly. All the operations work
+ * on the words of the mask.
+ */
+#ifndef LIB_CPUMASK_H
+#define LIB_CPUMASK_H
+
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitops.h"
+
+/* Number of CPUs the masks can hold, the possible CPUs of the system */
+extern unsigned int nr_cpumask_bits;
+
+#define BITS_TO_LONGS(nr)	(((nr) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+
+#define cpumask_longs()		BITS_TO_LONGS(nr_cpumask_bits)
+#define cpumask_size()		(cpumask_longs() * sizeof(unsigned long))
+#define cpumask_bits(maskp)	((unsigned long *)(maskp))
+
+/*
+ * Declare a temporary cpumask @name on the stack, it's no more than a
+ * few hundred bytes even on the largest systems.
+ */
+#define DECLARE_CPUMASK(name)						\
+	unsigned long name##_bits[cpumask_longs()];			\
+	cpu_set_t *name = (cpu_set_t *)name##_bits
+
+#define for_each_cpu(cpu, maskp)					\
+	for ((cpu) = cpumask_first(maskp); (cpu) >= 0;			\
+	     (cpu) = cpumask_next(maskp, cpu))
+
+static inline cpu_set_t *cpumask_alloc(void)
+{
+	return calloc(cpumask_longs(), sizeof(unsigned long));
+}
+
+static inline void cpumask_free(cpu_set_t *maskp)
+{
+	free(maskp);
+}
+
+static inline void cpumask_zero(cpu_set_t *maskp)
+{
+	memset(maskp, 0, cpumask_size());
+}
+
+/* Set all the CPUs up to nr_cpumask_bits, the tail bits are kept clear */
+static inline void cpumask_fill(cpu_set_t *maskp)
+{
+	unsigned long *bits = cpumask_bits(maskp);
+	unsigned int tail = nr_cpumask_bits % BITS_PER_LONG;
+
+	memset(bits, 0xff, cpumask_size());
+	if (tail)
+		bits[cpumask_longs() - 1] = GENMASK(tail - 1, 0);
+}
+
+static inline void cpumask_copy(cpu_set_t *dstp, const cpu_set_t *srcp)
+{
+	memcpy(dstp, srcp, cpumask_size());
+}
+
+static inline void cpumask_and(cpu_set_t *dstp, const cpu_set_t *src1p,
+			       const cpu_set_t *src2p)
+{
+	const unsigned long *s1 = cpumask_bits(src1p);
+	const unsigned long *s2 = cpumask_bits(src2p);
+	unsigned long *d = cpumask_bits(dstp);
+
+	for (size_t i = 0; i < cpumask_longs(); i++)
+		d[i] = s1[i] & s2[i];
+}
+
+static inline void cpumask_or(cpu_set_t *dstp, const cpu_set_t *src1p,
+			      const cpu_set_t *src2p)
+{
+	const unsigned long *s1 = cpumask_bits(src1p);
+	const unsigned long *s2 = cpumask_bits(src2p);
+	unsigned long *d = cpumask_bits(dstp);
+
+	for (size_t i = 0; i < cpumask_longs(); i++)
+		d[i] = s1[i] | s2[i];
+}
+
+static inline void cpumask_xor(cpu_set_t *dstp, const cpu_set_t *src1p,
+			       const cpu_set_t *src2p)
+{
+	const unsigned long *s1 = cpumask_bits(src1p);
+	const unsigned long *s2 = cpumask_bits(src2p);
+	unsigned long *d = cpumask_bits(dstp);
+
+	for (size_t i = 0; i < cpumask_longs(); i++)
+		d[i] = s1[i] ^ s2[i];
+}
+
+/* @dstp = @src1p & ~@src2p */
+static inline void cpumask_andnot(cpu_set_t *dstp, const cpu_set_t *src1p,
+				  const cpu_set_t *src2p)
+{
+	const unsigned long *s1 = cpumask_bits(src1p);
+	const unsigned long *s2 = cpumask_bits(src2p);
+	unsigned long *d = cpumask_bits(dstp);
+
+	for (size_t i = 0; i < cpumask_longs(); i++)
+		d[i] = s1[i] & ~s2[i];
+}
+
+static inline bool cpumask_equal(const cpu_set_t *src1p,
+				 const cpu_set_t *src2p)
+{
+	return !memcmp(src1p, src2p, cpumask_size());
+}
+
+static inline bool cpumask_intersects(const cpu_set_t *src1p,
+				      const cpu_set_t *src2p)
+{
+	const unsigned long *s1 = cpumask_bits(src1p);
+	const unsigned long *s2 = cpumask_bits(src2p);
+
+	for (size_t i = 0; i < cpumask_longs(); i++)
+		if (s1[i] & s2[i])
+			return true;
+	return false;
+}
+
+static inline bool cpumask_empty(const cpu_set_t *maskp)
+{
+	return find_first_bit(cpumask_bits(maskp), nr_cpumask_bits) ==
+	       nr_cpumask_bits;
+}
+
+static inline int cpumask_weight(const cpu_set_t *maskp)
+{
+	const unsigned long *bits = cpumask_bits(maskp);
+	int weight = 0;
+
+	for (size_t i = 0; i < cpumask_longs(); i++)
+		weight += __builtin_popcountl(bits[i]);
+
+	return weight;
+}
+
+static inline bool cpumask_test_cpu(int cpu, const cpu_set_t *maskp)
+{
+	if ((unsigned int)cpu >= nr_cpumask_bits)
+		return false;
+
+	return cpumask_bits(maskp)[cpu / BITS_PER_LONG] &
+	       (1UL << (cpu % BITS_PER_LONG));
+}
+
+static inline void cpumask_set_cpu(int cpu, cpu_set_t *maskp)
+{
+	if ((unsigned int)cpu < nr_cpumask_bits)
+		cpumask_bits(maskp)[cpu / BITS_PER_LONG] |=
+			1UL << (cpu % BITS_PER_LONG);
+}
+
+static inline void cpumask_clear_cpu(int cpu, cpu_set_t *maskp)
+{
+	if ((unsigned int)cpu < nr_cpumask_bits)
+		cpumask_bits(maskp)[cpu / BITS_PER_LONG] &=
+			~(1UL << (cpu % BITS_PER_LONG));
+}
+
+/* Return the first CPU in @maskp, or -1 if it's empty */
+static inline int cpumask_first(const cpu_set_t *maskp)
+{
+	unsigned long pos;
+
+	pos = find_first_bit(cpumask_bits(maskp), nr_cpumask_bits);
+
+	return pos == nr_cpumask_bits ? -1 : (int)pos;
+}
+
+/* Return the next CPU after @cpu in @maskp, or -1 if none */
+static inline int cpumask_next(const cpu_set_t *maskp, int cpu)
+{
+	unsigned long pos;
+
+	pos = find_next_bit(cpumask_bits(maskp), nr_cpumask_bits, cpu + 1);
+
+	return pos == nr_cpumask_bits ? -1 : (int)pos;
+}
+
+/* Return the last CPU in @maskp, or -1 if it's empty */
+static inline int cpumask_last(const cpu_set_t *maskp)
+{
+	unsigned long pos;
+
+	pos = find_last_bit(cpumask_bits(maskp), nr_cpumask_bits);
+
+	return pos == nr_cpumask_bits ? -1 : (int)pos;
+}
+
+#endif	/* LIB_CPUMASK_H */
@@ -23,11 +23,9 @@
 
 void wayca_thread_update_load(struct wayca_thread *thread, bool add)
 {
-	int cnt, pos;
+	int cnt;
 	long long load;
 
-	pthread_mutex_lock(&wayca_cpu_loads_mutex);
-
 	/*
 	 * Load is updated when the thread is created, destroyed or the
 	 * affinity is changed. It can be zero when the thread creation
@@ -36,44 +34,117 @@ void wayca_thread_update_load(struct wayca_thread *thread, bool add)
 	 * updating the load. Sanity check the count to avoid zero
 	 * division.
 	 */
-	cnt = CPU_COUNT(&thread->cur_set);
+	cnt = cpumask_weight(thread->cur_set);
 	if (!cnt)
-		goto out;
+		return;
 
 	load = div_round_up(wayca_sc_cpus_in_total(), cnt);
 
 	if (!add)
 		load = -load;
 
-	pos = cpuset_find_first_set(&thread->cur_set);
-	while (pos >= 0) {
-		wayca_cpu_loads[pos] += load;
-		pos = cpuset_find_next_set(&thread->cur_set, pos);
+	wayca_cpu_load_add(thread->cur_set, load);
+}
+
+/* Whether any wayca thread may run on @cpu */
+bool wayca_cpu_is_loaded(int cpu)
+{
+	if (!wayca_cpu_loads || cpu < 0 || cpu >= wayca_sc_cpus_in_total())
+		return false;
+
+	return wayca_cpu_load(cpu) > 0;
+}
+
+/* The capacity of @cpu, the kernel may not know it for the offline cpus */
+long long wayca_cpu_capacity(int cpu)
+{
+	int capacity = wayca_sc_get_cpu_capacity(cpu);
+
+	return capacity > 0 ? capacity : WAYCA_SC_CPU_CAPACITY_SCALE;
+}
+
+/**
+ * Get the CPUs in the same topology set of the group as @cpu. The sets
+ * are not always equal sized or contiguously numbered, so always get
+ * them from the topology rather than computing from the @cpu.
+ */
+static void group_topo_set(struct wayca_sc_group *group, int cpu,
+			   cpu_set_t *cpuset)
+{
+	int ret;
+
+	switch (group->attribute & 0xffff) {
+	case WT_GF_CORE:
+		ret = wayca_sc_core_cpu_mask(wayca_sc_get_core_id(cpu),
+					     cpumask_size(), cpuset);
+		break;
+	case WT_GF_CCL:
+		ret = wayca_sc_ccl_cpu_mask(wayca_sc_get_ccl_id(cpu),
+					    cpumask_size(), cpuset);
+		break;
+	case WT_GF_NUMA:
+		ret = wayca_sc_node_cpu_mask(wayca_sc_get_node_id(cpu),
+					     cpumask_size(), cpuset);
+		break;
+	case WT_GF_PACKAGE:
+		ret = wayca_sc_package_cpu_mask(wayca_sc_get_package_id(cpu),
+						cpumask_size(), cpuset);
+		break;
+	case WT_GF_ALL:
+		cpumask_copy(cpuset, total_cpu_set);
+		ret = 0;
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	/* Fall back to the CPU itself, as WT_GF_CPU does */
+	if (ret || !cpumask_test_cpu(cpu, cpuset)) {
+		cpumask_zero(cpuset);
+		cpumask_set_cpu(cpu, cpuset);
 	}
+}
 
-out:
-	pthread_mutex_unlock(&wayca_cpu_loads_mutex);
+/* The level of the load tree of the topology sets of the group */
+static int group_load_level(struct wayca_sc_group *group)
+{
+	switch (group->attribute & 0xffff) {
+	case WT_GF_CPU:
+	case WT_GF_CORE:
+		return WAYCA_SC_TOPO_LEVEL_CORE;
+	case WT_GF_CCL:
+		return WAYCA_SC_TOPO_LEVEL_CCL;
+	case WT_GF_NUMA:
+		return WAYCA_SC_TOPO_LEVEL_NODE;
+	case WT_GF_PACKAGE:
+		return WAYCA_SC_TOPO_LEVEL_PACKAGE;
+	default:
+		return -EINVAL;
+	}
 }
 
+/**
+ * Find the CPU with the least load in the @cpuset. The load is scaled
+ * by the capacity of the CPU, so a little CPU is regarded busier than
+ * a big one with the same load.
+ */
 static int find_idlest_core(cpu_set_t *cpuset)
 {
 	int pos, idlest_core;
-	long long load;
+	long long load, tload;
 
-	pthread_mutex_lock(&wayca_cpu_loads_mutex);
-	pos = cpuset_find_first_set(cpuset);
-	idlest_core = pos;
-	load = wayca_cpu_loads[pos];
+	idlest_core = cpumask_first(cpuset);
+	load = LLONG_MAX;
 
-	while (pos <= cpuset_find_last_set(cpuset) && pos >= 0) {
-		if (load > wayca_cpu_loads[pos]) {
-			load = wayca_cpu_loads[pos];
+	for_each_cpu(pos, cpuset) {
+		tload = wayca_cpu_busy_load(pos) * WAYCA_SC_CPU_CAPACITY_SCALE /
+			wayca_cpu_capacity(pos);
+		if (load > tload) {
+			load = tload;
 			idlest_core = pos;
 		}
-
-		pos = cpuset_find_next_set(cpuset, pos);
 	}
-	pthread_mutex_unlock(&wayca_cpu_loads_mutex);
 
 	return idlest_core;
 }
@@ -81,98 +152,133 @@ static int find_idlest_core(cpu_set_t *cpuset)
 /**
  * Find the idlest set in the @cpuset, and return the found set
  * by @cpuset. The @cpuset must not be an empty set.
+ *
+ * The load of a set is the sum of its CPUs' load scaled by the sum of
+ * their capacity, so the sets of different size and CPU types are
+ * comparable. The set is looked up in the load tree if it covers the
+ * @cpuset, otherwise each set of the @cpuset is summed up. A compact
+ * group always sums up the sets, so among the equally loaded sets the
+ * first one is taken, rather than the one the tree spreads to.
  */
 static void find_idlest_set(struct wayca_sc_group *group, cpu_set_t *cpuset)
 {
-	int stride, pos, idlest_pos, i;
-	long long load = INT_MAX, tload;
-
-	stride = group->nr_cpus_per_topo;
-	pos = cpuset_find_first_set(cpuset);
-
-	/* Make sure the @pos is always the start the topology. */
-	pos -= pos % stride;
-	idlest_pos = pos;
-
-	pthread_mutex_lock(&wayca_cpu_loads_mutex);
-	while (pos <= cpuset_find_last_set(cpuset)) {
-		/**
-		 * @cpuset maybe inconsistent. So skip the unavailable
-		 * set of cpus.
-		 */
-		if (!CPU_ISSET(pos, cpuset)) {
-			pos += stride;
+	DECLARE_CPUMASK(visited);
+	DECLARE_CPUMASK(tset);
+	DECLARE_CPUMASK(idlest_set);
+	long long load = LLONG_MAX, tload, capacity;
+	int pos, i;
+
+	if (!(group->attribute & WT_GF_COMPACT) &&
+	    !wayca_load_tree_idlest(group_load_level(group), cpuset, tset)) {
+		cpumask_and(tset, tset, cpuset);
+		/* the idlest CPU is found in the idlest core */
+		if ((group->attribute & 0xffff) == WT_GF_CPU)
+			pos = find_idlest_core(tset);
+		else
+			pos = cpumask_first(tset);
+		group_topo_set(group, pos, cpuset);
+		return;
+	}
+
+	cpumask_zero(visited);
+	cpumask_zero(idlest_set);
+
+	for_each_cpu(pos, cpuset) {
+		/* Each set is accounted once by its first available CPU */
+		if (cpumask_test_cpu(pos, visited))
 			continue;
-		}
+
+		group_topo_set(group, pos, tset);
+		cpumask_or(visited, visited, tset);
 
 		tload = 0;
-		for (i = 0; i < stride; i++)
-			tload += wayca_cpu_loads[pos + i];
+		capacity = 0;
+		for_each_cpu(i, tset) {
+			tload += wayca_cpu_busy_load(i);
+			capacity += wayca_cpu_capacity(i);
+		}
+		tload = tload * WAYCA_SC_CPU_CAPACITY_SCALE / capacity;
 
 		if (tload < load) {
-			idlest_pos = pos;
+			cpumask_copy(idlest_set, tset);
 			load = tload;
 		}
-
-		pos += stride;
 	}
-	pthread_mutex_unlock(&wayca_cpu_loads_mutex);
 
-	CPU_ZERO(cpuset);
-
-	for (i = idlest_pos; i < idlest_pos + stride; i++)
-		CPU_SET(i, cpuset);
+	cpumask_copy(cpuset, idlest_set);
 }
 
 /**
- * Find the first topology set in the @cpuset, which is not set
- * completely. Return the id of the first CPU in the found set.
+ * Find the first topology set in the group, which is partially
+ * available in the @cpuset. Return the id of the first available
+ * CPU in the found set.
  */
 static int find_incomplete_set(struct wayca_sc_group *group, cpu_set_t *cpuset)
 {
-	int stride, pos;
+	DECLARE_CPUMASK(visited);
+	DECLARE_CPUMASK(tset);
+	DECLARE_CPUMASK(avail);
+	int pos;
+
+	/* A single CPU is either available or not */
+	if ((group->attribute & 0xffff) == WT_GF_CPU)
+		return -ENODATA;
 
-	stride = group->nr_cpus_per_topo;
-	pos = cpuset_find_first_set(&group->total);
+	pos = wayca_load_tree_incomplete(group_load_level(group), group->total,
+					 cpuset);
+	if (pos != -ENOENT)
+		return pos;
 
-	while (pos <= cpuset_find_last_set(&group->total)) {
-		cpu_set_t tset;
-		int i;
+	cpumask_zero(visited);
 
-		CPU_ZERO(&tset);
-		for (i = 0; i < stride; i++)
-			CPU_SET(pos + i, &tset);
+	for_each_cpu(pos, group->total) {
+		if (cpumask_test_cpu(pos, visited))
+			continue;
 
-		CPU_AND(&tset, &tset, cpuset);
+		group_topo_set(group, pos, tset);
+		cpumask_or(visited, visited, tset);
+		cpumask_and(tset, tset, group->total);
+		cpumask_and(avail, tset, cpuset);
 
 		/* An empty set is not an incomplete set. */
-		if (CPU_COUNT(&tset) != stride && CPU_COUNT(&tset) != 0)
-			return pos;
-
-		pos += stride;
+		if (!cpumask_empty(avail) && !cpumask_equal(avail, tset))
+			return cpumask_first(avail);
 	}
 
 	/* No incomplete set is found in the @cpuset */
 	return -ENODATA;
 }
 
-bool is_thread_in_group(struct wayca_sc_group *group, struct wayca_thread *thread)
+/**
+ * Leave the CPUs out of the @cpuset whose physical core has a thread of
+ * the group already, unless none would be left. Then the threads take a
+ * CPU of each core before they share the cores with the SMT siblings.
+ */
+static void group_spread_cores(struct wayca_sc_group *group, cpu_set_t *cpuset)
 {
-	struct wayca_thread *member;
+	DECLARE_CPUMASK(spread);
+	DECLARE_CPUMASK(core);
+	int pos;
+
+	cpumask_copy(spread, cpuset);
+	for_each_cpu(pos, group->used) {
+		if (wayca_sc_core_cpu_mask(wayca_sc_get_core_id(pos),
+					   cpumask_size(), core))
+			continue;
+		cpumask_andnot(spread, spread, core);
+	}
+
+	if (!cpumask_empty(spread))
+		cpumask_copy(cpuset, spread);
+}
 
+/* A thread is in the list of the group it belongs to, and only there */
+bool is_thread_in_group(struct wayca_sc_group *group, struct wayca_thread *thread)
+{
 	if (!group || !thread)
 		return false;
 
-	member = group->threads;
-
-	while (member) {
-		if (member == thread)
-			return true;
-
-		member = member->siblings;
-	}
-
-	return false;
+	return thread->group == group;
 }
 
 int max_topo_cpus_in_child_groups(struct wayca_sc_group *group)
@@ -194,107 +300,72 @@ int max_topo_cpus_in_child_groups(struct wayca_sc_group *group)
 
 bool is_group_in_father(struct wayca_sc_group *group, struct wayca_sc_group *father)
 {
-	struct wayca_sc_group *member = father->groups;
-
-	while (member) {
-		if (member == group)
-			return true;
-
-		member = member->siblings;
-	}
+	if (!group || !father)
+		return false;
 
-	return false;
+	return group->father == father;
 }
 
 static void group_thread_add_to_tail(struct wayca_sc_group *group,
 				     struct wayca_thread *thread)
 {
-	struct wayca_thread *tail = group->threads;
-
 	/* The thread to be added must be alone */
-	WAYCA_SC_ASSERT(thread->siblings == NULL);
+	WAYCA_SC_ASSERT(thread->prev == NULL && thread->next == NULL);
 
-	/* No tail thread found, this is an empty group */
-	if (!tail) {
+	thread->prev = group->threads_tail;
+	if (group->threads_tail)
+		group->threads_tail->next = thread;
+	else
 		group->threads = thread;
-		return;
-	}
-
-	while (tail->siblings)
-		tail = tail->siblings;
-
-	tail->siblings = thread;
+	group->threads_tail = thread;
 }
 
 static void group_group_add_to_tail(struct wayca_sc_group *group,
 				    struct wayca_sc_group *father)
 {
-	struct wayca_sc_group *tail = father->groups;
-
 	/* The group to be added must be alone */
-	WAYCA_SC_ASSERT(group->siblings == NULL);
+	WAYCA_SC_ASSERT(group->prev == NULL && group->next == NULL);
 
-	if (!tail) {
+	group->prev = father->groups_tail;
+	if (father->groups_tail)
+		father->groups_tail->next = group;
+	else
 		father->groups = group;
-		return;
-	}
-
-	while (tail->siblings)
-		tail = tail->siblings;
-
-	tail->siblings = group;
+	father->groups_tail = group;
 }
 
 static void group_thread_delete_thread(struct wayca_sc_group *group,
 				       struct wayca_thread *thread)
 {
-	struct wayca_thread *member = group->threads, *next;
-
-	/* If the first element is the target thread. */
-	if (member == thread) {
-		group->threads = thread->siblings;
-		thread->siblings = NULL;
-		return;
-	}
-
-	while (member) {
-		next = member->siblings;
+	if (thread->prev)
+		thread->prev->next = thread->next;
+	else
+		group->threads = thread->next;
 
-		/* Find the target thread */
-		if (next == thread) {
-			next = next->siblings;
-			member->siblings = next;
-			thread->siblings = NULL;
-			break;
-		}
+	if (thread->next)
+		thread->next->prev = thread->prev;
+	else
+		group->threads_tail = thread->prev;
 
-		member = next;
-	}
+	thread->prev = NULL;
+	thread->next = NULL;
 }
 
 static void group_group_delete_group(struct wayca_sc_group *group,
 				     struct wayca_sc_group *father)
 {
-	struct wayca_sc_group *member = father->groups, *next;
-
-	if (member == group) {
-		father->groups = group->siblings;
-		group->siblings = NULL;
-		return;
-	}
-
-	while (member) {
-		next = member->siblings;
+	if (group->prev)
+		group->prev->next = group->next;
+	else
+		father->groups = group->next;
 
-		if (next == group) {
-			next = next->siblings;
-			member->siblings = next;
-			group->siblings = NULL;
-			break;
-		}
+	if (group->next)
+		group->next->prev = group->prev;
+	else
+		father->groups_tail = group->prev;
 
-		member = next;
-	}
+	group->prev = NULL;
+	group->next = NULL;
 }
 
 /**
@@ -311,12 +382,12 @@ static void group_group_delete_group(struct wayca_sc_group *group,
 static void wayca_group_request_resource_from_father(struct wayca_sc_group *group,
 						    cpu_set_t *cpuset)
 {
-	int cnts = CPU_COUNT(cpuset);
+	int cnts = cpumask_weight(cpuset);
 	struct wayca_sc_group *father;
-	cpu_set_t available_set;
+	DECLARE_CPUMASK(available_set);
 
 	WAYCA_SC_ASSERT(group->father != NULL);
-	WAYCA_SC_ASSERT(!CPU_EQUAL(&group->used, &group->total));
+	WAYCA_SC_ASSERT(!cpumask_equal(group->used, group->total));
 
 	father = group->father;
 
@@ -328,19 +399,17 @@ static void wayca_group_request_resource_from_father(struct wayca_sc_group *grou
 	 */
 	cnts = div_round_up(cnts, father->nr_cpus_per_topo);
 
-	CPU_ZERO(cpuset);
+	cpumask_zero(cpuset);
 
-	memset(&available_set, -1, sizeof(cpu_set_t));
-	CPU_XOR(&available_set, &available_set, &father->used);
-	CPU_AND(&available_set, &available_set, &father->total);
+	cpumask_andnot(available_set, father->total, father->used);
 
-	find_idlest_set(father, &available_set);
-	CPU_OR(&father->used, &father->used, &available_set);
-	CPU_OR(cpuset, cpuset, &available_set);
+	find_idlest_set(father, available_set);
+	cpumask_or(father->used, father->used, available_set);
+	cpumask_or(cpuset, cpuset, available_set);
 
-	if (CPU_EQUAL(&father->used, &father->total)) {
+	if (cpumask_equal(father->used, father->total)) {
 		father->roll_over_cnts++;
-		CPU_ZERO(&father->used);
+		cpumask_zero(father->used);
 	}
 }
 
@@ -351,7 +420,8 @@ static void wayca_group_request_resource_from_father(struct wayca_sc_group *grou
  * and set in the group->total member.
  *
  * If the group->father is NULL, which means this is the top level group,
- * then assign all the cpus in the system to the group.
+ * then assign all the cpus in the system to the group, or all the online
+ * ones if the group follows the CPU hotplug.
  *
  * If the group->threads is NULL, which means this is an empty group, then
  * assign the minimum cpus to the group according to the group's attribute.
@@ -359,14 +429,19 @@ static void wayca_group_request_resource_from_father(struct wayca_sc_group *grou
 static int wayca_group_request_resource(struct wayca_sc_group *group)
 {
 	int nr_threads = group->nr_threads ? group->nr_threads : 4;
-	cpu_set_t required_cpuset;
+	DECLARE_CPUMASK(required_cpuset);
 
 	if (group->father == NULL) {
-		memcpy(&group->total, &total_cpu_set, sizeof(cpu_set_t));
+		cpumask_copy(group->total, total_cpu_set);
+		/* Leave the offline CPUs out until they come back */
+		if ((group->attribute & WT_GF_REARRANGE) &&
+		    !wayca_sc_total_online_cpu_mask(cpumask_size(),
+						    required_cpuset))
+			cpumask_and(group->total, group->total, required_cpuset);
 		return 0;
 	}
 
-	CPU_ZERO(&required_cpuset);
+	cpumask_zero(required_cpuset);
 
 	/**
 	 * Setup the required cpuset numbers. No position information
@@ -376,13 +451,13 @@ static int wayca_group_request_resource(struct wayca_sc_group *group)
 	 */
 	for (int pos = 0; pos < nr_threads; pos++) {
 		int cpu = pos * group->stride;
-		CPU_SET(cpu, &required_cpuset);
+		cpumask_set_cpu(cpu, required_cpuset);
 	}
 
 	WAYCA_SC_ASSERT(group->father != NULL);
-	wayca_group_request_resource_from_father(group, &required_cpuset);
+	wayca_group_request_resource_from_father(group, required_cpuset);
 
-	memcpy(&group->total, &required_cpuset, sizeof(cpu_set_t));
+	cpumask_copy(group->total, required_cpuset);
 	return 0;
 }
 
@@ -394,6 +469,9 @@ static int wayca_group_arrange(struct wayca_sc_group *group)
 	case WT_GF_CPU:
 		group->nr_cpus_per_topo = 1;
 		break;
+	case WT_GF_CORE:
+		group->nr_cpus_per_topo = wayca_sc_cpus_in_core();
+		break;
 	case WT_GF_CCL:
 		group->nr_cpus_per_topo = wayca_sc_cpus_in_ccl();
 		break;
@@ -440,15 +518,20 @@ int wayca_group_init(struct wayca_sc_group *group)
 
 	/* Init with no members */
 	group->threads = NULL;
+	group->threads_tail = NULL;
 	group->nr_threads = 0;
+	group->groups = NULL;
+	group->groups_tail = NULL;
+	group->nr_groups = 0;
 
 	/* Init group in no hierarchy */
-	group->siblings = NULL;
+	group->prev = NULL;
+	group->next = NULL;
 	group->father = NULL;
 	group->topo_hint = -1;
 	group->roll_over_cnts = 0;
 
-	CPU_ZERO(&group->used);
+	cpumask_zero(group->used);
 	pthread_mutex_init(&group->mutex, NULL);
 
 	/*
@@ -463,40 +546,38 @@ int wayca_group_init(struct wayca_sc_group *group)
 static void wayca_group_assign_thread_resource(struct wayca_sc_group *group,
 					       struct wayca_thread *thread)
 {
-	cpu_set_t available_set;
-	ssize_t target_pos = 0;
-	int anchor;
+	DECLARE_CPUMASK(available_set);
+	ssize_t target_pos;
+
+	cpumask_andnot(available_set, group->total, group->used);
+	wayca_cpu_util_update();
+	wayca_load_tree_sync();
 
-	memset(&available_set, -1, sizeof(cpu_set_t));
-	CPU_XOR(&available_set, &available_set, &group->used);
-	CPU_AND(&available_set, &available_set, &group->total);
+	if (group->attribute & WT_GF_CORE_FIRST)
+		group_spread_cores(group, available_set);
 
 	/**
-	 * If threads in the group is compact, and the available CPU counts
-	 * isn't integer multiple of topology level CPU counts, then find the
-	 * incomplete topology set and place the thread.
+	 * If threads in the group is compact, and some topology set is
+	 * partially used, then place the thread in that incomplete set.
 	 *
 	 * Else find the idlest core in the idlest set and place the thread.
 	 */
-	if ((CPU_COUNT(&available_set) % group->nr_cpus_per_topo) &&
-	    group->attribute & WT_GF_COMPACT) {
-		anchor = find_incomplete_set(group, &available_set);
+	target_pos = -ENODATA;
+	if (group->attribute & WT_GF_COMPACT)
+		target_pos = find_incomplete_set(group, available_set);
 
-		WAYCA_SC_ASSERT(anchor >= 0);
-		target_pos = anchor;
+	if (target_pos < 0) {
+		DECLARE_CPUMASK(idlest_set);
 
-		/* iterate the available cpu set and find a proper cpu */
-		while(target_pos < anchor + group->nr_cpus_per_topo &&
-		      !CPU_ISSET(target_pos, &available_set))
-			target_pos += 1;
-	} else {
-		find_idlest_set(group, &available_set);
-		target_pos = find_idlest_core(&available_set);
+		cpumask_copy(idlest_set, available_set);
+		find_idlest_set(group, idlest_set);
+		cpumask_and(available_set, available_set, idlest_set);
+		target_pos = find_idlest_core(available_set);
 	}
 
 	/* Reset the thread's cpuset information first */
-	CPU_ZERO(&thread->allowed_set);
-	CPU_ZERO(&thread->cur_set);
+	cpumask_zero(thread->allowed_set);
+	cpumask_zero(thread->cur_set);
 	thread->target_pos = target_pos;
 
 	/**
@@ -504,27 +585,15 @@ static void wayca_group_assign_thread_resource(struct wayca_sc_group *group,
 	 * single CPU to the thread. So we directly assign the CPU at
 	 * the @target_pos to the thread.
 	 *
-	 * Otherwise, we assign a set of CPUs to the thread, ranged
-	 * [target_pos, target_pos + group->nr_cpus_per_topo).
+	 * Otherwise, we assign the topology set of the CPU at the
+	 * @target_pos to the thread.
 	 */
 	if (group->attribute & WT_GF_PERCPU) {
-		CPU_SET(target_pos, &thread->cur_set);
-		CPU_SET(target_pos, &thread->allowed_set);
+		cpumask_set_cpu(target_pos, thread->cur_set);
+		cpumask_set_cpu(target_pos, thread->allowed_set);
 	} else {
-		/**
-		 * If the bind policy is not per-CPU, then each thread will
-		 * bind to a set of CPU according to the topology level.
-		 * So always make the start CPU at the beginning of the
-		 * The topology set to avoid intercrossing between adjacent
-		 * topology sets.
-		 */
-		anchor = target_pos - target_pos % group->nr_cpus_per_topo;
-		for (int num = anchor;
-		     num < anchor + group->nr_cpus_per_topo;
-		     num++) {
-			CPU_SET(num, &thread->cur_set);
-			CPU_SET(num, &thread->allowed_set);
-		}
+		group_topo_set(group, target_pos, thread->cur_set);
+		cpumask_copy(thread->allowed_set, thread->cur_set);
 	}
 
 	/**
@@ -533,32 +602,25 @@ static void wayca_group_assign_thread_resource(struct wayca_sc_group *group,
 	 * record the @target_pos of this thread in the group->used,
 	 * as next thread may be placed in the same topology set.
 	 * Otherwise the threads are scattered, we have to record
-	 * all the CPUs assigned to this thread in the group->used,
-	 * as it's exclusive to the next thread.
+	 * all the CPUs in the topology set of this thread in the
+	 * group->used, as it's exclusive to the next thread.
 	 */
 	if (group->attribute & WT_GF_COMPACT) {
-		CPU_SET(target_pos, &group->used);
+		cpumask_set_cpu(target_pos, group->used);
 	} else {
-		if (group->attribute & WT_GF_PERCPU) {
-			anchor = target_pos -
-				 target_pos % group->nr_cpus_per_topo;
-
-			for (int num = anchor;
-			     num < anchor + group->nr_cpus_per_topo;
-			     num++)
-				CPU_SET(num, &group->used);
-		} else {
-			CPU_OR(&group->used, &group->used,
-			       &thread->allowed_set);
-		}
+		DECLARE_CPUMASK(tset);
+
+		group_topo_set(group, target_pos, tset);
+		cpumask_and(tset, tset, group->total);
+		cpumask_or(group->used, group->used, tset);
 	}
 
 	/**
 	 * When no cores remains in the group, increase the group->roll_over_cnts
 	 * and clear the group->used.
 	 */
-	if (CPU_EQUAL(&group->used, &group->total)) {
-		CPU_ZERO(&group->used);
+	if (cpumask_equal(group->used, group->total)) {
+		cpumask_zero(group->used);
 		group->roll_over_cnts++;
 	}
 }
@@ -592,18 +654,18 @@ int wayca_group_delete_thread(struct wayca_sc_group *group,
 	if (!is_thread_in_group(group, thread))
 		return -EINVAL;
 
-	if (CPU_COUNT(&group->used) == 0) {
+	if (cpumask_empty(group->used)) {
 		WAYCA_SC_ASSERT(group->roll_over_cnts > 0);
 
 		group->roll_over_cnts--;
-		CPU_OR(&group->used, &group->used, &group->total);
+		cpumask_or(group->used, group->used, group->total);
 	}
 
 	if ((group->attribute & WT_GF_COMPACT) &&
 	    !(group->attribute & WT_GF_PERCPU))
-		CPU_CLR(thread->target_pos, &group->used);
+		cpumask_clear_cpu(thread->target_pos, group->used);
 	else
-		CPU_XOR(&group->used, &group->used, &thread->allowed_set);
+		cpumask_xor(group->used, group->used, thread->allowed_set);
 
 	group_thread_delete_thread(group, thread);
 	thread->group = NULL;
@@ -615,7 +677,7 @@ int wayca_group_delete_thread(struct wayca_sc_group *group,
 int wayca_group_rearrange_thread(struct wayca_thread *thread)
 {
 	thread_sched_setaffinity(thread->pid,
-				 sizeof(cpu_set_t), &thread->cur_set);
+				 cpumask_size(), thread->cur_set);
 
 	wayca_thread_update_load(thread, true);
 
@@ -637,7 +699,7 @@ int wayca_group_rearrange_group(struct wayca_sc_group *group)
 	if (ret)
 		return ret;
 
-	CPU_ZERO(&group->used);
+	cpumask_zero(group->used);
 	group->roll_over_cnts = 0;
 
 	/*
@@ -701,14 +763,14 @@ int wayca_group_delete_group(struct wayca_sc_group *group, struct wayca_sc_group
 	if (!is_group_in_father(group, father))
 		return -EINVAL;
 
-	if (CPU_COUNT(&father->used) == 0) {
+	if (cpumask_empty(father->used)) {
 		WAYCA_SC_ASSERT(father->roll_over_cnts > 0);
 
 		father->roll_over_cnts--;
-		CPU_OR(&father->used, &father->used, &father->total);
+		cpumask_or(father->used, father->used, father->total);
 	}
 
-	CPU_XOR(&father->used, &father->used, &group->total);
+	cpumask_xor(father->used, father->used, group->total);
 
 	group_group_delete_group(group, father);
 	father->nr_groups--;
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2021 HiSilicon Technologies Co., Ltd.
+ * Wayca scheduler is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ *
+ * See the Mulan PSL v2 for more details.
+ */
+
+/* id_table.c - the ids of the wayca threads, groups and threadpools
+ *
+ * The low bits of an id index a slot of the table and the high bits hold
+ * the generation of the slot, which is bumped each time the slot is
+ * freed. So an id of a destroyed object never finds the object reusing
+ * the slot, and wayca_id_lookup() needs no lock.
+ *
+ * The free slots are marked in a bitmap, and the words of the bitmap
+ * with a free slot in a summary bitmap above it, so the lowest free slot
+ * is found by two __ffs() rather than by scanning the table.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdlib.h>
+
+#include "bitops.h"
+#include "wayca_thread.h"
+
+#define BITS_TO_LONGS(nr)	(((nr) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+
+static void id_bit_set(unsigned long *bits, size_t nr)
+{
+	bits[nr / BITS_PER_LONG] |= 1UL << (nr % BITS_PER_LONG);
+}
+
+static void id_bit_clear(unsigned long *bits, size_t nr)
+{
+	bits[nr / BITS_PER_LONG] &= ~(1UL << (nr % BITS_PER_LONG));
+}
+
+int wayca_id_table_init(struct wayca_id_table *table, size_t size)
+{
+	size_t slot;
+
+	if (size > WAYCA_ID_SLOT_MASK + 1)
+		size = WAYCA_ID_SLOT_MASK + 1;
+
+	table->objs = calloc(size, sizeof(*table->objs));
+	table->gens = calloc(size, sizeof(*table->gens));
+	table->free_slots = calloc(BITS_TO_LONGS(size), sizeof(unsigned long));
+	table->free_words = calloc(BITS_TO_LONGS(BITS_TO_LONGS(size)),
+				   sizeof(unsigned long));
+	if (!table->objs || !table->gens || !table->free_slots ||
+	    !table->free_words) {
+		wayca_id_table_exit(table);
+		return -ENOMEM;
+	}
+
+	for (slot = 0; slot < size; slot++)
+		id_bit_set(table->free_slots, slot);
+	for (slot = 0; slot < BITS_TO_LONGS(size); slot++)
+		id_bit_set(table->free_words, slot);
+
+	pthread_mutex_init(&table->mutex, NULL);
+	table->size = size;
+	return 0;
+}
+
+void wayca_id_table_exit(struct wayca_id_table *table)
+{
+	if (table->size)
+		pthread_mutex_destroy(&table->mutex);
+	table->size = 0;
+
+	free(table->objs);
+	free(table->gens);
+	free(table->free_slots);
+	free(table->free_words);
+	table->objs = NULL;
+	table->gens = NULL;
+	table->free_slots = NULL;
+	table->free_words = NULL;
+}
+
+/*
+ * wayca_id_get - reserve the lowest free slot of @table
+ * @id: the id of the slot
+ *
+ * The id isn't found by wayca_id_lookup() until the object is published
+ * by wayca_id_publish(), so the object can be set up in between.
+ *
+ * Return 0 on success, -EAGAIN if the table is full.
+ */
+int wayca_id_get(struct wayca_id_table *table, unsigned long long *id)
+{
+	size_t n = BITS_TO_LONGS(BITS_TO_LONGS(table->size));
+	size_t w, word, slot;
+
+	if (!n)
+		return -EAGAIN;
+
+	pthread_mutex_lock(&table->mutex);
+	for (w = 0; w < n; w++)
+		if (table->free_words[w])
+			break;
+
+	if (w == n) {
+		pthread_mutex_unlock(&table->mutex);
+		return -EAGAIN;
+	}
+
+	word = w * BITS_PER_LONG + __ffs(table->free_words[w]);
+	slot = word * BITS_PER_LONG + __ffs(table->free_slots[word]);
+	id_bit_clear(table->free_slots, slot);
+	if (!table->free_slots[word])
+		id_bit_clear(table->free_words, word);
+
+	*id = (unsigned long long)table->gens[slot] << WAYCA_ID_GEN_SHIFT |
+	      slot;
+	pthread_mutex_unlock(&table->mutex);
+	return 0;
+}
+
+/* wayca_id_publish - make @obj found by the @id reserved for it */
+void wayca_id_publish(struct wayca_id_table *table, unsigned long long id,
+		      void *obj)
+{
+	__atomic_store_n(&table->objs[id & WAYCA_ID_SLOT_MASK], obj,
+			 __ATOMIC_RELEASE);
+}
+
+/*
+ * wayca_id_put - free the slot of @id, published or not. The ids of the
+ * slot handed out so far are stale from now on.
+ */
+void wayca_id_put(struct wayca_id_table *table, unsigned long long id)
+{
+	size_t slot = id & WAYCA_ID_SLOT_MASK;
+
+	pthread_mutex_lock(&table->mutex);
+	__atomic_store_n(&table->objs[slot], NULL, __ATOMIC_RELAXED);
+	__atomic_store_n(&table->gens[slot], table->gens[slot] + 1,
+			 __ATOMIC_RELEASE);
+
+	id_bit_set(table->free_slots, slot);
+	id_bit_set(table->free_words, slot / BITS_PER_LONG);
+	pthread_mutex_unlock(&table->mutex);
+}
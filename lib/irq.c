@@ -23,6 +23,7 @@
 
 #include "bitops.h"
 #include "common.h"
+#include "topo.h"
 #include "wayca-scheduler.h"
 
 /*
@@ -120,7 +121,8 @@ int WAYCA_SC_DECLSPEC wayca_sc_irq_bind_cpu(int irq, int cpu)
 	CPU_ZERO(&mask);
 	CPU_SET(cpu, &mask);
 
-	snprintf(buf, PATH_MAX, "/proc/irq/%i/smp_affinity", irq);
+	snprintf(buf, PATH_MAX, "%s/%i/smp_affinity", WAYCA_SC_PROC_IRQ_FNAME,
+		 irq);
 	fd = open(buf, O_WRONLY, S_IRUSR | S_IWUSR);
 	if (fd < 0)
 		return -errno;
@@ -147,7 +149,8 @@ int WAYCA_SC_DECLSPEC wayca_sc_get_irq_bind_cpu(int irq, size_t cpusetsize,
 	if (!cpuset)
 		return -EINVAL;
 
-	snprintf(buf, PATH_MAX, "/proc/irq/%i/smp_affinity", irq);
+	snprintf(buf, PATH_MAX, "%s/%i/smp_affinity", WAYCA_SC_PROC_IRQ_FNAME,
+		 irq);
 	fd = open(buf, O_RDONLY, S_IRUSR | S_IWUSR);
 	if (fd < 0)
 		return -errno;
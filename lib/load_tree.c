@@ -0,0 +1,521 @@
+/*
+ * Copyright (c) 2021 HiSilicon Technologies Co., Ltd.
+ * Wayca scheduler is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ *
+ * See the Mulan PSL v2 for more details.
+ */
+
+/* load_tree.c - the loads of the wayca threads aggregated by topology
+ *
+ * The load of each core, cluster, NUMA node and package is kept as the sum
+ * of the loads of its cpus, updated along with the per-cpu loads. The
+ * domains of the levels form a tree, so the idlest domain of a level is
+ * found by descending from the idlest package, as the kernel scheduler
+ * balances, rather than by summing the loads of all the candidate cpus
+ * on each placement. A level missing from the topology, e.g. clusters,
+ * is skipped.
+ *
+ * The tree is built from the cpus when the library loads, and built again
+ * when the topology changes, see wayca_load_tree_sync(). The loads are
+ * carried over from the per-cpu loads. The cpus which have no place in
+ * it, e.g. the ones never online, are left to the linear search of the
+ * callers.
+ *
+ * A cpu is summed up by its busy load, the larger of its load and its
+ * utilization, see cpu_util.c. The busy load last added to the tree is
+ * kept per cpu, so a change of either adds the difference.
+ *
+ * The per-cpu loads are updated along with the tree under the read side
+ * of a rwlock, and the tree is replaced under the write side, so the sums
+ * of the new tree miss no update and the old one is freed right away.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "wayca_thread.h"
+
+#define WAYCA_LOAD_LEVELS	(WAYCA_SC_TOPO_LEVEL_PACKAGE + 1)
+
+struct wayca_load_domain {
+	long long load;		/* sum of the loads of the cpus */
+	long long capacity;	/* sum of the capacities of the cpus */
+	cpu_set_t *cpus;
+	int *children;		/* the domains of the level below */
+	int n_children;
+} __attribute__((aligned(WAYCA_SC_CACHELINE_SIZE)));
+
+struct wayca_load_level {
+	int n_domains;		/* 0 if the level is missing */
+	struct wayca_load_domain *domains;
+	int *cpu_domain;	/* the domain of each cpu, -1 if none */
+	int below;		/* the next level below, -1 for the lowest */
+};
+
+struct wayca_load_tree {
+	struct wayca_load_level levels[WAYCA_LOAD_LEVELS];
+	cpu_set_t *orphans;	/* the cpus missing from a level */
+	int top;		/* the highest level */
+};
+
+static struct wayca_load_tree *load_tree;	/* NULL without a tree */
+static pthread_rwlock_t load_tree_lock = PTHREAD_RWLOCK_INITIALIZER;
+/* the cpus of the tree, and the generation of the topology it's built of */
+static cpu_set_t *load_cpus;
+static unsigned long load_generation;
+static pthread_mutex_t load_rebuild_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int load_cpu_id(const struct wayca_sc_cpu_ids *ids, int level)
+{
+	switch (level) {
+	case WAYCA_SC_TOPO_LEVEL_CORE:
+		return ids->core_id;
+	case WAYCA_SC_TOPO_LEVEL_CCL:
+		return ids->ccl_id;
+	case WAYCA_SC_TOPO_LEVEL_NODE:
+		return ids->node_id;
+	case WAYCA_SC_TOPO_LEVEL_PACKAGE:
+		return ids->package_id;
+	default:
+		return -EINVAL;
+	}
+}
+
+/* The cpus of @ids without a domain at @level are set in @orphans */
+static int load_level_init(struct wayca_load_level *lv, int level,
+			   const struct wayca_sc_cpu_ids *ids, int n,
+			   cpu_set_t *orphans)
+{
+	struct wayca_load_domain *dom;
+	int i, d, max_id = -1;
+
+	lv->cpu_domain = malloc(nr_cpumask_bits * sizeof(int));
+	if (!lv->cpu_domain)
+		return -ENOMEM;
+	memset(lv->cpu_domain, -1, nr_cpumask_bits * sizeof(int));
+
+	for (i = 0; i < n; i++) {
+		d = load_cpu_id(&ids[i], level);
+		if (d < 0) {
+			cpumask_set_cpu(ids[i].cpu, orphans);
+			continue;
+		}
+		lv->cpu_domain[ids[i].cpu] = d;
+		max_id = max(max_id, d);
+	}
+
+	lv->n_domains = max_id + 1;
+	if (!lv->n_domains)
+		return 0;
+
+	lv->domains = aligned_alloc(WAYCA_SC_CACHELINE_SIZE,
+				    lv->n_domains * sizeof(*lv->domains));
+	if (!lv->domains)
+		return -ENOMEM;
+	memset(lv->domains, 0, lv->n_domains * sizeof(*lv->domains));
+
+	for (d = 0; d < lv->n_domains; d++) {
+		lv->domains[d].cpus = cpumask_alloc();
+		if (!lv->domains[d].cpus)
+			return -ENOMEM;
+	}
+
+	for (i = 0; i < n; i++) {
+		d = lv->cpu_domain[ids[i].cpu];
+		if (d < 0)
+			continue;
+		dom = &lv->domains[d];
+		cpumask_set_cpu(ids[i].cpu, dom->cpus);
+		dom->capacity += wayca_cpu_capacity(ids[i].cpu);
+	}
+	return 0;
+}
+
+/* A domain is the child of the domain of its first cpu on the level above */
+static int load_level_link(struct wayca_load_level *lv,
+			   const struct wayca_load_level *below)
+{
+	struct wayca_load_domain *dom;
+	int c, d;
+
+	for (c = 0; c < below->n_domains; c++) {
+		d = lv->cpu_domain[cpumask_first(below->domains[c].cpus)];
+		if (d >= 0)
+			lv->domains[d].n_children++;
+	}
+
+	for (d = 0; d < lv->n_domains; d++) {
+		dom = &lv->domains[d];
+		dom->children = calloc(max(dom->n_children, 1), sizeof(int));
+		if (!dom->children)
+			return -ENOMEM;
+		dom->n_children = 0;
+	}
+
+	for (c = 0; c < below->n_domains; c++) {
+		d = lv->cpu_domain[cpumask_first(below->domains[c].cpus)];
+		if (d < 0)
+			continue;
+		dom = &lv->domains[d];
+		dom->children[dom->n_children++] = c;
+	}
+	return 0;
+}
+
+static void load_tree_free(struct wayca_load_tree *tree)
+{
+	struct wayca_load_level *lv;
+	int level, d;
+
+	if (!tree)
+		return;
+
+	for (level = 0; level < WAYCA_LOAD_LEVELS; level++) {
+		lv = &tree->levels[level];
+		for (d = 0; lv->domains && d < lv->n_domains; d++) {
+			cpumask_free(lv->domains[d].cpus);
+			free(lv->domains[d].children);
+		}
+		free(lv->domains);
+		free(lv->cpu_domain);
+	}
+	cpumask_free(tree->orphans);
+	free(tree);
+}
+
+/* Build the tree of the cpus in @cpuset, without the loads */
+static struct wayca_load_tree *load_tree_build(const cpu_set_t *cpuset)
+{
+	struct wayca_load_tree *tree;
+	struct wayca_sc_cpu_ids *ids;
+	int level, below = -1;
+	int n;
+
+	tree = calloc(1, sizeof(*tree));
+	ids = calloc(nr_cpumask_bits, sizeof(*ids));
+	if (!tree || !ids)
+		goto err;
+
+	tree->orphans = cpumask_alloc();
+	if (!tree->orphans)
+		goto err;
+
+	n = wayca_sc_get_cpu_ids(cpumask_size(), cpuset, ids,
+				 nr_cpumask_bits);
+	if (n <= 0)
+		goto err;
+
+	for (level = 0; level < WAYCA_LOAD_LEVELS; level++) {
+		DECLARE_CPUMASK(orphans);
+
+		cpumask_zero(orphans);
+		if (load_level_init(&tree->levels[level], level, ids, n,
+				    orphans))
+			goto err;
+		/* a missing level is skipped, its cpus are no orphans */
+		if (!tree->levels[level].n_domains)
+			continue;
+
+		cpumask_or(tree->orphans, tree->orphans, orphans);
+
+		tree->levels[level].below = below;
+		if (below >= 0) {
+			if (load_level_link(&tree->levels[level],
+					    &tree->levels[below]))
+				goto err;
+		}
+		below = level;
+	}
+
+	if (below < 0)
+		goto err;
+
+	tree->top = below;
+	free(ids);
+	return tree;
+err:
+	free(ids);
+	load_tree_free(tree);
+	return NULL;
+}
+
+/*
+ * wayca_load_tree_init - build the tree of the cpus in @cpuset, which have
+ * no load yet. Without a tree the callers search linearly.
+ */
+void wayca_load_tree_init(const cpu_set_t *cpuset)
+{
+	load_cpus = cpumask_alloc();
+	if (!load_cpus)
+		return;
+
+	cpumask_copy(load_cpus, cpuset);
+	load_generation = wayca_sc_topo_generation();
+	load_tree = load_tree_build(load_cpus);
+}
+
+void wayca_load_tree_exit(void)
+{
+	pthread_rwlock_wrlock(&load_tree_lock);
+	load_tree_free(load_tree);
+	load_tree = NULL;
+	pthread_rwlock_unlock(&load_tree_lock);
+
+	cpumask_free(load_cpus);
+	load_cpus = NULL;
+}
+
+/* Add @load of @cpu to the domains of @cpu, with load_tree_lock held */
+static void load_tree_add(struct wayca_load_tree *tree, int cpu,
+			  long long load)
+{
+	struct wayca_load_level *lv;
+	int level, d;
+
+	if (!tree)
+		return;
+
+	for (level = tree->top; level >= 0; level = lv->below) {
+		lv = &tree->levels[level];
+		d = lv->cpu_domain[cpu];
+		if (d >= 0)
+			__atomic_add_fetch(&lv->domains[d].load, load,
+					   __ATOMIC_RELAXED);
+	}
+}
+
+/*
+ * wayca_load_tree_sync - build the tree again if the topology has changed
+ * since it was built, e.g. a cpu never online before has come online. The
+ * loads are summed up from the busy loads accounted per cpu. The old tree
+ * is kept if the new one can't be built, and it's not tried again until
+ * the next change.
+ */
+void wayca_load_tree_sync(void)
+{
+	struct wayca_load_tree *tree, *old;
+	unsigned long generation;
+	int cpu;
+
+	if (!load_cpus)
+		return;
+
+	generation = wayca_sc_topo_generation();
+	if (generation == __atomic_load_n(&load_generation, __ATOMIC_RELAXED))
+		return;
+
+	pthread_mutex_lock(&load_rebuild_mutex);
+	if (generation == load_generation) {
+		pthread_mutex_unlock(&load_rebuild_mutex);
+		return;
+	}
+
+	tree = load_tree_build(load_cpus);
+	if (tree) {
+		pthread_rwlock_wrlock(&load_tree_lock);
+		for_each_cpu(cpu, load_cpus)
+			load_tree_add(tree, cpu, wayca_cpu_loads[cpu].busy);
+		old = load_tree;
+		load_tree = tree;
+		pthread_rwlock_unlock(&load_tree_lock);
+		load_tree_free(old);
+	}
+	__atomic_store_n(&load_generation, generation, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&load_rebuild_mutex);
+}
+
+/*
+ * Add the change of the busy load of @cpu to the tree, with load_tree_lock
+ * read held. The busy load is recomputed if another thread has changed it
+ * meanwhile, so the last one added is of the latest load and utilization.
+ */
+static void load_tree_account(int cpu)
+{
+	long long *accounted = &wayca_cpu_loads[cpu].busy;
+	long long busy, old;
+
+	old = __atomic_load_n(accounted, __ATOMIC_RELAXED);
+	do {
+		busy = wayca_cpu_busy_load(cpu);
+		if (busy == old)
+			return;
+	} while (!__atomic_compare_exchange_n(accounted, &old, busy, false,
+					      __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
+
+	load_tree_add(load_tree, cpu, busy - old);
+}
+
+/* wayca_cpu_load_add - add @load of a wayca thread to each of @cpus */
+void wayca_cpu_load_add(const cpu_set_t *cpus, long long load)
+{
+	int cpu;
+
+	pthread_rwlock_rdlock(&load_tree_lock);
+	for_each_cpu(cpu, cpus) {
+		__atomic_add_fetch(&wayca_cpu_loads[cpu].load, load,
+				   __ATOMIC_RELAXED);
+		load_tree_account(cpu);
+	}
+	pthread_rwlock_unlock(&load_tree_lock);
+}
+
+/* wayca_cpu_util_set - set the utilization of @cpu, see cpu_util.c */
+void wayca_cpu_util_set(int cpu, long long util)
+{
+	pthread_rwlock_rdlock(&load_tree_lock);
+	__atomic_store_n(&wayca_cpu_loads[cpu].util, util, __ATOMIC_RELAXED);
+	load_tree_account(cpu);
+	pthread_rwlock_unlock(&load_tree_lock);
+}
+
+/* Whether the domains at @level of the cpus in @cpuset are all known */
+static bool load_tree_covers(const struct wayca_load_tree *tree, int level,
+			     const cpu_set_t *cpuset)
+{
+	return tree && level >= 0 && level < WAYCA_LOAD_LEVELS &&
+	       tree->levels[level].n_domains &&
+	       !cpumask_intersects(cpuset, tree->orphans);
+}
+
+static int load_tree_idlest(const struct wayca_load_tree *tree, int level,
+			    const cpu_set_t *cpuset, cpu_set_t *domain)
+{
+	const struct wayca_load_domain *dom, *best;
+	const int *cand = NULL;
+	long long load, min_load;
+	int l, i, n_cand;
+
+	if (!load_tree_covers(tree, level, cpuset))
+		return -ENOENT;
+
+	n_cand = tree->levels[tree->top].n_domains;
+	for (l = tree->top; ; l = tree->levels[l].below) {
+		best = NULL;
+		min_load = LLONG_MAX;
+		for (i = 0; i < n_cand; i++) {
+			dom = &tree->levels[l].domains[cand ? cand[i] : i];
+			if (!cpumask_intersects(dom->cpus, cpuset))
+				continue;
+
+			load = __atomic_load_n(&dom->load, __ATOMIC_RELAXED) *
+			       WAYCA_SC_CPU_CAPACITY_SCALE / dom->capacity;
+			if (load < min_load) {
+				min_load = load;
+				best = dom;
+			}
+		}
+
+		/* the levels don't nest, leave it to the linear search */
+		if (!best)
+			return -ENOENT;
+		if (l == level)
+			break;
+
+		cand = best->children;
+		n_cand = best->n_children;
+	}
+
+	cpumask_copy(domain, best->cpus);
+	return 0;
+}
+
+/*
+ * wayca_load_tree_idlest - find the idlest domain at @level with cpus in
+ * @cpuset, by the loads scaled by the capacities like find_idlest_set()
+ * @domain: the cpus of the domain found
+ *
+ * Return 0 on success, -ENOENT if the tree can't tell, e.g. @level is
+ * missing or some cpus of @cpuset have no place in the tree.
+ */
+int wayca_load_tree_idlest(int level, const cpu_set_t *cpuset,
+			   cpu_set_t *domain)
+{
+	int ret;
+
+	pthread_rwlock_rdlock(&load_tree_lock);
+	ret = load_tree_idlest(load_tree, level, cpuset, domain);
+	pthread_rwlock_unlock(&load_tree_lock);
+	return ret;
+}
+
+static void load_tree_first_incomplete(const struct wayca_load_tree *tree,
+				       int l, const int *cand, int n_cand,
+				       int level, const cpu_set_t *avail,
+				       const cpu_set_t *used, int *first,
+				       int *pos)
+{
+	const struct wayca_load_domain *dom;
+	DECLARE_CPUMASK(tset);
+	int i, cpu;
+
+	for (i = 0; i < n_cand; i++) {
+		dom = &tree->levels[l].domains[cand ? cand[i] : i];
+		if (!cpumask_intersects(dom->cpus, avail) ||
+		    !cpumask_intersects(dom->cpus, used))
+			continue;
+
+		if (l != level) {
+			load_tree_first_incomplete(tree, tree->levels[l].below,
+						   dom->children,
+						   dom->n_children, level,
+						   avail, used, first, pos);
+			continue;
+		}
+
+		/* the sets are ordered by their first cpu in the group */
+		cpumask_or(tset, avail, used);
+		cpumask_and(tset, tset, dom->cpus);
+		cpu = cpumask_first(tset);
+		if (*first < 0 || cpu < *first) {
+			cpumask_and(tset, dom->cpus, avail);
+			*first = cpu;
+			*pos = cpumask_first(tset);
+		}
+	}
+}
+
+/*
+ * wayca_load_tree_incomplete - find the first domain at @level which has
+ * cpus of @total both in @cpuset and out of it, like find_incomplete_set()
+ *
+ * The domains are ordered by their first cpu of @total, not by their
+ * place in the tree, so the compact groups fill the sets in cpu order.
+ *
+ * Return the first cpu of @cpuset in the domain, -ENODATA if there's no
+ * such domain, or -ENOENT if the tree can't tell.
+ */
+int wayca_load_tree_incomplete(int level, const cpu_set_t *total,
+			       const cpu_set_t *cpuset)
+{
+	const struct wayca_load_tree *tree;
+	DECLARE_CPUMASK(avail);
+	DECLARE_CPUMASK(used);
+	int ret = -ENOENT, first = -1;
+
+	/* only the parents of both kinds of cpus can have such a child */
+	cpumask_and(avail, total, cpuset);
+	cpumask_andnot(used, total, cpuset);
+
+	pthread_rwlock_rdlock(&load_tree_lock);
+	tree = load_tree;
+	if (load_tree_covers(tree, level, total)) {
+		ret = -ENODATA;
+		load_tree_first_incomplete(tree, tree->top, NULL,
+				tree->levels[tree->top].n_domains, level,
+				avail, used, &first, &ret);
+	}
+	pthread_rwlock_unlock(&load_tree_lock);
+	return ret;
+}
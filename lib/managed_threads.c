@@ -27,16 +27,17 @@ struct task_cpu_map wayca_sc_cpu_maps[MAX_MANAGED_MAPS];
 
 static inline void nodemask_to_cpumask(node_set_t *node_mask, cpu_set_t *cpu_mask)
 {
-	int cr_in_node = wayca_sc_cpus_in_node();
 	int nr_in_total = wayca_sc_nodes_in_total();
+	cpu_set_t node_cpus;
 
 	CPU_ZERO(cpu_mask);
 
 	for (int i = 0; i < nr_in_total; i++) {
 		if (!NODE_ISSET(i, node_mask))
 			continue;
-		for (int j = 0; j < cr_in_node; j++)
-			CPU_SET(i * cr_in_node + j, cpu_mask);
+		if (wayca_sc_node_cpu_mask(i, sizeof(node_cpus), &node_cpus))
+			continue;
+		CPU_OR(cpu_mask, cpu_mask, &node_cpus);
 	}
 }
 
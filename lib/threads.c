@@ -277,24 +277,25 @@ WAYCA_SC_DECLSPEC char *wayca_scheduler_socket_path = "/etc/wayca-scheduler/wayc
  * a bit less than the default limits of the system.
  */
 #define DEFAULT_WAYCA_SC_THREADS_NUM	32760
-static struct wayca_thread **wayca_threads_array;
-static pthread_mutex_t wayca_threads_array_mutex;
-static size_t wayca_threads_array_size;
+static struct wayca_id_table wayca_threads_table;
 
 #define DEFAULT_WAYCA_SC_GROUPS_NUM		256
-static struct wayca_sc_group **wayca_groups_array;
-static pthread_mutex_t wayca_groups_array_mutex;
-static size_t wayca_groups_array_size;
+static struct wayca_id_table wayca_groups_table;
 
 #define DEFAULT_WAYCA_SC_THREADPOOLS_NUM	256
-static struct wayca_threadpool **wayca_threadpools_array;
-static pthread_mutex_t wayca_threadpools_array_mutex;
-static size_t wayca_threadpools_num;
+static struct wayca_id_table wayca_threadpools_table;
 
-cpu_set_t total_cpu_set;
+cpu_set_t *total_cpu_set;
 
-long long *wayca_cpu_loads;
-pthread_mutex_t wayca_cpu_loads_mutex;
+/* The topology notifier of the groups with WT_GF_REARRANGE */
+static pthread_once_t wayca_group_notifier_once = PTHREAD_ONCE_INIT;
+static bool wayca_group_notifier_registered;
+static void wayca_group_topo_notifier(unsigned int event, int cpu,
+				      void *data);
+
+unsigned int nr_cpumask_bits = CPU_SETSIZE;
+
+struct wayca_cpu_load *wayca_cpu_loads;
 
 static inline bool is_env_invalid(size_t num)
 {
@@ -326,205 +327,91 @@ static void wayca_thread_init(void)
 	int total_cpu_cnt;
 	size_t num;
 
-	pthread_mutex_init(&wayca_cpu_loads_mutex, NULL);
-	pthread_mutex_init(&wayca_threads_array_mutex, NULL);
-	pthread_mutex_init(&wayca_groups_array_mutex, NULL);
-	pthread_mutex_init(&wayca_threadpools_array_mutex, NULL);
-
-	CPU_ZERO(&total_cpu_set);
 	total_cpu_cnt = wayca_sc_cpus_in_total();
-	if (total_cpu_cnt < 0)
+	if (total_cpu_cnt <= 0)
 		return;
 
-	for (int cpu = 0; cpu < total_cpu_cnt; cpu++)
-		CPU_SET(cpu, &total_cpu_set);
+	nr_cpumask_bits = total_cpu_cnt;
+	total_cpu_set = cpumask_alloc();
+	if (!total_cpu_set)
+		return;
+
+	if (wayca_sc_total_cpu_mask(cpumask_size(), total_cpu_set))
+		return;
 
-	wayca_cpu_loads = malloc(total_cpu_cnt * sizeof(long long));
+	wayca_cpu_loads = aligned_alloc(WAYCA_SC_CACHELINE_SIZE,
+					total_cpu_cnt * sizeof(*wayca_cpu_loads));
 	if (!wayca_cpu_loads)
 		return;
 
-	memset(wayca_cpu_loads, 0, sizeof(long long) * total_cpu_cnt);
+	memset(wayca_cpu_loads, 0, sizeof(*wayca_cpu_loads) * total_cpu_cnt);
+	wayca_load_tree_init(total_cpu_set);
+	wayca_cpu_util_init();
 
 	wayca_thread_init_from_envs(&num, DEFAULT_WAYCA_SC_THREADS_NUM,
 				    "WAYCA_SC_THREADS_NUMBER");
-	wayca_threads_array = malloc(num * sizeof(struct wayca_thread *));
-	if (!wayca_threads_array) {
-		wayca_threads_array = NULL;
+	if (wayca_id_table_init(&wayca_threads_table, num))
 		return;
-	}
-
-	memset(wayca_threads_array, 0, num * sizeof(struct wayca_thread *));
-	wayca_threads_array_size = num;
 
 	wayca_thread_init_from_envs(&num, DEFAULT_WAYCA_SC_GROUPS_NUM,
 				    "WAYCA_SC_GROUPS_NUMBER");
-	wayca_groups_array = malloc(num * sizeof(struct wayca_sc_group *));
-	if (!wayca_groups_array) {
-		wayca_groups_array = NULL;
-		wayca_threads_array_size = 0;
+	if (wayca_id_table_init(&wayca_groups_table, num)) {
+		wayca_id_table_exit(&wayca_threads_table);
 		return;
 	}
 
-	memset(wayca_groups_array, 0, num * sizeof(struct wayca_sc_group *));
-	wayca_groups_array_size = num;
-
 	wayca_thread_init_from_envs(&num, DEFAULT_WAYCA_SC_THREADPOOLS_NUM,
 				    "WAYCA_SC_THREADPOOLS_NUMBER");
-	wayca_threadpools_array = malloc(num * sizeof(struct wayca_threadpool *));
-	if (!wayca_threadpools_array) {
-		wayca_threadpools_array = NULL;
-		wayca_threadpools_num = 0;
-		return;
-	}
-	memset(wayca_threadpools_array, 0,
-	       num * sizeof(struct wayca_threadpool *));
-	wayca_threadpools_num = num;
+	wayca_id_table_init(&wayca_threadpools_table, num);
 }
 
 static void wayca_thread_exit(void)
 {
+	/* the groups may be rearranged by the topology notifier until then */
+	if (wayca_group_notifier_registered)
+		wayca_sc_topo_unregister_notifier(wayca_group_topo_notifier,
+						  NULL);
+
+	cpumask_free(total_cpu_set);
+	total_cpu_set = NULL;
+
+	wayca_cpu_util_exit();
+	wayca_load_tree_exit();
 	if (wayca_cpu_loads) {
 		free(wayca_cpu_loads);
 		wayca_cpu_loads = NULL;
 	}
 
-	if (wayca_threads_array) {
-		free(wayca_threads_array);
-		wayca_threads_array = NULL;
-	}
-
-	if (wayca_groups_array) {
-		free(wayca_groups_array);
-		wayca_groups_array = NULL;
-	}
-
-	if (wayca_threadpools_array) {
-		free(wayca_threadpools_array);
-		wayca_threadpools_array = NULL;
-	}
-	pthread_mutex_destroy(&wayca_threadpools_array_mutex);
-	pthread_mutex_destroy(&wayca_groups_array_mutex);
-	pthread_mutex_destroy(&wayca_threads_array_mutex);
-	pthread_mutex_destroy(&wayca_cpu_loads_mutex);
-}
-
-/**
- * The caller should have hold the @wayca_threads_array_mutex lock.
- */
-static int find_free_thread_id_locked(wayca_sc_thread_t *id)
-{
-	for (wayca_sc_thread_t i = 0; i < wayca_threads_array_size; i++) {
-		if (!wayca_threads_array[i]) {
-			*id = i;
-			return 0;
-		}
-	}
-
-	return -EAGAIN;
-}
-
-/**
- * The caller should have hold the @wayca_groups_array_mutex lock.
- */
-static int find_free_group_id_locked(wayca_sc_thread_t *id)
-{
-	for (wayca_sc_group_t i = 0; i < wayca_groups_array_size; i++) {
-		if (!wayca_groups_array[i]) {
-			*id = i;
-			return 0;
-		}
-	}
-
-	return -EAGAIN;
-}
-
-/**
- * The caller should have hold the @wayca_threadpools_array_mutex lock.
- */
-static int find_free_threadpool_id_locked(wayca_sc_threadpool_t *id)
-{
-	for (wayca_sc_threadpool_t i = 0; i < wayca_threadpools_num; i++) {
-		if (!wayca_threadpools_array[i]) {
-			*id = i;
-			return 0;
-		}
-	}
-
-	return -EAGAIN;
-}
-
-static bool is_thread_id_valid(wayca_sc_thread_t id)
-{
-	bool valid;
-
-	if (id >= wayca_threads_array_size)
-		return false;
-
-	pthread_mutex_lock(&wayca_threads_array_mutex);
-	valid = wayca_threads_array[id] != NULL;
-	pthread_mutex_unlock(&wayca_threads_array_mutex);
-
-	return valid;
-}
-
-static bool is_group_id_valid(wayca_sc_group_t id)
-{
-	bool valid;
-
-	if (id >= wayca_groups_array_size)
-		return false;
-
-	pthread_mutex_lock(&wayca_groups_array_mutex);
-	valid = wayca_groups_array[id] != NULL;
-	pthread_mutex_unlock(&wayca_groups_array_mutex);
-
-	return valid;
-}
-
-static bool is_threadpool_id_valid(wayca_sc_threadpool_t id)
-{
-	bool valid;
-
-	if (id >= wayca_threadpools_num)
-		return false;
-
-	pthread_mutex_lock(&wayca_threadpools_array_mutex);
-	valid = wayca_threadpools_array[id] != NULL;
-	pthread_mutex_unlock(&wayca_threadpools_array_mutex);
-
-	return valid;
+	wayca_id_table_exit(&wayca_threads_table);
+	wayca_id_table_exit(&wayca_groups_table);
+	wayca_id_table_exit(&wayca_threadpools_table);
 }
 
-/* The caller should make sure the @id is valid */
+/* NULL if the @id is invalid or the thread has been destroyed */
 static struct wayca_thread *id_to_wayca_thread(wayca_sc_thread_t id)
 {
-	return is_thread_id_valid(id) ? wayca_threads_array[id] : NULL;
+	return wayca_id_lookup(&wayca_threads_table, id);
 }
 
 static struct wayca_sc_group *id_to_wayca_group(wayca_sc_group_t id)
 {
-	return is_group_id_valid(id) ? wayca_groups_array[id] : NULL;
+	return wayca_id_lookup(&wayca_groups_table, id);
 }
 
 static struct wayca_threadpool *id_to_wayca_threadpool(wayca_sc_threadpool_t id)
 {
-	return is_threadpool_id_valid(id) ? wayca_threadpools_array[id] : NULL;
+	return wayca_id_lookup(&wayca_threadpools_table, id);
 }
 
 void *wayca_thread_start_routine(void *private)
 {
 	struct wayca_thread *thread = private;
-	cpu_set_t cpuset;
 
 	thread->pid = thread_sched_gettid();
 
-	CPU_ZERO(&cpuset);
-	sched_getaffinity(thread->pid, sizeof(cpu_set_t), &cpuset);
-
-	CPU_ZERO(&thread->cur_set);
-	CPU_ZERO(&thread->allowed_set);
-	CPU_OR(&thread->cur_set, &thread->cur_set, &cpuset);
-	CPU_OR(&thread->allowed_set, &thread->allowed_set, &cpuset);
+	cpumask_zero(thread->cur_set);
+	sched_getaffinity(thread->pid, cpumask_size(), thread->cur_set);
+	cpumask_copy(thread->allowed_set, thread->cur_set);
 
 	wayca_thread_update_load(thread, true);
 
@@ -547,7 +434,7 @@ int WAYCA_SC_DECLSPEC wayca_sc_thread_set_attr(wayca_sc_thread_t wthread,
 	if (wt_p->group)
 		wayca_group_rearrange_thread(wt_p);
 
-	return thread_sched_setaffinity(wt_p->pid, sizeof(cpu_set_t), &wt_p->cur_set);
+	return thread_sched_setaffinity(wt_p->pid, cpumask_size(), wt_p->cur_set);
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_thread_get_attr(wayca_sc_thread_t wthread,
@@ -566,34 +453,34 @@ int WAYCA_SC_DECLSPEC wayca_sc_thread_get_attr(wayca_sc_thread_t wthread,
 
 static struct wayca_thread *wayca_thread_alloc(void)
 {
+	size_t size = sizeof(struct wayca_thread) + 2 * cpumask_size();
+	struct wayca_thread *thread;
 	wayca_sc_thread_t id;
 
-	pthread_mutex_lock(&wayca_threads_array_mutex);
-	if (find_free_thread_id_locked(&id) < 0)
-		goto err;
-
-	wayca_threads_array[id] = malloc(sizeof(struct wayca_thread));
-	if (!wayca_threads_array[id])
-		goto err;
+	if (wayca_id_get(&wayca_threads_table, &id) < 0)
+		return NULL;
 
-	pthread_mutex_unlock(&wayca_threads_array_mutex);
+	/* The cpumasks follow the structure in the same allocation */
+	thread = malloc(size);
+	if (!thread) {
+		wayca_id_put(&wayca_threads_table, id);
+		return NULL;
+	}
 
-	memset(wayca_threads_array[id], 0, sizeof(struct wayca_thread));
-	wayca_threads_array[id]->id = id;
+	memset(thread, 0, size);
+	thread->id = id;
+	thread->cur_set = (cpu_set_t *)(thread + 1);
+	thread->allowed_set = (cpu_set_t *)((char *)thread->cur_set +
+					    cpumask_size());
 
-	return wayca_threads_array[id];
-err:
-	pthread_mutex_unlock(&wayca_threads_array_mutex);
-	return NULL;
+	return thread;
 }
 
 static void wayca_thread_free(struct wayca_thread *thread)
 {
 	wayca_thread_update_load(thread, false);
-	pthread_mutex_lock(&wayca_threads_array_mutex);
-	wayca_threads_array[thread->id] = NULL;
+	wayca_id_put(&wayca_threads_table, thread->id);
 	free(thread);
-	pthread_mutex_unlock(&wayca_threads_array_mutex);
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_thread_create(wayca_sc_thread_t *wthread,
@@ -612,7 +499,8 @@ int WAYCA_SC_DECLSPEC wayca_sc_thread_create(wayca_sc_thread_t *wthread,
 	if (!wt_p)
 		return -ENOMEM;
 
-	wt_p->siblings = NULL;
+	wt_p->prev = NULL;
+	wt_p->next = NULL;
 	wt_p->group = NULL;
 	wt_p->start_routine = start_routine;
 	wt_p->arg = arg;
@@ -638,6 +526,8 @@ int WAYCA_SC_DECLSPEC wayca_sc_thread_create(wayca_sc_thread_t *wthread,
 	while (!wt_p->start)
 		asm volatile("" : : : "memory");
 
+	/* it's found by the id only once it's set up */
+	wayca_id_publish(&wayca_threads_table, wt_p->id, wt_p);
 	*wthread = wt_p->id;
 	return 0;
 }
@@ -687,7 +577,6 @@ int WAYCA_SC_DECLSPEC wayca_sc_thread_kill(wayca_sc_thread_t wthread, int sig)
 int WAYCA_SC_DECLSPEC wayca_sc_pid_attach_thread(wayca_sc_thread_t *wthread, pid_t pid)
 {
 	struct wayca_thread *wt_p;
-	cpu_set_t cpuset;
 	int retval;
 
 	if (!wthread || pid < 0)
@@ -697,7 +586,8 @@ int WAYCA_SC_DECLSPEC wayca_sc_pid_attach_thread(wayca_sc_thread_t *wthread, pid
 	if (!wt_p)
 		return -ENOMEM;
 
-	wt_p->siblings = NULL;
+	wt_p->prev = NULL;
+	wt_p->next = NULL;
 	wt_p->group = NULL;
 	wt_p->start_routine = NULL;
 	wt_p->arg = NULL;
@@ -712,27 +602,24 @@ int WAYCA_SC_DECLSPEC wayca_sc_pid_attach_thread(wayca_sc_thread_t *wthread, pid
 
 	wt_p->pid = pid;
 
-	CPU_ZERO(&cpuset);
-
 	/*
 	 * Get the cpu affinity of the pid, if failed
 	 * the taget pid does not exists.
 	 */
-	retval = sched_getaffinity(wt_p->pid, sizeof(cpu_set_t), &cpuset);
+	retval = sched_getaffinity(wt_p->pid, cpumask_size(), wt_p->cur_set);
 	if (retval < 0) {
 		retval = -errno;
+		cpumask_zero(wt_p->cur_set);
 		wayca_thread_free(wt_p);
 		return retval;
 	}
 
-	CPU_ZERO(&wt_p->cur_set);
-	CPU_ZERO(&wt_p->allowed_set);
-	CPU_OR(&wt_p->cur_set, &wt_p->cur_set, &cpuset);
-	CPU_OR(&wt_p->allowed_set, &wt_p->allowed_set, &cpuset);
+	cpumask_copy(wt_p->allowed_set, wt_p->cur_set);
 
 	wayca_thread_update_load(wt_p, true);
 
 	wt_p->start = true;
+	wayca_id_publish(&wayca_threads_table, wt_p->id, wt_p);
 	*wthread = wt_p->id;
 	return 0;
 }
@@ -759,6 +646,44 @@ int WAYCA_SC_DECLSPEC wayca_sc_pid_detach_thread(wayca_sc_thread_t wthread)
 	return 0;
 }
 
+/*
+ * Rearrange the top level groups with WT_GF_REARRANGE on the CPU hotplug,
+ * their members follow. It runs in the thread of the topology notifiers,
+ * which doesn't hold any lock of the groups.
+ */
+static void wayca_group_topo_notifier(unsigned int event, int cpu,
+				      void *data)
+{
+	struct wayca_sc_group *group;
+	size_t i;
+
+	/* the groups are freed after their slots, not while walking them */
+	pthread_mutex_lock(&wayca_groups_table.mutex);
+	for (i = 0; i < wayca_groups_table.size; i++) {
+		group = __atomic_load_n(&wayca_groups_table.objs[i],
+					__ATOMIC_ACQUIRE);
+		if (!group)
+			continue;
+
+		pthread_mutex_lock(&group->mutex);
+		if (!group->father && (group->attribute & WT_GF_REARRANGE) &&
+		    (event == WAYCA_SC_TOPO_EV_CPU_ONLINE ||
+		     cpumask_test_cpu(cpu, group->total)))
+			wayca_group_rearrange_group(group);
+		pthread_mutex_unlock(&group->mutex);
+	}
+	pthread_mutex_unlock(&wayca_groups_table.mutex);
+}
+
+static void wayca_group_register_notifier(void)
+{
+	wayca_group_notifier_registered =
+		!wayca_sc_topo_register_notifier(wayca_group_topo_notifier,
+						 WAYCA_SC_TOPO_EV_CPU_ONLINE |
+						 WAYCA_SC_TOPO_EV_CPU_OFFLINE,
+						 NULL);
+}
+
 int WAYCA_SC_DECLSPEC wayca_sc_group_set_attr(wayca_sc_group_t group,
 					      wayca_sc_group_attr_t *attr)
 {
@@ -773,6 +698,11 @@ int WAYCA_SC_DECLSPEC wayca_sc_group_set_attr(wayca_sc_group_t group,
 	if (!wg_p)
 		return -EINVAL;
 
+	/* Registered before taking the lock the notifier takes */
+	if (*attr & WT_GF_REARRANGE)
+		pthread_once(&wayca_group_notifier_once,
+			     wayca_group_register_notifier);
+
 	pthread_mutex_lock(&wg_p->mutex);
 	old_attr = wg_p->attribute;
 	wg_p->attribute = *attr;
@@ -807,33 +737,32 @@ int WAYCA_SC_DECLSPEC wayca_sc_group_get_attr(wayca_sc_group_t group,
 
 static struct wayca_sc_group *wayca_group_alloc(void)
 {
+	size_t size = sizeof(struct wayca_sc_group) + 2 * cpumask_size();
+	struct wayca_sc_group *group;
 	wayca_sc_group_t id;
 
-	pthread_mutex_lock(&wayca_groups_array_mutex);
-	if (find_free_group_id_locked(&id) < 0)
-		goto err;
-
-	wayca_groups_array[id] = malloc(sizeof(struct wayca_sc_group));
-	if (!wayca_groups_array[id])
-		goto err;
+	if (wayca_id_get(&wayca_groups_table, &id) < 0)
+		return NULL;
 
-	pthread_mutex_unlock(&wayca_groups_array_mutex);
+	/* The cpumasks follow the structure in the same allocation */
+	group = malloc(size);
+	if (!group) {
+		wayca_id_put(&wayca_groups_table, id);
+		return NULL;
+	}
 
-	memset(wayca_groups_array[id], 0, sizeof(struct wayca_sc_group));
-	wayca_groups_array[id]->id = id;
+	memset(group, 0, size);
+	group->id = id;
+	group->used = (cpu_set_t *)(group + 1);
+	group->total = (cpu_set_t *)((char *)group->used + cpumask_size());
 
-	return wayca_groups_array[id];
-err:
-	pthread_mutex_unlock(&wayca_groups_array_mutex);
-	return NULL;
+	return group;
 }
 
 static void wayca_group_free(struct wayca_sc_group *group)
 {
-	pthread_mutex_lock(&wayca_groups_array_mutex);
-	wayca_groups_array[group->id] = NULL;
+	wayca_id_put(&wayca_groups_table, group->id);
 	free(group);
-	pthread_mutex_unlock(&wayca_groups_array_mutex);
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_group_create(wayca_sc_group_t *group)
@@ -854,6 +783,7 @@ int WAYCA_SC_DECLSPEC wayca_sc_group_create(wayca_sc_group_t *group)
 		return ret;
 	}
 
+	wayca_id_publish(&wayca_groups_table, wg_p->id, wg_p);
 	*group = wg_p->id;
 	return 0;
 }
@@ -1099,41 +1029,35 @@ static void *wayca_threadpool_worker_func(void *priv)
 
 static struct wayca_threadpool *wayca_threadpool_alloc(size_t thread_num)
 {
+	struct wayca_threadpool *pool;
 	wayca_sc_threadpool_t id;
 
-	pthread_mutex_lock(&wayca_threadpools_array_mutex);
-	if (find_free_threadpool_id_locked(&id) < 0)
-		goto err;
+	if (wayca_id_get(&wayca_threadpools_table, &id) < 0)
+		return NULL;
 
-	wayca_threadpools_array[id] = malloc(sizeof(struct wayca_threadpool));
-	if (!wayca_threadpools_array[id])
+	pool = malloc(sizeof(struct wayca_threadpool));
+	if (!pool)
 		goto err;
-	memset(wayca_threadpools_array[id], 0, sizeof(struct wayca_threadpool));
+	memset(pool, 0, sizeof(struct wayca_threadpool));
 
-	wayca_threadpools_array[id]->workers = malloc(thread_num *
-						sizeof(struct wayca_threads *));
-	if (!wayca_threadpools_array[id]->workers) {
-		free(wayca_threadpools_array[id]);
-		wayca_threadpools_array[id] = NULL;
+	pool->workers = malloc(thread_num * sizeof(struct wayca_threads *));
+	if (!pool->workers) {
+		free(pool);
 		goto err;
 	}
 
-	pthread_mutex_unlock(&wayca_threadpools_array_mutex);
-	wayca_threadpools_array[id]->id = id;
-
-	return wayca_threadpools_array[id];
+	pool->id = id;
+	return pool;
 err:
-	pthread_mutex_unlock(&wayca_threadpools_array_mutex);
+	wayca_id_put(&wayca_threadpools_table, id);
 	return NULL;
 }
 
 static void wayca_threadpool_free(struct wayca_threadpool *pool)
 {
-	pthread_mutex_lock(&wayca_threadpools_array_mutex);
-	wayca_threadpools_array[pool->id] = NULL;
+	wayca_id_put(&wayca_threadpools_table, pool->id);
 	free(pool->workers);
 	free(pool);
-	pthread_mutex_unlock(&wayca_threadpools_array_mutex);
 }
 
 static int wayca_threadpool_init(struct wayca_threadpool *pool,
@@ -1203,6 +1127,7 @@ ssize_t WAYCA_SC_DECLSPEC wayca_sc_threadpool_create(wayca_sc_threadpool_t *thre
 		return -ENOMEM;
 	}
 
+	wayca_id_publish(&wayca_threadpools_table, pool->id, pool);
 	*threadpool = pool->id;
 	return pool->total_worker_num;
 }
@@ -1364,12 +1289,12 @@ int WAYCA_SC_DECLSPEC wayca_sc_thread_get_cpuset(wayca_sc_thread_t wthread,
 	if (!wt_p)
 		return -EINVAL;
 
-	valid_cpu_setsize = CPU_ALLOC_SIZE(wayca_sc_cpus_in_total());
+	valid_cpu_setsize = cpumask_size();
 	if (cpusetsize < valid_cpu_setsize)
 		return -EINVAL;
 
-	CPU_ZERO(cpuset);
-	CPU_OR(cpuset, cpuset, &wt_p->cur_set);
+	CPU_ZERO_S(cpusetsize, cpuset);
+	cpumask_copy(cpuset, wt_p->cur_set);
 
 	return 0;
 }
@@ -1388,12 +1313,12 @@ int WAYCA_SC_DECLSPEC wayca_sc_group_get_cpuset(wayca_sc_group_t group,
 	if (!wg_p)
 		return -EINVAL;
 
-	valid_cpu_setsize = CPU_ALLOC_SIZE(wayca_sc_cpus_in_total());
+	valid_cpu_setsize = cpumask_size();
 	if (cpusetsize < valid_cpu_setsize)
 		return -EINVAL;
 
-	CPU_ZERO(cpuset);
-	CPU_OR(cpuset, cpuset, &wg_p->total);
+	CPU_ZERO_S(cpusetsize, cpuset);
+	cpumask_copy(cpuset, wg_p->total);
 
 	return 0;
 }
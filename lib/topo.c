@@ -23,13 +23,16 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include "bitops.h"
 #include "common.h"
 #include "log.h"
 #include "wayca-scheduler.h"
@@ -37,277 +40,268 @@
 #include "topo.h"
 
 WAYCA_SC_INIT_PRIO(topo_init, TOPO);
-WAYCA_SC_FINI_PRIO(topo_free, TOPO);
-static struct wayca_topo topo;
+WAYCA_SC_FINI_PRIO(topo_exit, TOPO);
+static void topo_free(struct wayca_topo *p_topo);
+static int topo_shared_attach(struct wayca_topo *p_topo,
+			      struct topo_shared *shared);
+static void topo_shared_seal(struct wayca_topo *p_topo, unsigned int phases);
+static void topo_shared_put(struct topo_shared *shared);
 
-static size_t max_cores;
-static size_t max_ccls;
-
-/* topo_expand_mem - expand memory size to 'new_size', if ptr is not empty,
- * original data will be copied to the new allocated buffer. Or a totally new
- * buffer will be returned.
- *
- * note: regardless of whether the execution is successful or not, the
- * original memory will be released.
+/*
+ * The topology is published in versions. A hotplug event doesn't modify
+ * the current version, a new one is built and the pointer is swapped, so
+ * the readers never wait on a lock. Only the lazily loaded phases are added
+ * to a published version, see topo_load_phase().
  *
- * - ptr: origin memory pointer
- * - old_size: origin memory size
- * - new_size: size expend to
- * return:
- *   NULL: fail to alloc memory, and origin memory will be freed.
- *   other: success to expand the memory
+ * A query holds the version it reads in a reader slot of its thread until
+ * it returns, and the queries nested in it read the same version. When a
+ * new version is published, the replaced ones which no slot holds are
+ * freed, so only the versions still being read are kept. The device and
+ * IRQ records, which the callers keep pointers to, are not freed along
+ * with the versions but shared by them, see struct topo_shared.
  */
-void *topo_expand_mem(void *ptr, size_t old_size, size_t new_size)
+struct topo_reader {
+	struct wayca_topo *version;	/* the version held, NULL if none */
+	unsigned int depth;		/* nesting of the queries */
+	bool used;			/* owned by a live thread */
+	struct topo_reader *next;
+} __attribute__((aligned(WAYCA_SC_CACHELINE_SIZE)));
+
+static struct wayca_topo topo_initial;
+static struct wayca_topo *topo_current = &topo_initial;
+static unsigned long topo_nr_retired;	/* replaced versions not freed yet */
+
+/* the slots of the threads, a slot is reused once its thread exits */
+static struct topo_reader *topo_readers;
+static __thread struct topo_reader *topo_reader;
+static pthread_key_t topo_reader_key;
+static pthread_once_t topo_reader_once = PTHREAD_ONCE_INIT;
+static int topo_reader_key_err;
+/* set if a thread reads without a slot, no version is freed then */
+static bool topo_reclaim_off;
+
+/* release the slot of the calling thread, which is exiting */
+static void topo_reader_release(void *data)
 {
-	void *mem = NULL;
+	struct topo_reader *reader = data;
 
-	if (new_size == 0 || old_size > new_size)
-		goto out;
-
-	mem = calloc(new_size, sizeof(char));
-	if (!mem)
-		goto out;
-
-	if (!ptr || old_size == 0)
-		goto out;
-	memcpy(mem, ptr, old_size);
-out:
-	/*
-	 * Though free() can correctly handle the NULL pointer, check it
-	 * explicitly to avoid confusion.
-	 */
-	if (ptr)
-		free(ptr);
-	return mem;
+	reader->depth = 0;
+	__atomic_store_n(&reader->version, NULL, __ATOMIC_RELEASE);
+	__atomic_store_n(&reader->used, false, __ATOMIC_RELEASE);
+	topo_reader = NULL;
 }
 
-/* topo_path_read_buffer - read from filename into buf, maximum 'count' in size
- * return:
- *   negative on error
- *   0 or more: total number of bytes read
- */
-static int topo_path_read_buffer(const char *base, const char *filename,
-				 char *buf, size_t count)
-{
-	char *real_path = NULL;
-	int c = 0, tries = 0;
-	int dir_fd;
-	int fd;
-	FILE *f;
-	int ret;
-
-	real_path = realpath(base, NULL);
-	if (!real_path)
-		return -errno;
-
-	dir_fd = open(real_path, O_RDONLY | O_CLOEXEC);
-	free(real_path);
-	if (dir_fd == -1)
-		return -errno;
+/* only the thread calling fork() lives on in the child */
+static void topo_reader_atfork_child(void)
+{
+	struct topo_reader *reader;
 
-	fd = openat(dir_fd, filename, O_RDONLY);
-	if (fd == -1) {
-		ret = errno;
-		close(dir_fd);
-		return -ret;
+	for (reader = topo_readers; reader; reader = reader->next) {
+		if (reader == topo_reader)
+			continue;
+		reader->depth = 0;
+		reader->version = NULL;
+		reader->used = false;
 	}
+}
 
-	f = fdopen(fd, "r");
-	if (f == NULL) {
-		ret = errno;
-		close(fd);
-		close(dir_fd);
-		return -ret;
-	}
+static void topo_reader_key_init(void)
+{
+	topo_reader_key_err = pthread_key_create(&topo_reader_key,
+						 topo_reader_release);
+	if (!topo_reader_key_err)
+		pthread_atfork(NULL, NULL, topo_reader_atfork_child);
+}
 
-	memset(buf, 0, count);
-	while (count > 0) {
-		ret = read(fd, buf, count);
-		if (ret < 0) {
-			if ((errno == EAGAIN || errno == EINTR) &&
-			    (tries++ < WAYCA_SC_MAX_FD_RETRIES)) {
-				usleep(WAYCA_SC_USLEEP_DELAY_250MS);
-				continue;
-			}
-			c = c ? c : (-errno);
-			break;
-		}
-		if (ret == 0)
+/* topo_reader_slot - take a free slot for the calling thread, or a new one */
+static struct topo_reader *topo_reader_slot(void)
+{
+	struct topo_reader *reader;
+	bool used;
+
+	pthread_once(&topo_reader_once, topo_reader_key_init);
+	if (topo_reader_key_err)
+		return NULL;
+
+	for (reader = __atomic_load_n(&topo_readers, __ATOMIC_SEQ_CST);
+	     reader; reader = reader->next) {
+		used = false;
+		if (__atomic_compare_exchange_n(&reader->used, &used, true,
+						false, __ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
 			break;
-		tries = 0;
-		count -= ret;
-		buf += ret;
-		c += ret;
 	}
 
-	fclose(f);
-	close(fd);
-	close(dir_fd);
+	if (!reader) {
+		reader = aligned_alloc(WAYCA_SC_CACHELINE_SIZE,
+				       sizeof(*reader));
+		if (!reader)
+			return NULL;
+		memset(reader, 0, sizeof(*reader));
+		reader->used = true;
+		reader->next = __atomic_load_n(&topo_readers, __ATOMIC_SEQ_CST);
+		while (!__atomic_compare_exchange_n(&topo_readers,
+						    &reader->next, reader,
+						    false, __ATOMIC_SEQ_CST,
+						    __ATOMIC_SEQ_CST))
+			;
+	}
 
-	return c;
+	if (pthread_setspecific(topo_reader_key, reader)) {
+		topo_reader_release(reader);
+		return NULL;
+	}
+	return reader;
 }
 
-/* return negative on error, 0 on success */
-static int topo_path_read_s32(const char *base, const char *filename,
-			      int *result)
+/*
+ * topo_get - hold the current version of the topology, until it's put by
+ * topo_put(). The variable the version is assigned to is declared with
+ * __topo_ref, so it's put when the variable goes out of scope.
+ */
+static struct wayca_topo *topo_get(void)
 {
-	char *real_path = NULL;
-	int dir_fd;
-	int fd;
-	FILE *f;
-	int ret, t;
+	struct topo_reader *reader = topo_reader;
+	struct wayca_topo *p_topo;
+
+	if (!reader)
+		reader = topo_reader = topo_reader_slot();
+	if (!reader) {
+		/* no telling when the version isn't read any more */
+		__atomic_store_n(&topo_reclaim_off, true, __ATOMIC_SEQ_CST);
+		return __atomic_load_n(&topo_current, __ATOMIC_SEQ_CST);
+	}
 
-	real_path = realpath(base, NULL);
-	if (!real_path)
-		return -errno;
+	if (reader->depth++)
+		return reader->version;
 
-	dir_fd = open(real_path, O_RDONLY | O_CLOEXEC);
-	free(real_path);
-	if (dir_fd == -1)
-		return -errno;
+	/* the version is held once it's seen still current after that */
+	do {
+		p_topo = __atomic_load_n(&topo_current, __ATOMIC_SEQ_CST);
+		__atomic_store_n(&reader->version, p_topo, __ATOMIC_SEQ_CST);
+	} while (__atomic_load_n(&topo_current, __ATOMIC_SEQ_CST) != p_topo);
 
-	fd = openat(dir_fd, filename, O_RDONLY);
-	if (fd == -1) {
-		ret = errno;
-		close(dir_fd);
-		return -ret;
-	}
+	return p_topo;
+}
 
-	f = fdopen(fd, "r");
-	if (f == NULL) {
-		ret = errno;
-		close(fd);
-		close(dir_fd);
-		return -ret;
-	}
+static void topo_put(struct wayca_topo **p_topo)
+{
+	struct topo_reader *reader = topo_reader;
 
-	ret = fscanf(f, "%d", &t);
+	if (reader && reader->depth && !--reader->depth)
+		__atomic_store_n(&reader->version, NULL, __ATOMIC_RELEASE);
+}
 
-	fclose(f);
-	close(fd);
-	close(dir_fd);
+#define __topo_ref	__attribute__((cleanup(topo_put)))
 
-	if (ret != 1)
-		return -EINVAL;
-	if (result)
-		*result = t;
-	return 0;
+/* get the current version after the online CPUs are brought up to date */
+static struct wayca_topo *topo_get_synced(void)
+{
+	topo_hotplug_sync();
+	return topo_get();
+}
+
+/* Whether a thread still holds @p_topo */
+static bool topo_is_held(const struct wayca_topo *p_topo)
+{
+	struct topo_reader *reader;
+
+	for (reader = __atomic_load_n(&topo_readers, __ATOMIC_SEQ_CST);
+	     reader; reader = reader->next)
+		if (__atomic_load_n(&reader->version, __ATOMIC_SEQ_CST) ==
+		    p_topo)
+			return true;
+	return false;
 }
 
 /*
- * topo_path_read_multi_s32 - read nmemb s32 integer from the given filename
- *  - array: is a pre-allocated integer array
- *  - nmemb: number of members to read from file "base/filename"
- *
- * return negative on error, 0 on success
+ * topo_reclaim - free the replaced versions no thread holds any more,
+ * with topo_phase_mutex held after a new version is published
  */
-static int topo_path_read_multi_s32(const char *base, const char *filename,
-				    size_t nmemb, int array[])
-{
-	char *real_path = NULL;
-	int dir_fd;
-	int fd;
-	FILE *f;
-	int i, t;
-	int ret = 0;
-
-	real_path = realpath(base, NULL);
-	if (!real_path)
-		return -errno;
-
-	dir_fd = open(real_path, O_RDONLY | O_CLOEXEC);
-	free(real_path);
-	if (dir_fd == -1)
-		return -errno;
-
-	fd = openat(dir_fd, filename, O_RDONLY);
-	if (fd == -1) {
-		ret = errno;
-		close(dir_fd);
-		return -ret;
-	}
+static void topo_reclaim(void)
+{
+	struct wayca_topo **pos = &topo_current->retired;
+	struct wayca_topo *p_topo;
 
-	f = fdopen(fd, "r");
-	if (f == NULL) {
-		ret = errno;
-		close(fd);
-		close(dir_fd);
-		return -ret;
-	}
+	if (__atomic_load_n(&topo_reclaim_off, __ATOMIC_SEQ_CST))
+		return;
 
-	for (i = 0; i < nmemb; i++) {
-		if (fscanf(f, "%d", &t) != 1) {
-			ret = -EINVAL;
-			break;
+	while ((p_topo = *pos) != NULL) {
+		if (topo_is_held(p_topo)) {
+			pos = &p_topo->retired;
+			continue;
 		}
-		array[i] = t;
+		*pos = p_topo->retired;
+		topo_free(p_topo);
+		if (p_topo != &topo_initial)
+			free(p_topo);
+		topo_nr_retired--;
 	}
-
-	fclose(f);
-	close(fd);
-	close(dir_fd);
-
-	return ret;
 }
 
 /*
- * topo_path_parse_meminfo - parse 'meminfo'
- *  - filename: usually, this is 'meminfo'
- *  - p_meminfo: a pre-allocated space to store parsing results
- *
- * return negative on error, 0 on success
+ * The device or IRQ records of the topology. They don't change with the
+ * CPUs, so the versions share them rather than copying them, and a record
+ * is never modified once shared. The first ones loaded are kept until the
+ * exit and attached to the later versions, so the names and the arrays
+ * returned to the callers stay valid after the version they were read
+ * from is freed. Only changed with topo_phase_mutex held.
  */
-static int topo_path_parse_meminfo(struct wayca_meminfo *p_meminfo,
-					const char *base, const char *filename)
-{
-	char *real_path = NULL;
-	char buf[BUFSIZ];
-	int ret = -1;
-	int dir_fd;
-	char *ptr;
-	FILE *f;
-	int fd;
-
-	real_path = realpath(base, NULL);
-	if (!real_path)
-		return -errno;
-
-	dir_fd = open(real_path, O_RDONLY | O_CLOEXEC);
-	free(real_path);
-	if (dir_fd == -1)
-		return -errno;
+struct topo_shared_node {
+	size_t n_pcidevs;
+	struct wayca_pci_device **pcidevs;
+	size_t n_smmus;
+	struct wayca_smmu **smmus;
+};
 
-	fd = openat(dir_fd, filename, O_RDONLY);
-	if (fd == -1) {
-		ret = errno;
-		close(dir_fd);
-		return -ret;
-	}
+struct topo_shared {
+	unsigned int refcount;		/* versions attached, and the global */
+	enum topo_phase phase;		/* TOPO_PHASE_DEVICE or _IRQ */
+	size_t n_nodes;
+	struct topo_shared_node *nodes;	/* devices of each node */
+	size_t n_irqs;
+	struct wayca_irq **irqs;
+	struct topo_index *index;
+};
 
-	f = fdopen(fd, "r");
-	if (f == NULL) {
-		ret = errno;
-		close(fd);
-		close(dir_fd);
-		return -ret;
-	}
+static struct topo_shared *topo_shared[TOPO_PHASE_MAX];
 
-	while (fgets(buf, sizeof(buf), f) != NULL) {
-		ptr = strstr(buf, "MemTotal:");
-		if (ptr == NULL)
-			continue;
+/* topo_expand_mem - expand memory size to 'new_size', if ptr is not empty,
+ * original data will be copied to the new allocated buffer. Or a totally new
+ * buffer will be returned.
+ *
+ * note: regardless of whether the execution is successful or not, the
+ * original memory will be released.
+ *
+ * - ptr: origin memory pointer
+ * - old_size: origin memory size
+ * - new_size: size expend to
+ * return:
+ *   NULL: fail to alloc memory, and origin memory will be freed.
+ *   other: success to expand the memory
+ */
+void *topo_expand_mem(void *ptr, size_t old_size, size_t new_size)
+{
+	void *mem = NULL;
 
-		if (sscanf(ptr, "%*s %lu", &p_meminfo->total_avail_kB) != 1)
-			break;
-		ret = 0;
-		break;
-	}
+	if (new_size == 0 || old_size > new_size)
+		goto out;
 
-	fclose(f);
-	close(fd);
-	close(dir_fd);
+	mem = calloc(new_size, sizeof(char));
+	if (!mem)
+		goto out;
 
-	return ret;
+	if (!ptr || old_size == 0)
+		goto out;
+	memcpy(mem, ptr, old_size);
+out:
+	/*
+	 * Though free() can correctly handle the NULL pointer, check it
+	 * explicitly to avoid confusion.
+	 */
+	if (ptr)
+		free(ptr);
+	return mem;
 }
 
 /* Note: cpuset_nbits(), nextnumber(), nexttoken(), cpulist_parse() are referenced
@@ -396,76 +390,82 @@ int cpulist_parse(const char *str, cpu_set_t *set, size_t setsize, int fail)
 	return 0;
 }
 
-/* return negative value on error, 0 on success */
-/* cpu_set_t *set: can contain anything and will be zero'ed by cpulist_parse() */
-static int topo_path_read_cpulist(const char *base, const char *filename,
-				  cpu_set_t *set, int maxcpus)
+/*
+ * Whether the CPU is online in the topology. While parsing, it's the
+ * cpu/online read at the beginning of the CPU phase, so the topology is
+ * built against one consistent view of the online CPUs. Later it's kept up
+ * to date by the hotplug tracking in topo_hotplug.c.
+ */
+static bool topo_cpu_is_online(const struct wayca_topo *p_topo, int cpu_index)
 {
-	size_t len = maxcpus * 8; /* big enough to hold a CPU ids */
-	char *real_path = NULL;
-	int ret = 0;
-	int dir_fd;
-	char *buf;
-	FILE *f;
-	int fd;
-
-	real_path = realpath(base, NULL);
-	if (!real_path)
-		return -errno;
-
-	dir_fd = open(real_path, O_RDONLY | O_CLOEXEC);
-	free(real_path);
-	if (dir_fd == -1)
-		return -errno;
+	return CPU_ISSET_S(cpu_index, p_topo->setsize, p_topo->online_cpu_map);
+}
 
-	fd = openat(dir_fd, filename, O_RDONLY);
-	if (fd == -1) {
-		close(dir_fd);
-		return -errno;
-	}
+/*
+ * topo_get_cpu_node - find NUMA node @node_index, create it if it's not
+ * found yet. The nodes are kept dense and in the order of their ids, as
+ * the ids may have holes and node%d/distance follows the id order.
+ *
+ * Return the node, NULL if out of memory
+ */
+static struct wayca_node *topo_get_cpu_node(struct wayca_topo *p_topo,
+					    int node_index)
+{
+	struct wayca_node *p_node;
+	int i;
 
-	f = fdopen(fd, "r");
-	if (f == NULL) {
-		close(fd);
-		close(dir_fd);
-		return -errno;
+	for (i = 0; i < p_topo->n_nodes; i++) {
+		if (p_topo->nodes[i]->node_idx == node_index)
+			return p_topo->nodes[i];
+		if (p_topo->nodes[i]->node_idx > node_index)
+			break;
 	}
 
-	buf = calloc(len, sizeof(char));
-	if (!buf) {
-		ret = -ENOMEM;
-		goto close_file;
+	p_node = (struct wayca_node *)calloc(1, sizeof(struct wayca_node));
+	if (!p_node)
+		return NULL;
+	p_node->node_idx = node_index;
+
+	/* initialize this node's cluster_map, core_map and possible cpu_map */
+	p_node->cluster_map = CPU_ALLOC(p_topo->kernel_max_cpus);
+	p_node->core_map = CPU_ALLOC(p_topo->kernel_max_cpus);
+	p_node->cpu_map = CPU_ALLOC(p_topo->kernel_max_cpus);
+	if (!p_node->cluster_map || !p_node->core_map || !p_node->cpu_map)
+		goto err;
+
+	/* topo_expand_mem() frees the old array on failure */
+	p_topo->nodes = (struct wayca_node **)topo_expand_mem(p_topo->nodes,
+			p_topo->n_nodes * sizeof(*p_topo->nodes),
+			(p_topo->n_nodes + 1) * sizeof(*p_topo->nodes));
+	if (!p_topo->nodes) {
+		p_topo->n_nodes = 0;
+		goto err;
 	}
-
-	if (fgets(buf, len, f) == NULL)
-		ret = -errno;
-
-close_file:
-	fclose(f);
-	close(fd);
-	close(dir_fd);
-
-	if (ret != 0)
-		goto free_buf;
-
-	len = strlen(buf);
-	if (buf[len - 1] == '\n')
-		buf[len - 1] = '\0';
-
-	if (cpulist_parse(buf, set, CPU_ALLOC_SIZE(maxcpus), 0))
-		ret = -EINVAL;
-
-free_buf:
-	free(buf);
-	return ret;
+	CPU_ZERO_S(p_topo->setsize, p_node->cluster_map);
+	CPU_ZERO_S(p_topo->setsize, p_node->core_map);
+	CPU_ZERO_S(p_topo->setsize, p_node->cpu_map);
+
+	memmove(&p_topo->nodes[i + 1], &p_topo->nodes[i],
+		(p_topo->n_nodes - i) * sizeof(*p_topo->nodes));
+	p_topo->nodes[i] = p_node;
+	p_topo->n_nodes++;
+
+	/* add node_index into the top-level node map */
+	CPU_SET_S(node_index, CPU_ALLOC_SIZE(p_topo->n_cpus), p_topo->node_map);
+	return p_node;
+
+err:
+	CPU_FREE(p_node->cluster_map);
+	CPU_FREE(p_node->core_map);
+	CPU_FREE(p_node->cpu_map);
+	free(p_node);
+	return NULL;
 }
 
-static bool wayca_sc_is_cpu_online(int cpu);
-
 static int topo_parse_cpu_node_info(struct wayca_topo *p_topo, int cpu_index)
 {
 	char path_buffer[WAYCA_SC_PATH_LEN_MAX];
-	static int max_node_index = -1; /* actual node_index starts from 0 */
+	struct wayca_node *p_node;
 	struct dirent *dirent;
 	long node_index;
 	char *endptr;
@@ -488,78 +488,16 @@ static int topo_parse_cpu_node_info(struct wayca_topo *p_topo, int cpu_index)
 			continue;
 		if (endptr == dirent->d_name + 4)
 			continue;
-		/* check whether need more node space */
-		if (node_index > max_node_index) {
-			max_node_index = node_index;
-			/*
-			 * Unnecessary to check the overflow of the
-			 * realloc(), max_node_index cannot be that
-			 * large.
-			 */
-			p_topo->nodes = (struct wayca_node **)topo_expand_mem(
-				p_topo->nodes,
-				node_index * sizeof(*p_topo->nodes),
-				(node_index + 1) * sizeof(*p_topo->nodes));
-			if (!p_topo->nodes) {
-				closedir(dir);
-				PRINT_ERROR("why I failed\n");
-				return -ENOMEM;
-			}
-		}
-		/*
-		 * check this 'node_index' node exist or not. if not, create one
-		 */
-		if (!CPU_ISSET_S(node_index, CPU_ALLOC_SIZE(p_topo->n_cpus),
-				 p_topo->node_map)) {
-			p_topo->nodes[node_index] = (struct wayca_node *)calloc(
-				1, sizeof(struct wayca_node));
-			if (!p_topo->nodes[node_index]) {
-				closedir(dir);
-				return -ENOMEM;
-			}
-			p_topo->nodes[node_index]->node_idx = node_index;
-
-			/* initialize this node's cluster_map */
-			p_topo->nodes[node_index]->cluster_map =
-				CPU_ALLOC(p_topo->kernel_max_cpus);
-			if (!p_topo->nodes[node_index]->cluster_map) {
-				closedir(dir);
-				return -ENOMEM;
-			}
-			CPU_ZERO_S(p_topo->setsize,
-				   p_topo->nodes[node_index]->cluster_map);
-
-			/* initialize this node's core_map */
-			p_topo->nodes[node_index]->core_map =
-				CPU_ALLOC(p_topo->kernel_max_cpus);
-			if (!p_topo->nodes[node_index]->core_map) {
-				closedir(dir);
-				return -ENOMEM;
-			}
-			CPU_ZERO_S(p_topo->setsize,
-				   p_topo->nodes[node_index]->core_map);
-
-			/* initialize this node's possible cpu_map */
-			p_topo->nodes[node_index]->cpu_map =
-				CPU_ALLOC(p_topo->kernel_max_cpus);
-			if (!p_topo->nodes[node_index]->cpu_map) {
-				closedir(dir);
-				return -ENOMEM;
-			}
-			CPU_ZERO_S(p_topo->setsize,
-				   p_topo->nodes[node_index]->cpu_map);
-			/* add node_index into the top-level node map */
-			CPU_SET_S(node_index, CPU_ALLOC_SIZE(p_topo->n_cpus),
-				  p_topo->node_map);
-			p_topo->n_nodes++;
+		p_node = topo_get_cpu_node(p_topo, node_index);
+		if (!p_node) {
+			closedir(dir);
+			return -ENOMEM;
 		}
 		/* add current CPU into this node's cpu map */
-		CPU_SET_S(cpu_index, p_topo->setsize,
-			  p_topo->nodes[node_index]->cpu_map);
-		p_topo->nodes[node_index]->n_cpus++;
+		CPU_SET_S(cpu_index, p_topo->setsize, p_node->cpu_map);
+		p_node->n_cpus++;
 		/* link this node back to current CPU */
-		p_topo->cpus[cpu_index]->p_numa_node =
-			p_topo->nodes[node_index];
+		p_topo->cpus[cpu_index]->p_numa_node = p_node;
 		break; /* found one "node" entry, no need to check any more */
 	}
 	closedir(dir);
@@ -574,7 +512,7 @@ static int topo_parse_cpu_cluster_info(struct wayca_topo *p_topo,
 	int i;
 
 	/* cluster level may not set or cpu[cpu_indedx] is offline */
-	if (topo_path_read_s32(path_buffer, "cluster_id", &cluster_id) != 0) {
+	if (topo_sysfs_read_s32(path_buffer, "cluster_id", &cluster_id) != 0) {
 		p_topo->cpus[cpu_index]->p_cluster = NULL;
 		return 0;
 	}
@@ -603,9 +541,9 @@ static int topo_parse_cpu_cluster_info(struct wayca_topo *p_topo,
 		if (!p_topo->ccls[i]->cpu_map)
 			return -ENOMEM;
 		/* read "cluster_cpus_list" */
-		ret = topo_path_read_cpulist(path_buffer, "cluster_cpus_list",
-					     p_topo->ccls[i]->cpu_map,
-					     p_topo->kernel_max_cpus);
+		ret = topo_sysfs_read_cpulist(path_buffer, "cluster_cpus_list",
+					      p_topo->ccls[i]->cpu_map,
+					      p_topo->setsize);
 		if (ret) {
 			PRINT_ERROR(
 				"get ccl %d cluster_cpu_list fail, ret = %d\n",
@@ -640,13 +578,13 @@ static int topo_parse_cpu_pkg_info(struct wayca_topo *p_topo,
 	int i;
 
 	/* If the cpu offline,return 0 */
-	if (!wayca_sc_is_cpu_online(cpu_index)) {
+	if (!topo_cpu_is_online(p_topo, cpu_index)) {
 		p_topo->cpus[cpu_index]->p_package = NULL;
 		return 0;
 	}
 
 	/* read "physical_package_id" */
-	ret = topo_path_read_s32(path_buffer, "physical_package_id", &ppkg_id);
+	ret = topo_sysfs_read_s32(path_buffer, "physical_package_id", &ppkg_id);
 	if (ret) {
 		PRINT_ERROR("get physical_package_id fail, ret = %d\n", ret);
 		return ret;
@@ -681,9 +619,9 @@ static int topo_parse_cpu_pkg_info(struct wayca_topo *p_topo,
 		CPU_ZERO_S(CPU_ALLOC_SIZE(p_topo->n_cpus),
 			   p_topo->packages[i]->numa_map);
 		/* read "package_cpus_list" */
-		ret = topo_path_read_cpulist(path_buffer, "package_cpus_list",
-					     p_topo->packages[i]->cpu_map,
-					     p_topo->kernel_max_cpus);
+		ret = topo_sysfs_read_cpulist(path_buffer, "package_cpus_list",
+					      p_topo->packages[i]->cpu_map,
+					      p_topo->setsize);
 		if (ret) {
 			PRINT_ERROR(
 				"get package %d package_cpu_list fail, ret = %d\n",
@@ -707,14 +645,14 @@ static int topo_parse_cpu_core_info(struct wayca_topo *p_topo,
 	int ret;
 
 	/* If the cpu offline,return 0 */
-	if (!wayca_sc_is_cpu_online(cpu_index)) {
+	if (!topo_cpu_is_online(p_topo, cpu_index)) {
 		p_topo->cpus[cpu_index]->core_id = -1;
 		p_topo->cpus[cpu_index]->core_cpus_map = NULL;
 		return 0;
 	}
 
 	/* read "core_id" */
-	ret = topo_path_read_s32(path_buffer, "core_id", &core_id);
+	ret = topo_sysfs_read_s32(path_buffer, "core_id", &core_id);
 	if (ret) {
 		PRINT_ERROR("get core_id fail, ret = %d\n", ret);
 		return ret;
@@ -728,9 +666,9 @@ static int topo_parse_cpu_core_info(struct wayca_topo *p_topo,
 		return -ENOMEM;
 
 	/* read "core_cpus_list" */
-	ret = topo_path_read_cpulist(path_buffer, "core_cpus_list",
-				     p_topo->cpus[cpu_index]->core_cpus_map,
-				     p_topo->kernel_max_cpus);
+	ret = topo_sysfs_read_cpulist(path_buffer, "core_cpus_list",
+				      p_topo->cpus[cpu_index]->core_cpus_map,
+				      p_topo->setsize);
 	if (ret) {
 		PRINT_ERROR("get cpu %d core_cpus_list fail, ret = %d\n",
 			    cpu_index, ret);
@@ -742,76 +680,46 @@ static int topo_parse_cpu_core_info(struct wayca_topo *p_topo,
 static int topo_parse_cache_info(struct wayca_cache *cache, const char *path,
 				int max_cpus)
 {
-	int type_len, real_len;
-	int ret;
+	struct topo_sysfs_attr attrs[] = {
+		{ .name = "id", .type = TOPO_SYSFS_S32, .val = &cache->id },
+		{ .name = "level", .type = TOPO_SYSFS_S32, .val = &cache->level },
+		{ .name = "type", .type = TOPO_SYSFS_STR,
+		  .val = cache->type, .len = WAYCA_SC_ATTR_STRING_LEN },
+		{ .name = "allocation_policy", .type = TOPO_SYSFS_STR,
+		  .val = cache->allocation_policy,
+		  .len = WAYCA_SC_ATTR_STRING_LEN },
+		{ .name = "write_policy", .type = TOPO_SYSFS_STR,
+		  .val = cache->write_policy, .len = WAYCA_SC_ATTR_STRING_LEN },
+		{ .name = "ways_of_associativity", .type = TOPO_SYSFS_S32,
+		  .val = &cache->ways_of_associativity },
+		{ .name = "physical_line_partition", .type = TOPO_SYSFS_S32,
+		  .val = &cache->physical_line_partition },
+		{ .name = "number_of_sets", .type = TOPO_SYSFS_S32,
+		  .val = &cache->number_of_sets },
+		{ .name = "coherency_line_size", .type = TOPO_SYSFS_S32,
+		  .val = &cache->coherency_line_size },
+		{ .name = "size", .type = TOPO_SYSFS_STR,
+		  .val = cache->cache_size, .len = WAYCA_SC_ATTR_STRING_LEN },
+		{ .name = "shared_cpu_list", .type = TOPO_SYSFS_CPULIST,
+		  .len = CPU_ALLOC_SIZE(max_cpus) },
+	};
+	struct topo_sysfs_attr *shared = &attrs[ARRAY_SIZE(attrs) - 1];
+
+	/* id and level default to -1, strings to empty on failure */
+	cache->id = -1;
+	cache->level = -1;
 
-	/* read cache: id, level, type. default set to -1 on failure */
-	if (topo_path_read_s32(path, "id", &cache->id) != 0)
-		cache->id = -1;
-	if (topo_path_read_s32(path, "level", &cache->level) != 0)
-		cache->level = -1;
-	type_len = topo_path_read_buffer(path, "type", cache->type,
-					 WAYCA_SC_ATTR_STRING_LEN - 1);
-	cache->type[WAYCA_SC_ATTR_STRING_LEN - 1] = '\0';
-	real_len = strlen(cache->type);
-
-	/* remove trailing newline and nonsense chars on success */
-	if (type_len <= 0)
-		cache->type[0] = '\0';
-	else if (cache->type[real_len - 1] == '\n')
-		cache->type[real_len - 1] = '\0';
-
-	/* read cache: allocation_policy */
-	type_len = topo_path_read_buffer(path, "allocation_policy",
-			      cache->allocation_policy,
-			      WAYCA_SC_ATTR_STRING_LEN - 1);
-	cache->allocation_policy[WAYCA_SC_ATTR_STRING_LEN - 1] = '\0';
-	real_len = strlen(cache->allocation_policy);
-	if (type_len <= 0)
-		cache->allocation_policy[0] = '\0';
-	else if (cache->allocation_policy[real_len - 1] == '\n')
-		cache->allocation_policy[real_len - 1] = '\0';
-
-	/* read cache: write_policy */
-	type_len = topo_path_read_buffer(path, "write_policy",
-					 cache->write_policy,
-					 WAYCA_SC_ATTR_STRING_LEN - 1);
-	cache->write_policy[WAYCA_SC_ATTR_STRING_LEN - 1] = '\0';
-	real_len = strlen(cache->write_policy);
-	if (type_len <= 0)
-		cache->write_policy[0] = '\0';
-	else if (cache->write_policy[real_len - 1] == '\n')
-		cache->write_policy[real_len - 1] = '\0';
-
-	/* read cache: ways_of_associativity, etc. */
-	topo_path_read_s32(path, "ways_of_associativity",
-			   (int *)&cache->ways_of_associativity);
-	topo_path_read_s32(path, "physical_line_partition",
-			   (int *)&cache->physical_line_partition);
-	topo_path_read_s32(path, "number_of_sets",
-			   (int *)&cache->number_of_sets);
-	topo_path_read_s32(path, "coherency_line_size",
-			   (int *)&cache->coherency_line_size);
-
-	/* read cache size */
-	type_len = topo_path_read_buffer(path, "size", cache->cache_size,
-					 WAYCA_SC_ATTR_STRING_LEN - 1);
-	real_len = strlen(cache->cache_size);
-	if (type_len <= 0)
-		cache->cache_size[0] = '\0';
-	else if (cache->cache_size[real_len - 1] == '\n')
-		cache->cache_size[real_len - 1] = '\0';
-
-	/* read cache: shared_cpu_list */
 	cache->shared_cpu_map = CPU_ALLOC(max_cpus);
 	if (!cache->shared_cpu_map)
 		return -ENOMEM;
-	ret = topo_path_read_cpulist(path, "shared_cpu_list",
-				     cache->shared_cpu_map, max_cpus);
-	if (ret) {
+	shared->val = cache->shared_cpu_map;
+
+	/* all the attributes except shared_cpu_list are optional */
+	topo_sysfs_read_attrs(path, attrs, ARRAY_SIZE(attrs));
+	if (shared->ret < 0) {
 		PRINT_ERROR("failed to read %s/shared_cpu_list, Error code: %d\n",
-			    path, ret);
-		return ret;
+			    path, shared->ret);
+		return shared->ret;
 	}
 	return 0;
 }
@@ -819,26 +727,25 @@ static int topo_parse_cache_info(struct wayca_cache *cache, const char *path,
 static int topo_parse_cpu_cache_info(struct wayca_topo *p_topo, int cpu_index)
 {
 	char path_buffer[WAYCA_SC_PATH_LEN_MAX];
+	char name[WAYCA_SC_NAME_LEN_MAX];
 	struct wayca_cache *p_caches;
 	size_t n_caches = 0;
 	int ret;
 	int i;
 
 	/* If the cpu offline,return 0 */
-	if (!wayca_sc_is_cpu_online(cpu_index)) {
+	if (!topo_cpu_is_online(p_topo, cpu_index)) {
 		p_topo->cpus[cpu_index]->n_caches = 0;
 		p_topo->cpus[cpu_index]->p_caches = NULL;
 		return 0;
 	}
 
 	/* count the number of caches exists */
+	snprintf(path_buffer, sizeof(path_buffer), "%s/cpu%d/cache",
+		 WAYCA_SC_CPU_FNAME, cpu_index);
 	do {
-		/* move the base to "cpu%d/cache/index%zu" */
-		snprintf(path_buffer, sizeof(path_buffer),
-			 "%s/cpu%d/cache/index%zu", WAYCA_SC_CPU_FNAME,
-			 cpu_index, n_caches);
-		/* check access */
-		if (access(path_buffer, F_OK) != 0) /* doesn't exist */
+		snprintf(name, sizeof(name), "index%zu", n_caches);
+		if (!topo_sysfs_exists(path_buffer, name))
 			break;
 		n_caches++;
 	} while (1);
@@ -896,6 +803,15 @@ static int topo_read_cpu_topology(struct wayca_topo *p_topo, int cpu_index)
 				cpu_index, ret);
 		return ret;
 	}
+
+	/* only the systems with asymmetric CPUs report the capacity */
+	snprintf(path_buffer, sizeof(path_buffer), "%s/cpu%d",
+			WAYCA_SC_CPU_FNAME, cpu_index);
+	if (topo_sysfs_read_s32(path_buffer, "cpu_capacity",
+				&p_topo->cpus[cpu_index]->capacity) ||
+	    p_topo->cpus[cpu_index]->capacity <= 0)
+		p_topo->cpus[cpu_index]->capacity = WAYCA_SC_CPU_CAPACITY_SCALE;
+
 	/* move the base to "cpu%d/topology" */
 	snprintf(path_buffer, sizeof(path_buffer), "%s/cpu%d/topology",
 			WAYCA_SC_CPU_FNAME, cpu_index);
@@ -930,20 +846,59 @@ static int topo_read_cpu_topology(struct wayca_topo *p_topo, int cpu_index)
 	return ret;
 }
 
-/* topo_read_node_topology() - read node%d topoloy, where %d is node_index
+/*
+ * topo_parse_meminfo - parse 'meminfo' of the node directory @dir
+ *  - p_meminfo: a pre-allocated space to store parsing results
+ *
+ * return negative on error, 0 on success
+ */
+static int topo_parse_meminfo(struct wayca_meminfo *p_meminfo, const char *dir)
+{
+	const char *content;
+	char *ptr;
+	int ret;
+
+	ret = topo_sysfs_read(dir, "meminfo", &content);
+	if (ret < 0)
+		return ret;
+
+	ptr = strstr(content, "MemTotal:");
+	if (ptr == NULL ||
+	    sscanf(ptr, "%*s %lu", &p_meminfo->total_avail_kB) != 1)
+		return -EINVAL;
+	return 0;
+}
+
+/* Return the index in p_topo->nodes[] of NUMA node @node_idx, or -EINVAL */
+static int topo_node_index(struct wayca_topo *p_topo, int node_idx)
+{
+	int i;
+
+	for (i = 0; i < p_topo->n_nodes; i++)
+		if (p_topo->nodes[i]->node_idx == node_idx)
+			return i;
+	return -EINVAL;
+}
+
+/* topo_read_node_topology() - read node%d topoloy, where %d is the id of
+ * the node at node_index
+ *  - column: the column of each node in node%d/distance, -1 if it's offline
+ *  - n_online: the number of columns
  *
  * Return negative on error, 0 on success
  */
-static int topo_read_node_topology(struct wayca_topo *p_topo, int node_index)
+static int topo_read_node_topology(struct wayca_topo *p_topo, int node_index,
+				   const int *column, size_t n_online)
 {
 	cpu_set_t *node_cpu_map, *online_cpu_map;
 	char path_buffer[WAYCA_SC_PATH_LEN_MAX];
 	struct wayca_meminfo *meminfo_tmp;
-	int *distance_array;
+	int *distance_array, *row;
 	int ret;
+	int i;
 
 	snprintf(path_buffer, sizeof(path_buffer), "%s/node%d",
-			WAYCA_SC_NODE_FNAME, node_index);
+			WAYCA_SC_NODE_FNAME, p_topo->nodes[node_index]->node_idx);
 
 	/* read node's cpulist */
 	node_cpu_map = CPU_ALLOC(p_topo->kernel_max_cpus);
@@ -956,15 +911,15 @@ static int topo_read_node_topology(struct wayca_topo *p_topo, int node_index)
 	CPU_AND_S(p_topo->setsize, online_cpu_map, p_topo->online_cpu_map,
 		  p_topo->nodes[node_index]->cpu_map);
 
-	ret = topo_path_read_cpulist(path_buffer, "cpulist", node_cpu_map,
-				     p_topo->kernel_max_cpus);
-	/* if topo_path_read_cpulist fail and cpu online, return ret */
-	if (ret && CPU_COUNT_S(topo.setsize, online_cpu_map))
+	ret = topo_sysfs_read_cpulist(path_buffer, "cpulist", node_cpu_map,
+				      p_topo->setsize);
+	/* if topo_sysfs_read_cpulist fail and cpu online, return ret */
+	if (ret && CPU_COUNT_S(p_topo->setsize, online_cpu_map))
 		return ret;
 	/* check w/ what's previously composed in cpu_topology reading */
 	if (!CPU_EQUAL_S(p_topo->setsize, node_cpu_map, online_cpu_map)) {
 		PRINT_ERROR("mismatch detected in node%d cpulist read\n",
-			    node_index);
+			    p_topo->nodes[node_index]->node_idx);
 		return -EINVAL;
 	}
 	CPU_FREE(node_cpu_map);
@@ -972,17 +927,31 @@ static int topo_read_node_topology(struct wayca_topo *p_topo, int node_index)
 
 	/* allocate a distance array */
 	distance_array = (int *)calloc(p_topo->n_nodes, sizeof(int));
-	if (!distance_array)
+	row = (int *)calloc(n_online, sizeof(int));
+	if (!distance_array || !row) {
+		free(distance_array);
+		free(row);
 		return -ENOMEM;
-	/* read node's distance */
-	ret = topo_path_read_multi_s32(path_buffer, "distance", p_topo->n_nodes,
-				       distance_array);
+	}
+	/*
+	 * read node's distance, which has a column for each online node
+	 * including the CPU-less ones
+	 */
+	ret = topo_sysfs_read_s32_array(path_buffer, "distance", n_online, row);
 	if (ret) {
 		PRINT_ERROR("get node distance fail, ret = %d\n", ret);
 		free(distance_array);
+		free(row);
 		return ret;
 	}
 
+	for (i = 0; i < p_topo->n_nodes; i++)
+		distance_array[i] = row[column[p_topo->nodes[i]->node_idx]];
+	for (i = 0; i < p_topo->n_mem_nodes; i++)
+		p_topo->mem_nodes[i].distance[node_index] =
+			row[column[p_topo->mem_nodes[i].node_idx]];
+	free(row);
+
 	p_topo->nodes[node_index]->distance = distance_array;
 
 	/* read meminfo */
@@ -990,7 +959,7 @@ static int topo_read_node_topology(struct wayca_topo *p_topo, int node_index)
 		(struct wayca_meminfo *)calloc(1, sizeof(struct wayca_meminfo));
 	if (!meminfo_tmp)
 		return -ENOMEM;
-	ret = topo_path_parse_meminfo(meminfo_tmp, path_buffer, "meminfo");
+	ret = topo_parse_meminfo(meminfo_tmp, path_buffer);
 	if (ret) {
 		PRINT_ERROR("get node meminfo fail, ret = %d\n", ret);
 		free(meminfo_tmp);
@@ -1002,43 +971,427 @@ static int topo_read_node_topology(struct wayca_topo *p_topo, int node_index)
 	return 0;
 }
 
-/* topo_construct_core_topology
- *  This function takes in wayca_cpus information and construct a wayca_cores
- *  topology.
+/*
+ * topo_alloc_mem_nodes - allocate a memory node for each online node with
+ * memory, including the CPU-less ones like CXL or HBM. Every online node
+ * is taken as having memory if node/has_memory is missing.
+ *
  * Return negative on error, 0 on success
  */
-static int topo_construct_core_topology(struct wayca_topo *p_topo)
+static int topo_alloc_mem_nodes(struct wayca_topo *p_topo,
+				const cpu_set_t *online_nodes)
 {
-	int cur_core_id;
-	int i, j;
+	size_t setsize = CPU_ALLOC_SIZE(WAYCA_SC_MAX_NUMNODES);
+	struct wayca_mem_node *mem;
+	cpu_set_t *has_memory;
+	int ret;
+	int i;
 
-	if (p_topo->cores != NULL || p_topo->n_cores != 0) {
-		WAYCA_SC_LOG_ERR(
-			"duplicated call, wayca_cores has been established\n");
-		return -1;
+	has_memory = CPU_ALLOC(WAYCA_SC_MAX_NUMNODES);
+	if (!has_memory)
+		return -ENOMEM;
+
+	ret = topo_sysfs_read_cpulist(WAYCA_SC_NODE_FNAME, "has_memory",
+				      has_memory, setsize);
+	if (ret == -ENOENT) {
+		memcpy(has_memory, online_nodes, setsize);
+		ret = 0;
 	}
+	if (ret)
+		goto cleanup;
+	CPU_AND_S(setsize, has_memory, has_memory, online_nodes);
 
-	for (i = 0; i < p_topo->n_cpus; i++) {
-		/* read this cpu's core_id */
-		cur_core_id = p_topo->cpus[i]->core_id;
+	p_topo->mem_nodes = (struct wayca_mem_node *)calloc(
+		CPU_COUNT_S(setsize, has_memory) + 1, sizeof(*p_topo->mem_nodes));
+	if (!p_topo->mem_nodes) {
+		ret = -ENOMEM;
+		goto cleanup;
+	}
 
-		/* if cpu[i] is offline, core_id = -1; continue */
-		if (cur_core_id == -1)
+	for (i = 0; i < WAYCA_SC_MAX_NUMNODES; i++) {
+		if (!CPU_ISSET_S(i, setsize, has_memory))
 			continue;
 
-		/* check whether it is already in wayca_core array */
-		for (j = 0; j < p_topo->n_cores; j++) {
-			if (p_topo->cores[j]->core_id == cur_core_id)
-				break; /* it exists, skip */
+		mem = &p_topo->mem_nodes[p_topo->n_mem_nodes++];
+		mem->node_idx = i;
+		mem->node = topo_node_index(p_topo, i);
+		if (mem->node < 0)
+			mem->node = -1;
+		mem->initiator = mem->node;
+		mem->tier = -1;
+		mem->distance = (int *)calloc(p_topo->n_nodes, sizeof(int));
+		if (!mem->distance) {
+			ret = -ENOMEM;
+			goto cleanup;
 		}
-		/*
-		 * cur_core_id exists in p_topo->cores, just go to check
-		 * next one
-		 */
-		if (j < p_topo->n_cores)
-			continue;
+	}
 
-		/* allocate a new wayca_core if cur_core_id does not exist */
+cleanup:
+	CPU_FREE(has_memory);
+	return ret;
+}
+
+/*
+ * topo_read_mem_access - read the access attributes of the memory node
+ * from its best initiators. The CPU initiators of access1 are preferred,
+ * those of access0 may be accelerators. The attributes are left zero on
+ * the systems without HMAT.
+ */
+static void topo_read_mem_access(struct wayca_topo *p_topo,
+				 struct wayca_mem_node *mem)
+{
+	static const char *const access_classes[] = { "access1", "access0" };
+	char path_buffer[WAYCA_SC_PATH_LEN_MAX];
+	int read_bw = 0, write_bw = 0, read_lat = 0, write_lat = 0;
+	struct topo_sysfs_attr attrs[] = {
+		{ .name = "read_bandwidth", .type = TOPO_SYSFS_S32,
+		  .val = &read_bw },
+		{ .name = "write_bandwidth", .type = TOPO_SYSFS_S32,
+		  .val = &write_bw },
+		{ .name = "read_latency", .type = TOPO_SYSFS_S32,
+		  .val = &read_lat },
+		{ .name = "write_latency", .type = TOPO_SYSFS_S32,
+		  .val = &write_lat },
+	};
+	struct dirent *dirent;
+	int i, node;
+	DIR *dp;
+
+	for (i = 0; i < ARRAY_SIZE(access_classes); i++) {
+		snprintf(path_buffer, sizeof(path_buffer),
+			 "%s/node%d/%s/initiators", WAYCA_SC_NODE_FNAME,
+			 mem->node_idx, access_classes[i]);
+		dp = opendir(path_buffer);
+		if (dp)
+			break;
+	}
+	if (!dp)
+		return;
+
+	/*
+	 * the initiators are linked as node%d, a node of CPUs is its own and
+	 * a CPU-less one takes the lowest of them
+	 */
+	while (mem->node < 0 && (dirent = readdir(dp)) != NULL) {
+		if (sscanf(dirent->d_name, "node%d", &node) != 1)
+			continue;
+		node = topo_node_index(p_topo, node);
+		if (node >= 0 && (mem->initiator < 0 || node < mem->initiator))
+			mem->initiator = node;
+	}
+	closedir(dp);
+
+	topo_sysfs_read_attrs(path_buffer, attrs, ARRAY_SIZE(attrs));
+	mem->read_bandwidth = max(read_bw, 0);
+	mem->write_bandwidth = max(write_bw, 0);
+	mem->read_latency = max(read_lat, 0);
+	mem->write_latency = max(write_lat, 0);
+}
+
+/* topo_read_mem_cache - read the first level of the memory-side cache */
+static void topo_read_mem_cache(struct wayca_mem_node *mem)
+{
+	char path_buffer[WAYCA_SC_PATH_LEN_MAX];
+	unsigned long long size;
+	const char *content;
+	int line_size;
+	char *end;
+
+	snprintf(path_buffer, sizeof(path_buffer),
+		 "%s/node%d/memory_side_cache/index1", WAYCA_SC_NODE_FNAME,
+		 mem->node_idx);
+	if (topo_sysfs_read(path_buffer, "size", &content) < 0)
+		return;
+
+	errno = 0;
+	size = strtoull(content, &end, 10);
+	if (errno || end == content)
+		return;
+
+	mem->cache_size = size;
+	if (!topo_sysfs_read_s32(path_buffer, "line_size", &line_size) &&
+	    line_size > 0)
+		mem->cache_line_size = line_size;
+}
+
+/*
+ * topo_read_mem_tiers - read the memory tiers of the memory nodes, a lower
+ * tier is faster. They're only there since Linux 6.1.
+ */
+static void topo_read_mem_tiers(struct wayca_topo *p_topo)
+{
+	size_t setsize = CPU_ALLOC_SIZE(WAYCA_SC_MAX_NUMNODES);
+	char path_buffer[WAYCA_SC_PATH_LEN_MAX];
+	struct dirent *dirent;
+	cpu_set_t *nodes;
+	int i, tier;
+	DIR *dp;
+
+	snprintf(path_buffer, sizeof(path_buffer), "%s/virtual/memory_tiering",
+		 WAYCA_SC_SYSDEV_FNAME);
+	dp = opendir(path_buffer);
+	if (!dp)
+		return;
+
+	nodes = CPU_ALLOC(WAYCA_SC_MAX_NUMNODES);
+	if (!nodes)
+		goto cleanup;
+
+	while ((dirent = readdir(dp)) != NULL) {
+		if (sscanf(dirent->d_name, "memory_tier%d", &tier) != 1)
+			continue;
+
+		snprintf(path_buffer, sizeof(path_buffer),
+			 "%s/virtual/memory_tiering/%s", WAYCA_SC_SYSDEV_FNAME,
+			 dirent->d_name);
+		if (topo_sysfs_read_cpulist(path_buffer, "nodelist", nodes,
+					    setsize))
+			continue;
+
+		for (i = 0; i < p_topo->n_mem_nodes; i++)
+			if (CPU_ISSET_S(p_topo->mem_nodes[i].node_idx, setsize,
+					nodes))
+				p_topo->mem_nodes[i].tier = tier;
+	}
+	CPU_FREE(nodes);
+
+cleanup:
+	closedir(dp);
+}
+
+/* the node of CPUs nearest to @mem, the lowest one on a tie */
+static int topo_mem_nearest_node(struct wayca_topo *p_topo,
+				 const struct wayca_mem_node *mem)
+{
+	int nearest = -1;
+	int i;
+
+	for (i = 0; i < p_topo->n_nodes; i++)
+		if (nearest < 0 || mem->distance[i] < mem->distance[nearest])
+			nearest = i;
+	return nearest;
+}
+
+/*
+ * topo_read_mem_nodes - read the size and the performance attributes of
+ * the memory nodes, after the nodes of CPUs are read
+ *
+ * Return negative on error, 0 on success
+ */
+static int topo_read_mem_nodes(struct wayca_topo *p_topo)
+{
+	char path_buffer[WAYCA_SC_PATH_LEN_MAX];
+	struct wayca_meminfo meminfo;
+	struct wayca_mem_node *mem;
+	int ret;
+	int i;
+
+	for (i = 0; i < p_topo->n_mem_nodes; i++) {
+		mem = &p_topo->mem_nodes[i];
+		snprintf(path_buffer, sizeof(path_buffer), "%s/node%d",
+			 WAYCA_SC_NODE_FNAME, mem->node_idx);
+
+		if (mem->node >= 0) {
+			meminfo = *p_topo->nodes[mem->node]->p_meminfo;
+		} else {
+			ret = topo_parse_meminfo(&meminfo, path_buffer);
+			if (ret) {
+				PRINT_ERROR("get node%d meminfo fail, ret = %d\n",
+					    mem->node_idx, ret);
+				return ret;
+			}
+		}
+		mem->total_avail_kB = meminfo.total_avail_kB;
+
+		topo_read_mem_access(p_topo, mem);
+		topo_read_mem_cache(mem);
+
+		/* without HMAT, the initiator is the nearest node of CPUs */
+		if (mem->initiator < 0)
+			mem->initiator = topo_mem_nearest_node(p_topo, mem);
+	}
+
+	topo_read_mem_tiers(p_topo);
+	return 0;
+}
+
+/* the data or unified cache of @p_cpu at @level, NULL if there's none */
+static struct wayca_cache *topo_cpu_cache(struct wayca_cpu *p_cpu, int level)
+{
+	int i;
+
+	for (i = 0; i < p_cpu->n_caches; i++) {
+		if (p_cpu->p_caches[i].level == level &&
+		    strcmp(p_cpu->p_caches[i].type, "Instruction"))
+			return &p_cpu->p_caches[i];
+	}
+	return NULL;
+}
+
+/*
+ * topo_cache_domain_ids - number the domains of the CPUs sharing the cache
+ * at @level, in the order of their first CPU
+ *
+ * Return the number of the domains
+ */
+static size_t topo_cache_domain_ids(struct wayca_topo *p_topo, int level,
+				    int *ids)
+{
+	struct wayca_cache *p_cache;
+	int next_id = 0;
+	int cpu, first;
+
+	for (cpu = 0; cpu < p_topo->n_cpus; cpu++) {
+		p_cache = topo_cpu_cache(p_topo->cpus[cpu], level);
+		if (!p_cache || !p_cache->shared_cpu_map) {
+			ids[cpu] = -ENODATA;
+			continue;
+		}
+
+		for (first = 0; first < cpu; first++)
+			if (CPU_ISSET_S(first, p_topo->setsize,
+					p_cache->shared_cpu_map))
+				break;
+		if (first < cpu && ids[first] >= 0)
+			ids[cpu] = ids[first];
+		else
+			ids[cpu] = next_id++;
+	}
+	return next_id;
+}
+
+static int topo_logical_core_id(struct wayca_topo *p_topo,
+				struct wayca_cpu *p_cpu)
+{
+	int i;
+
+	for (i = 0; i < p_topo->n_cores; i++) {
+		if (p_topo->cores[i]->core_id == p_cpu->core_id)
+			return i;
+	}
+	return -EINVAL;
+}
+
+static int topo_logical_ccl_id(struct wayca_topo *p_topo,
+			       struct wayca_cpu *p_cpu)
+{
+	int i;
+
+	if (!p_cpu->p_cluster)
+		return -EINVAL;
+
+	for (i = 0; i < p_topo->n_clusters; i++) {
+		if (p_topo->ccls[i]->cluster_id == p_cpu->p_cluster->cluster_id)
+			return i;
+	}
+	return -EINVAL;
+}
+
+static int topo_logical_node_id(struct wayca_topo *p_topo,
+				struct wayca_cpu *p_cpu)
+{
+	int i;
+
+	for (i = 0; i < p_topo->n_nodes; i++) {
+		if (p_topo->nodes[i] == p_cpu->p_numa_node)
+			return i;
+	}
+	return -EINVAL;
+}
+
+static int topo_logical_package_id(struct wayca_topo *p_topo,
+				   struct wayca_cpu *p_cpu)
+{
+	int i;
+
+	if (!p_cpu->p_package)
+		return -EINVAL;
+
+	for (i = 0; i < p_topo->n_packages; i++) {
+		if (p_topo->packages[i]->physical_package_id ==
+		    p_cpu->p_package->physical_package_id)
+			return i;
+	}
+	return -EINVAL;
+}
+
+/* topo_construct_cpu_ids - build the id tables of the CPUs
+ *
+ * The tables are derived from the CPUs, the cores and the shared cache
+ * maps, and are built again whenever those change.
+ */
+static int topo_construct_cpu_ids(struct wayca_topo *p_topo)
+{
+	struct wayca_cpu_ids *ids = &p_topo->cpu_ids;
+	struct wayca_cpu *p_cpu;
+	size_t stride;
+	int *table;
+	int i;
+
+	/* round each array up to whole cache lines */
+	stride = (p_topo->n_cpus * sizeof(int) + WAYCA_SC_CACHELINE_SIZE - 1) &
+		 ~(size_t)(WAYCA_SC_CACHELINE_SIZE - 1);
+	table = aligned_alloc(WAYCA_SC_CACHELINE_SIZE, 6 * stride);
+	if (!table)
+		return -ENOMEM;
+
+	free(ids->core);
+	ids->core = table;
+	ids->ccl = (int *)((char *)table + stride);
+	ids->node = (int *)((char *)table + 2 * stride);
+	ids->package = (int *)((char *)table + 3 * stride);
+	ids->l2 = (int *)((char *)table + 4 * stride);
+	ids->l3 = (int *)((char *)table + 5 * stride);
+
+	for (i = 0; i < p_topo->n_cpus; i++) {
+		p_cpu = p_topo->cpus[i];
+		ids->core[i] = topo_logical_core_id(p_topo, p_cpu);
+		ids->ccl[i] = topo_logical_ccl_id(p_topo, p_cpu);
+		ids->node[i] = topo_logical_node_id(p_topo, p_cpu);
+		ids->package[i] = topo_logical_package_id(p_topo, p_cpu);
+	}
+	ids->n_l2 = topo_cache_domain_ids(p_topo, 2, ids->l2);
+	ids->n_l3 = topo_cache_domain_ids(p_topo, 3, ids->l3);
+	return 0;
+}
+
+/* topo_construct_core_topology
+ *  This function takes in wayca_cpus information and construct a wayca_cores
+ *  topology.
+ * Return negative on error, 0 on success
+ */
+int topo_construct_core_topology(struct wayca_topo *p_topo)
+{
+	int cur_core_id;
+	int i, j;
+
+	if (p_topo->cores != NULL || p_topo->n_cores != 0) {
+		WAYCA_SC_LOG_ERR(
+			"duplicated call, wayca_cores has been established\n");
+		return -1;
+	}
+
+	for (i = 0; i < p_topo->n_cpus; i++) {
+		/* read this cpu's core_id */
+		cur_core_id = p_topo->cpus[i]->core_id;
+
+		/* if cpu[i] is offline, core_id = -1; continue */
+		if (cur_core_id == -1)
+			continue;
+
+		/* check whether it is already in wayca_core array */
+		for (j = 0; j < p_topo->n_cores; j++) {
+			if (p_topo->cores[j]->core_id == cur_core_id)
+				break; /* it exists, skip */
+		}
+		/*
+		 * cur_core_id exists in p_topo->cores, just go to check
+		 * next one
+		 */
+		if (j < p_topo->n_cores)
+			continue;
+
+		/* allocate a new wayca_core if cur_core_id does not exist */
 		p_topo->cores = (struct wayca_core **)topo_expand_mem(
 			p_topo->cores, j * sizeof(struct wayca_core *),
 			(j + 1) * sizeof(struct wayca_core *));
@@ -1064,7 +1417,7 @@ static int topo_construct_core_topology(struct wayca_topo *p_topo)
 		p_topo->cores[j]->p_caches = p_topo->cpus[i]->p_caches;
 
 		/* add current core into core_map of the ccl for this CPU */
-		if (topo.n_clusters > 0) /* cluster may not set */
+		if (p_topo->n_clusters > 0) /* cluster may not set */
 			CPU_SET_S(j, p_topo->setsize,
 				  p_topo->cpus[i]->p_cluster->core_map);
 
@@ -1072,11 +1425,10 @@ static int topo_construct_core_topology(struct wayca_topo *p_topo)
 		CPU_SET_S(j, p_topo->setsize,
 			  p_topo->cpus[i]->p_numa_node->core_map);
 	}
-	return 0;
+	return topo_construct_cpu_ids(p_topo);
 }
 
-static int topo_recursively_read_io_devices(struct wayca_topo *p_topo,
-						const char *rootdir);
+static int topo_read_io_devices(struct wayca_topo *p_topo, const char *rootdir);
 
 static int topo_alloc_cpu(struct wayca_topo *p_topo)
 {
@@ -1086,8 +1438,8 @@ static int topo_alloc_cpu(struct wayca_topo *p_topo)
 	 * read "cpu/kernel_max" to determine maximum size for future memory
 	 * allocations
 	 */
-	if (topo_path_read_s32(WAYCA_SC_CPU_FNAME, "kernel_max",
-			       &p_topo->kernel_max_cpus) == 0)
+	if (topo_sysfs_read_s32(WAYCA_SC_CPU_FNAME, "kernel_max",
+				&p_topo->kernel_max_cpus) == 0)
 		p_topo->kernel_max_cpus += 1;
 	else
 		p_topo->kernel_max_cpus = WAYCA_SC_DEFAULT_KERNEL_MAX;
@@ -1098,9 +1450,8 @@ static int topo_alloc_cpu(struct wayca_topo *p_topo)
 	if (!cpuset_possible)
 		return -ENOMEM;
 
-	if (topo_path_read_cpulist(WAYCA_SC_CPU_FNAME, "possible",
-				   cpuset_possible,
-				   p_topo->kernel_max_cpus) == 0) {
+	if (topo_sysfs_read_cpulist(WAYCA_SC_CPU_FNAME, "possible",
+				    cpuset_possible, p_topo->setsize) == 0) {
 		/* determine number of CPUs in cpuset_possible */
 		p_topo->n_cpus = CPU_COUNT_S(p_topo->setsize, cpuset_possible);
 		p_topo->cpu_map = cpuset_possible;
@@ -1119,9 +1470,8 @@ static int topo_alloc_cpu(struct wayca_topo *p_topo)
 	if (!cpuset_online)
 		return -ENOMEM;
 
-	if (topo_path_read_cpulist(WAYCA_SC_CPU_FNAME, "online",
-				   cpuset_online,
-				   p_topo->kernel_max_cpus) == 0) {
+	if (topo_sysfs_read_cpulist(WAYCA_SC_CPU_FNAME, "online",
+				    cpuset_online, p_topo->setsize) == 0) {
 		p_topo->online_cpu_map = cpuset_online;
 	} else {
 		PRINT_ERROR("failed to read online CPUs\n");
@@ -1168,35 +1518,55 @@ static int topo_construct_cpu_topology(struct wayca_topo *p_topo)
 
 static int topo_construct_numa_topology(struct wayca_topo *p_topo)
 {
-	cpu_set_t *bitmask, *online_cpu_map;
+	size_t nodes_setsize = CPU_ALLOC_SIZE(WAYCA_SC_MAX_NUMNODES);
+	cpu_set_t *bitmask, *online_cpu_map, *online_nodes;
+	int *column = NULL;
+	size_t n_online = 0;
 	size_t setsize;
 	int i, j;
 	int ret;
 
 	setsize = CPU_ALLOC_SIZE(p_topo->n_cpus);
 	bitmask = CPU_ALLOC(p_topo->n_cpus);
-	if (!bitmask) {
+	online_nodes = CPU_ALLOC(WAYCA_SC_MAX_NUMNODES);
+	column = (int *)calloc(WAYCA_SC_MAX_NUMNODES, sizeof(int));
+	if (!bitmask || !online_nodes || !column) {
 		ret = -ENOMEM;
 		goto cleanup;
 	}
-	/* read "node/possible" to determine number of numa nodes */
-	ret = topo_path_read_cpulist(WAYCA_SC_NODE_FNAME, "possible",
-					bitmask, p_topo->n_cpus);
+	/*
+	 * read "node/online", the nodes of CPUs and the CPU-less nodes of
+	 * memory, whose columns make up node%d/distance
+	 */
+	ret = topo_sysfs_read_cpulist(WAYCA_SC_NODE_FNAME, "online",
+				      online_nodes, nodes_setsize);
 	if (ret) {
-		PRINT_ERROR("failed to read possible NODEs\n");
+		PRINT_ERROR("failed to read online NODEs\n");
 		goto cleanup;
 	}
+	for (i = 0; i < WAYCA_SC_MAX_NUMNODES; i++)
+		column[i] = CPU_ISSET_S(i, nodes_setsize, online_nodes) ?
+			    n_online++ : -1;
 
-	/* check the n_nodes and node_map in p_topo */
-	if (!CPU_EQUAL_S(setsize, bitmask, p_topo->node_map) ||
-		CPU_COUNT_S(setsize, bitmask) != p_topo->n_nodes) {
-		PRINT_ERROR(
-			 "node/possible mismatch with what cpu topology shows\n");
+	/* check the nodes in p_topo are all online */
+	for (i = 0; i < p_topo->n_nodes; i++) {
+		if (p_topo->nodes[i]->node_idx >= WAYCA_SC_MAX_NUMNODES ||
+		    column[p_topo->nodes[i]->node_idx] < 0) {
+			PRINT_ERROR("node/online mismatch with what cpu topology shows\n");
+			ret = -EINVAL;
+			goto cleanup;
+		}
+	}
+
+	ret = topo_alloc_mem_nodes(p_topo, online_nodes);
+	if (ret) {
+		PRINT_ERROR("failed to alloc memory nodes, ret = %d\n", ret);
 		goto cleanup;
 	}
+
 	/* read all node%d topology, and it will establish the distance info */
 	for (i = 0; i < p_topo->n_nodes; i++) {
-		ret = topo_read_node_topology(p_topo, i);
+		ret = topo_read_node_topology(p_topo, i, column, n_online);
 		if (ret) {
 			PRINT_ERROR("get node %d topology fail, ret = %d\n", i,
 				    ret);
@@ -1213,7 +1583,7 @@ static int topo_construct_numa_topology(struct wayca_topo *p_topo)
 			  p_topo->online_cpu_map,
 			  p_topo->nodes[i]->cpu_map);
 		/* determine if the node has online cpus */
-		if (!CPU_COUNT_S(topo.setsize, online_cpu_map)) {
+		if (!CPU_COUNT_S(p_topo->setsize, online_cpu_map)) {
 			CPU_FREE(online_cpu_map);
 			continue;
 		}
@@ -1229,78 +1599,544 @@ static int topo_construct_numa_topology(struct wayca_topo *p_topo)
 		}
 		CPU_FREE(online_cpu_map);
 	}
+
+	ret = topo_read_mem_nodes(p_topo);
 cleanup:
 	CPU_FREE(bitmask);
+	CPU_FREE(online_nodes);
+	free(column);
 	return ret;
 }
 
 static int topo_get_irq_info(struct wayca_topo *sys_topo);
 
-static void topo_init(void)
+static int topo_load_cpu_phase(struct wayca_topo *p_topo)
 {
-	char origin_wd[WAYCA_SC_PATH_LEN_MAX];
-	struct wayca_topo *p_topo = &topo;
-	char *p;
 	int ret;
 
-	if (!getcwd(origin_wd, WAYCA_SC_PATH_LEN_MAX))
-		PRINT_ERROR("failed to get original working dir, try init\n");
-	memset(p_topo, 0, sizeof(struct wayca_topo));
+	/* try the snapshot stored by the previous run before walking sysfs */
+	if (!topo_snapshot_load(p_topo))
+		return 0;
+	topo_free(p_topo);
 
 	ret = topo_alloc_cpu(p_topo);
 	if (ret) {
 		PRINT_ERROR("failed to alloc cpu, ret = %d\n", ret);
-		goto cleanup_on_error;
+		return ret;
 	}
 
 	ret = topo_alloc_node_map(p_topo);
 	if (ret) {
 		PRINT_ERROR("failed to alloc numa node map, ret = %d\n", ret);
-		goto cleanup_on_error;
+		return ret;
 	}
 
 	ret = topo_construct_cpu_topology(p_topo);
 	if (ret) {
 		PRINT_ERROR("failed to construct cpu topology, ret = %d\n", ret);
-		goto cleanup_on_error;
+		return ret;
 	}
 
-	ret = topo_construct_numa_topology(p_topo);
-	if (ret) {
-		PRINT_ERROR("failed to construct numa topology, ret = %d\n", ret);
-		goto cleanup_on_error;
-	}
 	/* Construct wayca_cores topology from wayca_cpus */
 	ret = topo_construct_core_topology(p_topo);
-	if (ret) {
+	if (ret)
 		PRINT_ERROR("failed to construct core topology, ret = %d\n", ret);
-		goto cleanup_on_error;
-	}
+	return ret;
+}
 
-	if (topo_recursively_read_io_devices(p_topo, WAYCA_SC_SYSDEV_FNAME) !=
-	    0) {
+static int topo_load_numa_phase(struct wayca_topo *p_topo)
+{
+	int ret;
+
+	ret = topo_construct_numa_topology(p_topo);
+	if (ret)
+		PRINT_ERROR("failed to construct numa topology, ret = %d\n", ret);
+	return ret;
+}
+
+static int topo_load_device_phase(struct wayca_topo *p_topo)
+{
+	int ret;
+
+	/* the devices shared by the other versions, if they fit */
+	if (!topo_shared_attach(p_topo, topo_shared[TOPO_PHASE_DEVICE]))
+		return 0;
+
+	ret = topo_read_io_devices(p_topo, WAYCA_SC_SYSDEV_FNAME);
+	if (ret)
 		PRINT_ERROR("failed to construct io device topology, ret = %d\n",
 				ret);
-		goto cleanup_on_error;
+	return ret;
+}
+
+static int topo_load_irq_phase(struct wayca_topo *p_topo)
+{
+	int ret;
+
+	if (!topo_shared_attach(p_topo, topo_shared[TOPO_PHASE_IRQ]))
+		return 0;
+
+	ret = topo_get_irq_info(p_topo);
+	if (ret)
+		PRINT_ERROR("failed to get irq information, ret = %d\n", ret);
+	return ret;
+}
+
+static const struct {
+	int (*load)(struct wayca_topo *p_topo);
+	/* whether the phase is kept in the topology snapshot */
+	bool snapshot;
+} topo_phases[TOPO_PHASE_MAX] = {
+	[TOPO_PHASE_CPU] = { topo_load_cpu_phase, true },
+	[TOPO_PHASE_NUMA] = { topo_load_numa_phase, true },
+	[TOPO_PHASE_DEVICE] = { topo_load_device_phase, true },
+	[TOPO_PHASE_IRQ] = { topo_load_irq_phase, false },
+};
+
+/* Serialize the phase loading, readers of loaded phases never take it */
+static pthread_mutex_t topo_phase_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* topo_load_phase - make sure @phase of the topology has been loaded
+ *
+ * Each phase is loaded at most once, the other phases it depends on are
+ * loaded first. A phase failed to load won't be retried until the topology
+ * is rebuilt. The phase is loaded into the version the caller took, even
+ * if it has been replaced in the meantime.
+ *
+ * Return 0 if the phase is available, negative on error.
+ */
+/* called with topo_phase_mutex held */
+static int topo_load_phase_locked(struct wayca_topo *p_topo,
+				  enum topo_phase phase)
+{
+	unsigned int bit = TOPO_PHASE_BIT(phase);
+	int ret;
+
+	if (p_topo->phases & bit)
+		return 0;
+
+	if (p_topo->failed_phases & bit)
+		return -ENODATA;
+
+	ret = topo_phases[phase].load(p_topo);
+	/* don't hold the directory fds after the walk */
+	topo_sysfs_flush();
+	if (ret) {
+		if (phase == TOPO_PHASE_CPU)
+			topo_free(p_topo);
+		p_topo->failed_phases |= bit;
+		return ret;
 	}
 
-	p = secure_getenv("WAYCA_SC_TOPO_GET_IRQ_INFO");
-	if (p && !strcmp(p, "YES")) {
-		ret = topo_get_irq_info(p_topo);
+	topo_index_build(p_topo, p_topo->phases | bit);
+	topo_shared_seal(p_topo, p_topo->phases | bit);
+
+	/* the snapshot may carry more than the phase we asked for */
+	if (p_topo->phases & bit)
+		return 0;
+
+	__atomic_or_fetch(&p_topo->phases, bit, __ATOMIC_RELEASE);
+	if (topo_phases[phase].snapshot)
+		topo_snapshot_store(p_topo);
+	return 0;
+}
+
+static int topo_load_phase(struct wayca_topo *p_topo, enum topo_phase phase)
+{
+	unsigned int bit = TOPO_PHASE_BIT(phase);
+	int ret = 0;
+
+	if (likely(__atomic_load_n(&p_topo->phases, __ATOMIC_ACQUIRE) & bit))
+		return 0;
+
+	/* everything else is attached to the CPUs and NUMA nodes */
+	if (phase != TOPO_PHASE_CPU) {
+		ret = topo_load_phase(p_topo, TOPO_PHASE_CPU);
+		if (ret)
+			return ret;
+	}
+
+	pthread_mutex_lock(&topo_phase_mutex);
+	ret = topo_load_phase_locked(p_topo, phase);
+	pthread_mutex_unlock(&topo_phase_mutex);
+	return ret;
+}
+
+/*
+ * topo_publish - make @p_topo the current version, with topo_phase_mutex
+ * held. The replaced one is freed by topo_reclaim() once it's not held.
+ */
+static void topo_publish(struct wayca_topo *p_topo)
+{
+	struct wayca_topo *old = topo_current;
+
+	p_topo->generation = old->generation + 1;
+	p_topo->retired = old;
+	topo_nr_retired++;
+	__atomic_store_n(&topo_current, p_topo, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * topo_shared_inherit - attach the records shared by the versions to the
+ * new version @p_topo before it's published, instead of copying them
+ */
+static void topo_shared_inherit(struct wayca_topo *p_topo)
+{
+	enum topo_phase phases[] = { TOPO_PHASE_DEVICE, TOPO_PHASE_IRQ };
+	unsigned int bit;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(phases); i++) {
+		bit = TOPO_PHASE_BIT(phases[i]);
+		if (!(p_topo->phases & bit) &&
+		    !topo_shared_attach(p_topo, topo_shared[phases[i]]))
+			p_topo->phases |= bit;
+	}
+}
+
+static void topo_cpu_mask_update(struct wayca_topo *p_topo, cpu_set_t *mask,
+				 int cpu, bool online)
+{
+	if (!mask)
+		return;
+
+	if (online)
+		CPU_SET_S(cpu, p_topo->setsize, mask);
+	else
+		CPU_CLR_S(cpu, p_topo->setsize, mask);
+}
+
+/*
+ * topo_update_cpu_masks - add or remove @cpu from the masks which only
+ * contain online CPUs: the SMT siblings, the cluster, the package and the
+ * shared caches. @cpu keeps its ids, the masks of its own are updated as
+ * well so they are right again when it comes back online.
+ */
+static void topo_update_cpu_masks(struct wayca_topo *p_topo, int cpu,
+				  bool online)
+{
+	struct wayca_cpu *p_cpu = p_topo->cpus[cpu];
+	struct wayca_cpu *sibling;
+	cpu_set_t *shared;
+	int i, j;
+
+	topo_cpu_mask_update(p_topo, p_topo->online_cpu_map, cpu, online);
+
+	for (i = 0; i < p_topo->n_cpus; i++) {
+		if (i != cpu &&
+		    !CPU_ISSET_S(i, p_topo->setsize, p_cpu->core_cpus_map))
+			continue;
+		topo_cpu_mask_update(p_topo, p_topo->cpus[i]->core_cpus_map,
+				     cpu, online);
+	}
+
+	/* the map of a core is the one of its first CPU */
+	for (i = 0; i < p_topo->n_cores; i++) {
+		if (p_topo->cores[i]->core_id != p_cpu->core_id ||
+		    p_topo->cores[i]->p_package != p_cpu->p_package)
+			continue;
+		p_topo->cores[i]->n_cpus = CPU_COUNT_S(p_topo->setsize,
+					p_topo->cores[i]->core_cpus_map);
+	}
+
+	if (p_cpu->p_cluster) {
+		topo_cpu_mask_update(p_topo, p_cpu->p_cluster->cpu_map, cpu,
+				     online);
+		p_cpu->p_cluster->n_cpus = CPU_COUNT_S(p_topo->setsize,
+					p_cpu->p_cluster->cpu_map);
+	}
+
+	if (p_cpu->p_package) {
+		topo_cpu_mask_update(p_topo, p_cpu->p_package->cpu_map, cpu,
+				     online);
+		p_cpu->p_package->n_cpus = CPU_COUNT_S(p_topo->setsize,
+					p_cpu->p_package->cpu_map);
+	}
+
+	for (j = 0; j < p_cpu->n_caches; j++) {
+		shared = p_cpu->p_caches[j].shared_cpu_map;
+		for (i = 0; i < p_topo->n_cpus; i++) {
+			if (i != cpu && !CPU_ISSET_S(i, p_topo->setsize, shared))
+				continue;
+			sibling = p_topo->cpus[i];
+			if (j < sibling->n_caches)
+				topo_cpu_mask_update(p_topo,
+					sibling->p_caches[j].shared_cpu_map,
+					cpu, online);
+		}
+	}
+}
+
+/*
+ * topo_notify_online - queue the events of the CPUs changed from version
+ * @prev to @next of the topology, once @next is published. The notifiers
+ * are called from the dispatcher thread, so it's fine with
+ * topo_phase_mutex held.
+ */
+static void topo_notify_online(const struct wayca_topo *prev,
+			       const struct wayca_topo *next)
+{
+	bool online;
+	int cpu;
+
+	for (cpu = 0; cpu < prev->n_cpus && cpu < next->n_cpus; cpu++) {
+		online = topo_cpu_is_online(next, cpu);
+		if (topo_cpu_is_online(prev, cpu) == online)
+			continue;
+		topo_notify(online ? WAYCA_SC_TOPO_EV_CPU_ONLINE :
+				     WAYCA_SC_TOPO_EV_CPU_OFFLINE, cpu);
+	}
+}
+
+/*
+ * After a failed rebuild the CPUs never parsed are kept offline, and the
+ * rebuild isn't retried until a backoff doubling from the min to the max
+ * has passed, so the queries don't read sysfs over and over. Only changed
+ * with topo_phase_mutex held.
+ */
+#define TOPO_REBUILD_BACKOFF_MIN_MS	1000
+#define TOPO_REBUILD_BACKOFF_MAX_MS	64000
+
+static uint64_t topo_rebuild_retry;	/* when to retry, in ns */
+static uint64_t topo_rebuild_backoff;	/* in ms, 0 after a success */
+
+static uint64_t topo_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * topo_rebuild_locked - build a version of the topology from sysfs, to
+ * parse the CPUs offline since the current one was built. The error is
+ * reported once until a rebuild succeeds again.
+ *
+ * Return the new version, NULL on failure or during the backoff.
+ */
+static struct wayca_topo *topo_rebuild_locked(void)
+{
+	uint64_t now = topo_now();
+	struct wayca_topo *next;
+	int ret;
+
+	if (topo_rebuild_backoff && now < topo_rebuild_retry)
+		return NULL;
+
+	next = calloc(1, sizeof(struct wayca_topo));
+	ret = next ? topo_load_phase_locked(next, TOPO_PHASE_CPU) : -ENOMEM;
+	if (!ret) {
+		topo_rebuild_backoff = 0;
+		return next;
+	}
+
+	if (next) {
+		topo_free(next);
+		free(next);
+	}
+	if (!topo_rebuild_backoff)
+		PRINT_ERROR("failed to parse the new CPUs, ret = %d\n", ret);
+	topo_rebuild_backoff = topo_rebuild_backoff ?
+			       min(topo_rebuild_backoff * 2,
+				   TOPO_REBUILD_BACKOFF_MAX_MS) :
+			       TOPO_REBUILD_BACKOFF_MIN_MS;
+	topo_rebuild_retry = now + topo_rebuild_backoff * 1000000ULL;
+	return NULL;
+}
+
+/* Whether @cpu has never been parsed, as it was offline since the init */
+static bool topo_cpu_is_unparsed(const struct wayca_topo *p_topo, int cpu)
+{
+	return !p_topo->cpus[cpu]->core_cpus_map;
+}
+
+/*
+ * topo_update_online_locked - publish a version of the topology with the
+ * CPUs in @online online, called with topo_phase_mutex held
+ *
+ * A CPU coming online for the first time since the topology was built has
+ * never been parsed, then the new version is built from sysfs to find its
+ * core, cluster and caches. Otherwise, or if the rebuild fails, the
+ * current version is copied and the masks of the changed CPUs are updated,
+ * leaving the unparsed ones offline. The changed CPUs are notified, and
+ * the replaced versions no thread holds any more are freed.
+ */
+static void topo_update_online_locked(const cpu_set_t *online)
+{
+	struct wayca_topo *cur = topo_current;
+	struct wayca_topo *next = NULL;
+	bool changed = false;
+	bool unparsed = false;
+	bool is_online;
+	int cpu, ret;
+
+	for (cpu = 0; cpu < cur->n_cpus; cpu++) {
+		is_online = CPU_ISSET_S(cpu, cur->setsize, online);
+		if (topo_cpu_is_online(cur, cpu) == is_online)
+			continue;
+		if (is_online && topo_cpu_is_unparsed(cur, cpu))
+			unparsed = true;
+		else
+			changed = true;
+	}
+
+	if (unparsed)
+		next = topo_rebuild_locked();
+	if (!next && !changed)
+		return;
+
+	if (!next) {
+		next = calloc(1, sizeof(struct wayca_topo));
+		if (!next) {
+			PRINT_ERROR("failed to allocate a new topology\n");
+			return;
+		}
+
+		ret = topo_snapshot_clone(next, cur);
+		for (cpu = 0; !ret && cpu < cur->n_cpus; cpu++) {
+			is_online = CPU_ISSET_S(cpu, cur->setsize, online);
+			if (topo_cpu_is_online(next, cpu) == is_online ||
+			    topo_cpu_is_unparsed(next, cpu))
+				continue;
+			topo_update_cpu_masks(next, cpu, is_online);
+		}
+		/* the cache domains follow the shared maps */
+		if (!ret)
+			ret = topo_construct_cpu_ids(next);
 		if (ret) {
-			PRINT_ERROR("failed to get irq information, ret = %d\n",
-					ret);
-			goto cleanup_on_error;
+			PRINT_ERROR("failed to update the topology, ret = %d\n",
+				    ret);
+			topo_free(next);
+			free(next);
+			return;
 		}
 	}
-	/* the working dir may be changed, restore thie working dir */
-	if (chdir(origin_wd) == -1)
-		PRINT_DBG("failed to restore the working dir\n");
-	return;
-	/* cleanup_on_error */
-cleanup_on_error:
-	topo_free();
-	return;
+
+	topo_shared_inherit(next);
+	topo_publish(next);
+	topo_notify_online(cur, next);
+	topo_reclaim();
+}
+
+/* topo_set_cpu_online - apply a hotplug event of @cpu to the topology */
+void topo_set_cpu_online(int cpu, bool online)
+{
+	struct wayca_topo *cur;
+	cpu_set_t *mask;
+
+	pthread_mutex_lock(&topo_phase_mutex);
+	cur = topo_current;
+	if (!(cur->phases & TOPO_PHASE_BIT(TOPO_PHASE_CPU)) ||
+	    cpu < 0 || cpu >= cur->n_cpus ||
+	    topo_cpu_is_online(cur, cpu) == online)
+		goto unlock;
+
+	mask = CPU_ALLOC(cur->kernel_max_cpus);
+	if (!mask)
+		goto unlock;
+
+	memcpy(mask, cur->online_cpu_map, cur->setsize);
+	if (online)
+		CPU_SET_S(cpu, cur->setsize, mask);
+	else
+		CPU_CLR_S(cpu, cur->setsize, mask);
+	topo_update_online_locked(mask);
+	CPU_FREE(mask);
+unlock:
+	pthread_mutex_unlock(&topo_phase_mutex);
+}
+
+/*
+ * topo_sync_online_cpus - apply the difference between cpu/online and the
+ * online CPUs of the topology
+ *
+ * Return negative on error, 0 on success
+ */
+int topo_sync_online_cpus(void)
+{
+	struct wayca_topo *cur;
+	cpu_set_t *online;
+	int ret = 0;
+
+	pthread_mutex_lock(&topo_phase_mutex);
+	cur = topo_current;
+	if (!(cur->phases & TOPO_PHASE_BIT(TOPO_PHASE_CPU)))
+		goto unlock;
+
+	online = CPU_ALLOC(cur->kernel_max_cpus);
+	if (!online) {
+		ret = -ENOMEM;
+		goto unlock;
+	}
+
+	ret = topo_sysfs_read_cpulist(WAYCA_SC_CPU_FNAME, "online", online,
+				      cur->setsize);
+	if (!ret)
+		topo_update_online_locked(online);
+	CPU_FREE(online);
+unlock:
+	pthread_mutex_unlock(&topo_phase_mutex);
+	return ret;
+}
+
+/*
+ * Only the CPU phase is loaded by the constructor, the NUMA, device and
+ * IRQ information are loaded on the first use of the related APIs. IRQ
+ * information can be loaded here by WAYCA_SC_TOPO_GET_IRQ_INFO=YES.
+ */
+static void topo_init(void)
+{
+	struct wayca_topo *topo __topo_ref = topo_get();
+	char *p;
+	int ret;
+
+	ret = topo_load_phase(topo, TOPO_PHASE_CPU);
+	if (ret) {
+		PRINT_ERROR("failed to load cpu topology, ret = %d\n", ret);
+		return;
+	}
+
+	p = secure_getenv("WAYCA_SC_TOPO_GET_IRQ_INFO");
+	if (p && !strcmp(p, "YES"))
+		topo_load_phase(topo, TOPO_PHASE_IRQ);
+}
+
+static void topo_exit(void)
+{
+	struct wayca_topo *p_topo, *retired;
+	struct topo_reader *reader, *next;
+	int i;
+
+	/* the hotplug listener may still be updating the topology */
+	topo_hotplug_stop();
+	topo_meminfo_exit();
+	topo_notify_exit();
+
+	for (p_topo = topo_current; p_topo; p_topo = retired) {
+		retired = p_topo->retired;
+		topo_free(p_topo);
+		if (p_topo != &topo_initial)
+			free(p_topo);
+	}
+	topo_current = &topo_initial;
+	topo_nr_retired = 0;
+
+	for (i = 0; i < TOPO_PHASE_MAX; i++) {
+		if (topo_shared[i])
+			topo_shared_put(topo_shared[i]);
+		topo_shared[i] = NULL;
+	}
+
+	/* the threads exiting later must not release their slots */
+	if (topo_readers)
+		pthread_key_delete(topo_reader_key);
+	for (reader = topo_readers; reader; reader = next) {
+		next = reader->next;
+		free(reader);
+	}
+	topo_readers = NULL;
+	topo_reader = NULL;
 }
 
 /* print the topology */
@@ -1425,9 +2261,13 @@ void topo_print_wayca_core(size_t setsize, struct wayca_core *p_core)
 #ifdef WAYCA_SC_DEBUG
 void WAYCA_SC_DECLSPEC wayca_sc_topo_print(void)
 {
-	struct wayca_topo *p_topo = &topo;
+	struct wayca_topo *p_topo __topo_ref = topo_get_synced();
+	struct wayca_mem_node *mem;
 	int i;
 
+	topo_load_phase(p_topo, TOPO_PHASE_NUMA);
+	topo_load_phase(p_topo, TOPO_PHASE_DEVICE);
+
 	PRINT_DBG("kernel_max_cpus: %d\n", p_topo->kernel_max_cpus);
 	PRINT_DBG("setsize: %lu\n", p_topo->setsize);
 
@@ -1435,7 +2275,8 @@ void WAYCA_SC_DECLSPEC wayca_sc_topo_print(void)
 	PRINT_DBG("\tCPU count in cpu_map: %d\n",
 		  CPU_COUNT_S(p_topo->setsize, p_topo->cpu_map));
 	for (i = 0; i < p_topo->n_cpus; i++) {
-		if (p_topo->cpus[i] == NULL)
+		/* the cpus offline since the init were never parsed */
+		if (p_topo->cpus[i] == NULL || !p_topo->cpus[i]->p_package)
 			continue;
 		PRINT_DBG("CPU%d information:\n", i);
 		topo_print_wayca_cpu(p_topo->setsize, p_topo->cpus[i]);
@@ -1468,6 +2309,17 @@ void WAYCA_SC_DECLSPEC wayca_sc_topo_print(void)
 		topo_print_wayca_node(p_topo->setsize, p_topo->nodes[i],
 				      p_topo->n_nodes);
 	}
+	PRINT_DBG("n_mem_nodes: %lu\n", p_topo->n_mem_nodes);
+	for (i = 0; i < p_topo->n_mem_nodes; i++) {
+		mem = &p_topo->mem_nodes[i];
+		PRINT_DBG("mem node%d: node %d of cpu node %d, initiator %d, tier %d\n",
+			  i, mem->node_idx, mem->node, mem->initiator, mem->tier);
+		PRINT_DBG("\ttotal memory (in kB): %8lu\n", mem->total_avail_kB);
+		PRINT_DBG("\tread %u MB/s %u ns, write %u MB/s %u ns\n",
+			  mem->read_bandwidth, mem->read_latency,
+			  mem->write_bandwidth, mem->write_latency);
+		PRINT_DBG("\tmemory-side cache: %llu bytes\n", mem->cache_size);
+	}
 	PRINT_DBG("n_packages: %lu\n", p_topo->n_packages);
 
 	return;
@@ -1538,6 +2390,16 @@ static void topo_ccl_free(struct wayca_cluster **ccls, size_t n_clusters)
 	free(ccls);
 }
 
+static void topo_free_pci_device(struct wayca_pci_device *pcidev)
+{
+	if (!pcidev)
+		return;
+
+	CPU_FREE(pcidev->local_cpu_map);
+	free(pcidev->irqs.irq_numbers);
+	free(pcidev);
+}
+
 static void topo_pcidev_free(struct wayca_pci_device **pcidevs,
 		size_t n_pcidevs)
 {
@@ -1546,14 +2408,8 @@ static void topo_pcidev_free(struct wayca_pci_device **pcidevs,
 	if (!pcidevs)
 		return;
 
-	for (i = 0; i < n_pcidevs; i++) {
-		if (!pcidevs[i])
-			continue;
-
-		CPU_FREE(pcidevs[i]->local_cpu_map);
-		free(pcidevs[i]->irqs.irq_numbers);
-		free(pcidevs[i]);
-	}
+	for (i = 0; i < n_pcidevs; i++)
+		topo_free_pci_device(pcidevs[i]);
 	free(pcidevs);
 }
 
@@ -1589,105 +2445,343 @@ static void topo_node_free(struct wayca_node **nodes, size_t n_nodes)
 		topo_smmu_free(nodes[i]->smmus, nodes[i]->n_smmus);
 		free(nodes[i]);
 	}
-	free(nodes);
+	free(nodes);
+}
+
+static void topo_mem_node_free(struct wayca_mem_node *mem_nodes,
+			       size_t n_mem_nodes)
+{
+	int i;
+
+	if (!mem_nodes)
+		return;
+
+	for (i = 0; i < n_mem_nodes; i++)
+		free(mem_nodes[i].distance);
+	free(mem_nodes);
+}
+
+static void topo_package_free(struct wayca_package **packages,
+		size_t n_packages)
+{
+	int i;
+
+	if (!packages)
+		return;
+
+	for (i = 0; i < n_packages; i++) {
+		if (!packages[i])
+			continue;
+
+		CPU_FREE(packages[i]->cpu_map);
+		CPU_FREE(packages[i]->numa_map);
+		free(packages[i]);
+	}
+	free(packages);
+}
+
+static void topo_irq_free(struct wayca_irq **irqs, size_t n_irqs);
+
+/*
+ * topo_shared_attach - make @p_topo read the records of @shared
+ *
+ * Return 0 on success, -ENOENT if there's no @shared or it doesn't fit the
+ * NUMA nodes of @p_topo
+ */
+static int topo_shared_attach(struct wayca_topo *p_topo,
+			      struct topo_shared *shared)
+{
+	struct wayca_node *node;
+	int i;
+
+	if (!shared)
+		return -ENOENT;
+
+	if (shared->phase == TOPO_PHASE_DEVICE) {
+		if (shared->n_nodes != p_topo->n_nodes)
+			return -ENOENT;
+		for (i = 0; i < p_topo->n_nodes; i++) {
+			node = p_topo->nodes[i];
+			node->n_pcidevs = shared->nodes[i].n_pcidevs;
+			node->pcidevs = shared->nodes[i].pcidevs;
+			node->n_smmus = shared->nodes[i].n_smmus;
+			node->smmus = shared->nodes[i].smmus;
+		}
+		p_topo->dev_index = shared->index;
+		p_topo->dev_shared = shared;
+	} else {
+		p_topo->n_irqs = shared->n_irqs;
+		p_topo->irqs = shared->irqs;
+		p_topo->irq_index = shared->index;
+		p_topo->irq_shared = shared;
+	}
+
+	shared->refcount++;
+	return 0;
+}
+
+/* Drop the records shared by @p_topo, which still owns the others */
+static void topo_shared_detach(struct wayca_topo *p_topo)
+{
+	struct wayca_node *node;
+	int i;
+
+	if (p_topo->dev_shared) {
+		for (i = 0; p_topo->nodes && i < p_topo->n_nodes; i++) {
+			node = p_topo->nodes[i];
+			if (!node)
+				continue;
+			node->n_pcidevs = 0;
+			node->pcidevs = NULL;
+			node->n_smmus = 0;
+			node->smmus = NULL;
+		}
+		p_topo->dev_index = NULL;
+		topo_shared_put(p_topo->dev_shared);
+		p_topo->dev_shared = NULL;
+	}
+
+	if (p_topo->irq_shared) {
+		p_topo->n_irqs = 0;
+		p_topo->irqs = NULL;
+		p_topo->irq_index = NULL;
+		topo_shared_put(p_topo->irq_shared);
+		p_topo->irq_shared = NULL;
+	}
+}
+
+static void topo_shared_put(struct topo_shared *shared)
+{
+	int i;
+
+	if (--shared->refcount)
+		return;
+
+	for (i = 0; shared->nodes && i < shared->n_nodes; i++) {
+		topo_pcidev_free(shared->nodes[i].pcidevs,
+				 shared->nodes[i].n_pcidevs);
+		topo_smmu_free(shared->nodes[i].smmus,
+			       shared->nodes[i].n_smmus);
+	}
+	free(shared->nodes);
+	topo_irq_free(shared->irqs, shared->n_irqs);
+	free(shared->index);
+	free(shared);
+}
+
+/* Hand the devices of @p_topo over to a new shared record */
+static struct topo_shared *topo_shared_devices(struct wayca_topo *p_topo)
+{
+	struct topo_shared *shared;
+	struct wayca_node *node;
+	int i;
+
+	shared = calloc(1, sizeof(*shared));
+	if (!shared)
+		return NULL;
+	shared->nodes = calloc(p_topo->n_nodes, sizeof(*shared->nodes));
+	if (!shared->nodes && p_topo->n_nodes) {
+		free(shared);
+		return NULL;
+	}
+
+	shared->phase = TOPO_PHASE_DEVICE;
+	shared->n_nodes = p_topo->n_nodes;
+	for (i = 0; i < p_topo->n_nodes; i++) {
+		node = p_topo->nodes[i];
+		shared->nodes[i].n_pcidevs = node->n_pcidevs;
+		shared->nodes[i].pcidevs = node->pcidevs;
+		shared->nodes[i].n_smmus = node->n_smmus;
+		shared->nodes[i].smmus = node->smmus;
+	}
+	shared->index = p_topo->dev_index;
+	shared->refcount = 1;
+	p_topo->dev_shared = shared;
+	return shared;
 }
 
-static void topo_package_free(struct wayca_package **packages,
-		size_t n_packages)
+/* Hand the IRQs of @p_topo over to a new shared record */
+static struct topo_shared *topo_shared_irqs(struct wayca_topo *p_topo)
 {
-	int i;
+	struct topo_shared *shared;
+
+	shared = calloc(1, sizeof(*shared));
+	if (!shared)
+		return NULL;
+
+	shared->phase = TOPO_PHASE_IRQ;
+	shared->n_irqs = p_topo->n_irqs;
+	shared->irqs = p_topo->irqs;
+	shared->index = p_topo->irq_index;
+	shared->refcount = 1;
+	p_topo->irq_shared = shared;
+	return shared;
+}
 
-	if (!packages)
-		return;
+/*
+ * topo_shared_seal - share the device and IRQ records just loaded into
+ * @p_topo by @phases, before the phases are visible to the other threads.
+ * If some are shared already, @p_topo reads those and frees its own, so
+ * all the versions return the same records. Running out of memory only
+ * leaves the records owned by @p_topo.
+ */
+static void topo_shared_seal(struct wayca_topo *p_topo, unsigned int phases)
+{
+	struct topo_shared *shared;
+	int i;
 
-	for (i = 0; i < n_packages; i++) {
-		if (!packages[i])
-			continue;
+	if ((phases & TOPO_PHASE_BIT(TOPO_PHASE_DEVICE)) &&
+	    !p_topo->dev_shared) {
+		shared = topo_shared[TOPO_PHASE_DEVICE];
+		if (shared && shared->n_nodes == p_topo->n_nodes) {
+			for (i = 0; i < p_topo->n_nodes; i++) {
+				topo_pcidev_free(p_topo->nodes[i]->pcidevs,
+						 p_topo->nodes[i]->n_pcidevs);
+				topo_smmu_free(p_topo->nodes[i]->smmus,
+					       p_topo->nodes[i]->n_smmus);
+			}
+			free(p_topo->dev_index);
+			topo_shared_attach(p_topo, shared);
+		} else if (!shared) {
+			shared = topo_shared_devices(p_topo);
+			if (shared) {
+				shared->refcount++;
+				topo_shared[TOPO_PHASE_DEVICE] = shared;
+			}
+		}
+	}
 
-		CPU_FREE(packages[i]->cpu_map);
-		CPU_FREE(packages[i]->numa_map);
-		free(packages[i]);
+	if ((phases & TOPO_PHASE_BIT(TOPO_PHASE_IRQ)) && !p_topo->irq_shared) {
+		shared = topo_shared[TOPO_PHASE_IRQ];
+		if (shared) {
+			topo_irq_free(p_topo->irqs, p_topo->n_irqs);
+			free(p_topo->irq_index);
+			topo_shared_attach(p_topo, shared);
+		} else {
+			shared = topo_shared_irqs(p_topo);
+			if (shared) {
+				shared->refcount++;
+				topo_shared[TOPO_PHASE_IRQ] = shared;
+			}
+		}
 	}
-	free(packages);
 }
 
-static void topo_irq_free(struct wayca_irq **irqs, size_t n_irqs);
-
-/* topo_free - free up memories */
-void topo_free(void)
+/* topo_free - free up memories of a version of the topology */
+static void topo_free(struct wayca_topo *p_topo)
 {
-	struct wayca_topo *p_topo = &topo;
-
+	topo_shared_detach(p_topo);
 	CPU_FREE(p_topo->cpu_map);
 	CPU_FREE(p_topo->online_cpu_map);
 	topo_cpu_free(p_topo->cpus, p_topo->n_cpus);
+	free(p_topo->cpu_ids.core);
 
 	topo_core_free(p_topo->cores, p_topo->n_cores);
 	topo_ccl_free(p_topo->ccls, p_topo->n_clusters);
 
 	CPU_FREE(p_topo->node_map);
 	topo_node_free(p_topo->nodes, p_topo->n_nodes);
+	topo_mem_node_free(p_topo->mem_nodes, p_topo->n_mem_nodes);
 	topo_package_free(p_topo->packages, p_topo->n_packages);
 	topo_irq_free(p_topo->irqs, p_topo->n_irqs);
+	topo_index_free(p_topo);
 
 	memset(p_topo, 0, sizeof(struct wayca_topo));
 	return;
 }
 
+/*
+ * topo_max_cores - number of cores the CPUs would make if every core had
+ * as many CPUs as the largest one, -ENODATA if there's no core
+ */
+static int topo_max_cores(const struct wayca_topo *topo)
+{
+	size_t cpu_in_core = 0;
+	int i;
+
+	/* determines the maximum number of CPUs contained in the core */
+	for (i = 0; i < topo->n_cores; i++) {
+		if (topo->cores[i]->n_cpus > cpu_in_core)
+			cpu_in_core = topo->cores[i]->n_cpus;
+	}
+
+	if (cpu_in_core > 0)
+		return topo->n_cpus / cpu_in_core;
+	return -ENODATA; /* not initialized */
+}
+
+/* topo_max_ccls - the same as topo_max_cores() for the clusters */
+static int topo_max_ccls(const struct wayca_topo *topo)
+{
+	size_t cpu_in_ccl = 0;
+	int i;
+
+	/* determines the maximum number of CPUs contained in the ccl */
+	for (i = 0; i < topo->n_clusters; i++) {
+		if (topo->ccls[i]->n_cpus > cpu_in_ccl)
+			cpu_in_ccl = topo->ccls[i]->n_cpus;
+	}
+
+	if (cpu_in_ccl > 0)
+		return topo->n_cpus / cpu_in_ccl;
+	return -ENODATA; /* not initialized */
+}
+
 int WAYCA_SC_DECLSPEC wayca_sc_cpus_in_core(void)
 {
-	if (topo.n_cores < 1)
-		return -ENODATA; /* not initialized */
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int max_cores = topo_max_cores(topo);
 
-	wayca_sc_cores_in_total();
 	if (max_cores > 0)
-		return topo.n_cpus / max_cores;
+		return topo->n_cpus / max_cores;
 	else
 		return -ENODATA; /* not initialized */
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_cpus_in_ccl(void)
 {
-	if (topo.n_clusters < 1)
-		return -ENODATA; /* not initialized */
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int max_ccls = topo_max_ccls(topo);
 
-	wayca_sc_ccls_in_total();
 	if (max_ccls > 0)
-		return topo.n_cpus / max_ccls;
+		return topo->n_cpus / max_ccls;
 	else
 		return -ENODATA; /* not initialized */
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_cpus_in_node(void)
 {
-	if (topo.n_nodes < 1)
+	struct wayca_topo *topo __topo_ref = topo_get();
+
+	if (topo->n_nodes < 1)
 		return -ENODATA; /* not initialized */
-	return topo.n_cpus / topo.n_nodes;
+	return topo->n_cpus / topo->n_nodes;
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_cpus_in_package(void)
 {
-	if (topo.n_packages < 1)
+	struct wayca_topo *topo __topo_ref = topo_get();
+
+	if (topo->n_packages < 1)
 		return -ENODATA; /* not initialized */
-	return topo.n_cpus / topo.n_packages;
+	return topo->n_cpus / topo->n_packages;
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_cpus_in_total(void)
 {
-	if (topo.n_cpus < 1)
+	struct wayca_topo *topo __topo_ref = topo_get();
+
+	if (topo->n_cpus < 1)
 		return -ENODATA; /* not initialized */
-	return topo.n_cpus;
+	return topo->n_cpus;
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_cores_in_ccl(void)
 {
-	if (topo.n_clusters < 1)
-		return -ENODATA; /* not initialized */
-	if (topo.n_cores < 1)
-		return -ENODATA; /* not initialized */
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int max_cores = topo_max_cores(topo);
+	int max_ccls = topo_max_ccls(topo);
 
-	wayca_sc_cores_in_total();
-	wayca_sc_ccls_in_total();
 	if (max_ccls > 0 && max_cores > 0)
 		return max_cores / max_ccls;
 	else
@@ -1696,479 +2790,746 @@ int WAYCA_SC_DECLSPEC wayca_sc_cores_in_ccl(void)
 
 int WAYCA_SC_DECLSPEC wayca_sc_cores_in_node(void)
 {
-	if (topo.n_cores < 1 || topo.n_nodes < 1)
-		return -ENODATA; /* not initialized */
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int max_cores = topo_max_cores(topo);
 
-	wayca_sc_cores_in_total();
-	if (max_cores > 0)
-		return max_cores / topo.n_nodes;
+	if (max_cores > 0 && topo->n_nodes > 0)
+		return max_cores / topo->n_nodes;
 	else
 		return -ENODATA; /* not initialized */
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_cores_in_package(void)
 {
-	if (topo.n_cores < 1 || topo.n_packages < 1)
-		return -ENODATA; /* not initialized */
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int max_cores = topo_max_cores(topo);
 
-	wayca_sc_cores_in_total();
-	if (max_cores > 0)
-		return max_cores / topo.n_packages;
+	if (max_cores > 0 && topo->n_packages > 0)
+		return max_cores / topo->n_packages;
 	else
 		return -ENODATA; /* not initialized */
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_cores_in_total(void)
 {
-	size_t cpu_in_core = 0;
-	int i;
+	struct wayca_topo *topo __topo_ref = topo_get();
 
-	if (topo.n_cores < 1)
-		return -ENODATA; /* not initialized */
-
-	/* determines the maximum number of CPUs contained in the core */
-	for (i = 0; i < topo.n_cores; i++) {
-		if (topo.cores[i]->n_cpus > cpu_in_core)
-			cpu_in_core = topo.cores[i]->n_cpus;
-	}
-
-	if (cpu_in_core > 0)
-		max_cores = topo.n_cpus / cpu_in_core;
-	else
-		return -ENODATA;
-
-	return max_cores;
+	return topo_max_cores(topo);
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_ccls_in_package(void)
 {
-	if (topo.n_clusters < 1 || topo.n_packages < 1)
-		return -ENODATA; /* not initialized */
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int max_ccls = topo_max_ccls(topo);
 
-	wayca_sc_ccls_in_total();
-	if (max_ccls > 0)
-		return max_ccls / topo.n_packages;
+	if (max_ccls > 0 && topo->n_packages > 0)
+		return max_ccls / topo->n_packages;
 	else
 		return -ENODATA; /* not initialized */
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_ccls_in_node(void)
 {
-	if (topo.n_clusters < 1 || topo.n_nodes < 1)
-		return -ENODATA; /* not initialized */
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int max_ccls = topo_max_ccls(topo);
 
-	wayca_sc_ccls_in_total();
-	if (max_ccls > 0)
-		return max_ccls / topo.n_nodes;
+	if (max_ccls > 0 && topo->n_nodes > 0)
+		return max_ccls / topo->n_nodes;
 	else
 		return -ENODATA; /* not initialized */
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_ccls_in_total(void)
 {
-	size_t cpu_in_ccl = 0;
-	int i;
-
-	if (topo.n_clusters < 1)
-		return -ENODATA; /* not initialized */
-
-	/* determines the maximum number of CPUs contained in the ccl */
-	for (i = 0; i < topo.n_clusters; i++) {
-		if (topo.ccls[i]->n_cpus > cpu_in_ccl)
-			cpu_in_ccl = topo.ccls[i]->n_cpus;
-	}
-
-	if (cpu_in_ccl > 0)
-		max_ccls = topo.n_cpus / cpu_in_ccl;
-	else
-		return -ENODATA;
+	struct wayca_topo *topo __topo_ref = topo_get();
 
-	return max_ccls;
+	return topo_max_ccls(topo);
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_nodes_in_package(void)
 {
-	if (topo.n_packages < 1)
+	struct wayca_topo *topo __topo_ref = topo_get();
+
+	if (topo->n_packages < 1)
 		return -ENODATA; /* not initialized */
-	return topo.n_nodes / topo.n_packages;
+	return topo->n_nodes / topo->n_packages;
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_nodes_in_total(void)
 {
-	if (topo.n_nodes < 1)
+	struct wayca_topo *topo __topo_ref = topo_get();
+
+	if (topo->n_nodes < 1)
 		return -ENODATA; /* not initialized */
-	return topo.n_nodes;
+	return topo->n_nodes;
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_packages_in_total(void)
 {
-	if (topo.n_packages < 1)
+	struct wayca_topo *topo __topo_ref = topo_get();
+
+	if (topo->n_packages < 1)
 		return -ENODATA; /* not initialized */
-	return topo.n_packages;
+	return topo->n_packages;
 }
 
-static bool topo_is_valid_cpu(int cpu_id)
+unsigned long WAYCA_SC_DECLSPEC wayca_sc_topo_generation(void)
 {
-	return cpu_id >= 0 && cpu_id < topo.n_cpus;
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+
+	return topo->generation;
 }
 
-static bool topo_is_valid_core(int core_id)
+#ifdef WAYCA_SC_DEBUG
+unsigned long WAYCA_SC_DECLSPEC wayca_sc_topo_nr_retired(void)
 {
-	return core_id >= 0 && core_id < topo.n_cores;
+	unsigned long nr;
+
+	pthread_mutex_lock(&topo_phase_mutex);
+	nr = topo_nr_retired;
+	pthread_mutex_unlock(&topo_phase_mutex);
+	return nr;
 }
+#endif /* WAYCA_SC_DEBUG */
 
-static bool topo_is_valid_ccl(int ccl_id)
+static bool topo_is_valid_cpu(const struct wayca_topo *topo, int cpu_id)
 {
-	return ccl_id >= 0 && ccl_id < topo.n_clusters;
+	return cpu_id >= 0 && cpu_id < topo->n_cpus;
 }
 
-static bool topo_is_valid_node(int node_id)
+static bool topo_is_valid_core(const struct wayca_topo *topo, int core_id)
 {
-	return node_id >= 0 && node_id < topo.n_nodes;
+	return core_id >= 0 && core_id < topo->n_cores;
 }
 
-static bool topo_is_valid_package(int package_id)
+static bool topo_is_valid_ccl(const struct wayca_topo *topo, int ccl_id)
 {
-	return package_id >= 0 && package_id < topo.n_packages;
+	return ccl_id >= 0 && ccl_id < topo->n_clusters;
 }
 
-int WAYCA_SC_DECLSPEC wayca_sc_get_physical_id(char *elem_name, int logical_id)
+static bool topo_is_valid_node(const struct wayca_topo *topo, int node_id)
 {
-	if (!strcmp(elem_name, "package") && topo_is_valid_package(logical_id))
-		return topo.packages[logical_id]->physical_package_id;
-	if (!strcmp(elem_name, "cluster") && topo_is_valid_ccl(logical_id))
-		return topo.ccls[logical_id]->cluster_id;
-	if (!strcmp(elem_name, "core") && topo_is_valid_core(logical_id))
-		return topo.cores[logical_id]->core_id;
-
-	return -ENODATA;
+	return node_id >= 0 && node_id < topo->n_nodes;
 }
 
-static bool wayca_sc_is_cpu_online(int cpu)
+static bool topo_is_valid_package(const struct wayca_topo *topo,
+				   int package_id)
 {
-	char path_buffer[WAYCA_SC_PATH_LEN_MAX];
-	int online;
-
-	if (!topo_is_valid_cpu(cpu))
-		return false;
-
-	/* CPU 0 is always online */
-	if (!cpu)
-		return true;
+	return package_id >= 0 && package_id < topo->n_packages;
+}
 
-	snprintf(path_buffer, sizeof(path_buffer), "%s/cpu%d/",
-			WAYCA_SC_CPU_FNAME, cpu);
-	topo_path_read_s32(path_buffer, "online", &online);
+int WAYCA_SC_DECLSPEC wayca_sc_get_physical_id(char *elem_name, int logical_id)
+{
+	struct wayca_topo *topo __topo_ref = topo_get();
 
-	/* check whether the cache status is the same as the actual CPU status */
-	if (online == CPU_ISSET_S(cpu, topo.setsize, topo.online_cpu_map))
-		return CPU_ISSET_S(cpu, topo.setsize, topo.online_cpu_map);
+	if (!strcmp(elem_name, "package") &&
+	    topo_is_valid_package(topo, logical_id))
+		return topo->packages[logical_id]->physical_package_id;
+	if (!strcmp(elem_name, "cluster") && topo_is_valid_ccl(topo, logical_id))
+		return topo->ccls[logical_id]->cluster_id;
+	if (!strcmp(elem_name, "core") && topo_is_valid_core(topo, logical_id))
+		return topo->cores[logical_id]->core_id;
 
-	/*
-	 * When the CPU status is inconsistent with the cache status, need to
-	 * re-create the topology.
-	 */
-	topo_free();
-	topo_init();
-	return CPU_ISSET_S(cpu, topo.setsize, topo.online_cpu_map);
+	return -ENODATA;
 }
 
-static void check_and_update_cpu_status(void)
+/* the caller syncs the online CPUs before it takes @topo */
+static bool wayca_sc_is_cpu_online(const struct wayca_topo *topo, int cpu)
 {
-	int num_cpu, i;
+	if (!topo_is_valid_cpu(topo, cpu))
+		return false;
 
-	/* check and update the CPU status */
-	num_cpu = wayca_sc_cpus_in_total();
-	for (i = 0; i < num_cpu; i++)
-		wayca_sc_is_cpu_online(i);
+	return topo_cpu_is_online(topo, cpu);
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_core_cpu_mask(int core_id, size_t cpusetsize,
 					     cpu_set_t *mask)
 {
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
 	size_t valid_cpu_setsize;
 
-	if (mask == NULL || !topo_is_valid_core(core_id))
+	if (mask == NULL || !topo_is_valid_core(topo, core_id))
 		return -EINVAL;
 
-	check_and_update_cpu_status();
-
-	valid_cpu_setsize = CPU_ALLOC_SIZE(topo.n_cpus);
+	valid_cpu_setsize = CPU_ALLOC_SIZE(topo->n_cpus);
 	if (cpusetsize < valid_cpu_setsize)
 		return -EINVAL;
 
 	CPU_ZERO_S(cpusetsize, mask);
 	CPU_OR_S(valid_cpu_setsize, mask, mask,
-		 topo.cores[core_id]->core_cpus_map);
+		 topo->cores[core_id]->core_cpus_map);
 	return 0;
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_ccl_cpu_mask(int ccl_id, size_t cpusetsize,
 					    cpu_set_t *mask)
 {
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
 	size_t valid_cpu_setsize;
 
-	if (mask == NULL || !topo_is_valid_ccl(ccl_id))
+	if (mask == NULL || !topo_is_valid_ccl(topo, ccl_id))
 		return -EINVAL;
 
-	check_and_update_cpu_status();
-
-	valid_cpu_setsize = CPU_ALLOC_SIZE(topo.n_cpus);
+	valid_cpu_setsize = CPU_ALLOC_SIZE(topo->n_cpus);
 	if (cpusetsize < valid_cpu_setsize)
 		return -EINVAL;
 
 	CPU_ZERO_S(cpusetsize, mask);
-	CPU_OR_S(valid_cpu_setsize, mask, mask, topo.ccls[ccl_id]->cpu_map);
+	CPU_OR_S(valid_cpu_setsize, mask, mask, topo->ccls[ccl_id]->cpu_map);
 	return 0;
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_ccl_core_mask(int ccl_id, size_t setsize,
 					    cpu_set_t *mask)
 {
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
 	size_t valid_core_setsize;
 
-	if (mask == NULL || !topo_is_valid_ccl(ccl_id))
+	if (mask == NULL || !topo_is_valid_ccl(topo, ccl_id))
 		return -EINVAL;
 
-	check_and_update_cpu_status();
-
-	valid_core_setsize = CPU_ALLOC_SIZE(topo.n_cores);
+	valid_core_setsize = CPU_ALLOC_SIZE(topo->n_cores);
 	if (setsize < valid_core_setsize)
 		return -EINVAL;
 
 	CPU_ZERO_S(setsize, mask);
-	CPU_OR_S(valid_core_setsize, mask, mask, topo.ccls[ccl_id]->core_map);
+	CPU_OR_S(valid_core_setsize, mask, mask, topo->ccls[ccl_id]->core_map);
 	return 0;
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_node_cpu_mask(int node_id, size_t cpusetsize,
 					     cpu_set_t *mask)
 {
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
 	size_t valid_cpu_setsize;
 
-	if (mask == NULL || !topo_is_valid_node(node_id))
+	if (mask == NULL || !topo_is_valid_node(topo, node_id))
 		return -EINVAL;
 
-	check_and_update_cpu_status();
-
-	valid_cpu_setsize = CPU_ALLOC_SIZE(topo.n_cpus);
+	valid_cpu_setsize = CPU_ALLOC_SIZE(topo->n_cpus);
 	if (cpusetsize < valid_cpu_setsize)
 		return -EINVAL;
 
 	CPU_ZERO_S(cpusetsize, mask);
-	CPU_OR_S(valid_cpu_setsize, mask, mask, topo.nodes[node_id]->cpu_map);
+	CPU_OR_S(valid_cpu_setsize, mask, mask, topo->nodes[node_id]->cpu_map);
 	return 0;
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_node_core_mask(int node_id, size_t setsize,
 					     cpu_set_t *mask)
 {
-	size_t valid_core_setsize;
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+	size_t valid_core_setsize;
+
+	if (mask == NULL || !topo_is_valid_node(topo, node_id))
+		return -EINVAL;
+
+	valid_core_setsize = CPU_ALLOC_SIZE(topo->n_cores);
+	if (setsize < valid_core_setsize)
+		return -EINVAL;
+
+	CPU_ZERO_S(setsize, mask);
+	CPU_OR_S(valid_core_setsize, mask, mask,
+		 topo->nodes[node_id]->core_map);
+	return 0;
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_node_ccl_mask(int node_id, size_t setsize,
+					     cpu_set_t *mask)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+	size_t valid_ccl_setsize;
+
+	if (mask == NULL || !topo_is_valid_node(topo, node_id))
+		return -EINVAL;
+
+	valid_ccl_setsize = CPU_ALLOC_SIZE(topo->n_clusters);
+	if (setsize < valid_ccl_setsize)
+		return -EINVAL;
+
+	CPU_ZERO_S(setsize, mask);
+	CPU_OR_S(valid_ccl_setsize, mask, mask,
+		 topo->nodes[node_id]->cluster_map);
+	return 0;
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_package_cpu_mask(int package_id, size_t cpusetsize,
+						cpu_set_t *mask)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+	size_t valid_cpu_setsize;
+
+	if (mask == NULL || !topo_is_valid_package(topo, package_id))
+		return -EINVAL;
+
+	valid_cpu_setsize = CPU_ALLOC_SIZE(topo->n_cpus);
+	if (cpusetsize < valid_cpu_setsize)
+		return -EINVAL;
+
+	CPU_ZERO_S(cpusetsize, mask);
+	CPU_OR_S(valid_cpu_setsize, mask, mask,
+		 topo->packages[package_id]->cpu_map);
+	return 0;
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_total_cpu_mask(size_t cpusetsize, cpu_set_t *mask)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+	size_t valid_cpu_setsize;
+
+	if (mask == NULL)
+		return -EINVAL;
+
+	valid_cpu_setsize = CPU_ALLOC_SIZE(topo->n_cpus);
+	if (cpusetsize < valid_cpu_setsize)
+		return -EINVAL;
+
+	CPU_ZERO_S(cpusetsize, mask);
+	CPU_OR_S(valid_cpu_setsize, mask, mask, topo->cpu_map);
+	return 0;
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_total_online_cpu_mask(size_t cpusetsize, cpu_set_t *mask)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+	size_t valid_cpu_setsize;
+
+	if (mask == NULL)
+		return -EINVAL;
+
+	valid_cpu_setsize = CPU_ALLOC_SIZE(topo->n_cpus);
+	if (cpusetsize < valid_cpu_setsize)
+		return -EINVAL;
+
+	CPU_ZERO_S(cpusetsize, mask);
+	CPU_OR_S(valid_cpu_setsize, mask, mask, topo->online_cpu_map);
+	return 0;
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_package_node_mask(int package_id, size_t setsize,
+						 cpu_set_t *mask)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+	size_t valid_numa_setsize;
+	int ret;
+
+	if (mask == NULL || !topo_is_valid_package(topo, package_id))
+		return -EINVAL;
+
+	ret = topo_load_phase(topo, TOPO_PHASE_NUMA);
+	if (ret)
+		return ret;
+
+	valid_numa_setsize = CPU_ALLOC_SIZE(topo->n_nodes);
+	if (setsize < valid_numa_setsize)
+		return -EINVAL;
+
+	CPU_ZERO_S(setsize, mask);
+	CPU_OR_S(valid_numa_setsize, mask, mask,
+		 topo->packages[package_id]->numa_map);
+	return 0;
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_total_node_mask(size_t setsize, cpu_set_t *mask)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+	size_t valid_numa_setsize;
+	int i;
+
+	if (mask == NULL)
+		return -EINVAL;
+
+	valid_numa_setsize = CPU_ALLOC_SIZE(topo->n_nodes);
+	if (setsize < valid_numa_setsize)
+		return -EINVAL;
+
+	/* the node masks hold the logical node ids, not the ones of sysfs */
+	CPU_ZERO_S(setsize, mask);
+	for (i = 0; i < topo->n_nodes; i++)
+		CPU_SET_S(i, setsize, mask);
+	return 0;
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_get_core_id(int cpu_id)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+
+	if (!topo_is_valid_cpu(topo, cpu_id))
+		return -EINVAL;
+
+	/* if cpu is offline, can't get physical_core_id */
+	if (!wayca_sc_is_cpu_online(topo, cpu_id))
+		return -ENOENT;
+
+	return topo->cpu_ids.core[cpu_id];
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_get_ccl_id(int cpu_id)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+
+	/* cluster may not exist in some version of kernel */
+	if (!topo_is_valid_cpu(topo, cpu_id) || topo->n_clusters < 1)
+		return -EINVAL;
+
+	/* if cpu is offline, can't get physical_cluster_id */
+	if (!wayca_sc_is_cpu_online(topo, cpu_id))
+		return -ENOENT;
+
+	return topo->cpu_ids.ccl[cpu_id];
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_get_node_id(int cpu_id)
+{
+	struct wayca_topo *topo __topo_ref = topo_get();
+
+	if (!topo_is_valid_cpu(topo, cpu_id))
+		return -EINVAL;
+
+	return topo->cpu_ids.node[cpu_id];
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_get_package_id(int cpu_id)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+
+	if (!topo_is_valid_cpu(topo, cpu_id))
+		return -EINVAL;
+
+	/* if cpu is offline, can't get physical_package_id */
+	if (!wayca_sc_is_cpu_online(topo, cpu_id))
+		return -ENOENT;
+
+	return topo->cpu_ids.package[cpu_id];
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_get_cpu_capacity(int cpu_id)
+{
+	struct wayca_topo *topo __topo_ref = topo_get();
 
-	if (mask == NULL || !topo_is_valid_node(node_id))
+	if (!topo_is_valid_cpu(topo, cpu_id))
 		return -EINVAL;
 
-	check_and_update_cpu_status();
+	return topo->cpus[cpu_id]->capacity;
+}
 
-	valid_core_setsize = CPU_ALLOC_SIZE(topo.n_cores);
-	if (setsize < valid_core_setsize)
+int WAYCA_SC_DECLSPEC wayca_sc_get_cpu_ids(size_t cpusetsize,
+					   const cpu_set_t *cpuset,
+					   struct wayca_sc_cpu_ids *ids,
+					   size_t num)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+	const struct wayca_cpu_ids *tbl = &topo->cpu_ids;
+	size_t n = 0;
+	int cpu;
+
+	if (cpuset == NULL || ids == NULL || topo->n_cpus < 1)
 		return -EINVAL;
 
-	CPU_ZERO_S(setsize, mask);
-	CPU_OR_S(valid_core_setsize, mask, mask,
-		 topo.nodes[node_id]->core_map);
-	return 0;
+	for (cpu = 0; cpu < cpusetsize * 8; cpu++) {
+		if (!CPU_ISSET_S(cpu, cpusetsize, cpuset))
+			continue;
+		if (!topo_is_valid_cpu(topo, cpu) || n == num)
+			return -EINVAL;
+
+		ids[n].cpu = cpu;
+		ids[n].node_id = tbl->node[cpu];
+		if (topo_cpu_is_online(topo, cpu)) {
+			ids[n].core_id = tbl->core[cpu];
+			ids[n].ccl_id = tbl->ccl[cpu];
+			ids[n].package_id = tbl->package[cpu];
+			ids[n].l2_id = tbl->l2[cpu];
+			ids[n].l3_id = tbl->l3[cpu];
+		} else {
+			ids[n].core_id = -ENOENT;
+			ids[n].ccl_id = -ENOENT;
+			ids[n].package_id = -ENOENT;
+			ids[n].l2_id = -ENOENT;
+			ids[n].l3_id = -ENOENT;
+		}
+		n++;
+	}
+	return n;
 }
 
-int WAYCA_SC_DECLSPEC wayca_sc_node_ccl_mask(int node_id, size_t setsize,
-					     cpu_set_t *mask)
+int WAYCA_SC_DECLSPEC wayca_sc_get_node_mem_size(int node_id, unsigned long *size)
 {
-	size_t valid_ccl_setsize;
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int ret;
 
-	if (mask == NULL || !topo_is_valid_node(node_id))
+	if (size == NULL || !topo_is_valid_node(topo, node_id))
 		return -EINVAL;
 
-	check_and_update_cpu_status();
-
-	valid_ccl_setsize = CPU_ALLOC_SIZE(topo.n_clusters);
-	if (setsize < valid_ccl_setsize)
-		return -EINVAL;
+	ret = topo_load_phase(topo, TOPO_PHASE_NUMA);
+	if (ret)
+		return ret;
 
-	CPU_ZERO_S(setsize, mask);
-	CPU_OR_S(valid_ccl_setsize, mask, mask,
-		 topo.nodes[node_id]->cluster_map);
+	*size = topo->nodes[node_id]->p_meminfo->total_avail_kB;
 	return 0;
 }
 
-int WAYCA_SC_DECLSPEC wayca_sc_package_cpu_mask(int package_id, size_t cpusetsize,
-						cpu_set_t *mask)
+int WAYCA_SC_DECLSPEC wayca_sc_get_node_mem_stat(int node_id,
+				unsigned int max_age_ms,
+				struct wayca_sc_node_mem_stat *stat)
 {
-	size_t valid_cpu_setsize;
+	struct wayca_topo *topo __topo_ref = topo_get();
 
-	if (mask == NULL || !topo_is_valid_package(package_id))
+	if (stat == NULL || !topo_is_valid_node(topo, node_id))
 		return -EINVAL;
 
-	check_and_update_cpu_status();
+	return topo_meminfo_stat(topo->nodes[node_id]->node_idx, max_age_ms,
+				 stat);
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_node_distance(int node_a, int node_b)
+{
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int ret;
 
-	valid_cpu_setsize = CPU_ALLOC_SIZE(topo.n_cpus);
-	if (cpusetsize < valid_cpu_setsize)
+	if (!topo_is_valid_node(topo, node_a) ||
+	    !topo_is_valid_node(topo, node_b))
 		return -EINVAL;
 
-	CPU_ZERO_S(cpusetsize, mask);
-	CPU_OR_S(valid_cpu_setsize, mask, mask,
-		 topo.packages[package_id]->cpu_map);
-	return 0;
+	ret = topo_load_phase(topo, TOPO_PHASE_NUMA);
+	if (ret)
+		return ret;
+
+	return topo->nodes[node_a]->distance[node_b];
 }
 
-int WAYCA_SC_DECLSPEC wayca_sc_total_cpu_mask(size_t cpusetsize, cpu_set_t *mask)
+int WAYCA_SC_DECLSPEC wayca_sc_node_distance_matrix(size_t *num, int *matrix)
 {
-	size_t valid_cpu_setsize;
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int i, ret;
 
-	if (mask == NULL)
+	if (num == NULL)
 		return -EINVAL;
 
-	check_and_update_cpu_status();
+	ret = topo_load_phase(topo, TOPO_PHASE_NUMA);
+	if (ret)
+		return ret;
 
-	valid_cpu_setsize = CPU_ALLOC_SIZE(topo.n_cpus);
-	if (cpusetsize < valid_cpu_setsize)
-		return -EINVAL;
+	*num = topo->n_nodes;
+	if (!matrix)
+		return 0;
 
-	CPU_ZERO_S(cpusetsize, mask);
-	CPU_OR_S(valid_cpu_setsize, mask, mask, topo.cpu_map);
+	for (i = 0; i < topo->n_nodes; i++)
+		memcpy(matrix + i * topo->n_nodes, topo->nodes[i]->distance,
+		       topo->n_nodes * sizeof(int));
 	return 0;
 }
 
-int WAYCA_SC_DECLSPEC wayca_sc_total_online_cpu_mask(size_t cpusetsize, cpu_set_t *mask)
+/*
+ * topo_nearest_nodes - fill @nodes with the first @num nodes in ascending
+ * distance from @node_id. Nodes at the same distance keep their order.
+ */
+static int topo_nearest_nodes(struct wayca_topo *topo, int node_id,
+			      size_t num, int *nodes)
 {
-	size_t valid_cpu_setsize;
+	const int *distance;
+	int *order;
+	int i, j, tmp, ret;
 
-	if (mask == NULL)
-		return -EINVAL;
+	ret = topo_load_phase(topo, TOPO_PHASE_NUMA);
+	if (ret)
+		return ret;
 
-	check_and_update_cpu_status();
+	order = calloc(topo->n_nodes, sizeof(int));
+	if (!order)
+		return -ENOMEM;
 
-	valid_cpu_setsize = CPU_ALLOC_SIZE(topo.n_cpus);
-	if (cpusetsize < valid_cpu_setsize)
-		return -EINVAL;
+	/* insertion sort, the number of nodes is small */
+	distance = topo->nodes[node_id]->distance;
+	for (i = 0; i < topo->n_nodes; i++) {
+		order[i] = i;
+		for (j = i; j > 0 && distance[order[j - 1]] > distance[order[j]];
+		     j--) {
+			tmp = order[j];
+			order[j] = order[j - 1];
+			order[j - 1] = tmp;
+		}
+	}
 
-	CPU_ZERO_S(cpusetsize, mask);
-	CPU_OR_S(valid_cpu_setsize, mask, mask, topo.online_cpu_map);
-	return 0;
+	if (num > topo->n_nodes)
+		num = topo->n_nodes;
+	memcpy(nodes, order, num * sizeof(int));
+	free(order);
+	return num;
 }
 
-int WAYCA_SC_DECLSPEC wayca_sc_package_node_mask(int package_id, size_t setsize,
-						 cpu_set_t *mask)
+int WAYCA_SC_DECLSPEC wayca_sc_nearest_nodes(int node_id, size_t num,
+					     int *nodes)
 {
-	size_t valid_numa_setsize;
+	struct wayca_topo *topo __topo_ref = topo_get();
 
-	if (mask == NULL || !topo_is_valid_package(package_id))
+	if (nodes == NULL || !topo_is_valid_node(topo, node_id))
 		return -EINVAL;
 
-	check_and_update_cpu_status();
+	return topo_nearest_nodes(topo, node_id, num, nodes);
+}
 
-	valid_numa_setsize = CPU_ALLOC_SIZE(topo.n_nodes);
-	if (setsize < valid_numa_setsize)
+int WAYCA_SC_DECLSPEC wayca_sc_cpu_nearest_nodes(int cpu_id, size_t num,
+						 int *nodes)
+{
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int node_id;
+
+	if (nodes == NULL || !topo_is_valid_cpu(topo, cpu_id))
 		return -EINVAL;
 
-	CPU_ZERO_S(setsize, mask);
-	CPU_OR_S(valid_numa_setsize, mask, mask,
-		 topo.packages[package_id]->numa_map);
-	return 0;
+	node_id = topo->cpu_ids.node[cpu_id];
+	if (node_id < 0)
+		return node_id;
+
+	return topo_nearest_nodes(topo, node_id, num, nodes);
 }
 
-int WAYCA_SC_DECLSPEC wayca_sc_total_node_mask(size_t setsize, cpu_set_t *mask)
+int WAYCA_SC_DECLSPEC wayca_sc_mem_nodes_in_total(void)
 {
-	size_t valid_numa_setsize;
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int ret;
 
-	if (mask == NULL)
+	ret = topo_load_phase(topo, TOPO_PHASE_NUMA);
+	if (ret)
+		return ret;
+
+	if (topo->n_mem_nodes < 1)
+		return -ENODATA;
+	return topo->n_mem_nodes;
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_get_mem_node_info(int mem_node,
+				struct wayca_sc_mem_node_info *info)
+{
+	struct wayca_topo *topo __topo_ref = topo_get();
+	struct wayca_mem_node *mem;
+	int ret;
+
+	if (info == NULL)
 		return -EINVAL;
 
-	check_and_update_cpu_status();
+	ret = topo_load_phase(topo, TOPO_PHASE_NUMA);
+	if (ret)
+		return ret;
 
-	valid_numa_setsize = CPU_ALLOC_SIZE(topo.n_nodes);
-	if (setsize < valid_numa_setsize)
+	if (mem_node < 0 || mem_node >= topo->n_mem_nodes)
 		return -EINVAL;
 
-	CPU_ZERO_S(setsize, mask);
-	CPU_OR_S(valid_numa_setsize, mask, mask, topo.node_map);
+	mem = &topo->mem_nodes[mem_node];
+	info->phys_node = mem->node_idx;
+	info->node_id = mem->node;
+	info->initiator = mem->initiator;
+	info->tier = mem->tier;
+	info->size = mem->total_avail_kB;
+	info->read_bandwidth = mem->read_bandwidth;
+	info->write_bandwidth = mem->write_bandwidth;
+	info->read_latency = mem->read_latency;
+	info->write_latency = mem->write_latency;
+	info->cache_size = mem->cache_size;
+	info->cache_line_size = mem->cache_line_size;
 	return 0;
 }
 
-int WAYCA_SC_DECLSPEC wayca_sc_get_core_id(int cpu_id)
+int WAYCA_SC_DECLSPEC wayca_sc_mem_node_distance(int node_id, int mem_node)
 {
-	int physical_id, i;
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int ret;
 
-	if (!topo_is_valid_cpu(cpu_id))
+	if (!topo_is_valid_node(topo, node_id))
 		return -EINVAL;
 
-	/* if cpu is offline, can't get physical_core_id */
-	if (!wayca_sc_is_cpu_online(cpu_id))
-		return -ENOENT;
+	ret = topo_load_phase(topo, TOPO_PHASE_NUMA);
+	if (ret)
+		return ret;
 
-	physical_id = topo.cpus[cpu_id]->core_id;
-	for (i = 0; i < topo.n_cores; i++) {
-		if (topo.cores[i]->core_id == physical_id)
-			return i;
-	}
-	return -EINVAL;
+	if (mem_node < 0 || mem_node >= topo->n_mem_nodes)
+		return -EINVAL;
+
+	return topo->mem_nodes[mem_node].distance[node_id];
 }
 
-int WAYCA_SC_DECLSPEC wayca_sc_get_ccl_id(int cpu_id)
+int WAYCA_SC_DECLSPEC wayca_sc_get_mem_node_stat(int mem_node,
+				unsigned int max_age_ms,
+				struct wayca_sc_node_mem_stat *stat)
 {
-	int physical_id;
-	int i;
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int ret;
 
-	/* cluster may not exist in some version of kernel */
-	if (!topo_is_valid_cpu(cpu_id) || wayca_sc_cpus_in_ccl() < 0)
+	if (stat == NULL)
 		return -EINVAL;
 
-	/* if cpu is offline, can't get physical_cluster_id */
-	if (!wayca_sc_is_cpu_online(cpu_id))
-		return -ENOENT;
+	ret = topo_load_phase(topo, TOPO_PHASE_NUMA);
+	if (ret)
+		return ret;
 
-	physical_id = topo.cpus[cpu_id]->p_cluster->cluster_id;
-	for (i = 0; i < topo.n_clusters; i++) {
-		if (topo.ccls[i]->cluster_id == physical_id)
-			return i;
-	}
-	return -EINVAL;
+	if (mem_node < 0 || mem_node >= topo->n_mem_nodes)
+		return -EINVAL;
+
+	return topo_meminfo_stat(topo->mem_nodes[mem_node].node_idx,
+				 max_age_ms, stat);
 }
 
-int WAYCA_SC_DECLSPEC wayca_sc_get_node_id(int cpu_id)
+/* the key to order the memory nodes by @attr, lower is better */
+static long long topo_mem_attr_key(const struct wayca_mem_node *mem,
+				   int attr)
 {
-	if (!topo_is_valid_cpu(cpu_id))
-		return -EINVAL;
-
-	return topo.cpus[cpu_id]->p_numa_node->node_idx;
+	switch (attr) {
+	case WAYCA_SC_MEM_READ_BANDWIDTH:
+		return mem->read_bandwidth ? -(long long)mem->read_bandwidth :
+					     LLONG_MAX;
+	case WAYCA_SC_MEM_WRITE_BANDWIDTH:
+		return mem->write_bandwidth ? -(long long)mem->write_bandwidth :
+					      LLONG_MAX;
+	case WAYCA_SC_MEM_READ_LATENCY:
+		return mem->read_latency ? mem->read_latency : LLONG_MAX;
+	case WAYCA_SC_MEM_WRITE_LATENCY:
+		return mem->write_latency ? mem->write_latency : LLONG_MAX;
+	default:
+		return mem->tier >= 0 ? mem->tier : LLONG_MAX;
+	}
 }
 
-int WAYCA_SC_DECLSPEC wayca_sc_get_package_id(int cpu_id)
+int WAYCA_SC_DECLSPEC wayca_sc_mem_nodes_by_attr(int attr, size_t num,
+						 int *mem_nodes)
 {
-	int physical_id;
-	int i;
+	struct wayca_topo *topo __topo_ref = topo_get();
+	long long *keys;
+	int *order;
+	int i, j, tmp, ret;
 
-	if (!topo_is_valid_cpu(cpu_id))
+	if (mem_nodes == NULL || attr < WAYCA_SC_MEM_READ_BANDWIDTH ||
+	    attr > WAYCA_SC_MEM_TIER)
 		return -EINVAL;
 
-	/* if cpu is offline, can't get physical_package_id */
-	if (!wayca_sc_is_cpu_online(cpu_id))
-		return -ENOENT;
+	ret = topo_load_phase(topo, TOPO_PHASE_NUMA);
+	if (ret)
+		return ret;
 
-	physical_id = topo.cpus[cpu_id]->p_package->physical_package_id;
-	for (i = 0; i < topo.n_packages; i++) {
-		if (topo.packages[i]->physical_package_id == physical_id)
-			return i;
+	order = calloc(topo->n_mem_nodes + 1, sizeof(int));
+	keys = calloc(topo->n_mem_nodes + 1, sizeof(long long));
+	if (!order || !keys) {
+		free(order);
+		free(keys);
+		return -ENOMEM;
 	}
-	return -EINVAL;
-}
 
-int WAYCA_SC_DECLSPEC wayca_sc_get_node_mem_size(int node_id, unsigned long *size)
-{
-	if (size == NULL || !topo_is_valid_node(node_id))
-		return -EINVAL;
+	/* insertion sort, the number of nodes is small */
+	for (i = 0; i < topo->n_mem_nodes; i++) {
+		keys[i] = topo_mem_attr_key(&topo->mem_nodes[i], attr);
+		order[i] = i;
+		for (j = i; j > 0 && keys[order[j - 1]] > keys[order[j]]; j--) {
+			tmp = order[j];
+			order[j] = order[j - 1];
+			order[j - 1] = tmp;
+		}
+	}
 
-	*size = topo.nodes[node_id]->p_meminfo->total_avail_kB;
-	return 0;
+	if (num > topo->n_mem_nodes)
+		num = topo->n_mem_nodes;
+	memcpy(mem_nodes, order, num * sizeof(int));
+	free(order);
+	free(keys);
+	return num;
 }
 
 static int parse_cache_size(const char *size)
@@ -2185,23 +3546,24 @@ static int parse_cache_size(const char *size)
 
 int WAYCA_SC_DECLSPEC wayca_sc_get_l1i_size(int cpu_id)
 {
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
 	static const char *size;
 	static const char *type;
 	int level;
 	int i;
 
-	if (!topo_is_valid_cpu(cpu_id))
+	if (!topo_is_valid_cpu(topo, cpu_id))
 		return -EINVAL;
 
 	/* if cpu offline, return 0 */
-	if (!wayca_sc_is_cpu_online(cpu_id))
+	if (!wayca_sc_is_cpu_online(topo, cpu_id))
 		return 0;
 
-	for (i = 0; i < topo.cpus[cpu_id]->n_caches; i++) {
-		level = topo.cpus[cpu_id]->p_caches[i].level;
-		type = topo.cpus[cpu_id]->p_caches[i].type;
+	for (i = 0; i < topo->cpus[cpu_id]->n_caches; i++) {
+		level = topo->cpus[cpu_id]->p_caches[i].level;
+		type = topo->cpus[cpu_id]->p_caches[i].type;
 		if (level == 1 && !strcmp(type, "Instruction")) {
-			size = topo.cpus[cpu_id]->p_caches[i].cache_size;
+			size = topo->cpus[cpu_id]->p_caches[i].cache_size;
 			return parse_cache_size(size);
 		}
 	}
@@ -2210,23 +3572,24 @@ int WAYCA_SC_DECLSPEC wayca_sc_get_l1i_size(int cpu_id)
 
 int WAYCA_SC_DECLSPEC wayca_sc_get_l1d_size(int cpu_id)
 {
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
 	static const char *size;
 	static const char *type;
 	int level;
 	int i;
 
-	if (!topo_is_valid_cpu(cpu_id))
+	if (!topo_is_valid_cpu(topo, cpu_id))
 		return -EINVAL;
 
 	/* if cpu offline, return 0 */
-	if (!wayca_sc_is_cpu_online(cpu_id))
+	if (!wayca_sc_is_cpu_online(topo, cpu_id))
 		return 0;
 
-	for (i = 0; i < topo.cpus[cpu_id]->n_caches; i++) {
-		level = topo.cpus[cpu_id]->p_caches[i].level;
-		type = topo.cpus[cpu_id]->p_caches[i].type;
+	for (i = 0; i < topo->cpus[cpu_id]->n_caches; i++) {
+		level = topo->cpus[cpu_id]->p_caches[i].level;
+		type = topo->cpus[cpu_id]->p_caches[i].type;
 		if (level == 1 && !strcmp(type, "Data")) {
-			size = topo.cpus[cpu_id]->p_caches[i].cache_size;
+			size = topo->cpus[cpu_id]->p_caches[i].cache_size;
 			return parse_cache_size(size);
 		}
 	}
@@ -2235,23 +3598,24 @@ int WAYCA_SC_DECLSPEC wayca_sc_get_l1d_size(int cpu_id)
 
 int WAYCA_SC_DECLSPEC wayca_sc_get_l2_size(int cpu_id)
 {
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
 	static const char *size;
 	static const char *type;
 	int level;
 	int i;
 
-	if (!topo_is_valid_cpu(cpu_id))
+	if (!topo_is_valid_cpu(topo, cpu_id))
 		return -EINVAL;
 
 	/* if cpu offline, return 0 */
-	if (!wayca_sc_is_cpu_online(cpu_id))
+	if (!wayca_sc_is_cpu_online(topo, cpu_id))
 		return 0;
 
-	for (i = 0; i < topo.cpus[cpu_id]->n_caches; i++) {
-		level = topo.cpus[cpu_id]->p_caches[i].level;
-		type = topo.cpus[cpu_id]->p_caches[i].type;
+	for (i = 0; i < topo->cpus[cpu_id]->n_caches; i++) {
+		level = topo->cpus[cpu_id]->p_caches[i].level;
+		type = topo->cpus[cpu_id]->p_caches[i].type;
 		if (level == 2 && !strcmp(type, "Unified")) {
-			size = topo.cpus[cpu_id]->p_caches[i].cache_size;
+			size = topo->cpus[cpu_id]->p_caches[i].cache_size;
 			return parse_cache_size(size);
 		}
 	}
@@ -2260,29 +3624,245 @@ int WAYCA_SC_DECLSPEC wayca_sc_get_l2_size(int cpu_id)
 
 int WAYCA_SC_DECLSPEC wayca_sc_get_l3_size(int cpu_id)
 {
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
 	const char *size;
 	const char *type;
 	int level;
 	int i;
 
-	if (!topo_is_valid_cpu(cpu_id))
+	if (!topo_is_valid_cpu(topo, cpu_id))
 		return -EINVAL;
 
 	/* if cpu offline, return 0 */
-	if (!wayca_sc_is_cpu_online(cpu_id))
+	if (!wayca_sc_is_cpu_online(topo, cpu_id))
 		return 0;
 
-	for (i = 0; i < topo.cpus[cpu_id]->n_caches; i++) {
-		level = topo.cpus[cpu_id]->p_caches[i].level;
-		type = topo.cpus[cpu_id]->p_caches[i].type;
+	for (i = 0; i < topo->cpus[cpu_id]->n_caches; i++) {
+		level = topo->cpus[cpu_id]->p_caches[i].level;
+		type = topo->cpus[cpu_id]->p_caches[i].type;
 		if (level == 3 && !strcmp(type, "Unified")) {
-			size = topo.cpus[cpu_id]->p_caches[i].cache_size;
+			size = topo->cpus[cpu_id]->p_caches[i].cache_size;
 			return parse_cache_size(size);
 		}
 	}
 	return -ENODATA;
 }
 
+/* the domain ids of the caches at @level by CPU, NULL if not tracked */
+static const int *topo_cache_domain_table(const struct wayca_topo *topo,
+					  int level, size_t *n_domains)
+{
+	switch (level) {
+	case 2:
+		*n_domains = topo->cpu_ids.n_l2;
+		return topo->cpu_ids.l2;
+	case 3:
+		*n_domains = topo->cpu_ids.n_l3;
+		return topo->cpu_ids.l3;
+	default:
+		return NULL;
+	}
+}
+
+/* the cache of the first CPU in @domain_id, which describes the domain */
+static struct wayca_cache *topo_cache_domain(const struct wayca_topo *topo,
+					     int level, int domain_id)
+{
+	const int *ids;
+	size_t n;
+	int cpu;
+
+	ids = topo_cache_domain_table(topo, level, &n);
+	if (!ids || domain_id < 0 || domain_id >= n)
+		return NULL;
+
+	for (cpu = 0; cpu < topo->n_cpus; cpu++)
+		if (ids[cpu] == domain_id)
+			return topo_cpu_cache(topo->cpus[cpu], level);
+	return NULL;
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_cache_domains_in_total(int level)
+{
+	struct wayca_topo *topo __topo_ref = topo_get();
+	size_t n;
+
+	if (!topo_cache_domain_table(topo, level, &n))
+		return -EINVAL;
+	if (n < 1)
+		return -ENODATA; /* not initialized */
+	return n;
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_get_cache_domain_id(int cpu_id, int level)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+	const int *ids;
+	size_t n;
+
+	ids = topo_cache_domain_table(topo, level, &n);
+	if (!ids || !topo_is_valid_cpu(topo, cpu_id))
+		return -EINVAL;
+
+	/* if cpu is offline, it shares no cache */
+	if (!wayca_sc_is_cpu_online(topo, cpu_id))
+		return -ENOENT;
+
+	return ids[cpu_id];
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_cache_domain_cpu_mask(int level, int domain_id,
+						     size_t cpusetsize,
+						     cpu_set_t *mask)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+	struct wayca_cache *p_cache;
+	size_t valid_cpu_setsize;
+
+	p_cache = topo_cache_domain(topo, level, domain_id);
+	if (mask == NULL || !p_cache)
+		return -EINVAL;
+
+	valid_cpu_setsize = CPU_ALLOC_SIZE(topo->n_cpus);
+	if (cpusetsize < valid_cpu_setsize)
+		return -EINVAL;
+
+	CPU_ZERO_S(cpusetsize, mask);
+	CPU_OR_S(valid_cpu_setsize, mask, mask, p_cache->shared_cpu_map);
+	return 0;
+}
+
+/* the @i-th mask of an array of masks of @cpusetsize bytes */
+static cpu_set_t *topo_mask_at(cpu_set_t *masks, size_t cpusetsize, size_t i)
+{
+	return (cpu_set_t *)((char *)masks + i * cpusetsize);
+}
+
+/* the cpus of domain @i of a level not made of caches */
+static const cpu_set_t *topo_domain_cpu_map(const struct wayca_topo *topo,
+					    enum wayca_sc_topo_level level,
+					    size_t i)
+{
+	switch (level) {
+	case WAYCA_SC_TOPO_LEVEL_CORE:
+		return topo->cores[i]->core_cpus_map;
+	case WAYCA_SC_TOPO_LEVEL_CCL:
+		return topo->ccls[i]->cpu_map;
+	case WAYCA_SC_TOPO_LEVEL_NODE:
+		return topo->nodes[i]->cpu_map;
+	case WAYCA_SC_TOPO_LEVEL_PACKAGE:
+		return topo->packages[i]->cpu_map;
+	default:
+		return NULL;
+	}
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_topo_domain_masks(enum wayca_sc_topo_level level,
+						 size_t cpusetsize,
+						 cpu_set_t *masks, size_t num,
+						 unsigned long *generation)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+	struct wayca_cache *p_cache;
+	size_t valid_cpu_setsize;
+	const int *ids = NULL;
+	int cache_level = 0;
+	cpu_set_t *mask;
+	size_t n, i;
+	int cpu;
+
+	switch (level) {
+	case WAYCA_SC_TOPO_LEVEL_CORE:
+		n = topo->n_cores;
+		break;
+	case WAYCA_SC_TOPO_LEVEL_CCL:
+		n = topo->n_clusters;
+		break;
+	case WAYCA_SC_TOPO_LEVEL_NODE:
+		n = topo->n_nodes;
+		break;
+	case WAYCA_SC_TOPO_LEVEL_PACKAGE:
+		n = topo->n_packages;
+		break;
+	case WAYCA_SC_TOPO_LEVEL_L2:
+		cache_level = 2;
+		break;
+	case WAYCA_SC_TOPO_LEVEL_L3:
+		cache_level = 3;
+		break;
+	case WAYCA_SC_TOPO_LEVEL_LLC:
+		cache_level = topo->cpu_ids.n_l3 ? 3 : 2;
+		break;
+	default:
+		return -EINVAL;
+	}
+	if (cache_level)
+		ids = topo_cache_domain_table(topo, cache_level, &n);
+
+	if (generation)
+		*generation = topo->generation;
+	if (masks == NULL)
+		return n;
+
+	valid_cpu_setsize = CPU_ALLOC_SIZE(topo->n_cpus);
+	if (cpusetsize < valid_cpu_setsize || num < n)
+		return -EINVAL;
+
+	for (i = 0; i < n; i++)
+		CPU_ZERO_S(cpusetsize, topo_mask_at(masks, cpusetsize, i));
+
+	if (!ids) {
+		for (i = 0; i < n; i++) {
+			mask = topo_mask_at(masks, cpusetsize, i);
+			CPU_OR_S(valid_cpu_setsize, mask, mask,
+				 topo_domain_cpu_map(topo, level, i));
+		}
+		return n;
+	}
+
+	/* a cache domain is the shared map of any of its cpus */
+	for (cpu = 0; cpu < topo->n_cpus; cpu++) {
+		if (!topo_cpu_is_online(topo, cpu) || ids[cpu] < 0 ||
+		    ids[cpu] >= n)
+			continue;
+
+		mask = topo_mask_at(masks, cpusetsize, ids[cpu]);
+		if (CPU_ISSET_S(cpu, cpusetsize, mask))
+			continue;
+
+		p_cache = topo_cpu_cache(topo->cpus[cpu], cache_level);
+		if (p_cache)
+			CPU_OR_S(valid_cpu_setsize, mask, mask,
+				 p_cache->shared_cpu_map);
+	}
+	return n;
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_get_cache_domain_info(int level, int domain_id,
+					struct wayca_sc_cache_info *cache_info)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+	struct wayca_cache *p_cache;
+	int size;
+
+	p_cache = topo_cache_domain(topo, level, domain_id);
+	if (cache_info == NULL || !p_cache)
+		return -EINVAL;
+
+	size = parse_cache_size(p_cache->cache_size);
+	if (size < 0)
+		return size;
+
+	cache_info->level = p_cache->level;
+	cache_info->size = size;
+	cache_info->line_size = p_cache->coherency_line_size;
+	cache_info->ways = p_cache->ways_of_associativity;
+	cache_info->sets = p_cache->number_of_sets;
+	cache_info->n_cpus = CPU_COUNT_S(topo->setsize,
+					 p_cache->shared_cpu_map);
+	return 0;
+}
+
 /* memory bandwidth (relative value) of speading over multiple CCLs
  *
  * Measured with: bw_mem bcopy
@@ -2467,43 +4047,31 @@ static void topo_irq_free(struct wayca_irq **irqs, size_t n_irqs)
 
 static int topo_parse_irq_info(struct wayca_irq *irq, const char *irq_number)
 {
-	char buf[WAYCA_SC_ATTR_STRING_LEN] = {0};
 	char path_buffer[WAYCA_SC_PATH_LEN_MAX];
+	const char *content;
 	char *endptr;
 	int ret;
 
-	snprintf(path_buffer, sizeof(path_buffer), "/sys/kernel/irq/%s",
-			irq_number);
+	snprintf(path_buffer, sizeof(path_buffer), "%s/%s",
+			WAYCA_SC_KERNEL_IRQ_FNAME, irq_number);
 	/*
 	 * actions is the irq name, if the action is empty, it is not an active
 	 * irq
 	 */
-	ret = topo_path_read_buffer(path_buffer, "actions", irq->name,
-				    WAYCA_SC_ATTR_STRING_LEN - 1);
-	if (ret <= 0)
-		irq->name[0] = '\0';
-	else if (irq->name[strlen(irq->name) - 1] == '\n')
-		irq->name[strlen(irq->name) - 1] = '\0';
+	topo_sysfs_read_str(path_buffer, "actions", irq->name,
+			    sizeof(irq->name));
 
-	ret = topo_path_read_buffer(path_buffer, "chip_name", buf,
-				    WAYCA_SC_ATTR_STRING_LEN - 1);
-	if (ret <= 0) {
+	ret = topo_sysfs_read(path_buffer, "chip_name", &content);
+	if (ret <= 0)
 		irq->chip_name = WAYCA_SC_TOPO_CHIP_NAME_INVAL;
-	} else {
-		if (buf[strlen(buf) - 1] == '\n')
-			buf[strlen(buf) - 1] = '\0';
-		irq->chip_name = str2_irq_chip_name(buf);
-	}
+	else
+		irq->chip_name = str2_irq_chip_name(content);
 
-	ret = topo_path_read_buffer(path_buffer, "type", buf,
-				    WAYCA_SC_ATTR_STRING_LEN - 1);
-	if (ret <= 0) {
+	ret = topo_sysfs_read(path_buffer, "type", &content);
+	if (ret <= 0)
 		irq->type = WAYCA_SC_TOPO_TYPE_INVAL;
-	} else {
-		if (buf[strlen(buf) - 1] == '\n')
-			buf[strlen(buf) - 1] = '\0';
-		irq->type = str2_irq_type(buf);
-	}
+	else
+		irq->type = str2_irq_type(content);
 
 	errno = 0;
 	irq->irq_number = strtoul(irq_number, &endptr, 10);
@@ -2537,9 +4105,10 @@ static int topo_get_irq_info(struct wayca_topo *sys_topo)
 	 * we only consider activated irqs, and all activated irqs have been
 	 * put in /proc/irq/.
 	 */
-	proc_dp = opendir("/proc/irq");
+	proc_dp = opendir(WAYCA_SC_PROC_IRQ_FNAME);
 	if (!proc_dp) {
-		PRINT_ERROR("failed to open directory /proc/irq\n");
+		PRINT_ERROR("failed to open directory %s\n",
+			    WAYCA_SC_PROC_IRQ_FNAME);
 		return -errno;
 	}
 	while ((entry = readdir(proc_dp)) != NULL) {
@@ -2645,7 +4214,7 @@ static int topo_parse_irq(struct wayca_device_irqs *wirqs,
 	int irq = -1;
 	int j;
 
-	topo_path_read_s32(device_sysfs_dir, "irq", &irq);
+	topo_sysfs_read_s32(device_sysfs_dir, "irq", &irq);
 	PRINT_DBG("irq file exists, irq number is: %d\n", irq);
 	if (irq < 0)
 		irq_number = 0; /* on failure, default to set 0 */
@@ -2675,44 +4244,14 @@ static int topo_parse_irq(struct wayca_device_irqs *wirqs,
 static int topo_parse_device_irqs(struct wayca_device_irqs *wirqs,
 					const char *device_sysfs_dir)
 {
-	int msi_irqs_exist = 0;
-	int irq_file_exist = 0;
-	struct dirent *entry;
-	struct stat statbuf;
+	bool msi_irqs_exist, irq_file_exist;
 	int ret = 0;
-	DIR *dp;
 
 	wirqs->n_irqs = 0;
 
 	/* find "msi_irqs" and/or "irq" */
-	dp = opendir(device_sysfs_dir);
-	if (!dp)
-		return -errno;
-	while (((msi_irqs_exist == 0) || (irq_file_exist == 0)) &&
-	       (entry = readdir(dp)) != NULL) {
-		ret = lstat(entry->d_name, &statbuf);
-		if (ret < 0) {
-			PRINT_ERROR("fail to get directory %s stat, ret = %d\n",
-					entry->d_name, -errno);
-			continue;
-		}
-
-		if ((msi_irqs_exist == 0) && S_ISDIR(statbuf.st_mode)) {
-			if (strcmp("msi_irqs", entry->d_name) == 0) {
-				msi_irqs_exist = 1;
-				PRINT_DBG("found msi_irqs directory under %s\n",
-					  device_sysfs_dir);
-				continue;
-			}
-		} else if ((irq_file_exist == 0) &&
-			   (strcmp("irq", entry->d_name) == 0)) {
-			irq_file_exist = 1;
-			PRINT_DBG("found irq file under %s\n",
-				  device_sysfs_dir);
-			continue;
-		}
-	}
-	closedir(dp);
+	msi_irqs_exist = topo_sysfs_exists(device_sysfs_dir, "msi_irqs");
+	irq_file_exist = topo_sysfs_exists(device_sysfs_dir, "irq");
 
 	if (msi_irqs_exist) {
 		ret = topo_parse_msi_irq(wirqs, device_sysfs_dir);
@@ -2775,52 +4314,40 @@ static int topo_parse_pci_smmu(struct wayca_pci_device *p_pcidev,
 static int topo_parse_pci_info(struct wayca_topo *p_topo,
 			struct wayca_pci_device *pcidev, const char *dir)
 {
-	char buf[WAYCA_SC_ATTR_STRING_LEN] = {0};
+	struct topo_sysfs_attr attrs[] = {
+		{ .name = "class", .type = TOPO_SYSFS_HEX32,
+		  .val = &pcidev->class },
+		{ .name = "vendor", .type = TOPO_SYSFS_HEX16,
+		  .val = &pcidev->vendor },
+		{ .name = "device", .type = TOPO_SYSFS_HEX16,
+		  .val = &pcidev->device },
+	};
 	int ret;
 
 	/*
 	 * read PCI information into: pcidev.
 	 * Sysfs data output format is defined in linux kernel code:
 	 * [linux.kernel]/drivers/pci/pci-sysfs.c
-	 * The format is class:vendor:device
+	 * The format is class:vendor:device, each defaults to 0 on failure.
 	 */
-	ret = topo_path_read_buffer(dir, "class", buf,
-				    WAYCA_SC_ATTR_STRING_LEN - 1);
-	if (ret <= 0)
-		pcidev->class = 0;
-	else {
-		if (sscanf(buf, "%x", &pcidev->class) != 1)
-			pcidev->class = 0;
-		PRINT_DBG("class: 0x%06x\n", pcidev->class);
-	}
-	ret = topo_path_read_buffer(dir, "vendor", buf,
-				    WAYCA_SC_ATTR_STRING_LEN - 1);
-	if (ret <= 0)
-		pcidev->vendor = 0;
-	else {
-		if (sscanf(buf, "%hx", &pcidev->vendor) != 1)
-			pcidev->vendor = 0;
-		PRINT_DBG("vendor: 0x%04x\n", pcidev->vendor);
-	}
-	ret = topo_path_read_buffer(dir, "device", buf,
-				    WAYCA_SC_ATTR_STRING_LEN - 1);
-	if (ret <= 0)
-		pcidev->device = 0;
-	else {
-		if (sscanf(buf, "%hx", &pcidev->device) != 1)
-			pcidev->device = 0;
-		PRINT_DBG("device: 0x%04x\n", pcidev->device);
-	}
+	pcidev->class = 0;
+	pcidev->vendor = 0;
+	pcidev->device = 0;
+	topo_sysfs_read_attrs(dir, attrs, ARRAY_SIZE(attrs));
+	PRINT_DBG("class: 0x%06x\n", pcidev->class);
+	PRINT_DBG("vendor: 0x%04x\n", pcidev->vendor);
+	PRINT_DBG("device: 0x%04x\n", pcidev->device);
+
 	/* read local_cpulist */
 	pcidev->local_cpu_map = CPU_ALLOC(p_topo->kernel_max_cpus);
 	if (!pcidev->local_cpu_map)
 		return -ENOMEM;
-	ret = topo_path_read_cpulist(dir, "local_cpulist",
-				     pcidev->local_cpu_map,
-				     p_topo->kernel_max_cpus);
+	ret = topo_sysfs_read_cpulist(dir, "local_cpulist",
+				      pcidev->local_cpu_map,
+				      p_topo->setsize);
 	/* if cpu online, return ret; else continue */
 	if (ret != 0 &&
-	    CPU_EQUAL_S(topo.setsize, topo.online_cpu_map, topo.cpu_map)) {
+	    CPU_EQUAL_S(p_topo->setsize, p_topo->online_cpu_map, p_topo->cpu_map)) {
 		PRINT_ERROR("failed to get local_cpulist, ret = %d\n", ret);
 		return ret;
 	}
@@ -2831,7 +4358,7 @@ static int topo_parse_pci_info(struct wayca_topo *p_topo,
 		return ret;
 	}
 	/* read enable */
-	ret = topo_path_read_s32(dir, "enable", &pcidev->enable);
+	ret = topo_sysfs_read_s32(dir, "enable", &pcidev->enable);
 	if (ret < 0) {
 		PRINT_ERROR("failed to read %s/enable, ret = %d\n", dir, ret);
 		return ret;
@@ -2847,31 +4374,116 @@ static int topo_parse_pci_numa_node(struct wayca_topo *p_topo,
 	int i;
 
 	/* read 'numa_node' */
-	topo_path_read_s32(dir, "numa_node", &node_nb);
+	topo_sysfs_read_s32(dir, "numa_node", &node_nb);
 	PRINT_DBG("numa_node: %d\n", node_nb);
 	if (node_nb < 0)
 		node_nb = 0; /* on failure, default to node #0 */
 	p_pcidev->numa_node = node_nb;
 
 	/* get the 'wayca_node *' whoes node_idx == this 'node_nb' */
-	for (i = 0; i < p_topo->n_nodes; i++) {
-		if (p_topo->nodes[i]->node_idx == node_nb)
-			break;
+	i = topo_node_index(p_topo, node_nb);
+	if (i < 0) {
+		PRINT_ERROR(
+			"failed to match this PCI device to any numa node: %s\n",
+			dir);
+		return -EINVAL;
+	}
+	*numa_id = i;
+	return 0;
+}
+
+/* Whether @name, up to '/' or the end, is a PCI address like 0000:00:01.0 */
+static bool topo_is_pci_slot_name(const char *name)
+{
+	unsigned int domain, bus, dev, fn;
+	int len = 0;
+
+	return sscanf(name, "%x:%x:%x.%x%n", &domain, &bus, &dev, &fn,
+		      &len) == 4 && (name[len] == '\0' || name[len] == '/');
+}
+
+/* Whether @name, up to '/' or the end, is a host bridge like pci0000:00 */
+static bool topo_is_pci_host_name(const char *name)
+{
+	unsigned int domain, bus;
+	int len = 0;
+
+	return sscanf(name, "pci%x:%x%n", &domain, &bus, &len) == 2 &&
+	       (name[len] == '\0' || name[len] == '/');
+}
+
+/*
+ * topo_parse_pci_hierarchy - find the host bridge and the upstream bridge of
+ * @pcidev from its path, e.g. .../pci0000:00/0000:00:01.0/0000:01:00.0 is
+ * below the bridge 0000:00:01.0 of the host bridge pci0000:00.
+ */
+static void topo_parse_pci_hierarchy(struct wayca_pci_device *pcidev)
+{
+	const char *path = pcidev->absolute_path;
+	const char *comp, *parent = NULL;
+	size_t len;
+
+	pcidev->depth = 0;
+	for (comp = strchr(path, '/'); comp; comp = strchr(comp + 1, '/')) {
+		if (topo_is_pci_host_name(comp + 1)) {
+			/* a host bridge restarts the hierarchy */
+			len = strcspn(comp + 1, "/");
+			if (len >= sizeof(pcidev->root_name))
+				len = sizeof(pcidev->root_name) - 1;
+			memcpy(pcidev->root_name, comp + 1, len);
+			pcidev->root_name[len] = '\0';
+			pcidev->depth = 0;
+			parent = NULL;
+		} else if (topo_is_pci_slot_name(comp + 1) &&
+			   strchr(comp + 1, '/')) {
+			pcidev->depth++;
+			parent = comp + 1;
+		}
 	}
-	if (i == p_topo->n_nodes) {
-		PRINT_ERROR(
-			"failed to match this PCI device to any numa node: %s\n",
-			dir);
-		return -EINVAL;
+
+	pcidev->parent_name[0] = '\0';
+	if (parent) {
+		len = strcspn(parent, "/");
+		if (len >= sizeof(pcidev->parent_name))
+			len = sizeof(pcidev->parent_name) - 1;
+		memcpy(pcidev->parent_name, parent, len);
+		pcidev->parent_name[len] = '\0';
 	}
-	*numa_id = i;
-	return 0;
 }
 
-static int topo_parse_pci_device(struct wayca_topo *p_topo, const char *dir)
+/* Read the current link of a PCIe device, 0 for a conventional PCI one */
+static void topo_parse_pci_link(struct wayca_pci_device *pcidev,
+				const char *dir)
+{
+	char speed[WAYCA_SC_ATTR_STRING_LEN] = {0};
+	struct topo_sysfs_attr attrs[] = {
+		{ .name = "current_link_speed", .type = TOPO_SYSFS_STR,
+		  .val = speed, .len = sizeof(speed) },
+		{ .name = "current_link_width", .type = TOPO_SYSFS_S32,
+		  .val = &pcidev->link_width },
+	};
+
+	/* the speed is like "8.0 GT/s PCIe", or "Unknown" if the link is down */
+	pcidev->link_width = 0;
+	topo_sysfs_read_attrs(dir, attrs, ARRAY_SIZE(attrs));
+	pcidev->link_speed = (int)(strtod(speed, NULL) * 1000);
+	if (pcidev->link_width < 0)
+		pcidev->link_width = 0;
+	PRINT_DBG("link: %d MT/s x%d\n", pcidev->link_speed,
+		  pcidev->link_width);
+}
+
+/*
+ * topo_parse_pci_device - parse the PCI device at @dir into a new
+ * wayca_pci_device, which is returned by @pcidev as long as it belongs to a
+ * NUMA node, even if some of its information fails to be read.
+ *
+ * Return negative on error, 0 on success
+ */
+static int topo_parse_pci_device(struct wayca_topo *p_topo, const char *dir,
+				 struct wayca_pci_device **pcidev)
 {
 	struct wayca_pci_device *p_pcidev;
-	struct wayca_node *node;
 	char *p_index;
 	int ret;
 	int i;
@@ -2902,18 +4514,10 @@ static int topo_parse_pci_device(struct wayca_topo *p_topo, const char *dir)
 		PRINT_ERROR("failed to get pci device node id, ret = %d\n", ret);
 		return ret;
 	}
-	/* append p_pcidev to wayca node[]->pcidevs */
-	node = p_topo->nodes[i];
-	node->pcidevs = (struct wayca_pci_device **)topo_expand_mem(
-			node->pcidevs, node->n_pcidevs * sizeof(*node->pcidevs),
-			(node->n_pcidevs + 1) * sizeof(*node->pcidevs));
-	if (!node->pcidevs) {
-		free(p_pcidev);
-		return -ENOMEM;
-	}
-	node->pcidevs[node->n_pcidevs] = p_pcidev;
-	node->n_pcidevs++;
-	PRINT_DBG("n_pcidevs = %zu\n", node->n_pcidevs);
+	*pcidev = p_pcidev;
+
+	topo_parse_pci_hierarchy(p_pcidev);
+	topo_parse_pci_link(p_pcidev, dir);
 
 	ret = topo_parse_pci_info(p_topo, p_pcidev, dir);
 	if (ret) {
@@ -2927,12 +4531,32 @@ static int topo_parse_pci_device(struct wayca_topo *p_topo, const char *dir)
 	return ret;
 }
 
+/* append @pcidev to the wayca node[]->pcidevs it belongs to */
+static int topo_add_pci_device(struct wayca_topo *p_topo,
+			       struct wayca_pci_device *pcidev)
+{
+	struct wayca_node *node;
+
+	node = p_topo->nodes[topo_node_index(p_topo, pcidev->numa_node)];
+	node->pcidevs = (struct wayca_pci_device **)topo_expand_mem(
+			node->pcidevs, node->n_pcidevs * sizeof(*node->pcidevs),
+			(node->n_pcidevs + 1) * sizeof(*node->pcidevs));
+	if (!node->pcidevs) {
+		node->n_pcidevs = 0;
+		topo_free_pci_device(pcidev);
+		return -ENOMEM;
+	}
+	node->pcidevs[node->n_pcidevs] = pcidev;
+	node->n_pcidevs++;
+	PRINT_DBG("n_pcidevs = %zu\n", node->n_pcidevs);
+	return 0;
+}
+
 static int topo_parse_smmu_info(struct wayca_smmu *p_smmu, const char *dir)
 {
 	char path_buffer[WAYCA_SC_PATH_LEN_MAX] = {0};
 	struct dirent *entry;
 	char *p_index;
-	int ret;
 	DIR *dp;
 
 	p_index = strstr(dir, "arm-smmu-v3");
@@ -2944,13 +4568,8 @@ static int topo_parse_smmu_info(struct wayca_smmu *p_smmu, const char *dir)
 	(void)strncpy(p_smmu->name, p_index, sizeof(p_smmu->name) - 1);
 	PRINT_DBG("smmu name: %s\n", p_smmu->name);
 	/* read type (modalias) */
-	ret = topo_path_read_buffer(dir, "modalias", p_smmu->modalias,
-				    WAYCA_SC_ATTR_STRING_LEN - 1);
-	p_smmu->modalias[WAYCA_SC_ATTR_STRING_LEN - 1] = '\0';
-	if (ret <= 0)
-		p_smmu->modalias[0] = '\0';
-	else if (p_smmu->modalias[strlen(p_smmu->modalias) - 1] == '\n')
-		p_smmu->modalias[strlen(p_smmu->modalias) - 1] = '\0';
+	topo_sysfs_read_str(dir, "modalias", p_smmu->modalias,
+			    sizeof(p_smmu->modalias));
 	PRINT_DBG("modalias = %s\n", p_smmu->modalias);
 	/*
 	 * identify smmu_idx from the 'dir' string
@@ -2990,55 +4609,65 @@ static int topo_parse_smmu_info(struct wayca_smmu *p_smmu, const char *dir)
 	return 0;
 }
 
-static int topo_parse_smmu(struct wayca_topo *p_topo, const char *dir)
+/*
+ * topo_parse_smmu - parse the SMMU at @dir into a new wayca_smmu, which is
+ * returned by @smmu as long as it belongs to a NUMA node.
+ *
+ * Return negative on error, 0 on success
+ */
+static int topo_parse_smmu(struct wayca_topo *p_topo, const char *dir,
+			   struct wayca_smmu **smmu)
 {
 	struct wayca_smmu *p_smmu;
-	struct wayca_node *node;
 	int node_nb = -1;
 	int ret;
-	int i;
 
 	PRINT_DBG("SMMU full path: %s\n", dir);
 	p_smmu = (struct wayca_smmu *)calloc(1, sizeof(struct wayca_smmu));
 	if (!p_smmu)
 		return -ENOMEM;
 	/* read numa_node */
-	topo_path_read_s32(dir, "numa_node", &node_nb);
+	topo_sysfs_read_s32(dir, "numa_node", &node_nb);
 	PRINT_DBG("numa_node: %d\n", node_nb);
 	if (node_nb < 0)
 		node_nb = 0; /* on failure, default to node #0 */
 	p_smmu->numa_node = node_nb;
 
-	/* get the 'wayca_node *' whoes node_idx == this 'node_nb' */
-	for (i = 0; i < p_topo->n_nodes; i++) {
-		if (p_topo->nodes[i]->node_idx == node_nb)
-			break;
-	}
-	if (i == p_topo->n_nodes) {
+	/* check there's a 'wayca_node *' whoes node_idx == this 'node_nb' */
+	if (topo_node_index(p_topo, node_nb) < 0) {
 		PRINT_ERROR(
 			"failed to match this PCI device to any numa node: %s\n",
 			dir);
 		free(p_smmu);
 		return -EINVAL;
 	}
+	*smmu = p_smmu;
+
+	ret = topo_parse_smmu_info(p_smmu, dir);
+	if (ret)
+		PRINT_ERROR("failed to parse smmu information, ret = %d\n",
+				ret);
+	return ret;
+}
+
+/* append @smmu to the wayca node[]->smmus it belongs to */
+static int topo_add_smmu(struct wayca_topo *p_topo, struct wayca_smmu *smmu)
+{
+	struct wayca_node *node;
 
-	node = p_topo->nodes[i];
+	node = p_topo->nodes[topo_node_index(p_topo, smmu->numa_node)];
 	node->smmus = (struct wayca_smmu **)topo_expand_mem(
 			node->smmus, node->n_smmus * sizeof(*node->smmus),
 			(node->n_smmus + 1) * sizeof(*node->smmus));
 	if (!node->smmus) {
-		free(p_smmu);
+		node->n_smmus = 0;
+		free(smmu);
 		return -ENOMEM;
 	}
-	node->smmus[node->n_smmus] = p_smmu;
+	node->smmus[node->n_smmus] = smmu;
 	node->n_smmus++; /* incement number of SMMU devices */
 	PRINT_DBG("n_smmus = %zu\n", node->n_smmus);
-
-	ret = topo_parse_smmu_info(p_smmu, dir);
-	if (ret)
-		PRINT_ERROR("failed to parse smmu information, ret = %d\n",
-				ret);
-	return ret;
+	return 0;
 }
 
 static bool is_pci_device_dir(const char *dir)
@@ -3064,9 +4693,16 @@ static bool is_pci_device_dir(const char *dir)
 	return true;
 }
 
+/* a PCI device or an SMMU found by the device walker */
+struct topo_io_device {
+	struct wayca_pci_device *pcidev;
+	struct wayca_smmu *smmu;
+};
+
 /* Return negative on error, 0 on success
  */
-static int topo_parse_io_device(struct wayca_topo *p_topo, const char *dir)
+static int topo_parse_io_device(struct wayca_topo *p_topo, const char *dir,
+				struct topo_io_device *iodev)
 {
 	int ret;
 
@@ -3074,13 +4710,13 @@ static int topo_parse_io_device(struct wayca_topo *p_topo, const char *dir)
 		return -EINVAL;
 
 	if (strstr(dir, "pci") && is_pci_device_dir(dir)) {
-		ret = topo_parse_pci_device(p_topo, dir);
+		ret = topo_parse_pci_device(p_topo, dir, &iodev->pcidev);
 		if (ret) {
 			PRINT_ERROR("parse pci device fail, ret = %d\n", ret);
 			return ret;
 		}
 	} else if (strstr(dir, "smmu")) {
-		ret = topo_parse_smmu(p_topo, dir);
+		ret = topo_parse_smmu(p_topo, dir, &iodev->smmu);
 		if (ret) {
 			PRINT_ERROR("parse smmu fail, ret = %d\n", ret);
 			return ret;
@@ -3093,140 +4729,143 @@ static int topo_parse_io_device(struct wayca_topo *p_topo, const char *dir)
 	return 0;
 }
 
-/* Return negative on error, 0 on success
- */
-static int topo_recursively_read_io_devices(struct wayca_topo *p_topo,
-						const char *rootdir)
+/* called on the walker threads, only reads p_topo */
+static void *topo_walk_parse_device(const char *dir, void *data)
 {
-	DIR *dp;
-	struct dirent *entry;
-	struct stat statbuf;
-	char cwd[WAYCA_SC_PATH_LEN_MAX];
-	int ret = 0;
-
-	dp = opendir(rootdir);
-	if (!dp)
-		return -errno;
+	struct topo_io_device *iodev;
 
-	if (chdir(rootdir) == -1)
-		PRINT_DBG("failed to change the working dir\n");
-
-	while ((entry = readdir(dp)) != NULL) {
-		ret = lstat(entry->d_name, &statbuf);
-		if (ret < 0) {
-			ret = -errno;
-			goto out;
-		}
+	iodev = calloc(1, sizeof(*iodev));
+	if (!iodev)
+		return NULL;
 
-		if (S_ISDIR(statbuf.st_mode)) {
-			/* Found a directory, but ignore . and .. */
-			if (strcmp(".", entry->d_name) == 0 ||
-			    strcmp("..", entry->d_name) == 0)
-				continue;
-			(void)topo_recursively_read_io_devices(p_topo, entry->d_name);
-		} else {
-			/*
-			 * TODO: We rely on 'numa_node' to represent a
-			 * legitimate i/o device. However 'numa_node' exists
-			 * only when NUMA is enabled in kernel. So, we Need to
-			 * consider a better idea of identifying i/o device.
-			 */
-			if (strcmp("numa_node", entry->d_name) == 0)
-				(void)topo_parse_io_device(p_topo,
-					getcwd(cwd, WAYCA_SC_PATH_LEN_MAX));
-		}
+	(void)topo_parse_io_device(data, dir, iodev);
+	if (!iodev->pcidev && !iodev->smmu) {
+		free(iodev);
+		return NULL;
 	}
+	return iodev;
+}
 
-out:
-	if (chdir("..") == -1)
-		PRINT_DBG("failed to restore the working dir\n");
-	closedir(dp);
+static int topo_walk_add_device(void *dev, void *data)
+{
+	struct topo_io_device *iodev = dev;
+	int ret;
+
+	if (iodev->pcidev)
+		ret = topo_add_pci_device(data, iodev->pcidev);
+	else
+		ret = topo_add_smmu(data, iodev->smmu);
+	free(iodev);
 	return ret;
 }
 
+static void topo_walk_free_device(void *dev)
+{
+	struct topo_io_device *iodev = dev;
+
+	topo_free_pci_device(iodev->pcidev);
+	free(iodev->smmu);
+	free(iodev);
+}
+
+/* Return negative on error, 0 on success
+ */
+static int topo_read_io_devices(struct wayca_topo *p_topo, const char *rootdir)
+{
+	const struct topo_walk_ops ops = {
+		.parse = topo_walk_parse_device,
+		.add = topo_walk_add_device,
+		.free = topo_walk_free_device,
+		.data = p_topo,
+	};
+
+	return topo_walk_devices(rootdir, &ops);
+}
+
 int WAYCA_SC_DECLSPEC wayca_sc_get_irq_list(size_t *num, uint32_t *irq)
 {
+	struct wayca_topo *topo __topo_ref = topo_get();
 	int ret;
 	int i;
 
 	if (!num)
 		return -EINVAL;
 
-	if (!topo.irqs) {
-		ret = topo_get_irq_info(&topo);
-		if (ret)
-			return ret;
-	}
+	ret = topo_load_phase(topo, TOPO_PHASE_IRQ);
+	if (ret)
+		return ret;
 
-	*num = topo.n_irqs;
+	*num = topo->n_irqs;
 	if (!irq)
 		return 0;
 
-	for (i = 0; i < topo.n_irqs; i++)
-		irq[i] = topo.irqs[i]->irq_number;
+	for (i = 0; i < topo->n_irqs; i++)
+		irq[i] = topo->irqs[i]->irq_number;
 	return 0;
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_get_irq_info(uint32_t irq_num,
 					    struct wayca_sc_irq_info *irq_info)
 {
+	struct wayca_topo *topo __topo_ref = topo_get();
+	struct wayca_irq *irq;
 	int ret;
-	int i;
 
 	if (!irq_info)
 		return -EINVAL;
 	memset(irq_info, 0, sizeof(*irq_info));
 
-	if (!topo.irqs) {
-		ret = topo_get_irq_info(&topo);
-		if (ret)
-			return ret;
-	}
+	ret = topo_load_phase(topo, TOPO_PHASE_IRQ);
+	if (ret)
+		return ret;
 
-	for (i = 0; i < topo.n_irqs; i++) {
-		if (topo.irqs[i]->irq_number == irq_num)
-			break;
-	}
-	if (i == topo.n_irqs)
+	irq = topo_index_find_irq(topo, irq_num);
+	if (!irq)
 		return -ENOENT;
 
-	irq_info->irq_num = topo.irqs[i]->irq_number;
-	irq_info->chip_name = topo.irqs[i]->chip_name;
-	irq_info->type = topo.irqs[i]->type;
-	irq_info->name = topo.irqs[i]->name;
+	irq_info->irq_num = irq->irq_number;
+	irq_info->chip_name = irq->chip_name;
+	irq_info->type = irq->type;
+	irq_info->name = irq->name;
 	return 0;
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_get_device_list(int numa_node, size_t *num,
 					       const char **name)
 {
+	struct wayca_topo *topo __topo_ref = topo_get();
 	int start_node, end_node;
 	int i, j, k;
+	int ret;
 
 	if (numa_node >= wayca_sc_nodes_in_total() || !num)
 		return -EINVAL;
 
+	ret = topo_load_phase(topo, TOPO_PHASE_DEVICE);
+	if (ret)
+		return ret;
+
 	*num = 0;
 	if (numa_node < 0) {
 		start_node = 0;
-		end_node = topo.n_nodes - 1;
+		end_node = topo->n_nodes - 1;
 	} else {
 		start_node = numa_node;
 		end_node = numa_node;
 	}
 
 	for (i = start_node; i <= end_node; i++)
-		*num += topo.nodes[i]->n_pcidevs + topo.nodes[i]->n_smmus;
+		*num += topo->nodes[i]->n_pcidevs + topo->nodes[i]->n_smmus;
 
 	if (!name)
 		return 0;
 
 	for (i = 0, j = start_node; j <= end_node; j++) {
-		for (k = 0; k < topo.nodes[j]->n_smmus; k++, i++)
-			name[i] = topo.nodes[j]->smmus[k]->name;
+		for (k = 0; k < topo->nodes[j]->n_smmus; k++, i++)
+			name[i] = topo->nodes[j]->smmus[k]->name;
 
-		for (k = 0; k < topo.nodes[j]->n_pcidevs; k++, i++)
-			name[i] = topo.nodes[j]->pcidevs[k]->slot_name;
+		for (k = 0; k < topo->nodes[j]->n_pcidevs; k++, i++)
+			name[i] = topo->nodes[j]->pcidevs[k]->slot_name;
 	}
 
 	return 0;
@@ -3253,40 +4892,329 @@ static void topo_copy_pcidev_info(struct wayca_sc_device_info *dev_info,
 	dev_info->class = pcidev->class;
 	dev_info->nb_irq = pcidev->irqs.n_irqs;
 	dev_info->irq_numbers = pcidev->irqs.irq_numbers;
+	dev_info->parent = pcidev->parent_name[0] ? pcidev->parent_name : NULL;
+	dev_info->root = pcidev->root_name;
+	dev_info->depth = pcidev->depth;
+	dev_info->link_speed = pcidev->link_speed;
+	dev_info->link_width = pcidev->link_width;
+}
+
+static void topo_copy_device_info(struct wayca_sc_device_info *dev_info,
+				  const struct topo_device *dev)
+{
+	dev_info->dev_type = dev->type;
+	if (dev->type == WAYCA_SC_TOPO_DEV_TYPE_SMMU)
+		topo_copy_smmu_info(dev_info, dev->smmu);
+	else
+		topo_copy_pcidev_info(dev_info, dev->pcidev);
 }
 
 int WAYCA_SC_DECLSPEC wayca_sc_get_device_info(const char *name,
 					       struct wayca_sc_device_info *dev_info)
 {
-	int j, k;
+	struct wayca_topo *topo __topo_ref = topo_get();
+	struct topo_device dev;
+	int ret;
 
 	if (!dev_info || !name)
 		return -EINVAL;
 	memset(dev_info, 0, sizeof(*dev_info));
 
-	for (j = 0; j < topo.n_nodes; j++) {
-		for (k = 0; k < topo.nodes[j]->n_smmus; k++) {
-			struct wayca_smmu *smmu = topo.nodes[j]->smmus[k];
+	ret = topo_load_phase(topo, TOPO_PHASE_DEVICE);
+	if (ret)
+		return ret;
 
-			if (!strcmp(smmu->name, name)) {
-				dev_info->dev_type =
-					WAYCA_SC_TOPO_DEV_TYPE_SMMU;
-				topo_copy_smmu_info(dev_info, smmu);
-				return 0;
-			}
+	ret = topo_index_find_device(topo, name, &dev);
+	if (ret)
+		return ret;
+
+	topo_copy_device_info(dev_info, &dev);
+	return 0;
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_get_device_info_list(int numa_node, size_t *num,
+					struct wayca_sc_device_info *dev_info)
+{
+	struct wayca_topo *topo __topo_ref = topo_get();
+	int start_node, end_node;
+	struct topo_device dev;
+	int i, j, k;
+	int ret;
+
+	if (numa_node >= wayca_sc_nodes_in_total() || !num)
+		return -EINVAL;
+
+	ret = topo_load_phase(topo, TOPO_PHASE_DEVICE);
+	if (ret)
+		return ret;
+
+	if (numa_node < 0) {
+		start_node = 0;
+		end_node = topo->n_nodes - 1;
+	} else {
+		start_node = numa_node;
+		end_node = numa_node;
+	}
+
+	*num = 0;
+	for (i = start_node; i <= end_node; i++)
+		*num += topo->nodes[i]->n_pcidevs + topo->nodes[i]->n_smmus;
+
+	if (!dev_info)
+		return 0;
+
+	/* in the order of wayca_sc_get_device_list() */
+	for (i = 0, j = start_node; j <= end_node; j++) {
+		dev.type = WAYCA_SC_TOPO_DEV_TYPE_SMMU;
+		for (k = 0; k < topo->nodes[j]->n_smmus; k++, i++) {
+			dev.smmu = topo->nodes[j]->smmus[k];
+			memset(&dev_info[i], 0, sizeof(dev_info[i]));
+			topo_copy_device_info(&dev_info[i], &dev);
+		}
+
+		dev.type = WAYCA_SC_TOPO_DEV_TYPE_PCI;
+		for (k = 0; k < topo->nodes[j]->n_pcidevs; k++, i++) {
+			dev.pcidev = topo->nodes[j]->pcidevs[k];
+			memset(&dev_info[i], 0, sizeof(dev_info[i]));
+			topo_copy_device_info(&dev_info[i], &dev);
+		}
+	}
+
+	return 0;
+}
+
+/* locality of a CPU to a device, the lower the nearer */
+struct topo_cpu_rank {
+	int cpu;
+	int irqs;		/* IRQs of the device in the cluster, negated */
+	int remote_node;	/* not in the node of the device */
+	int remote_package;	/* not in the package of the device */
+	int distance;		/* distance to the node of the device */
+};
+
+static int topo_cpu_rank_cmp(const void *a, const void *b)
+{
+	const struct topo_cpu_rank *ra = a, *rb = b;
+
+	if (ra->irqs != rb->irqs)
+		return ra->irqs - rb->irqs;
+	if (ra->remote_node != rb->remote_node)
+		return ra->remote_node - rb->remote_node;
+	if (ra->remote_package != rb->remote_package)
+		return ra->remote_package - rb->remote_package;
+	if (ra->distance != rb->distance)
+		return ra->distance - rb->distance;
+	return ra->cpu - rb->cpu;
+}
+
+/*
+ * topo_device_irq_ccls - count the IRQs of @pcidev handled in each cluster
+ * into @ccl_irqs, by the effective affinity of the IRQs if the kernel
+ * reports it, or else by the affinity set to them
+ */
+static void topo_device_irq_ccls(struct wayca_topo *topo,
+				 const struct wayca_pci_device *pcidev,
+				 int *ccl_irqs)
+{
+	char path_buffer[WAYCA_SC_PATH_LEN_MAX];
+	cpu_set_t *affinity;
+	int *counted;
+	int i, cpu, ccl;
+
+	affinity = CPU_ALLOC(topo->kernel_max_cpus);
+	counted = calloc(topo->n_clusters, sizeof(*counted));
+	if (!affinity || !counted)
+		goto out;
+
+	for (i = 0; i < pcidev->irqs.n_irqs; i++) {
+		snprintf(path_buffer, sizeof(path_buffer), "%s/%u",
+			 WAYCA_SC_PROC_IRQ_FNAME, pcidev->irqs.irq_numbers[i]);
+		if (topo_sysfs_read_cpulist(path_buffer,
+					    "effective_affinity_list",
+					    affinity, topo->setsize) &&
+		    topo_sysfs_read_cpulist(path_buffer, "smp_affinity_list",
+					    affinity, topo->setsize))
+			continue;
+
+		/* each IRQ counts once in a cluster */
+		for (cpu = 0; cpu < topo->n_cpus; cpu++) {
+			ccl = topo->cpu_ids.ccl[cpu];
+			if (ccl < 0 || counted[ccl] == i + 1 ||
+			    !CPU_ISSET_S(cpu, topo->setsize, affinity))
+				continue;
+			counted[ccl] = i + 1;
+			ccl_irqs[ccl]++;
+		}
+	}
+
+out:
+	free(counted);
+	CPU_FREE(affinity);
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_device_near_cpus(const char *name, size_t n,
+						unsigned int flags,
+						size_t cpusetsize,
+						cpu_set_t *mask)
+{
+	struct wayca_topo *topo __topo_ref = topo_get_synced();
+	struct topo_cpu_rank *ranks;
+	struct wayca_node *node = NULL;
+	const cpu_set_t *local = NULL;
+	struct topo_device dev;
+	int i, node_id, package_id = -1;
+	size_t n_ranks = 0;
+	int *ccl_irqs;
+	int ret;
+
+	if (!name || !mask || !n ||
+	    cpusetsize < CPU_ALLOC_SIZE(topo->n_cpus) ||
+	    (flags & ~WAYCA_SC_NEAR_EXCLUDE_LOADED))
+		return -EINVAL;
+
+	ret = topo_load_phase(topo, TOPO_PHASE_DEVICE);
+	if (ret)
+		return ret;
+	ret = topo_load_phase(topo, TOPO_PHASE_NUMA);
+	if (ret)
+		return ret;
+
+	ret = topo_index_find_device(topo, name, &dev);
+	if (ret)
+		return ret;
+
+	ranks = calloc(topo->n_cpus, sizeof(*ranks));
+	ccl_irqs = calloc(topo->n_clusters, sizeof(*ccl_irqs));
+	if (!ranks || (!ccl_irqs && topo->n_clusters)) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	if (dev.type == WAYCA_SC_TOPO_DEV_TYPE_PCI) {
+		node_id = topo_node_index(topo, dev.pcidev->numa_node);
+		local = dev.pcidev->local_cpu_map;
+		topo_device_irq_ccls(topo, dev.pcidev, ccl_irqs);
+	} else {
+		node_id = topo_node_index(topo, dev.smmu->numa_node);
+	}
+	if (node_id >= 0)
+		node = topo->nodes[node_id];
+
+	/* the package of the device is the one of the CPUs in its node */
+	for (i = 0; node && i < topo->n_cpus; i++) {
+		if (topo->cpu_ids.node[i] == node_id) {
+			package_id = topo->cpu_ids.package[i];
+			break;
 		}
+	}
+
+	for (i = 0; i < topo->n_cpus; i++) {
+		struct topo_cpu_rank *rank = &ranks[n_ranks];
+		int cpu_node = topo->cpu_ids.node[i];
+		int ccl = topo->cpu_ids.ccl[i];
+
+		if (!CPU_ISSET_S(i, topo->setsize, topo->online_cpu_map))
+			continue;
+		if ((flags & WAYCA_SC_NEAR_EXCLUDE_LOADED) &&
+		    wayca_cpu_is_loaded(i))
+			continue;
+
+		rank->cpu = i;
+		rank->irqs = ccl >= 0 ? -ccl_irqs[ccl] : 0;
+		rank->remote_node = !((node && cpu_node == node_id) ||
+				      (local && CPU_ISSET_S(i, topo->setsize,
+							    local)));
+		rank->remote_package = package_id < 0 ||
+				       topo->cpu_ids.package[i] != package_id;
+		rank->distance = node && cpu_node >= 0 ?
+				 node->distance[cpu_node] : INT_MAX;
+		n_ranks++;
+	}
+
+	qsort(ranks, n_ranks, sizeof(*ranks), topo_cpu_rank_cmp);
+
+	if (n > n_ranks)
+		n = n_ranks;
+	CPU_ZERO_S(cpusetsize, mask);
+	for (i = 0; i < n; i++)
+		CPU_SET_S(ranks[i].cpu, cpusetsize, mask);
+	ret = n;
+
+out:
+	free(ccl_irqs);
+	free(ranks);
+	return ret;
+}
+
+static int topo_pcidev_path_cmp(const void *a, const void *b)
+{
+	const struct wayca_pci_device *pa = *(struct wayca_pci_device **)a;
+	const struct wayca_pci_device *pb = *(struct wayca_pci_device **)b;
+
+	return strcmp(pa->absolute_path, pb->absolute_path);
+}
+
+int WAYCA_SC_DECLSPEC wayca_sc_pci_walk(const char *name,
+					wayca_sc_pci_walk_fn fn, void *data)
+{
+	struct wayca_topo *topo __topo_ref = topo_get();
+	struct wayca_sc_device_info dev_info;
+	struct wayca_pci_device **pcidevs;
+	const char *start = NULL;
+	struct topo_device dev;
+	size_t n = 0, len = 0;
+	int i, j, ret;
+
+	if (!fn)
+		return -EINVAL;
+
+	ret = topo_load_phase(topo, TOPO_PHASE_DEVICE);
+	if (ret)
+		return ret;
+
+	if (name) {
+		ret = topo_index_find_device(topo, name, &dev);
+		if (ret)
+			return ret;
+		if (dev.type != WAYCA_SC_TOPO_DEV_TYPE_PCI)
+			return -EINVAL;
+		start = dev.pcidev->absolute_path;
+		len = strlen(start);
+	}
+
+	for (i = 0; i < topo->n_nodes; i++)
+		n += topo->nodes[i]->n_pcidevs;
+	pcidevs = calloc(n ? n : 1, sizeof(*pcidevs));
+	if (!pcidevs)
+		return -ENOMEM;
 
-		for (k = 0; k < topo.nodes[j]->n_pcidevs; k++) {
+	/* the subtree of @name, the device itself and the paths below it */
+	for (n = 0, i = 0; i < topo->n_nodes; i++) {
+		for (j = 0; j < topo->nodes[i]->n_pcidevs; j++) {
 			struct wayca_pci_device *pcidev =
-						topo.nodes[j]->pcidevs[k];
+						topo->nodes[i]->pcidevs[j];
 
-			if (!strcmp(pcidev->slot_name, name)) {
-				dev_info->dev_type =
-					WAYCA_SC_TOPO_DEV_TYPE_PCI;
-				topo_copy_pcidev_info(dev_info, pcidev);
-				return 0;
-			}
+			if (start && (strncmp(pcidev->absolute_path, start, len) ||
+				      (pcidev->absolute_path[len] != '\0' &&
+				       pcidev->absolute_path[len] != '/')))
+				continue;
+			pcidevs[n++] = pcidev;
 		}
 	}
-	return -ENOENT;
+
+	/*
+	 * The addresses in the paths are of fixed width, so the order of the
+	 * paths is the depth first order with a bridge before its subtree.
+	 */
+	qsort(pcidevs, n, sizeof(*pcidevs), topo_pcidev_path_cmp);
+
+	for (i = 0; i < n && !ret; i++) {
+		memset(&dev_info, 0, sizeof(dev_info));
+		dev_info.dev_type = WAYCA_SC_TOPO_DEV_TYPE_PCI;
+		topo_copy_pcidev_info(&dev_info, pcidevs[i]);
+		ret = fn(&dev_info, data);
+	}
+
+	free(pcidevs);
+	return ret;
 }
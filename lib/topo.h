@@ -22,14 +22,29 @@
 #define _TOPO_H 	1
 
 #include <sched.h>
+#include <stdbool.h>
 #include <linux/limits.h>
 #include "wayca-scheduler.h"
 
-#define WAYCA_SC_SYSDEV_FNAME 	"/sys/devices"
-#define WAYCA_SC_NODE_FNAME 	"/sys/devices/system/node"
-#define WAYCA_SC_CPU_FNAME 	"/sys/devices/system/cpu"
+/*
+ * The sysfs and procfs directories, under the mount points given by
+ * WAYCA_SC_SYSFS_ROOT and WAYCA_SC_PROCFS_ROOT, see topo_fs_path().
+ */
+#define WAYCA_SC_SYSDEV_FNAME 	topo_fs_path(TOPO_FS_SYSDEV)
+#define WAYCA_SC_NODE_FNAME 	topo_fs_path(TOPO_FS_NODE)
+#define WAYCA_SC_CPU_FNAME 	topo_fs_path(TOPO_FS_CPU)
+#define WAYCA_SC_KERNEL_IRQ_FNAME	topo_fs_path(TOPO_FS_KERNEL_IRQ)
+#define WAYCA_SC_RANDOM_FNAME	topo_fs_path(TOPO_FS_RANDOM)
+#define WAYCA_SC_PROC_IRQ_FNAME	topo_fs_path(TOPO_FS_PROC_IRQ)
+
+#define WAYCA_SC_SYSFS_ROOT	"/sys"
+#define WAYCA_SC_PROCFS_ROOT	"/proc"
+
+/* default directory of the topology snapshot, see topo_snapshot.c */
+#define WAYCA_SC_TOPO_CACHE_DIR	"/var/cache/wayca-scheduler"
 
 #define WAYCA_SC_DEFAULT_KERNEL_MAX 	(2048)
+#define WAYCA_SC_MAX_NUMNODES		(1024)		/* MAX_NUMNODES of the kernel */
 #define WAYCA_SC_PATH_LEN_MAX		(PATH_MAX)	/* maximum length of file pathname */
 #define WAYCA_SC_NAME_LEN_MAX		(NAME_MAX)	/* maximum length of chars in a file name */
 #define WAYCA_SC_MAX_FD_RETRIES		(5)		/* maximum retries when reading from an open file */
@@ -63,6 +78,7 @@ struct wayca_cache {
 struct wayca_cpu {
 	int cpu_id;
 	int core_id;				/* to which core it belongs to */
+	int capacity;				/* cpu_capacity, WAYCA_SC_CPU_CAPACITY_SCALE if not reported */
 	struct wayca_cluster	*p_cluster;	/* in which cluster */
 	struct wayca_node	*p_numa_node;	/* in which Numa node */
 	struct wayca_package	*p_package;	/* in which Package */
@@ -131,6 +147,13 @@ struct wayca_pci_device {
 	unsigned short device;
 
 	struct wayca_device_irqs irqs;	/* array of registered irqs */
+
+	/* PCIe hierarchy, the upstream bridge is "" under the host bridge */
+	char parent_name[WAYCA_SC_PCI_SLOT_NAME_LEN_MAX];
+	char root_name[WAYCA_SC_PCI_SLOT_NAME_LEN_MAX];	/* e.g. pci0000:00 */
+	int depth;			/* number of the upstream bridges */
+	int link_speed;			/* current link speed in MT/s, 0 if unknown */
+	int link_width;			/* current link width, 0 if unknown */
 };
 
 struct wayca_node {
@@ -154,6 +177,26 @@ struct wayca_meminfo {
 	unsigned long total_avail_kB;	/* total available memory in kiloBytes */
 };
 
+/*
+ * A NUMA node with memory, which may have no CPU like a CXL or HBM node.
+ * The access attributes come from the HMAT, as seen by the initiator.
+ */
+struct wayca_mem_node {
+	int node_idx;			/* index of node */
+	int node;			/* logical id of the node of CPUs, or -1 */
+	int initiator;			/* logical id of the nearest node of CPUs */
+	int tier;			/* memory tier, or -1 if unknown */
+	unsigned long total_avail_kB;	/* total available memory in kiloBytes */
+	unsigned int read_bandwidth;	/* MB/s, 0 if unknown */
+	unsigned int write_bandwidth;
+	unsigned int read_latency;	/* nanoseconds, 0 if unknown */
+	unsigned int write_latency;
+	unsigned long long cache_size;	/* memory-side cache in bytes, or 0 */
+	unsigned int cache_line_size;
+
+	int *distance;			/* distance from each node of CPUs */
+};
+
 struct wayca_package {
 	int physical_package_id;
 	size_t n_cpus;			/* number of online CPUs in package */
@@ -161,7 +204,42 @@ struct wayca_package {
 	cpu_set_t *numa_map;		/* mask of contained numa nodes */
 };
 
+/* Phases of the topology initialization, each one is loaded on first use */
+enum topo_phase {
+	TOPO_PHASE_CPU,		/* CPUs, cores, clusters, packages and caches */
+	TOPO_PHASE_NUMA,	/* distance, meminfo and memory nodes */
+	TOPO_PHASE_DEVICE,	/* PCI devices and SMMUs */
+	TOPO_PHASE_IRQ,		/* active interrupts */
+	TOPO_PHASE_MAX,
+};
+
+#define TOPO_PHASE_BIT(phase)	(1U << (phase))
+
+/*
+ * The logical ids of the CPUs in a struct-of-arrays layout. Each array is
+ * indexed by CPU and starts on its own cache line, so the lookups of one
+ * kind of id only touch the lines of that kind. A negative entry is the
+ * error returned for the CPU.
+ */
+struct wayca_cpu_ids {
+	int *core;
+	int *ccl;
+	int *node;
+	int *package;
+	int *l2;			/* domain of CPUs sharing an L2 cache */
+	int *l3;			/* domain of CPUs sharing an L3 cache */
+	size_t n_l2;			/* number of the L2 domains */
+	size_t n_l3;			/* number of the L3 domains */
+};
+
+struct topo_shared;
+
 struct wayca_topo {
+	unsigned int phases;			/* bitmap of loaded phases */
+	unsigned int failed_phases;		/* bitmap of phases failed to load */
+	unsigned long generation;		/* bumped by each new version */
+	struct wayca_topo *retired;		/* version replaced by this one */
+
 	int kernel_max_cpus;			/* maximum number of CPUs kernel can support */
 	size_t setsize;				/* setsize for use in CPU_SET macros */
 
@@ -169,6 +247,7 @@ struct wayca_topo {
 	cpu_set_t *cpu_map;		/* possible CPU mask */
 	cpu_set_t *online_cpu_map;	/* online CPU mask */
 	struct wayca_cpu	**cpus;		/* possible CPUs */
+	struct wayca_cpu_ids cpu_ids;		/* ids of the CPUs, by CPU */
 
 	size_t n_cores;				/* number of cores in this node */
 	struct wayca_core **cores;		/* array of cores */
@@ -180,11 +259,130 @@ struct wayca_topo {
 	cpu_set_t *node_map;
 	struct wayca_node	**nodes;	/* array of numa nodes */
 
+	size_t n_mem_nodes;
+	struct wayca_mem_node	*mem_nodes;	/* nodes with memory */
+
 	size_t n_packages;
 	struct wayca_package	**packages;	/* array of Pacakges */
 
 	size_t n_irqs;
 	struct wayca_irq **irqs;			/* array of irqs */
+
+	struct topo_index *dev_index;		/* devices by name */
+	struct topo_index *irq_index;		/* irqs by number */
+	/* the devices and the irqs if shared with other versions, see topo.c */
+	struct topo_shared *dev_shared;
+	struct topo_shared *irq_shared;
+};
+
+int cpulist_parse(const char *str, cpu_set_t *set, size_t setsize, int fail);
+int topo_construct_core_topology(struct wayca_topo *p_topo);
+
+/* topology snapshot, implemented in topo_snapshot.c */
+int topo_snapshot_load(struct wayca_topo *p_topo);
+int topo_snapshot_store(const struct wayca_topo *p_topo);
+int topo_snapshot_clone(struct wayca_topo *dst, const struct wayca_topo *src);
+
+/* sysfs and procfs paths, implemented in topo_sysfs.c */
+enum topo_fs_path {
+	TOPO_FS_SYSDEV,		/* sysfs/devices */
+	TOPO_FS_NODE,		/* sysfs/devices/system/node */
+	TOPO_FS_CPU,		/* sysfs/devices/system/cpu */
+	TOPO_FS_KERNEL_IRQ,	/* sysfs/kernel/irq */
+	TOPO_FS_RANDOM,		/* procfs/sys/kernel/random */
+	TOPO_FS_PROC_IRQ,	/* procfs/irq */
+	TOPO_FS_NR_PATHS,
+};
+
+const char *topo_fs_path(enum topo_fs_path path);
+const char *topo_fs_sysfs_root(void);
+const char *topo_fs_procfs_root(void);
+bool topo_fs_is_native(void);
+
+/* sysfs attribute reader, implemented in topo_sysfs.c */
+enum topo_sysfs_attr_type {
+	TOPO_SYSFS_S32,		/* decimal integer into int */
+	TOPO_SYSFS_HEX32,	/* hexadecimal integer into uint32_t */
+	TOPO_SYSFS_HEX16,	/* hexadecimal integer into uint16_t */
+	TOPO_SYSFS_STR,		/* string into char[len] */
+	TOPO_SYSFS_CPULIST,	/* CPU list into cpu_set_t of len bytes */
+};
+
+struct topo_sysfs_attr {
+	const char *name;
+	enum topo_sysfs_attr_type type;
+	void *val;
+	size_t len;		/* size of val for TOPO_SYSFS_STR and _CPULIST */
+	int ret;		/* result of reading this attribute */
 };
 
+int topo_sysfs_read(const char *dir, const char *name, const char **content);
+bool topo_sysfs_exists(const char *dir, const char *name);
+int topo_sysfs_read_s32(const char *dir, const char *name, int *val);
+int topo_sysfs_read_s32_array(const char *dir, const char *name, size_t nmemb,
+			      int array[]);
+int topo_sysfs_read_str(const char *dir, const char *name, char *str,
+			size_t len);
+int topo_sysfs_read_cpulist(const char *dir, const char *name, cpu_set_t *set,
+			    size_t setsize);
+int topo_sysfs_read_attrs(const char *dir, struct topo_sysfs_attr *attrs,
+			  size_t n);
+void topo_sysfs_flush(void);
+
+#ifdef WAYCA_SC_DEBUG
+/*
+ * The number of the open/read/close and alike syscalls issued by the sysfs
+ * reader so far, to measure the cost of building the topology. It's not a
+ * public API, only the debug build exports it for the tests.
+ */
+unsigned long wayca_sc_topo_sysfs_syscalls(void);
+/* The number of the replaced versions of the topology not freed yet */
+unsigned long wayca_sc_topo_nr_retired(void);
+#endif
+
+/* CPU and memory hotplug tracking, implemented in topo_hotplug.c */
+void topo_hotplug_sync(void);
+void topo_hotplug_stop(void);
+void topo_set_cpu_online(int cpu, bool online);
+int topo_sync_online_cpus(void);
+
+/* live memory statistics of the nodes, implemented in topo_meminfo.c */
+int topo_meminfo_stat(int node_idx, unsigned int max_age_ms,
+		      struct wayca_sc_node_mem_stat *stat);
+void topo_meminfo_invalidate(int node_idx);
+void topo_meminfo_exit(void);
+
+/* topology change notifiers, implemented in topo_notify.c */
+void topo_notify(unsigned int event, int id);
+void topo_notify_exit(void);
+
+/* indexes of the devices and the IRQs, implemented in topo_index.c */
+struct topo_device {
+	int type;				/* enum wayca_sc_device_type */
+	union {
+		struct wayca_pci_device *pcidev;
+		struct wayca_smmu *smmu;
+	};
+};
+
+void topo_index_build(struct wayca_topo *p_topo, unsigned int phases);
+void topo_index_free(struct wayca_topo *p_topo);
+struct wayca_irq *topo_index_find_irq(const struct wayca_topo *p_topo,
+				      uint32_t irq);
+int topo_index_find_device(const struct wayca_topo *p_topo, const char *name,
+			   struct topo_device *dev);
+
+/* load of the wayca threads, implemented in group.c */
+bool wayca_cpu_is_loaded(int cpu);
+
+/* I/O device walker, implemented in topo_walk.c */
+struct topo_walk_ops {
+	void *(*parse)(const char *dir, void *data);	/* NULL if not a device */
+	int (*add)(void *dev, void *data);	/* owns @dev even on failure */
+	void (*free)(void *dev);
+	void *data;
+};
+
+int topo_walk_devices(const char *root, const struct topo_walk_ops *ops);
+
 #endif /* _TOPO_H */
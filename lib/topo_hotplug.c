@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2021 HiSilicon Technologies Co., Ltd.
+ * Wayca scheduler is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ *
+ * See the Mulan PSL v2 for more details.
+ */
+
+/* topo_hotplug.c - CPU and memory hotplug tracking
+ *
+ * A listener thread receives the kernel uevents from a netlink socket and
+ * applies the online/offline events of the CPUs to the topology, so the
+ * getters only read memory. The events of the memory blocks drop the cached
+ * statistics of their nodes. Both are passed on to the notifiers. The
+ * listener is started on the first query. If the socket can't be set up,
+ * e.g. in a network namespace which doesn't receive uevents, every query
+ * falls back to reading cpu/online. So does a topology loaded from a
+ * synthetic sysfs, which the uevents are not for.
+ */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+#include "bitops.h"
+#include "common.h"
+#include "topo.h"
+
+#define TOPO_HOTPLUG_BUF_LEN	8192		/* big enough for a uevent */
+#define TOPO_HOTPLUG_RCVBUF	(1 << 20)	/* absorb bursts of events */
+#define TOPO_UEVENT_GROUP	1		/* kernel uevents, not udev's */
+
+enum topo_hotplug_state {
+	TOPO_HOTPLUG_STOPPED,
+	TOPO_HOTPLUG_RUNNING,
+	TOPO_HOTPLUG_FAILED,	/* no listener, poll cpu/online on each query */
+};
+
+static int topo_hotplug_state = TOPO_HOTPLUG_STOPPED;
+static pthread_mutex_t topo_hotplug_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t topo_hotplug_atfork_once = PTHREAD_ONCE_INIT;
+static pthread_t topo_hotplug_thread;
+static int topo_hotplug_sock = -1;
+static int topo_hotplug_stopfd = -1;
+
+static void topo_hotplug_close(void)
+{
+	if (topo_hotplug_sock >= 0)
+		close(topo_hotplug_sock);
+	if (topo_hotplug_stopfd >= 0)
+		close(topo_hotplug_stopfd);
+	topo_hotplug_sock = -1;
+	topo_hotplug_stopfd = -1;
+}
+
+/* the listener doesn't survive fork(), the child starts its own on demand */
+static void topo_hotplug_atfork_child(void)
+{
+	pthread_mutex_init(&topo_hotplug_mutex, NULL);
+	topo_hotplug_close();
+	topo_hotplug_state = TOPO_HOTPLUG_STOPPED;
+}
+
+static void topo_hotplug_register_atfork(void)
+{
+	pthread_atfork(NULL, NULL, topo_hotplug_atfork_child);
+}
+
+/* Return the CPU of a devpath like /devices/system/cpu/cpu3, or -1 */
+static int topo_uevent_cpu(const char *devpath)
+{
+	int cpu, len = 0;
+
+	if (sscanf(devpath, "/devices/system/cpu/cpu%d%n", &cpu, &len) != 1 ||
+	    devpath[len] != '\0')
+		return -1;
+	return cpu;
+}
+
+/* Return the node of a memory block like /devices/system/memory/memory32 */
+static int topo_uevent_mem_node(const char *devpath)
+{
+	char path_buffer[WAYCA_SC_PATH_LEN_MAX];
+	struct dirent *entry;
+	int block, node = -1;
+	int len = 0;
+	DIR *dir;
+
+	if (sscanf(devpath, "/devices/system/memory/memory%d%n", &block,
+		   &len) != 1 || devpath[len] != '\0')
+		return -1;
+
+	/* the block links to its node by a "node%d" entry */
+	snprintf(path_buffer, sizeof(path_buffer), "%s%s",
+		 topo_fs_sysfs_root(), devpath);
+	dir = opendir(path_buffer);
+	if (!dir)
+		return -1;
+	while ((entry = readdir(dir)) != NULL) {
+		if (sscanf(entry->d_name, "node%d%n", &node, &len) == 1 &&
+		    entry->d_name[len] == '\0')
+			break;
+		node = -1;
+	}
+	closedir(dir);
+	return node;
+}
+
+static void topo_hotplug_handle_mem(const char *action, const char *devpath)
+{
+	unsigned int event;
+	int node;
+
+	if (!strcmp(action, "online"))
+		event = WAYCA_SC_TOPO_EV_MEM_ONLINE;
+	else if (!strcmp(action, "offline"))
+		event = WAYCA_SC_TOPO_EV_MEM_OFFLINE;
+	else
+		return;
+
+	node = topo_uevent_mem_node(devpath);
+	if (node < 0)
+		return;
+
+	topo_meminfo_invalidate(node);
+	topo_notify(event, node);
+}
+
+/*
+ * A uevent is "action@devpath" followed by the "KEY=value" properties,
+ * each terminated by '\0'.
+ */
+static void topo_hotplug_handle(const char *buf, size_t len)
+{
+	const char *action = NULL, *devpath = NULL, *subsystem = NULL;
+	const char *end = buf + len;
+	const char *p;
+	int cpu;
+
+	for (p = buf; p < end; p += strlen(p) + 1) {
+		if (!strncmp(p, "ACTION=", 7))
+			action = p + 7;
+		else if (!strncmp(p, "DEVPATH=", 8))
+			devpath = p + 8;
+		else if (!strncmp(p, "SUBSYSTEM=", 10))
+			subsystem = p + 10;
+	}
+
+	if (!action || !devpath || !subsystem)
+		return;
+
+	if (!strcmp(subsystem, "memory")) {
+		topo_hotplug_handle_mem(action, devpath);
+		return;
+	}
+	if (strcmp(subsystem, "cpu"))
+		return;
+
+	cpu = topo_uevent_cpu(devpath);
+	if (cpu < 0)
+		return;
+
+	if (!strcmp(action, "online"))
+		topo_set_cpu_online(cpu, true);
+	else if (!strcmp(action, "offline"))
+		topo_set_cpu_online(cpu, false);
+	else
+		topo_sync_online_cpus();	/* add, remove, ... */
+}
+
+static void *topo_hotplug_listen(void *data)
+{
+	struct pollfd fds[2] = {
+		{ .fd = topo_hotplug_sock, .events = POLLIN },
+		{ .fd = topo_hotplug_stopfd, .events = POLLIN },
+	};
+	char buf[TOPO_HOTPLUG_BUF_LEN];
+	struct sockaddr_nl addr;
+	struct iovec iov = {
+		.iov_base = buf,
+		.iov_len = sizeof(buf) - 1,
+	};
+	struct msghdr msg = {
+		.msg_name = &addr,
+		.msg_namelen = sizeof(addr),
+		.msg_iov = &iov,
+		.msg_iovlen = 1,
+	};
+	ssize_t len;
+
+	while (1) {
+		if (poll(fds, ARRAY_SIZE(fds), -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (fds[1].revents)
+			break;
+
+		msg.msg_namelen = sizeof(addr);
+		len = recvmsg(topo_hotplug_sock, &msg, MSG_DONTWAIT);
+		if (len < 0) {
+			/* events are lost, look at the CPUs again */
+			if (errno == ENOBUFS)
+				topo_sync_online_cpus();
+			continue;
+		}
+
+		/* only trust the kernel */
+		if (addr.nl_pid != 0 || (msg.msg_flags & MSG_TRUNC))
+			continue;
+
+		buf[len] = '\0';
+		topo_hotplug_handle(buf, len);
+	}
+
+	/* don't hold the directory fds of a sync until the exit */
+	topo_sysfs_flush();
+	return NULL;
+}
+
+static int topo_hotplug_start(void)
+{
+	struct sockaddr_nl addr = {
+		.nl_family = AF_NETLINK,
+		.nl_groups = TOPO_UEVENT_GROUP,
+	};
+	int rcvbuf = TOPO_HOTPLUG_RCVBUF;
+	sigset_t set, oldset;
+	int ret;
+
+	pthread_once(&topo_hotplug_atfork_once, topo_hotplug_register_atfork);
+
+	if (!topo_fs_is_native())
+		return -ENODEV;
+
+	topo_hotplug_sock = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC,
+				   NETLINK_KOBJECT_UEVENT);
+	if (topo_hotplug_sock < 0)
+		return -errno;
+
+	(void)setsockopt(topo_hotplug_sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf,
+			 sizeof(rcvbuf));
+	if (bind(topo_hotplug_sock, (struct sockaddr *)&addr, sizeof(addr))) {
+		ret = -errno;
+		goto err;
+	}
+
+	topo_hotplug_stopfd = eventfd(0, EFD_CLOEXEC);
+	if (topo_hotplug_stopfd < 0) {
+		ret = -errno;
+		goto err;
+	}
+
+	/* signals of the host process are not for the listener */
+	sigfillset(&set);
+	pthread_sigmask(SIG_SETMASK, &set, &oldset);
+	ret = -pthread_create(&topo_hotplug_thread, NULL, topo_hotplug_listen,
+			      NULL);
+	pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+	if (ret)
+		goto err;
+
+	/* catch up with the events sent before the socket was bound */
+	topo_sync_online_cpus();
+	return 0;
+
+err:
+	topo_hotplug_close();
+	return ret;
+}
+
+/*
+ * topo_hotplug_sync - make the online CPUs of the topology up to date
+ *
+ * Once the listener is running it's a single memory read, otherwise the
+ * listener is started, or cpu/online is read if it can't be.
+ */
+void topo_hotplug_sync(void)
+{
+	int state = __atomic_load_n(&topo_hotplug_state, __ATOMIC_ACQUIRE);
+
+	if (likely(state == TOPO_HOTPLUG_RUNNING))
+		return;
+
+	if (state == TOPO_HOTPLUG_STOPPED) {
+		pthread_mutex_lock(&topo_hotplug_mutex);
+		state = topo_hotplug_state;
+		if (state == TOPO_HOTPLUG_STOPPED) {
+			state = topo_hotplug_start() ? TOPO_HOTPLUG_FAILED :
+						       TOPO_HOTPLUG_RUNNING;
+			__atomic_store_n(&topo_hotplug_state, state,
+					 __ATOMIC_RELEASE);
+		}
+		pthread_mutex_unlock(&topo_hotplug_mutex);
+		if (state == TOPO_HOTPLUG_RUNNING)
+			return;
+	}
+
+	topo_sync_online_cpus();
+}
+
+/*
+ * topo_hotplug_stop - stop the listener, called before the topology is
+ * freed at exit. Later queries poll cpu/online instead of starting it again.
+ */
+void topo_hotplug_stop(void)
+{
+	uint64_t val = 1;
+
+	pthread_mutex_lock(&topo_hotplug_mutex);
+	if (topo_hotplug_state == TOPO_HOTPLUG_RUNNING) {
+		if (write(topo_hotplug_stopfd, &val, sizeof(val)) != sizeof(val))
+			pthread_cancel(topo_hotplug_thread);
+		pthread_join(topo_hotplug_thread, NULL);
+		topo_hotplug_close();
+	}
+	__atomic_store_n(&topo_hotplug_state, TOPO_HOTPLUG_FAILED,
+			 __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&topo_hotplug_mutex);
+}
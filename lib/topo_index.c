@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2021 HiSilicon Technologies Co., Ltd.
+ * Wayca scheduler is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ *
+ * See the Mulan PSL v2 for more details.
+ */
+
+/* topo_index.c - hash indexes of the IRQs and the I/O devices
+ *
+ * A host may have thousands of MSI vectors and hundreds of devices, which
+ * are looked up by the IRQ number and the device name many times. Each
+ * version of the topology gets an index of them once the phase is loaded,
+ * an open addressing table with at least twice the slots of the entries,
+ * which is never changed afterwards. If an index couldn't be built the
+ * lookups fall back to walking the arrays.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "topo.h"
+
+struct topo_index_slot {
+	const char *name;	/* name of a device, NULL for an IRQ */
+	uint32_t key;		/* IRQ number, or hash of the device name */
+	int type;		/* enum wayca_sc_device_type of a device */
+	void *rec;		/* the record, NULL if the slot is free */
+};
+
+struct topo_index {
+	size_t mask;		/* number of the slots - 1 */
+	struct topo_index_slot slots[];
+};
+
+static uint32_t topo_index_hash_irq(uint32_t irq)
+{
+	/* Fibonacci hashing spreads the consecutive MSI vectors */
+	return irq * 0x9e3779b1U;
+}
+
+static uint32_t topo_index_hash_name(const char *name)
+{
+	uint32_t hash = 0x811c9dc5U;
+
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 0x01000193U;
+	}
+	return hash;
+}
+
+static struct topo_index *topo_index_alloc(size_t n)
+{
+	struct topo_index *index;
+	size_t n_slots = 4;
+
+	while (n_slots < n * 2)
+		n_slots <<= 1;
+
+	index = calloc(1, sizeof(*index) + n_slots * sizeof(index->slots[0]));
+	if (index)
+		index->mask = n_slots - 1;
+	return index;
+}
+
+/* Insert an entry, the first one of the same key is kept */
+static void topo_index_insert(struct topo_index *index, uint32_t hash,
+			      const struct topo_index_slot *entry)
+{
+	struct topo_index_slot *slot;
+	size_t i;
+
+	for (i = hash & index->mask; ; i = (i + 1) & index->mask) {
+		slot = &index->slots[i];
+		if (!slot->rec)
+			break;
+		if (slot->key == entry->key &&
+		    (!entry->name || !strcmp(slot->name, entry->name)))
+			return;
+	}
+	*slot = *entry;
+}
+
+static struct topo_index *topo_index_irqs(const struct wayca_topo *p_topo)
+{
+	struct topo_index_slot entry = { 0 };
+	struct topo_index *index;
+	int i;
+
+	index = topo_index_alloc(p_topo->n_irqs);
+	if (!index)
+		return NULL;
+
+	for (i = 0; i < p_topo->n_irqs; i++) {
+		entry.key = p_topo->irqs[i]->irq_number;
+		entry.rec = p_topo->irqs[i];
+		topo_index_insert(index, topo_index_hash_irq(entry.key), &entry);
+	}
+	return index;
+}
+
+static void topo_index_add_device(struct topo_index *index, const char *name,
+				  int type, void *rec)
+{
+	struct topo_index_slot entry = {
+		.name = name,
+		.key = topo_index_hash_name(name),
+		.type = type,
+		.rec = rec,
+	};
+
+	topo_index_insert(index, entry.key, &entry);
+}
+
+static struct topo_index *topo_index_devices(const struct wayca_topo *p_topo)
+{
+	struct topo_index *index;
+	struct wayca_node *node;
+	size_t n = 0;
+	int i, j;
+
+	for (i = 0; i < p_topo->n_nodes; i++)
+		n += p_topo->nodes[i]->n_smmus + p_topo->nodes[i]->n_pcidevs;
+
+	index = topo_index_alloc(n);
+	if (!index)
+		return NULL;
+
+	/* in the order of the linear lookup, so a duplicate resolves the same */
+	for (i = 0; i < p_topo->n_nodes; i++) {
+		node = p_topo->nodes[i];
+		for (j = 0; j < node->n_smmus; j++)
+			topo_index_add_device(index, node->smmus[j]->name,
+					      WAYCA_SC_TOPO_DEV_TYPE_SMMU,
+					      node->smmus[j]);
+		for (j = 0; j < node->n_pcidevs; j++)
+			topo_index_add_device(index, node->pcidevs[j]->slot_name,
+					      WAYCA_SC_TOPO_DEV_TYPE_PCI,
+					      node->pcidevs[j]);
+	}
+	return index;
+}
+
+/*
+ * topo_index_build - build the missing indexes of the loaded @phases of
+ * @p_topo, before the phases are visible to the other threads or with
+ * the phase loading serialized. Running out of memory only leaves the
+ * lookups slower.
+ */
+void topo_index_build(struct wayca_topo *p_topo, unsigned int phases)
+{
+	if ((phases & TOPO_PHASE_BIT(TOPO_PHASE_DEVICE)) && !p_topo->dev_index)
+		__atomic_store_n(&p_topo->dev_index, topo_index_devices(p_topo),
+				 __ATOMIC_RELEASE);
+
+	if ((phases & TOPO_PHASE_BIT(TOPO_PHASE_IRQ)) && !p_topo->irq_index)
+		__atomic_store_n(&p_topo->irq_index, topo_index_irqs(p_topo),
+				 __ATOMIC_RELEASE);
+}
+
+void topo_index_free(struct wayca_topo *p_topo)
+{
+	free(p_topo->dev_index);
+	free(p_topo->irq_index);
+	p_topo->dev_index = NULL;
+	p_topo->irq_index = NULL;
+}
+
+/*
+ * topo_index_find_irq - find IRQ @irq in the loaded IRQ phase of @p_topo
+ *
+ * Return the IRQ, or NULL if there's no such one
+ */
+struct wayca_irq *topo_index_find_irq(const struct wayca_topo *p_topo,
+				      uint32_t irq)
+{
+	struct topo_index *index;
+	struct topo_index_slot *slot;
+	size_t i;
+
+	index = __atomic_load_n(&p_topo->irq_index, __ATOMIC_ACQUIRE);
+	if (!index) {
+		for (i = 0; i < p_topo->n_irqs; i++)
+			if (p_topo->irqs[i]->irq_number == irq)
+				return p_topo->irqs[i];
+		return NULL;
+	}
+
+	for (i = topo_index_hash_irq(irq) & index->mask; ;
+	     i = (i + 1) & index->mask) {
+		slot = &index->slots[i];
+		if (!slot->rec)
+			return NULL;
+		if (slot->key == irq)
+			return slot->rec;
+	}
+}
+
+/*
+ * topo_index_find_device - find the device named @name in the loaded device
+ * phase of @p_topo
+ * @dev: the device found
+ *
+ * Return 0 on success, -ENOENT if there's no such device
+ */
+int topo_index_find_device(const struct wayca_topo *p_topo, const char *name,
+			   struct topo_device *dev)
+{
+	struct topo_index_slot *slot;
+	struct topo_index *index;
+	struct wayca_node *node;
+	uint32_t hash;
+	size_t i, j;
+
+	index = __atomic_load_n(&p_topo->dev_index, __ATOMIC_ACQUIRE);
+	if (!index) {
+		for (i = 0; i < p_topo->n_nodes; i++) {
+			node = p_topo->nodes[i];
+			for (j = 0; j < node->n_smmus; j++) {
+				if (strcmp(node->smmus[j]->name, name))
+					continue;
+				dev->type = WAYCA_SC_TOPO_DEV_TYPE_SMMU;
+				dev->smmu = node->smmus[j];
+				return 0;
+			}
+			for (j = 0; j < node->n_pcidevs; j++) {
+				if (strcmp(node->pcidevs[j]->slot_name, name))
+					continue;
+				dev->type = WAYCA_SC_TOPO_DEV_TYPE_PCI;
+				dev->pcidev = node->pcidevs[j];
+				return 0;
+			}
+		}
+		return -ENOENT;
+	}
+
+	hash = topo_index_hash_name(name);
+	for (i = hash & index->mask; ; i = (i + 1) & index->mask) {
+		slot = &index->slots[i];
+		if (!slot->rec)
+			return -ENOENT;
+		if (slot->key == hash && !strcmp(slot->name, name))
+			break;
+	}
+
+	dev->type = slot->type;
+	if (dev->type == WAYCA_SC_TOPO_DEV_TYPE_SMMU)
+		dev->smmu = slot->rec;
+	else
+		dev->pcidev = slot->rec;
+	return 0;
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2021 HiSilicon Technologies Co., Ltd.
+ * Wayca scheduler is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ *
+ * See the Mulan PSL v2 for more details.
+ */
+
+/* topo_meminfo.c - live memory statistics of the NUMA nodes
+ *
+ * Unlike the rest of the topology, the free and used memory of a node
+ * changes all the time, so it's read from node%d/meminfo on request. The
+ * last values of each node are kept with the time they were read, and a
+ * caller which can live with values up to a given age gets them without
+ * any syscall. The cache is a seqlock, readers never block and only one
+ * of the threads refreshing a node at the same time stores its values.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "topo.h"
+
+#define TOPO_MEMINFO_KEY_LEN	32
+
+struct topo_meminfo_cache {
+	unsigned int seq;		/* odd while the values are updated */
+	uint64_t stamp;			/* when the values were read, in ns */
+	struct wayca_sc_node_mem_stat stat;
+};
+
+/* the caches of the nodes by node number, allocated on first use */
+static struct topo_meminfo_cache *topo_meminfo_caches[WAYCA_SC_MAX_NUMNODES];
+
+static const struct {
+	const char *name;
+	size_t offset;
+} topo_meminfo_fields[] = {
+	{ "MemTotal", offsetof(struct wayca_sc_node_mem_stat, total) },
+	{ "MemFree", offsetof(struct wayca_sc_node_mem_stat, free) },
+	{ "FilePages", offsetof(struct wayca_sc_node_mem_stat, file) },
+	{ "AnonPages", offsetof(struct wayca_sc_node_mem_stat, anon) },
+	{ "Shmem", offsetof(struct wayca_sc_node_mem_stat, shmem) },
+	{ "Dirty", offsetof(struct wayca_sc_node_mem_stat, dirty) },
+	{ "Writeback", offsetof(struct wayca_sc_node_mem_stat, writeback) },
+	{ "SReclaimable",
+	  offsetof(struct wayca_sc_node_mem_stat, slab_reclaimable) },
+	{ "HugePages_Total",
+	  offsetof(struct wayca_sc_node_mem_stat, huge_total) },
+	{ "HugePages_Free", offsetof(struct wayca_sc_node_mem_stat, huge_free) },
+};
+
+static uint64_t topo_meminfo_now(void)
+{
+	struct timespec ts;
+
+	/* the resolution of a tick is plenty for an age in milliseconds */
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Parse the lines like "Node 0 MemFree:  1234 kB" of node%d/meminfo, the
+ * fields missing on older kernels are left zero.
+ */
+static int topo_meminfo_parse(const char *content,
+			      struct wayca_sc_node_mem_stat *stat)
+{
+	char key[TOPO_MEMINFO_KEY_LEN];
+	const char *line;
+	unsigned long val;
+	int n_fields = 0;
+	int i;
+
+	memset(stat, 0, sizeof(*stat));
+	for (line = content; line && *line; line = strchr(line, '\n')) {
+		if (*line == '\n')
+			line++;
+		if (sscanf(line, "Node %*d %31[^:]: %lu", key, &val) != 2)
+			continue;
+
+		for (i = 0; i < ARRAY_SIZE(topo_meminfo_fields); i++) {
+			if (strcmp(key, topo_meminfo_fields[i].name))
+				continue;
+			*(unsigned long *)((char *)stat +
+					   topo_meminfo_fields[i].offset) = val;
+			n_fields++;
+			break;
+		}
+	}
+
+	return n_fields ? 0 : -EINVAL;
+}
+
+static struct topo_meminfo_cache *topo_meminfo_cache(int node_idx)
+{
+	struct topo_meminfo_cache *cache, *old = NULL;
+
+	cache = __atomic_load_n(&topo_meminfo_caches[node_idx],
+				__ATOMIC_ACQUIRE);
+	if (cache)
+		return cache;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+
+	if (!__atomic_compare_exchange_n(&topo_meminfo_caches[node_idx], &old,
+					 cache, false, __ATOMIC_ACQ_REL,
+					 __ATOMIC_ACQUIRE)) {
+		free(cache);
+		return old;
+	}
+	return cache;
+}
+
+/* Copy the cached values into @stat, false if they're older than @max_age */
+static bool topo_meminfo_cached(struct topo_meminfo_cache *cache, uint64_t now,
+				uint64_t max_age, struct wayca_sc_node_mem_stat *stat)
+{
+	unsigned int seq;
+	uint64_t stamp;
+
+	do {
+		seq = __atomic_load_n(&cache->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+			return false;	/* don't wait for the writer */
+		stamp = cache->stamp;
+		*stat = cache->stat;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while (__atomic_load_n(&cache->seq, __ATOMIC_RELAXED) != seq);
+
+	return stamp && now - stamp <= max_age;
+}
+
+/* Store @stat read at @now, unless another thread is storing its own */
+static void topo_meminfo_store(struct topo_meminfo_cache *cache, uint64_t now,
+			       const struct wayca_sc_node_mem_stat *stat)
+{
+	unsigned int seq = __atomic_load_n(&cache->seq, __ATOMIC_RELAXED);
+
+	if ((seq & 1) ||
+	    !__atomic_compare_exchange_n(&cache->seq, &seq, seq + 1, false,
+					 __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return;
+
+	/* the odd sequence is visible before the values change */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	cache->stamp = now;
+	cache->stat = *stat;
+	__atomic_store_n(&cache->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/*
+ * topo_meminfo_stat - get the memory statistics of node @node_idx
+ * @max_age_ms: the maximum age of the cached values to take, 0 to always
+ *		read node%d/meminfo
+ *
+ * Return 0 on success, negative on error.
+ */
+int topo_meminfo_stat(int node_idx, unsigned int max_age_ms,
+		      struct wayca_sc_node_mem_stat *stat)
+{
+	char path_buffer[WAYCA_SC_PATH_LEN_MAX];
+	struct topo_meminfo_cache *cache;
+	uint64_t now = topo_meminfo_now();
+	const char *content;
+	int ret;
+
+	if (node_idx < 0 || node_idx >= WAYCA_SC_MAX_NUMNODES)
+		return -EINVAL;
+
+	cache = topo_meminfo_cache(node_idx);
+	if (!cache)
+		return -ENOMEM;
+
+	if (max_age_ms &&
+	    topo_meminfo_cached(cache, now, max_age_ms * 1000000ULL, stat))
+		return 0;
+
+	snprintf(path_buffer, sizeof(path_buffer), "%s/node%d",
+		 WAYCA_SC_NODE_FNAME, node_idx);
+	ret = topo_sysfs_read(path_buffer, "meminfo", &content);
+	if (ret < 0)
+		return ret;
+
+	ret = topo_meminfo_parse(content, stat);
+	if (ret)
+		return ret;
+
+	topo_meminfo_store(cache, now, stat);
+	return 0;
+}
+
+/*
+ * topo_meminfo_invalidate - drop the cached values of node @node_idx, e.g.
+ * when a memory block of the node goes online or offline
+ */
+void topo_meminfo_invalidate(int node_idx)
+{
+	struct topo_meminfo_cache *cache;
+	unsigned int seq;
+
+	if (node_idx < 0 || node_idx >= WAYCA_SC_MAX_NUMNODES)
+		return;
+
+	cache = __atomic_load_n(&topo_meminfo_caches[node_idx],
+				__ATOMIC_ACQUIRE);
+	if (!cache)
+		return;
+
+	/* unlike a reader's store this one must not be skipped */
+	do {
+		seq = __atomic_load_n(&cache->seq, __ATOMIC_RELAXED) & ~1U;
+	} while (!__atomic_compare_exchange_n(&cache->seq, &seq, seq + 1, false,
+					      __ATOMIC_ACQUIRE,
+					      __ATOMIC_RELAXED));
+
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	cache->stamp = 0;
+	__atomic_store_n(&cache->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/* topo_meminfo_exit - free the caches, called when the library unloads */
+void topo_meminfo_exit(void)
+{
+	int i;
+
+	for (i = 0; i < WAYCA_SC_MAX_NUMNODES; i++) {
+		free(topo_meminfo_caches[i]);
+		topo_meminfo_caches[i] = NULL;
+	}
+}
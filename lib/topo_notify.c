@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2021 HiSilicon Technologies Co., Ltd.
+ * Wayca scheduler is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ *
+ * See the Mulan PSL v2 for more details.
+ */
+
+/* topo_notify.c - topology change notifiers
+ *
+ * The changes are applied to the topology by the hotplug listener, or by
+ * whichever query finds them if there's no listener, possibly with the
+ * locks of the caller held. So the events are queued and the notifiers are
+ * called from a dispatcher thread of the library, started when the first
+ * notifier is registered, once the change is visible to the queries.
+ *
+ * The notifiers are called with a recursive lock held, so a notifier may
+ * register or unregister notifiers, and once unregistering returns in
+ * another thread the notifier won't be called any more.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "topo.h"
+
+struct topo_notifier {
+	wayca_sc_topo_notifier_t cb;	/* NULL once unregistered */
+	unsigned int events;
+	void *data;
+	struct topo_notifier *next;
+};
+
+struct topo_event {
+	unsigned int event;
+	int id;
+	struct topo_event *next;
+};
+
+/* the notifiers, in the order of registration */
+static pthread_mutex_t topo_notify_mutex =
+	PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static struct topo_notifier *topo_notifiers;
+static int topo_notify_depth;	/* nesting of the notifier calls */
+
+/* the queued events and the dispatcher */
+static pthread_mutex_t topo_event_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t topo_event_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t topo_notify_atfork_once = PTHREAD_ONCE_INIT;
+static struct topo_event *topo_event_head;
+static struct topo_event **topo_event_tail = &topo_event_head;
+static bool topo_notify_running;
+static bool topo_notify_stopping;
+static pthread_t topo_notify_thread;
+
+/* the dispatcher doesn't survive fork(), the child starts its own */
+static void topo_notify_atfork_child(void)
+{
+	pthread_mutex_init(&topo_event_mutex, NULL);
+	pthread_cond_init(&topo_event_cond, NULL);
+	topo_event_head = NULL;
+	topo_event_tail = &topo_event_head;
+	topo_notify_running = false;
+	topo_notify_stopping = false;
+}
+
+static void topo_notify_register_atfork(void)
+{
+	pthread_atfork(NULL, NULL, topo_notify_atfork_child);
+}
+
+/* Free the notifiers unregistered during the calls, with the lock held */
+static void topo_notify_sweep(void)
+{
+	struct topo_notifier **pos = &topo_notifiers;
+	struct topo_notifier *notifier;
+
+	while ((notifier = *pos) != NULL) {
+		if (notifier->cb) {
+			pos = &notifier->next;
+			continue;
+		}
+		*pos = notifier->next;
+		free(notifier);
+	}
+}
+
+static void topo_notify_dispatch(const struct topo_event *ev)
+{
+	struct topo_notifier *notifier;
+
+	pthread_mutex_lock(&topo_notify_mutex);
+	topo_notify_depth++;
+	for (notifier = topo_notifiers; notifier; notifier = notifier->next) {
+		if (notifier->cb && (notifier->events & ev->event))
+			notifier->cb(ev->event, ev->id, notifier->data);
+	}
+	if (!--topo_notify_depth)
+		topo_notify_sweep();
+	pthread_mutex_unlock(&topo_notify_mutex);
+}
+
+static void *topo_notify_worker(void *data)
+{
+	struct topo_event *ev;
+
+	while (1) {
+		pthread_mutex_lock(&topo_event_mutex);
+		while (!topo_event_head && !topo_notify_stopping)
+			pthread_cond_wait(&topo_event_cond, &topo_event_mutex);
+		if (topo_notify_stopping) {
+			pthread_mutex_unlock(&topo_event_mutex);
+			break;
+		}
+		ev = topo_event_head;
+		topo_event_head = ev->next;
+		if (!topo_event_head)
+			topo_event_tail = &topo_event_head;
+		pthread_mutex_unlock(&topo_event_mutex);
+
+		topo_notify_dispatch(ev);
+		free(ev);
+	}
+
+	/* don't hold the directory fds of the queries until the exit */
+	topo_sysfs_flush();
+	return NULL;
+}
+
+static int topo_notify_start(void)
+{
+	sigset_t set, oldset;
+	int ret = 0;
+
+	pthread_once(&topo_notify_atfork_once, topo_notify_register_atfork);
+
+	pthread_mutex_lock(&topo_event_mutex);
+	if (topo_notify_running || topo_notify_stopping)
+		goto unlock;
+
+	/* signals of the host process are not for the dispatcher */
+	sigfillset(&set);
+	pthread_sigmask(SIG_SETMASK, &set, &oldset);
+	ret = -pthread_create(&topo_notify_thread, NULL, topo_notify_worker,
+			      NULL);
+	pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+	topo_notify_running = !ret;
+unlock:
+	pthread_mutex_unlock(&topo_event_mutex);
+	return ret;
+}
+
+int WAYCA_SC_DECLSPEC
+wayca_sc_topo_register_notifier(wayca_sc_topo_notifier_t cb,
+				unsigned int events, void *data)
+{
+	struct topo_notifier *notifier, **tail;
+	int ret;
+
+	if (!cb || !events || (events & ~WAYCA_SC_TOPO_EV_ALL))
+		return -EINVAL;
+
+	ret = topo_notify_start();
+	if (ret)
+		return ret;
+
+	notifier = calloc(1, sizeof(*notifier));
+	if (!notifier)
+		return -ENOMEM;
+	notifier->cb = cb;
+	notifier->events = events;
+	notifier->data = data;
+
+	pthread_mutex_lock(&topo_notify_mutex);
+	for (tail = &topo_notifiers; *tail; tail = &(*tail)->next)
+		;
+	*tail = notifier;
+	pthread_mutex_unlock(&topo_notify_mutex);
+
+	/* the events come from the hotplug listener */
+	topo_hotplug_sync();
+	return 0;
+}
+
+int WAYCA_SC_DECLSPEC
+wayca_sc_topo_unregister_notifier(wayca_sc_topo_notifier_t cb, void *data)
+{
+	struct topo_notifier *notifier;
+	int ret = -ENOENT;
+
+	pthread_mutex_lock(&topo_notify_mutex);
+	for (notifier = topo_notifiers; notifier; notifier = notifier->next) {
+		if (notifier->cb == cb && notifier->data == data) {
+			notifier->cb = NULL;
+			ret = 0;
+			break;
+		}
+	}
+	if (!topo_notify_depth)
+		topo_notify_sweep();
+	pthread_mutex_unlock(&topo_notify_mutex);
+
+	return ret;
+}
+
+/*
+ * topo_notify - queue @event on CPU or node @id for the notifiers, called
+ * once the change is published
+ */
+void topo_notify(unsigned int event, int id)
+{
+	struct topo_event *ev;
+
+	pthread_mutex_lock(&topo_event_mutex);
+	if (!topo_notify_running || topo_notify_stopping)
+		goto unlock;
+
+	ev = malloc(sizeof(*ev));
+	if (!ev) {
+		PRINT_ERROR("failed to queue topology event %#x\n", event);
+		goto unlock;
+	}
+	ev->event = event;
+	ev->id = id;
+	ev->next = NULL;
+	*topo_event_tail = ev;
+	topo_event_tail = &ev->next;
+	pthread_cond_signal(&topo_event_cond);
+unlock:
+	pthread_mutex_unlock(&topo_event_mutex);
+}
+
+/*
+ * topo_notify_exit - stop the dispatcher and free the notifiers, called
+ * when the library unloads after the hotplug listener is stopped
+ */
+void topo_notify_exit(void)
+{
+	struct topo_notifier *notifier;
+	struct topo_event *ev;
+	bool running;
+
+	pthread_mutex_lock(&topo_event_mutex);
+	running = topo_notify_running;
+	topo_notify_stopping = true;
+	pthread_cond_signal(&topo_event_cond);
+	pthread_mutex_unlock(&topo_event_mutex);
+
+	if (running && !pthread_equal(topo_notify_thread, pthread_self()))
+		pthread_join(topo_notify_thread, NULL);
+
+	while ((ev = topo_event_head) != NULL) {
+		topo_event_head = ev->next;
+		free(ev);
+	}
+	topo_event_tail = &topo_event_head;
+
+	pthread_mutex_lock(&topo_notify_mutex);
+	while ((notifier = topo_notifiers) != NULL) {
+		topo_notifiers = notifier->next;
+		free(notifier);
+	}
+	pthread_mutex_unlock(&topo_notify_mutex);
+}
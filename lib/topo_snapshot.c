@@ -0,0 +1,957 @@
+/*
+ * Copyright (c) 2021 HiSilicon Technologies Co., Ltd.
+ * Wayca scheduler is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ *
+ * See the Mulan PSL v2 for more details.
+ */
+
+/* topo_snapshot.c - persistent binary snapshot of the topology
+ *
+ * Walking sysfs for every CPU, cache index and I/O device is the most
+ * expensive part of the library loading. The result only changes across
+ * reboots or CPU hotplug, so the first process which builds the topology
+ * stores it into a versioned binary file under the cache directory, and
+ * later processes map that file and rebuild the in-memory topology from it.
+ *
+ * The snapshot is only trusted when the boot_id and the online CPU mask
+ * it was taken with match the running system. Anything unexpected in the
+ * file makes the loader bail out and the caller falls back to sysfs.
+ *
+ * Only the topology phases loaded so far are stored, the snapshot is
+ * refreshed each time another phase is loaded from sysfs.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "common.h"
+#include "topo.h"
+
+#define TOPO_SNAPSHOT_MAGIC		"WAYCATOP"
+#define TOPO_SNAPSHOT_VERSION		5
+#define TOPO_SNAPSHOT_FILE_PREFIX	"topo"
+#define TOPO_SNAPSHOT_BOOT_ID_LEN	40
+#define TOPO_SNAPSHOT_PHASES		(TOPO_PHASE_BIT(TOPO_PHASE_CPU) |	\
+					 TOPO_PHASE_BIT(TOPO_PHASE_NUMA) |	\
+					 TOPO_PHASE_BIT(TOPO_PHASE_DEVICE))
+
+struct topo_snapshot_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t header_size;
+	uint64_t payload_size;
+	uint64_t checksum;		/* FNV-1a of the payload */
+	uint32_t phases;		/* topology phases in the payload */
+	char boot_id[TOPO_SNAPSHOT_BOOT_ID_LEN];
+	/* layout of the structures copied as a whole */
+	uint32_t cache_size;
+	uint32_t smmu_size;
+	uint32_t pcidev_size;
+	uint32_t mem_node_size;
+	int32_t kernel_max_cpus;
+};
+
+struct topo_snapshot_buf {
+	char *data;
+	size_t len;
+	size_t cap;
+	int err;
+};
+
+struct topo_snapshot_cursor {
+	const char *data;
+	size_t len;
+	size_t pos;
+	int err;
+};
+
+static uint64_t topo_snapshot_checksum(const char *data, size_t len)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static bool topo_snapshot_enabled(void)
+{
+	char *p = secure_getenv("WAYCA_SC_TOPO_CACHE");
+
+	return !(p && !strcmp(p, "NO"));
+}
+
+/*
+ * The snapshot of a synthetic sysfs is kept apart from the native one,
+ * named after the hash of its roots.
+ */
+static int topo_snapshot_path(char *path, size_t len, const char *suffix)
+{
+	const char *dir = secure_getenv("WAYCA_SC_TOPO_CACHE_DIR");
+	const char *sysfs = topo_fs_sysfs_root();
+	const char *procfs = topo_fs_procfs_root();
+	char name[32] = "";
+	int ret;
+
+	if (!dir || !*dir)
+		dir = WAYCA_SC_TOPO_CACHE_DIR;
+
+	if (!topo_fs_is_native())
+		snprintf(name, sizeof(name), "-%016" PRIx64,
+			 topo_snapshot_checksum(sysfs, strlen(sysfs)) * 31 +
+			 topo_snapshot_checksum(procfs, strlen(procfs)));
+
+	ret = snprintf(path, len, "%s/%s-v%d%s.bin%s", dir,
+		       TOPO_SNAPSHOT_FILE_PREFIX, TOPO_SNAPSHOT_VERSION, name,
+		       suffix ? suffix : "");
+	if (ret < 0 || ret >= len)
+		return -ENAMETOOLONG;
+	return 0;
+}
+
+static int topo_snapshot_boot_id(char *boot_id)
+{
+	int ret;
+
+	ret = topo_sysfs_read_str(WAYCA_SC_RANDOM_FNAME, "boot_id", boot_id,
+				  TOPO_SNAPSHOT_BOOT_ID_LEN);
+	if (ret <= 0)
+		return ret < 0 ? ret : -ENODATA;
+	return 0;
+}
+
+/* Read the current online CPUs into @online, which holds @kernel_max_cpus */
+static int topo_snapshot_online_cpus(cpu_set_t *online, int kernel_max_cpus)
+{
+	return topo_sysfs_read_cpulist(WAYCA_SC_CPU_FNAME, "online", online,
+				       CPU_ALLOC_SIZE(kernel_max_cpus));
+}
+
+static void snap_put(struct topo_snapshot_buf *buf, const void *src, size_t len)
+{
+	size_t cap;
+	char *data;
+
+	if (buf->err || !len)
+		return;
+
+	if (buf->len + len > buf->cap) {
+		cap = max(buf->cap * 2, buf->len + len);
+		cap = max(cap, (size_t)BUFSIZ);
+		data = realloc(buf->data, cap);
+		if (!data) {
+			buf->err = -ENOMEM;
+			return;
+		}
+		buf->data = data;
+		buf->cap = cap;
+	}
+
+	memcpy(buf->data + buf->len, src, len);
+	buf->len += len;
+}
+
+static void snap_put_u64(struct topo_snapshot_buf *buf, uint64_t val)
+{
+	snap_put(buf, &val, sizeof(val));
+}
+
+static void snap_put_s32(struct topo_snapshot_buf *buf, int32_t val)
+{
+	snap_put(buf, &val, sizeof(val));
+}
+
+/* A NULL mask is stored with zero length and loaded back as NULL */
+static void snap_put_mask(struct topo_snapshot_buf *buf, const cpu_set_t *mask,
+			  size_t setsize)
+{
+	snap_put_u64(buf, mask ? setsize : 0);
+	if (mask)
+		snap_put(buf, mask, setsize);
+}
+
+static void snap_get(struct topo_snapshot_cursor *cur, void *dst, size_t len)
+{
+	if (!cur->err && len > cur->len - cur->pos)
+		cur->err = -EINVAL;
+
+	if (cur->err) {
+		memset(dst, 0, len);
+		return;
+	}
+
+	memcpy(dst, cur->data + cur->pos, len);
+	cur->pos += len;
+}
+
+static uint64_t snap_get_u64(struct topo_snapshot_cursor *cur)
+{
+	uint64_t val;
+
+	snap_get(cur, &val, sizeof(val));
+	return val;
+}
+
+static int32_t snap_get_s32(struct topo_snapshot_cursor *cur)
+{
+	int32_t val;
+
+	snap_get(cur, &val, sizeof(val));
+	return val;
+}
+
+/*
+ * Read a count of elements which occupy at least @elem_size bytes each,
+ * so a corrupted count cannot make us allocate more than the file holds.
+ */
+static size_t snap_get_count(struct topo_snapshot_cursor *cur, size_t elem_size)
+{
+	uint64_t count = snap_get_u64(cur);
+
+	if (!cur->err && count > (cur->len - cur->pos) / elem_size)
+		cur->err = -EINVAL;
+
+	return cur->err ? 0 : count;
+}
+
+/*
+ * The users of a mask index it by the number of the elements it holds, so
+ * a mask stored with another size than @expected is rejected.
+ */
+static cpu_set_t *snap_get_mask(struct topo_snapshot_cursor *cur,
+				size_t expected)
+{
+	uint64_t setsize = snap_get_u64(cur);
+	cpu_set_t *mask;
+
+	if (cur->err || !setsize)
+		return NULL;
+
+	if (setsize != expected || setsize > cur->len - cur->pos) {
+		cur->err = -EINVAL;
+		return NULL;
+	}
+
+	mask = CPU_ALLOC(setsize * 8);
+	if (!mask) {
+		cur->err = -ENOMEM;
+		return NULL;
+	}
+
+	snap_get(cur, mask, setsize);
+	return mask;
+}
+
+/* Allocate an empty mask, used for the maps derived on loading */
+static cpu_set_t *snap_zero_mask(struct topo_snapshot_cursor *cur,
+				 struct wayca_topo *p_topo)
+{
+	cpu_set_t *mask;
+
+	if (cur->err)
+		return NULL;
+
+	mask = CPU_ALLOC(p_topo->kernel_max_cpus);
+	if (!mask) {
+		cur->err = -ENOMEM;
+		return NULL;
+	}
+
+	CPU_ZERO_S(p_topo->setsize, mask);
+	return mask;
+}
+
+static void *snap_calloc(struct topo_snapshot_cursor *cur, size_t nmemb,
+			 size_t size)
+{
+	void *mem;
+
+	if (cur->err || !nmemb)
+		return NULL;
+
+	mem = calloc(nmemb, size);
+	if (!mem)
+		cur->err = -ENOMEM;
+	return mem;
+}
+
+/* Return the index of @elem in @array, or -1 if it's not there */
+static int topo_index_of(void *const *array, size_t n, const void *elem)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		if (array[i] == elem)
+			return i;
+	return -1;
+}
+
+static void topo_snapshot_put_node_devices(struct topo_snapshot_buf *buf,
+					   const struct wayca_topo *p_topo,
+					   const struct wayca_node *node)
+{
+	struct wayca_pci_device pcidev;
+	int i;
+
+	snap_put_u64(buf, node->n_smmus);
+	for (i = 0; i < node->n_smmus; i++)
+		snap_put(buf, node->smmus[i], sizeof(struct wayca_smmu));
+
+	snap_put_u64(buf, node->n_pcidevs);
+	for (i = 0; i < node->n_pcidevs; i++) {
+		/* pointers are stored separately after the plain fields */
+		pcidev = *node->pcidevs[i];
+		pcidev.local_cpu_map = NULL;
+		pcidev.irqs.irq_numbers = NULL;
+		snap_put(buf, &pcidev, sizeof(pcidev));
+		snap_put_mask(buf, node->pcidevs[i]->local_cpu_map,
+			      p_topo->setsize);
+		snap_put(buf, node->pcidevs[i]->irqs.irq_numbers,
+			 pcidev.irqs.n_irqs * sizeof(uint32_t));
+	}
+}
+
+static void topo_snapshot_put_cpu(struct topo_snapshot_buf *buf,
+				  const struct wayca_topo *p_topo,
+				  const struct wayca_cpu *cpu)
+{
+	struct wayca_cache cache;
+	int i;
+
+	snap_put_s32(buf, cpu->cpu_id);
+	snap_put_s32(buf, cpu->core_id);
+	snap_put_s32(buf, cpu->p_cluster ? topo_index_of((void *const *)p_topo->ccls,
+				p_topo->n_clusters, cpu->p_cluster) : -1);
+	snap_put_s32(buf, cpu->p_numa_node ? topo_index_of((void *const *)p_topo->nodes,
+				p_topo->n_nodes, cpu->p_numa_node) : -1);
+	snap_put_s32(buf, cpu->p_package ? topo_index_of((void *const *)p_topo->packages,
+				p_topo->n_packages, cpu->p_package) : -1);
+	snap_put_mask(buf, cpu->core_cpus_map, p_topo->setsize);
+	snap_put_s32(buf, cpu->capacity);
+
+	snap_put_u64(buf, cpu->n_caches);
+	for (i = 0; i < cpu->n_caches; i++) {
+		cache = cpu->p_caches[i];
+		cache.shared_cpu_map = NULL;
+		snap_put(buf, &cache, sizeof(cache));
+		snap_put_mask(buf, cpu->p_caches[i].shared_cpu_map,
+			      p_topo->setsize);
+	}
+}
+
+static void topo_snapshot_put_mem_nodes(struct topo_snapshot_buf *buf,
+					const struct wayca_topo *p_topo)
+{
+	struct wayca_mem_node mem;
+	int i;
+
+	snap_put_u64(buf, p_topo->n_mem_nodes);
+	for (i = 0; i < p_topo->n_mem_nodes; i++) {
+		mem = p_topo->mem_nodes[i];
+		mem.distance = NULL;
+		snap_put(buf, &mem, sizeof(mem));
+		snap_put(buf, p_topo->mem_nodes[i].distance,
+			 p_topo->n_nodes * sizeof(int));
+	}
+}
+
+/*
+ * The payload is split into the sections of the snapshot-able phases, in
+ * the order of enum topo_phase. The CPU section is always present.
+ */
+static void topo_snapshot_serialize(struct topo_snapshot_buf *buf,
+				    const struct wayca_topo *p_topo,
+				    unsigned int phases)
+{
+	size_t node_setsize = CPU_ALLOC_SIZE(p_topo->n_cpus);
+	struct wayca_node *node;
+	int i;
+
+	snap_put_s32(buf, p_topo->kernel_max_cpus);
+	snap_put_u64(buf, p_topo->n_cpus);
+	snap_put_mask(buf, p_topo->cpu_map, p_topo->setsize);
+	snap_put_mask(buf, p_topo->online_cpu_map, p_topo->setsize);
+
+	snap_put_u64(buf, p_topo->n_clusters);
+	for (i = 0; i < p_topo->n_clusters; i++) {
+		snap_put_s32(buf, p_topo->ccls[i]->cluster_id);
+		snap_put_u64(buf, p_topo->ccls[i]->n_cpus);
+		snap_put_mask(buf, p_topo->ccls[i]->cpu_map, p_topo->setsize);
+	}
+
+	snap_put_u64(buf, p_topo->n_packages);
+	for (i = 0; i < p_topo->n_packages; i++) {
+		snap_put_s32(buf, p_topo->packages[i]->physical_package_id);
+		snap_put_u64(buf, p_topo->packages[i]->n_cpus);
+		snap_put_mask(buf, p_topo->packages[i]->cpu_map,
+			      p_topo->setsize);
+	}
+
+	snap_put_u64(buf, p_topo->n_nodes);
+	snap_put_mask(buf, p_topo->node_map, node_setsize);
+	for (i = 0; i < p_topo->n_nodes; i++) {
+		node = p_topo->nodes[i];
+		snap_put_s32(buf, node->node_idx);
+		snap_put_u64(buf, node->n_cpus);
+		snap_put_mask(buf, node->cpu_map, p_topo->setsize);
+		snap_put_mask(buf, node->cluster_map, p_topo->setsize);
+	}
+
+	for (i = 0; i < p_topo->n_cpus; i++)
+		topo_snapshot_put_cpu(buf, p_topo, p_topo->cpus[i]);
+
+	if (phases & TOPO_PHASE_BIT(TOPO_PHASE_NUMA)) {
+		for (i = 0; i < p_topo->n_packages; i++)
+			snap_put_mask(buf, p_topo->packages[i]->numa_map,
+				      node_setsize);
+		for (i = 0; i < p_topo->n_nodes; i++) {
+			node = p_topo->nodes[i];
+			snap_put(buf, node->distance,
+				 p_topo->n_nodes * sizeof(int));
+			snap_put_u64(buf, node->p_meminfo->total_avail_kB);
+		}
+		topo_snapshot_put_mem_nodes(buf, p_topo);
+	}
+
+	if (phases & TOPO_PHASE_BIT(TOPO_PHASE_DEVICE))
+		for (i = 0; i < p_topo->n_nodes; i++)
+			topo_snapshot_put_node_devices(buf, p_topo,
+						       p_topo->nodes[i]);
+}
+
+static void topo_snapshot_get_node_devices(struct topo_snapshot_cursor *cur,
+					   const struct wayca_topo *p_topo,
+					   struct wayca_node *node)
+{
+	struct wayca_pci_device *pcidev;
+	int i;
+
+	node->n_smmus = snap_get_count(cur, sizeof(struct wayca_smmu));
+	node->smmus = snap_calloc(cur, node->n_smmus, sizeof(*node->smmus));
+	for (i = 0; i < node->n_smmus && !cur->err; i++) {
+		node->smmus[i] = snap_calloc(cur, 1, sizeof(struct wayca_smmu));
+		if (node->smmus[i])
+			snap_get(cur, node->smmus[i], sizeof(struct wayca_smmu));
+	}
+
+	node->n_pcidevs = snap_get_count(cur, sizeof(*pcidev));
+	node->pcidevs = snap_calloc(cur, node->n_pcidevs,
+				    sizeof(*node->pcidevs));
+	for (i = 0; i < node->n_pcidevs && !cur->err; i++) {
+		pcidev = snap_calloc(cur, 1, sizeof(*pcidev));
+		if (!pcidev)
+			break;
+		node->pcidevs[i] = pcidev;
+		snap_get(cur, pcidev, sizeof(*pcidev));
+		pcidev->absolute_path[WAYCA_SC_PATH_LEN_MAX - 1] = '\0';
+		pcidev->slot_name[WAYCA_SC_PCI_SLOT_NAME_LEN_MAX - 1] = '\0';
+		pcidev->parent_name[WAYCA_SC_PCI_SLOT_NAME_LEN_MAX - 1] = '\0';
+		pcidev->root_name[WAYCA_SC_PCI_SLOT_NAME_LEN_MAX - 1] = '\0';
+		pcidev->local_cpu_map = snap_get_mask(cur, p_topo->setsize);
+		pcidev->irqs.irq_numbers = NULL;
+		if (pcidev->irqs.n_irqs > (cur->len - cur->pos) / sizeof(uint32_t)) {
+			pcidev->irqs.n_irqs = 0;
+			cur->err = -EINVAL;
+			break;
+		}
+		pcidev->irqs.irq_numbers = snap_calloc(cur, pcidev->irqs.n_irqs,
+						       sizeof(uint32_t));
+		if (pcidev->irqs.irq_numbers)
+			snap_get(cur, pcidev->irqs.irq_numbers,
+				 pcidev->irqs.n_irqs * sizeof(uint32_t));
+	}
+}
+
+/* Return a pointer to element @idx of @array, or NULL if @idx is -1 */
+static void *snap_link(struct topo_snapshot_cursor *cur, void **array,
+		       size_t n, int idx)
+{
+	if (idx == -1)
+		return NULL;
+
+	if (idx < 0 || idx >= n) {
+		cur->err = -EINVAL;
+		return NULL;
+	}
+	return array[idx];
+}
+
+static void topo_snapshot_get_cpu(struct topo_snapshot_cursor *cur,
+				  struct wayca_topo *p_topo,
+				  struct wayca_cpu *cpu)
+{
+	struct wayca_cache *cache;
+	int i;
+
+	cpu->cpu_id = snap_get_s32(cur);
+	cpu->core_id = snap_get_s32(cur);
+	cpu->p_cluster = snap_link(cur, (void **)p_topo->ccls,
+				   p_topo->n_clusters, snap_get_s32(cur));
+	cpu->p_numa_node = snap_link(cur, (void **)p_topo->nodes,
+				     p_topo->n_nodes, snap_get_s32(cur));
+	cpu->p_package = snap_link(cur, (void **)p_topo->packages,
+				   p_topo->n_packages, snap_get_s32(cur));
+	cpu->core_cpus_map = snap_get_mask(cur, p_topo->setsize);
+	cpu->capacity = snap_get_s32(cur);
+
+	/* every possible CPU belongs to a NUMA node */
+	if (!cur->err && !cpu->p_numa_node)
+		cur->err = -EINVAL;
+
+	cpu->n_caches = snap_get_count(cur, sizeof(*cache));
+	cpu->p_caches = snap_calloc(cur, cpu->n_caches, sizeof(*cache));
+	for (i = 0; i < cpu->n_caches && !cur->err; i++) {
+		cache = &cpu->p_caches[i];
+		snap_get(cur, cache, sizeof(*cache));
+		cache->type[WAYCA_SC_ATTR_STRING_LEN - 1] = '\0';
+		cache->allocation_policy[WAYCA_SC_ATTR_STRING_LEN - 1] = '\0';
+		cache->write_policy[WAYCA_SC_ATTR_STRING_LEN - 1] = '\0';
+		cache->cache_size[WAYCA_SC_ATTR_STRING_LEN - 1] = '\0';
+		cache->shared_cpu_map = snap_get_mask(cur, p_topo->setsize);
+	}
+}
+
+static void topo_snapshot_get_mem_nodes(struct topo_snapshot_cursor *cur,
+					struct wayca_topo *p_topo)
+{
+	struct wayca_mem_node *mem;
+	int i;
+
+	p_topo->n_mem_nodes = snap_get_count(cur, sizeof(*mem));
+	p_topo->mem_nodes = snap_calloc(cur, p_topo->n_mem_nodes,
+					sizeof(*mem));
+	for (i = 0; i < p_topo->n_mem_nodes && !cur->err; i++) {
+		mem = &p_topo->mem_nodes[i];
+		snap_get(cur, mem, sizeof(*mem));
+		mem->distance = NULL;
+		/* the links to the nodes of CPUs are indexes */
+		if (mem->node < -1 || mem->node >= (int)p_topo->n_nodes ||
+		    mem->initiator < -1 ||
+		    mem->initiator >= (int)p_topo->n_nodes) {
+			cur->err = -EINVAL;
+			break;
+		}
+		mem->distance = snap_calloc(cur, p_topo->n_nodes, sizeof(int));
+		if (mem->distance)
+			snap_get(cur, mem->distance,
+				 p_topo->n_nodes * sizeof(int));
+	}
+}
+
+static void topo_snapshot_get_numa(struct topo_snapshot_cursor *cur,
+				   struct wayca_topo *p_topo)
+{
+	size_t node_setsize = CPU_ALLOC_SIZE(p_topo->n_cpus);
+	struct wayca_node *node;
+	int i;
+
+	for (i = 0; i < p_topo->n_packages && !cur->err; i++) {
+		CPU_FREE(p_topo->packages[i]->numa_map);
+		p_topo->packages[i]->numa_map = snap_get_mask(cur,
+							      node_setsize);
+	}
+
+	for (i = 0; i < p_topo->n_nodes && !cur->err; i++) {
+		node = p_topo->nodes[i];
+		node->distance = snap_calloc(cur, p_topo->n_nodes, sizeof(int));
+		if (node->distance)
+			snap_get(cur, node->distance,
+				 p_topo->n_nodes * sizeof(int));
+		node->p_meminfo = snap_calloc(cur, 1,
+					      sizeof(struct wayca_meminfo));
+		if (node->p_meminfo)
+			node->p_meminfo->total_avail_kB = snap_get_u64(cur);
+	}
+
+	topo_snapshot_get_mem_nodes(cur, p_topo);
+}
+
+static int topo_snapshot_deserialize(struct topo_snapshot_cursor *cur,
+				     struct wayca_topo *p_topo,
+				     unsigned int phases)
+{
+	struct wayca_node *node;
+	int i, ret;
+
+	p_topo->kernel_max_cpus = snap_get_s32(cur);
+	if (p_topo->kernel_max_cpus <= 0)
+		return -EINVAL;
+	p_topo->setsize = CPU_ALLOC_SIZE(p_topo->kernel_max_cpus);
+
+	p_topo->n_cpus = snap_get_count(cur, 1);
+	p_topo->cpu_map = snap_get_mask(cur, p_topo->setsize);
+	p_topo->online_cpu_map = snap_get_mask(cur, p_topo->setsize);
+	p_topo->cpus = snap_calloc(cur, p_topo->n_cpus, sizeof(*p_topo->cpus));
+	if (!cur->err && (!p_topo->cpu_map || !p_topo->online_cpu_map ||
+			  !p_topo->cpus))
+		return -EINVAL;
+
+	p_topo->n_clusters = snap_get_count(cur, 1);
+	p_topo->ccls = snap_calloc(cur, p_topo->n_clusters,
+				   sizeof(*p_topo->ccls));
+	for (i = 0; i < p_topo->n_clusters && !cur->err; i++) {
+		p_topo->ccls[i] = snap_calloc(cur, 1, sizeof(**p_topo->ccls));
+		if (!p_topo->ccls[i])
+			break;
+		p_topo->ccls[i]->cluster_id = snap_get_s32(cur);
+		p_topo->ccls[i]->n_cpus = snap_get_u64(cur);
+		p_topo->ccls[i]->cpu_map = snap_get_mask(cur, p_topo->setsize);
+		p_topo->ccls[i]->core_map = snap_zero_mask(cur, p_topo);
+	}
+
+	p_topo->n_packages = snap_get_count(cur, 1);
+	p_topo->packages = snap_calloc(cur, p_topo->n_packages,
+				       sizeof(*p_topo->packages));
+	for (i = 0; i < p_topo->n_packages && !cur->err; i++) {
+		p_topo->packages[i] = snap_calloc(cur, 1,
+						  sizeof(**p_topo->packages));
+		if (!p_topo->packages[i])
+			break;
+		p_topo->packages[i]->physical_package_id = snap_get_s32(cur);
+		p_topo->packages[i]->n_cpus = snap_get_u64(cur);
+		p_topo->packages[i]->cpu_map = snap_get_mask(cur,
+							     p_topo->setsize);
+		/* filled by the NUMA phase */
+		p_topo->packages[i]->numa_map = snap_zero_mask(cur, p_topo);
+	}
+
+	p_topo->n_nodes = snap_get_count(cur, 1);
+	p_topo->node_map = snap_get_mask(cur, CPU_ALLOC_SIZE(p_topo->n_cpus));
+	p_topo->nodes = snap_calloc(cur, p_topo->n_nodes,
+				    sizeof(*p_topo->nodes));
+	for (i = 0; i < p_topo->n_nodes && !cur->err; i++) {
+		node = calloc(1, sizeof(*node));
+		if (!node) {
+			cur->err = -ENOMEM;
+			break;
+		}
+		p_topo->nodes[i] = node;
+		node->node_idx = snap_get_s32(cur);
+		node->n_cpus = snap_get_u64(cur);
+		node->cpu_map = snap_get_mask(cur, p_topo->setsize);
+		node->cluster_map = snap_get_mask(cur, p_topo->setsize);
+		/* the core map is rebuilt by topo_construct_core_topology() */
+		node->core_map = snap_zero_mask(cur, p_topo);
+	}
+
+	for (i = 0; i < p_topo->n_cpus && !cur->err; i++) {
+		p_topo->cpus[i] = snap_calloc(cur, 1, sizeof(**p_topo->cpus));
+		if (!p_topo->cpus[i])
+			break;
+		topo_snapshot_get_cpu(cur, p_topo, p_topo->cpus[i]);
+	}
+
+	if (phases & TOPO_PHASE_BIT(TOPO_PHASE_NUMA))
+		topo_snapshot_get_numa(cur, p_topo);
+
+	if (phases & TOPO_PHASE_BIT(TOPO_PHASE_DEVICE))
+		for (i = 0; i < p_topo->n_nodes && !cur->err; i++)
+			topo_snapshot_get_node_devices(cur, p_topo,
+						       p_topo->nodes[i]);
+
+	if (!cur->err && cur->pos != cur->len)
+		cur->err = -EINVAL;
+	if (cur->err)
+		return cur->err;
+
+	ret = topo_construct_core_topology(p_topo);
+	if (!ret)
+		topo_index_build(p_topo, phases);
+	return ret;
+}
+
+static int topo_snapshot_validate(const struct topo_snapshot_header *hdr,
+				  size_t file_size, const char *payload)
+{
+	char boot_id[TOPO_SNAPSHOT_BOOT_ID_LEN];
+	size_t setsize = CPU_ALLOC_SIZE(hdr->kernel_max_cpus);
+	cpu_set_t *online, *cached_online;
+	struct topo_snapshot_cursor cur;
+	int ret;
+
+	if (memcmp(hdr->magic, TOPO_SNAPSHOT_MAGIC, sizeof(hdr->magic)) ||
+	    hdr->version != TOPO_SNAPSHOT_VERSION ||
+	    hdr->header_size != sizeof(*hdr) ||
+	    hdr->payload_size != file_size - sizeof(*hdr) ||
+	    hdr->cache_size != sizeof(struct wayca_cache) ||
+	    hdr->smmu_size != sizeof(struct wayca_smmu) ||
+	    hdr->pcidev_size != sizeof(struct wayca_pci_device) ||
+	    hdr->mem_node_size != sizeof(struct wayca_mem_node) ||
+	    hdr->kernel_max_cpus <= 0 ||
+	    !(hdr->phases & TOPO_PHASE_BIT(TOPO_PHASE_CPU)) ||
+	    (hdr->phases & ~TOPO_SNAPSHOT_PHASES))
+		return -EINVAL;
+
+	ret = topo_snapshot_boot_id(boot_id);
+	if (ret)
+		return ret;
+	if (strncmp(boot_id, hdr->boot_id, sizeof(boot_id)))
+		return -ESTALE;
+
+	if (topo_snapshot_checksum(payload, hdr->payload_size) != hdr->checksum)
+		return -EINVAL;
+
+	/* the online mask follows the kernel_max_cpus and n_cpus */
+	cur = (struct topo_snapshot_cursor){ payload, hdr->payload_size, 0, 0 };
+	snap_get_s32(&cur);
+	snap_get_u64(&cur);
+	CPU_FREE(snap_get_mask(&cur, setsize));
+	cached_online = snap_get_mask(&cur, setsize);
+	if (!cached_online)
+		return cur.err ? cur.err : -EINVAL;
+
+	online = CPU_ALLOC(hdr->kernel_max_cpus);
+	if (!online) {
+		CPU_FREE(cached_online);
+		return -ENOMEM;
+	}
+
+	ret = topo_snapshot_online_cpus(online, hdr->kernel_max_cpus);
+	if (!ret && !CPU_EQUAL_S(setsize, online, cached_online))
+		ret = -ESTALE;
+
+	CPU_FREE(online);
+	CPU_FREE(cached_online);
+	return ret;
+}
+
+/* topo_snapshot_load - rebuild @p_topo from the snapshot in the cache directory
+ *
+ * The phases carried by the snapshot are marked loaded in @p_topo->phases.
+ * @p_topo must be zeroed. On failure it may be partially filled and the
+ * caller is responsible for releasing it.
+ *
+ * Return 0 on success, negative on error.
+ */
+int topo_snapshot_load(struct wayca_topo *p_topo)
+{
+	const struct topo_snapshot_header *hdr;
+	char path[WAYCA_SC_PATH_LEN_MAX];
+	struct topo_snapshot_cursor cur;
+	struct stat statbuf;
+	void *addr;
+	int ret;
+	int fd;
+
+	if (!topo_snapshot_enabled())
+		return -ENOENT;
+
+	ret = topo_snapshot_path(path, sizeof(path), NULL);
+	if (ret)
+		return ret;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return -errno;
+
+	if (fstat(fd, &statbuf) < 0) {
+		ret = -errno;
+		goto close_fd;
+	}
+
+	/* only trust the snapshot written by root or ourselves */
+	if (!S_ISREG(statbuf.st_mode) ||
+	    (statbuf.st_uid != 0 && statbuf.st_uid != geteuid()) ||
+	    (statbuf.st_mode & (S_IWGRP | S_IWOTH)) ||
+	    statbuf.st_size < sizeof(*hdr)) {
+		ret = -EPERM;
+		goto close_fd;
+	}
+
+	addr = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (addr == MAP_FAILED) {
+		ret = -errno;
+		goto close_fd;
+	}
+
+	hdr = addr;
+	ret = topo_snapshot_validate(hdr, statbuf.st_size,
+				     (const char *)addr + sizeof(*hdr));
+	if (ret) {
+		PRINT_DBG("ignore stale topology snapshot %s, ret = %d\n",
+			  path, ret);
+		goto unmap;
+	}
+
+	cur = (struct topo_snapshot_cursor){
+		(const char *)addr + sizeof(*hdr), hdr->payload_size, 0, 0
+	};
+	ret = topo_snapshot_deserialize(&cur, p_topo, hdr->phases);
+	if (ret)
+		PRINT_ERROR("failed to load topology snapshot %s, ret = %d\n",
+			    path, ret);
+	else
+		__atomic_store_n(&p_topo->phases, hdr->phases, __ATOMIC_RELEASE);
+
+unmap:
+	munmap(addr, statbuf.st_size);
+close_fd:
+	close(fd);
+	return ret;
+}
+
+static int topo_snapshot_write(int fd, const void *data, size_t len)
+{
+	const char *p = data;
+	ssize_t ret;
+
+	while (len > 0) {
+		ret = write(fd, p, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		p += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+/* topo_snapshot_store - store @p_topo into the cache directory
+ *
+ * The snapshot is written into a temporary file and renamed into place, so
+ * the concurrent loaders either see the old file or the complete new one.
+ * Failing to store the snapshot is not fatal, the next process simply
+ * walks the sysfs again.
+ *
+ * Return 0 on success, negative on error.
+ */
+int topo_snapshot_store(const struct wayca_topo *p_topo)
+{
+	struct topo_snapshot_buf buf = { 0 };
+	char path[WAYCA_SC_PATH_LEN_MAX];
+	char tmp[WAYCA_SC_PATH_LEN_MAX];
+	struct topo_snapshot_header hdr;
+	char suffix[32];
+	char *p;
+	int ret;
+	int fd;
+
+	if (!topo_snapshot_enabled())
+		return 0;
+
+	snprintf(suffix, sizeof(suffix), ".%d.tmp", getpid());
+	ret = topo_snapshot_path(path, sizeof(path), NULL);
+	if (!ret)
+		ret = topo_snapshot_path(tmp, sizeof(tmp), suffix);
+	if (ret)
+		goto free_buf;
+
+	/*
+	 * Create the cache directory if it's missing, parent must exist. If
+	 * it's not writable, e.g. the default one for a user other than root,
+	 * don't serialize the topology for nothing.
+	 */
+	p = strrchr(path, '/');
+	*p = '\0';
+	if (mkdir(path, 0755) < 0 && errno != EEXIST)
+		ret = -errno;
+	else if (euidaccess(path, W_OK | X_OK) < 0)
+		ret = -errno;
+	*p = '/';
+	if (ret)
+		goto free_buf;
+
+	memset(&hdr, 0, sizeof(hdr));
+	ret = topo_snapshot_boot_id(hdr.boot_id);
+	if (ret)
+		goto free_buf;
+
+	hdr.phases = p_topo->phases & TOPO_SNAPSHOT_PHASES;
+	topo_snapshot_serialize(&buf, p_topo, hdr.phases);
+	if (buf.err) {
+		ret = buf.err;
+		goto free_buf;
+	}
+
+	memcpy(hdr.magic, TOPO_SNAPSHOT_MAGIC, sizeof(hdr.magic));
+	hdr.version = TOPO_SNAPSHOT_VERSION;
+	hdr.header_size = sizeof(hdr);
+	hdr.payload_size = buf.len;
+	hdr.checksum = topo_snapshot_checksum(buf.data, buf.len);
+	hdr.cache_size = sizeof(struct wayca_cache);
+	hdr.smmu_size = sizeof(struct wayca_smmu);
+	hdr.pcidev_size = sizeof(struct wayca_pci_device);
+	hdr.mem_node_size = sizeof(struct wayca_mem_node);
+	hdr.kernel_max_cpus = p_topo->kernel_max_cpus;
+
+	fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		ret = -errno;
+		goto free_buf;
+	}
+
+	ret = topo_snapshot_write(fd, &hdr, sizeof(hdr));
+	if (!ret)
+		ret = topo_snapshot_write(fd, buf.data, buf.len);
+	close(fd);
+
+	if (!ret && rename(tmp, path) < 0)
+		ret = -errno;
+	if (ret)
+		unlink(tmp);
+
+free_buf:
+	free(buf.data);
+	if (ret)
+		PRINT_DBG("failed to store topology snapshot, ret = %d\n", ret);
+	return ret;
+}
+
+/* topo_snapshot_clone - copy the snapshot-able phases of @src into @dst
+ *
+ * The copy goes through the snapshot encoding in memory, so it shares
+ * nothing with @src and can be modified while @src is being read. The
+ * devices shared by the versions are left out, the caller attaches them
+ * to @dst instead. @dst must be zeroed. On failure it may be partially
+ * filled and the caller is responsible for releasing it.
+ *
+ * Return 0 on success, negative on error.
+ */
+int topo_snapshot_clone(struct wayca_topo *dst, const struct wayca_topo *src)
+{
+	unsigned int phases = src->phases & TOPO_SNAPSHOT_PHASES;
+	struct topo_snapshot_buf buf = { 0 };
+	struct topo_snapshot_cursor cur;
+	int ret;
+
+	if (src->dev_shared)
+		phases &= ~TOPO_PHASE_BIT(TOPO_PHASE_DEVICE);
+
+	topo_snapshot_serialize(&buf, src, phases);
+	if (buf.err) {
+		ret = buf.err;
+		goto free_buf;
+	}
+
+	cur = (struct topo_snapshot_cursor){ buf.data, buf.len, 0, 0 };
+	ret = topo_snapshot_deserialize(&cur, dst, phases);
+	if (!ret)
+		dst->phases = phases;
+
+free_buf:
+	free(buf.data);
+	return ret;
+}
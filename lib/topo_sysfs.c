@@ -0,0 +1,589 @@
+/*
+ * Copyright (c) 2021 HiSilicon Technologies Co., Ltd.
+ * Wayca scheduler is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ *
+ * See the Mulan PSL v2 for more details.
+ */
+
+/* topo_sysfs.c - sysfs attribute reader used to build the topology
+ *
+ * The topology is built from tens of thousands of small sysfs attributes
+ * which live in a few directories per CPU, cache and device. Each thread
+ * keeps a small cache of directory fds opened with O_PATH, so reading an
+ * attribute is an openat(), a read() and a close() on a per-thread scratch
+ * buffer, without resolving the directory path again.
+ *
+ * sysfs and procfs are looked up under WAYCA_SC_SYSFS_ROOT and
+ * WAYCA_SC_PROCFS_ROOT if set, so the topology can be loaded from a
+ * synthetic tree, e.g. one made by tools/wayca-fake-sysfs.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "topo.h"
+
+/* number of directory fds cached by each thread */
+#define TOPO_SYSFS_NR_DIRFDS	32
+
+static const struct {
+	bool procfs;		/* under procfs rather than sysfs */
+	const char *name;
+} topo_fs_paths[TOPO_FS_NR_PATHS] = {
+	[TOPO_FS_SYSDEV] = { false, "/devices" },
+	[TOPO_FS_NODE] = { false, "/devices/system/node" },
+	[TOPO_FS_CPU] = { false, "/devices/system/cpu" },
+	[TOPO_FS_KERNEL_IRQ] = { false, "/kernel/irq" },
+	[TOPO_FS_RANDOM] = { true, "/sys/kernel/random" },
+	[TOPO_FS_PROC_IRQ] = { true, "/irq" },
+};
+
+static pthread_once_t topo_fs_once = PTHREAD_ONCE_INIT;
+static const char *topo_fs_sysfs = WAYCA_SC_SYSFS_ROOT;
+static const char *topo_fs_procfs = WAYCA_SC_PROCFS_ROOT;
+static char *topo_fs_full_paths[TOPO_FS_NR_PATHS];
+
+struct topo_sysfs_dirfd {
+	uint64_t hash;
+	char *path;		/* NULL if the slot is unused */
+	int fd;
+};
+
+struct topo_sysfs_ctx {
+	struct topo_sysfs_dirfd dirfds[TOPO_SYSFS_NR_DIRFDS];
+	unsigned int victim;	/* next slot to reuse when the cache is full */
+	char *scratch;
+	size_t scratch_len;
+};
+
+static pthread_key_t topo_sysfs_key;
+static pthread_once_t topo_sysfs_key_once = PTHREAD_ONCE_INIT;
+static int topo_sysfs_key_err;
+
+#ifdef WAYCA_SC_DEBUG
+/* syscalls issued by the reader, for diagnosing the init cost */
+static unsigned long topo_sysfs_nr_syscalls;
+
+static inline void topo_sysfs_count(unsigned long nr)
+{
+	__atomic_add_fetch(&topo_sysfs_nr_syscalls, nr, __ATOMIC_RELAXED);
+}
+#else
+static inline void topo_sysfs_count(unsigned long nr) { }
+#endif
+
+/* A root is used without the trailing '/', so "/" means the native one */
+static const char *topo_fs_root(const char *env, const char *def)
+{
+	const char *root = secure_getenv(env);
+	char *dup;
+	size_t len;
+
+	if (!root || !*root)
+		return def;
+
+	len = strlen(root);
+	while (len > 1 && root[len - 1] == '/')
+		len--;
+	if (len == 1 && root[0] == '/')
+		return def;
+
+	dup = strndup(root, len);
+	return dup ? dup : def;
+}
+
+static void topo_fs_init(void)
+{
+	const char *root;
+	int i;
+
+	topo_fs_sysfs = topo_fs_root("WAYCA_SC_SYSFS_ROOT", WAYCA_SC_SYSFS_ROOT);
+	topo_fs_procfs = topo_fs_root("WAYCA_SC_PROCFS_ROOT",
+				      WAYCA_SC_PROCFS_ROOT);
+
+	/* a failed path stays NULL, and topo_fs_path() uses the native one */
+	for (i = 0; i < TOPO_FS_NR_PATHS; i++) {
+		root = topo_fs_paths[i].procfs ? topo_fs_procfs : topo_fs_sysfs;
+		if (asprintf(&topo_fs_full_paths[i], "%s%s", root,
+			     topo_fs_paths[i].name) < 0)
+			topo_fs_full_paths[i] = NULL;
+	}
+}
+
+/*
+ * topo_fs_path - get the full path of a sysfs or procfs directory, which
+ * is computed once as the roots don't change in the life of the process.
+ */
+const char *topo_fs_path(enum topo_fs_path path)
+{
+	static const char *native[TOPO_FS_NR_PATHS] = {
+		[TOPO_FS_SYSDEV] = "/sys/devices",
+		[TOPO_FS_NODE] = "/sys/devices/system/node",
+		[TOPO_FS_CPU] = "/sys/devices/system/cpu",
+		[TOPO_FS_KERNEL_IRQ] = "/sys/kernel/irq",
+		[TOPO_FS_RANDOM] = "/proc/sys/kernel/random",
+		[TOPO_FS_PROC_IRQ] = "/proc/irq",
+	};
+
+	pthread_once(&topo_fs_once, topo_fs_init);
+	return topo_fs_full_paths[path] ? topo_fs_full_paths[path] :
+					  native[path];
+}
+
+const char *topo_fs_sysfs_root(void)
+{
+	pthread_once(&topo_fs_once, topo_fs_init);
+	return topo_fs_sysfs;
+}
+
+const char *topo_fs_procfs_root(void)
+{
+	pthread_once(&topo_fs_once, topo_fs_init);
+	return topo_fs_procfs;
+}
+
+/* Return true if the topology comes from the running kernel */
+bool topo_fs_is_native(void)
+{
+	return !strcmp(topo_fs_sysfs_root(), WAYCA_SC_SYSFS_ROOT) &&
+	       !strcmp(topo_fs_procfs_root(), WAYCA_SC_PROCFS_ROOT);
+}
+
+static void topo_sysfs_ctx_flush(struct topo_sysfs_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < TOPO_SYSFS_NR_DIRFDS; i++) {
+		if (!ctx->dirfds[i].path)
+			continue;
+		close(ctx->dirfds[i].fd);
+		topo_sysfs_count(1);
+		free(ctx->dirfds[i].path);
+		ctx->dirfds[i].path = NULL;
+	}
+	ctx->victim = 0;
+}
+
+static void topo_sysfs_ctx_free(void *data)
+{
+	struct topo_sysfs_ctx *ctx = data;
+
+	topo_sysfs_ctx_flush(ctx);
+	free(ctx->scratch);
+	free(ctx);
+}
+
+static void topo_sysfs_key_init(void)
+{
+	topo_sysfs_key_err = -pthread_key_create(&topo_sysfs_key,
+						 topo_sysfs_ctx_free);
+}
+
+static struct topo_sysfs_ctx *topo_sysfs_get_ctx(void)
+{
+	struct topo_sysfs_ctx *ctx;
+
+	pthread_once(&topo_sysfs_key_once, topo_sysfs_key_init);
+	if (topo_sysfs_key_err)
+		return NULL;
+
+	ctx = pthread_getspecific(topo_sysfs_key);
+	if (ctx)
+		return ctx;
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx)
+		return NULL;
+
+	/* a sysfs attribute is at most one page */
+	ctx->scratch_len = sysconf(_SC_PAGESIZE) + 1;
+	ctx->scratch = malloc(ctx->scratch_len);
+	if (!ctx->scratch || pthread_setspecific(topo_sysfs_key, ctx)) {
+		free(ctx->scratch);
+		free(ctx);
+		return NULL;
+	}
+	return ctx;
+}
+
+static uint64_t topo_sysfs_hash(const char *str)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	while (*str) {
+		hash ^= (unsigned char)*str++;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/* Return the cached fd of directory @dir, or open and cache it */
+static int topo_sysfs_ctx_dirfd(struct topo_sysfs_ctx *ctx, const char *dir)
+{
+	uint64_t hash = topo_sysfs_hash(dir);
+	struct topo_sysfs_dirfd *slot;
+	char *path;
+	int fd;
+	int i;
+
+	for (i = 0; i < TOPO_SYSFS_NR_DIRFDS; i++) {
+		slot = &ctx->dirfds[i];
+		if (slot->path && slot->hash == hash && !strcmp(slot->path, dir))
+			return slot->fd;
+	}
+
+	path = strdup(dir);
+	if (!path)
+		return -ENOMEM;
+
+	fd = open(dir, O_PATH | O_DIRECTORY | O_CLOEXEC);
+	topo_sysfs_count(1);
+	if (fd < 0) {
+		free(path);
+		return -errno;
+	}
+
+	slot = &ctx->dirfds[ctx->victim];
+	ctx->victim = (ctx->victim + 1) % TOPO_SYSFS_NR_DIRFDS;
+	if (slot->path) {
+		close(slot->fd);
+		topo_sysfs_count(1);
+		free(slot->path);
+	}
+
+	slot->hash = hash;
+	slot->path = path;
+	slot->fd = fd;
+	return fd;
+}
+
+/*
+ * Read the whole attribute @name under @dirfd into the scratch buffer,
+ * the trailing newline is removed. Both sysfs and seq_file based procfs
+ * return everything left in one read if the buffer is large enough, so a
+ * short read is taken as the end of the file.
+ *
+ * Return the length of the content, or negative on error.
+ */
+static int topo_sysfs_ctx_read(struct topo_sysfs_ctx *ctx, int dirfd,
+			       const char *name)
+{
+	size_t len = 0, new_len;
+	int tries = 0;
+	ssize_t ret;
+	char *buf;
+	int fd;
+
+	fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC);
+	topo_sysfs_count(1);
+	if (fd < 0)
+		return -errno;
+
+	while (1) {
+		ret = read(fd, ctx->scratch + len, ctx->scratch_len - len - 1);
+		topo_sysfs_count(1);
+		if (ret < 0) {
+			if ((errno == EAGAIN || errno == EINTR) &&
+			    (tries++ < WAYCA_SC_MAX_FD_RETRIES)) {
+				usleep(WAYCA_SC_USLEEP_DELAY_250MS);
+				continue;
+			}
+			ret = -errno;
+			break;
+		}
+		len += ret;
+		if (ret == 0 || len < ctx->scratch_len - 1)
+			break;
+
+		/* the buffer is full, there may be more */
+		new_len = ctx->scratch_len * 2;
+		buf = realloc(ctx->scratch, new_len);
+		if (!buf) {
+			ret = -ENOMEM;
+			break;
+		}
+		ctx->scratch = buf;
+		ctx->scratch_len = new_len;
+	}
+
+	close(fd);
+	topo_sysfs_count(1);
+	if (ret < 0)
+		return ret;
+
+	if (len > 0 && ctx->scratch[len - 1] == '\n')
+		len--;
+	ctx->scratch[len] = '\0';
+	return len;
+}
+
+/* topo_sysfs_read - read attribute @dir/@name
+ * @content: set to the content of the attribute on success, which is valid
+ *           until the next read of the calling thread
+ *
+ * Return the length of the content, or negative on error.
+ */
+int topo_sysfs_read(const char *dir, const char *name, const char **content)
+{
+	struct topo_sysfs_ctx *ctx = topo_sysfs_get_ctx();
+	int dirfd, ret;
+
+	if (!ctx)
+		return -ENOMEM;
+
+	dirfd = topo_sysfs_ctx_dirfd(ctx, dir);
+	if (dirfd < 0)
+		return dirfd;
+
+	ret = topo_sysfs_ctx_read(ctx, dirfd, name);
+	if (ret >= 0 && content)
+		*content = ctx->scratch;
+	return ret;
+}
+
+/* Return true if @dir/@name exists */
+bool topo_sysfs_exists(const char *dir, const char *name)
+{
+	struct topo_sysfs_ctx *ctx = topo_sysfs_get_ctx();
+	int dirfd;
+
+	if (!ctx)
+		return false;
+
+	dirfd = topo_sysfs_ctx_dirfd(ctx, dir);
+	if (dirfd < 0)
+		return false;
+
+	topo_sysfs_count(1);
+	return !faccessat(dirfd, name, F_OK, 0);
+}
+
+static int topo_sysfs_parse_s32(const char *str, int *val)
+{
+	char *end;
+	long t;
+
+	errno = 0;
+	t = strtol(str, &end, 10);
+	if (errno || end == str || t < INT32_MIN || t > INT32_MAX)
+		return -EINVAL;
+
+	*val = t;
+	return 0;
+}
+
+static int topo_sysfs_parse_hex(const char *str, unsigned long max,
+				unsigned long *val)
+{
+	char *end;
+
+	errno = 0;
+	*val = strtoul(str, &end, 16);
+	if (errno || end == str || *val > max)
+		return -EINVAL;
+	return 0;
+}
+
+/* Copy @content into @str of @len bytes, truncate if it's too long */
+static void topo_sysfs_copy_str(char *str, size_t len, const char *content)
+{
+	if (!len)
+		return;
+
+	strncpy(str, content, len - 1);
+	str[len - 1] = '\0';
+}
+
+/* return negative on error, 0 on success */
+int topo_sysfs_read_s32(const char *dir, const char *name, int *val)
+{
+	const char *content;
+	int ret, t;
+
+	ret = topo_sysfs_read(dir, name, &content);
+	if (ret < 0)
+		return ret;
+
+	ret = topo_sysfs_parse_s32(content, &t);
+	if (!ret && val)
+		*val = t;
+	return ret;
+}
+
+/*
+ * topo_sysfs_read_s32_array - read @nmemb integers separated by white
+ * spaces into the pre-allocated @array
+ *
+ * return negative on error, 0 on success
+ */
+int topo_sysfs_read_s32_array(const char *dir, const char *name, size_t nmemb,
+			      int array[])
+{
+	const char *content;
+	char *end;
+	long t;
+	int ret;
+	int i;
+
+	ret = topo_sysfs_read(dir, name, &content);
+	if (ret < 0)
+		return ret;
+
+	for (i = 0; i < nmemb; i++) {
+		errno = 0;
+		t = strtol(content, &end, 10);
+		if (errno || end == content || t < INT32_MIN || t > INT32_MAX)
+			return -EINVAL;
+		array[i] = t;
+		content = end;
+	}
+	return 0;
+}
+
+/*
+ * topo_sysfs_read_str - read the attribute into @str of @len bytes, the
+ * trailing newline is removed and @str is emptied on failure
+ *
+ * Return the length of the attribute, or negative on error.
+ */
+int topo_sysfs_read_str(const char *dir, const char *name, char *str,
+			size_t len)
+{
+	const char *content;
+	int ret;
+
+	ret = topo_sysfs_read(dir, name, &content);
+	if (ret < 0) {
+		if (len)
+			str[0] = '\0';
+		return ret;
+	}
+
+	topo_sysfs_copy_str(str, len, content);
+	return ret;
+}
+
+/*
+ * topo_sysfs_read_cpulist - read a CPU list like "0-3,8" into @set
+ * @setsize: size of @set in bytes
+ *
+ * return negative on error, 0 on success
+ */
+int topo_sysfs_read_cpulist(const char *dir, const char *name, cpu_set_t *set,
+			    size_t setsize)
+{
+	const char *content;
+	int ret;
+
+	ret = topo_sysfs_read(dir, name, &content);
+	if (ret < 0)
+		return ret;
+
+	if (cpulist_parse(content, set, setsize, 0))
+		return -EINVAL;
+	return 0;
+}
+
+/*
+ * topo_sysfs_read_attrs - read several attributes of directory @dir
+ *
+ * The directory is looked up once for all the @n attributes. The result
+ * of each attribute is stored into its ->ret, and the destination is left
+ * untouched if the attribute failed to be read or parsed.
+ *
+ * Return 0 if all the attributes are read, otherwise the first error.
+ */
+int topo_sysfs_read_attrs(const char *dir, struct topo_sysfs_attr *attrs,
+			  size_t n)
+{
+	struct topo_sysfs_ctx *ctx = topo_sysfs_get_ctx();
+	struct topo_sysfs_attr *attr;
+	unsigned long hex;
+	int dirfd, ret;
+	int first = 0;
+	int i;
+
+	if (!ctx)
+		return -ENOMEM;
+
+	dirfd = topo_sysfs_ctx_dirfd(ctx, dir);
+	for (i = 0; i < n; i++) {
+		attr = &attrs[i];
+		attr->ret = dirfd < 0 ? dirfd : topo_sysfs_ctx_read(ctx, dirfd,
+								    attr->name);
+		if (attr->ret < 0)
+			goto next;
+
+		ret = 0;
+		switch (attr->type) {
+		case TOPO_SYSFS_S32:
+			ret = topo_sysfs_parse_s32(ctx->scratch, attr->val);
+			break;
+		case TOPO_SYSFS_HEX32:
+			ret = topo_sysfs_parse_hex(ctx->scratch, UINT32_MAX, &hex);
+			if (!ret)
+				*(uint32_t *)attr->val = hex;
+			break;
+		case TOPO_SYSFS_HEX16:
+			ret = topo_sysfs_parse_hex(ctx->scratch, UINT16_MAX, &hex);
+			if (!ret)
+				*(uint16_t *)attr->val = hex;
+			break;
+		case TOPO_SYSFS_STR:
+			topo_sysfs_copy_str(attr->val, attr->len, ctx->scratch);
+			break;
+		case TOPO_SYSFS_CPULIST:
+			if (cpulist_parse(ctx->scratch, attr->val, attr->len, 0))
+				ret = -EINVAL;
+			break;
+		default:
+			ret = -EINVAL;
+		}
+		attr->ret = ret ? ret : attr->ret;
+next:
+		if (attr->ret < 0 && !first)
+			first = attr->ret;
+	}
+	return first;
+}
+
+/*
+ * topo_sysfs_flush - close the directory fds cached by the calling thread,
+ * called when a topology phase is loaded to not hold the fds for the whole
+ * life of the process.
+ */
+void topo_sysfs_flush(void)
+{
+	struct topo_sysfs_ctx *ctx;
+
+	pthread_once(&topo_sysfs_key_once, topo_sysfs_key_init);
+	if (topo_sysfs_key_err)
+		return;
+
+	ctx = pthread_getspecific(topo_sysfs_key);
+	if (ctx)
+		topo_sysfs_ctx_flush(ctx);
+}
+
+#ifdef WAYCA_SC_DEBUG
+unsigned long WAYCA_SC_DECLSPEC wayca_sc_topo_sysfs_syscalls(void)
+{
+	return __atomic_load_n(&topo_sysfs_nr_syscalls, __ATOMIC_RELAXED);
+}
+#endif /* WAYCA_SC_DEBUG */
@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2021 HiSilicon Technologies Co., Ltd.
+ * Wayca scheduler is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ *
+ * See the Mulan PSL v2 for more details.
+ */
+
+/* topo_walk.c - I/O device discovery under /sys/devices
+ *
+ * The first two levels of the tree are listed by the calling thread and
+ * every subtree below them becomes a work item. The items are walked by a
+ * few worker threads with openat()/fdopendir(), without touching the
+ * working directory of the process. The devices found are merged by the
+ * calling thread in the order of a sequential depth-first walk, so the
+ * result doesn't depend on the scheduling of the workers.
+ */
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "common.h"
+#include "topo.h"
+
+#define TOPO_WALK_MAX_THREADS	8	/* maximum number of walkers */
+#define TOPO_WALK_SPLIT_DEPTH	2	/* depth of the subtrees handed out */
+#define TOPO_WALK_MAX_DEPTH	64	/* subtrees deeper than this are skipped */
+
+struct topo_walk_item {
+	char *path;		/* directory of this item */
+	bool recursive;		/* false if only the directory itself is a device */
+	void **devs;		/* devices found, in the walk order */
+	size_t n_devs;
+	size_t max_devs;
+	int ret;
+};
+
+struct topo_walk {
+	const struct topo_walk_ops *ops;
+	struct topo_walk_item *items;
+	size_t n_items;
+	size_t max_items;
+	size_t next_item;	/* next item to walk, taken atomically */
+};
+
+/* top level directories which never hold a PCI device or an SMMU */
+static const char *const topo_walk_pruned_roots[] = {
+	"system", "virtual", "software", "breakpoint", "tracepoint",
+	"kprobe", "uprobe",
+};
+
+/* directories of a device which never hold another device */
+static const char *const topo_walk_pruned_dirs[] = {
+	"power", "msi_irqs", "holders", "slaves", "queues", "statistics", "mq",
+};
+
+static bool topo_walk_is_pruned(const char *name, int depth)
+{
+	int i;
+
+	if (depth == 0) {
+		for (i = 0; i < ARRAY_SIZE(topo_walk_pruned_roots); i++)
+			if (!strcmp(name, topo_walk_pruned_roots[i]))
+				return true;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(topo_walk_pruned_dirs); i++)
+		if (!strcmp(name, topo_walk_pruned_dirs[i]))
+			return true;
+	return false;
+}
+
+/* Return DT_DIR, DT_REG, or DT_UNKNOWN for anything else including symlinks */
+static unsigned char topo_walk_entry_type(DIR *dp, const struct dirent *entry)
+{
+	struct stat statbuf;
+
+	if (entry->d_type != DT_UNKNOWN)
+		return entry->d_type == DT_DIR || entry->d_type == DT_REG ?
+			entry->d_type : DT_UNKNOWN;
+
+	if (fstatat(dirfd(dp), entry->d_name, &statbuf, AT_SYMLINK_NOFOLLOW))
+		return DT_UNKNOWN;
+	if (S_ISDIR(statbuf.st_mode))
+		return DT_DIR;
+	return S_ISREG(statbuf.st_mode) ? DT_REG : DT_UNKNOWN;
+}
+
+static DIR *topo_walk_opendir(int parent_fd, const char *name)
+{
+	DIR *dp;
+	int fd;
+
+	fd = openat(parent_fd, name,
+		    O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	dp = fdopendir(fd);
+	if (!dp)
+		close(fd);
+	return dp;
+}
+
+static bool topo_walk_skip_entry(const struct dirent *entry)
+{
+	return !strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..");
+}
+
+/*
+ * TODO: We rely on 'numa_node' to represent a legitimate i/o device.
+ * However 'numa_node' exists only when NUMA is enabled in kernel. So, we
+ * Need to consider a better idea of identifying i/o device.
+ */
+static bool topo_walk_is_device_attr(const struct dirent *entry,
+				     unsigned char type)
+{
+	return type == DT_REG && !strcmp(entry->d_name, "numa_node");
+}
+
+static int topo_walk_add_item(struct topo_walk *walk, const char *path,
+			      bool recursive)
+{
+	struct topo_walk_item *items;
+	size_t max_items;
+
+	if (walk->n_items == walk->max_items) {
+		max_items = walk->max_items ? walk->max_items * 2 : 64;
+		items = realloc(walk->items, max_items * sizeof(*items));
+		if (!items)
+			return -ENOMEM;
+		walk->items = items;
+		walk->max_items = max_items;
+	}
+
+	items = &walk->items[walk->n_items];
+	memset(items, 0, sizeof(*items));
+	items->recursive = recursive;
+	items->path = strdup(path);
+	if (!items->path)
+		return -ENOMEM;
+	walk->n_items++;
+	return 0;
+}
+
+/*
+ * List the top levels of the tree into work items, in the order the
+ * sequential walk would visit them: a subdirectory at TOPO_WALK_SPLIT_DEPTH
+ * becomes a recursive item, and a device found above it an item of itself.
+ */
+static int topo_walk_split(struct topo_walk *walk, DIR *dp, char *path,
+			   size_t len, int depth)
+{
+	struct dirent *entry;
+	unsigned char type;
+	DIR *child;
+	int ret = 0;
+
+	while (!ret && (entry = readdir(dp)) != NULL) {
+		if (topo_walk_skip_entry(entry))
+			continue;
+
+		type = topo_walk_entry_type(dp, entry);
+		if (topo_walk_is_device_attr(entry, type)) {
+			path[len] = '\0';
+			ret = topo_walk_add_item(walk, path, false);
+			continue;
+		}
+
+		if (type != DT_DIR || topo_walk_is_pruned(entry->d_name, depth))
+			continue;
+
+		if (snprintf(path + len, WAYCA_SC_PATH_LEN_MAX - len, "/%s",
+			     entry->d_name) >= WAYCA_SC_PATH_LEN_MAX - len)
+			continue;
+
+		if (depth + 1 == TOPO_WALK_SPLIT_DEPTH) {
+			ret = topo_walk_add_item(walk, path, true);
+			continue;
+		}
+
+		child = topo_walk_opendir(dirfd(dp), entry->d_name);
+		if (!child)
+			continue;
+		ret = topo_walk_split(walk, child, path, strlen(path), depth + 1);
+		closedir(child);
+	}
+
+	path[len] = '\0';
+	return ret;
+}
+
+static int topo_walk_found(struct topo_walk *walk, struct topo_walk_item *item,
+			   const char *dir)
+{
+	size_t max_devs;
+	void **devs;
+	void *dev;
+
+	dev = walk->ops->parse(dir, walk->ops->data);
+	if (!dev)
+		return 0;
+
+	if (item->n_devs == item->max_devs) {
+		max_devs = item->max_devs ? item->max_devs * 2 : 8;
+		devs = realloc(item->devs, max_devs * sizeof(*devs));
+		if (!devs) {
+			walk->ops->free(dev);
+			return -ENOMEM;
+		}
+		item->devs = devs;
+		item->max_devs = max_devs;
+	}
+	item->devs[item->n_devs++] = dev;
+	return 0;
+}
+
+/* Walk the subtree of @item depth-first without recursion */
+static int topo_walk_tree(struct topo_walk *walk, struct topo_walk_item *item)
+{
+	size_t lens[TOPO_WALK_MAX_DEPTH];
+	DIR *stack[TOPO_WALK_MAX_DEPTH];
+	char path[WAYCA_SC_PATH_LEN_MAX];
+	struct dirent *entry;
+	unsigned char type;
+	int depth = 0;
+	size_t len;
+	int ret = 0;
+	DIR *dp;
+
+	len = strlen(item->path);
+	if (len >= sizeof(path))
+		return 0;
+	memcpy(path, item->path, len + 1);
+
+	stack[0] = opendir(path);
+	if (!stack[0])
+		return 0;
+	lens[0] = len;
+
+	while (depth >= 0) {
+		dp = stack[depth];
+		entry = ret ? NULL : readdir(dp);
+		if (!entry) {
+			closedir(dp);
+			depth--;
+			continue;
+		}
+
+		if (topo_walk_skip_entry(entry))
+			continue;
+
+		len = lens[depth];
+		path[len] = '\0';
+		type = topo_walk_entry_type(dp, entry);
+		if (topo_walk_is_device_attr(entry, type)) {
+			ret = topo_walk_found(walk, item, path);
+			continue;
+		}
+
+		if (type != DT_DIR || depth + 1 == TOPO_WALK_MAX_DEPTH ||
+		    topo_walk_is_pruned(entry->d_name, -1))
+			continue;
+
+		if (snprintf(path + len, sizeof(path) - len, "/%s",
+			     entry->d_name) >= sizeof(path) - len)
+			continue;
+
+		dp = topo_walk_opendir(dirfd(dp), entry->d_name);
+		if (!dp)
+			continue;
+		stack[++depth] = dp;
+		lens[depth] = strlen(path);
+	}
+	return ret;
+}
+
+static void *topo_walk_worker(void *data)
+{
+	struct topo_walk *walk = data;
+	struct topo_walk_item *item;
+	size_t i;
+
+	while (1) {
+		i = __atomic_fetch_add(&walk->next_item, 1, __ATOMIC_RELAXED);
+		if (i >= walk->n_items)
+			break;
+
+		item = &walk->items[i];
+		if (item->recursive)
+			item->ret = topo_walk_tree(walk, item);
+		else
+			item->ret = topo_walk_found(walk, item, item->path);
+	}
+	return NULL;
+}
+
+static size_t topo_walk_nr_threads(struct topo_walk *walk)
+{
+	long nr = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (nr < 1)
+		nr = 1;
+	return min(min((size_t)nr, TOPO_WALK_MAX_THREADS), walk->n_items);
+}
+
+/* Run the workers, the calling thread is one of them */
+static void topo_walk_run(struct topo_walk *walk)
+{
+	pthread_t threads[TOPO_WALK_MAX_THREADS];
+	size_t nr_threads = topo_walk_nr_threads(walk);
+	sigset_t set, oldset;
+	size_t i, started;
+
+	/* signals of the host process are not for the workers */
+	sigfillset(&set);
+	pthread_sigmask(SIG_SETMASK, &set, &oldset);
+	for (started = 0; started + 1 < nr_threads; started++)
+		if (pthread_create(&threads[started], NULL, topo_walk_worker,
+				   walk))
+			break;
+	pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+
+	topo_walk_worker(walk);
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+}
+
+/*
+ * topo_walk_devices - find the I/O devices under @root
+ *
+ * @ops->parse is called on the worker threads for every device directory,
+ * and must only read the topology. The devices it returns are passed to
+ * @ops->add on the calling thread in the order of a depth-first walk, or
+ * to @ops->free if the walk fails.
+ *
+ * Return negative on error, 0 on success.
+ */
+int topo_walk_devices(const char *root, const struct topo_walk_ops *ops)
+{
+	char path[WAYCA_SC_PATH_LEN_MAX];
+	struct topo_walk walk = {
+		.ops = ops,
+	};
+	struct topo_walk_item *item;
+	size_t i, j;
+	int ret;
+	DIR *dp;
+
+	if (strlen(root) >= sizeof(path))
+		return -ENAMETOOLONG;
+	strcpy(path, root);
+
+	dp = opendir(root);
+	if (!dp)
+		return -errno;
+	ret = topo_walk_split(&walk, dp, path, strlen(path), 0);
+	closedir(dp);
+
+	if (!ret)
+		topo_walk_run(&walk);
+
+	for (i = 0; i < walk.n_items; i++) {
+		item = &walk.items[i];
+		if (!ret && item->ret)
+			ret = item->ret;
+	}
+
+	for (i = 0; i < walk.n_items; i++) {
+		item = &walk.items[i];
+		for (j = 0; j < item->n_devs; j++) {
+			if (ret)
+				ops->free(item->devs[j]);
+			else
+				ret = ops->add(item->devs[j], ops->data);
+		}
+		free(item->devs);
+		free(item->path);
+	}
+	free(walk.items);
+	return ret;
+}
@@ -20,6 +20,7 @@
 
 #include "common.h"
 #include "bitops.h"
+#include "cpumask.h"
 #include "wayca-scheduler.h"
 
 static inline int thread_sched_setaffinity(pid_t pid, size_t cpusetsize,
@@ -48,11 +49,116 @@ static inline pid_t thread_sched_gettid(void)
 	return ret < 0 ? -errno : ret;
 }
 
-/* CPU set of all the cpus in the system */
-extern cpu_set_t total_cpu_set;
+/* CPU set of all the cpus in the system, a cpumask */
+extern cpu_set_t *total_cpu_set;
+/*
+ * The load of a cpu. Each one takes a cache line of its own, so the
+ * threads updating the loads of different cpus don't contend.
+ */
+struct wayca_cpu_load {
+	/* of the wayca threads which may run on the cpu */
+	long long load;
+	/* of the busy time of the cpu by any task, see cpu_util.c */
+	long long util;
+	/* the busy load summed up in the load tree, see load_tree.c */
+	long long busy;
+} __attribute__((aligned(WAYCA_SC_CACHELINE_SIZE)));
+
 /* Load Array of each cpu, length is cores_in_total() */
-extern long long *wayca_cpu_loads;
-extern pthread_mutex_t wayca_cpu_loads_mutex;
+extern struct wayca_cpu_load *wayca_cpu_loads;
+
+/* The loads are read without a lock, a search may see them change */
+static inline long long wayca_cpu_load(int cpu)
+{
+	return __atomic_load_n(&wayca_cpu_loads[cpu].load, __ATOMIC_RELAXED);
+}
+
+/*
+ * The load of @cpu to place the threads by. The utilization counts the
+ * wayca threads running on @cpu too, so it's not added to the load.
+ */
+static inline long long wayca_cpu_busy_load(int cpu)
+{
+	long long load = wayca_cpu_load(cpu);
+	long long util = __atomic_load_n(&wayca_cpu_loads[cpu].util,
+					 __ATOMIC_RELAXED);
+
+	return max(load, util);
+}
+
+/* Sample the utilization of the cpus into their loads */
+void wayca_cpu_util_init(void);
+void wayca_cpu_util_exit(void);
+void wayca_cpu_util_update(void);
+
+/* The capacity of @cpu, the default scale if the kernel doesn't know */
+long long wayca_cpu_capacity(int cpu);
+
+/*
+ * The loads summed up by the cores, clusters, nodes and packages, to find
+ * the idlest set by descending the topology. The per-cpu loads are only
+ * updated through the tree. See load_tree.c.
+ */
+void wayca_load_tree_init(const cpu_set_t *cpuset);
+void wayca_load_tree_exit(void);
+void wayca_load_tree_sync(void);
+void wayca_cpu_load_add(const cpu_set_t *cpus, long long load);
+void wayca_cpu_util_set(int cpu, long long util);
+int wayca_load_tree_idlest(int level, const cpu_set_t *cpuset,
+			   cpu_set_t *domain);
+int wayca_load_tree_incomplete(int level, const cpu_set_t *total,
+			       const cpu_set_t *cpuset);
+
+/*
+ * The table mapping the ids to the wayca threads, groups or threadpools.
+ * An id is the slot in the low bits and its generation in the high bits.
+ * See id_table.c.
+ */
+#define WAYCA_ID_GEN_SHIFT	32
+#define WAYCA_ID_SLOT_MASK	((1ULL << WAYCA_ID_GEN_SHIFT) - 1)
+
+struct wayca_id_table {
+	/* The published objects, read without the lock */
+	void **objs;
+	/* The generation of each slot, bumped when it's freed */
+	unsigned int *gens;
+	/* The free slots, and the words of @free_slots with free slots */
+	unsigned long *free_slots;
+	unsigned long *free_words;
+	size_t size;
+	/* The mutex to serialize the allocation and the freeing */
+	pthread_mutex_t mutex;
+};
+
+int wayca_id_table_init(struct wayca_id_table *table, size_t size);
+void wayca_id_table_exit(struct wayca_id_table *table);
+int wayca_id_get(struct wayca_id_table *table, unsigned long long *id);
+void wayca_id_publish(struct wayca_id_table *table, unsigned long long id,
+		      void *obj);
+void wayca_id_put(struct wayca_id_table *table, unsigned long long id);
+
+/*
+ * Find the object published with @id, NULL if @id is invalid or stale.
+ * The generation is checked again after loading the object, as the slot
+ * may be freed and reused in between.
+ */
+static inline void *wayca_id_lookup(struct wayca_id_table *table,
+				    unsigned long long id)
+{
+	unsigned long long slot = id & WAYCA_ID_SLOT_MASK;
+	unsigned int gen = id >> WAYCA_ID_GEN_SHIFT;
+	void *obj;
+
+	if (slot >= table->size ||
+	    __atomic_load_n(&table->gens[slot], __ATOMIC_ACQUIRE) != gen)
+		return NULL;
+
+	obj = __atomic_load_n(&table->objs[slot], __ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&table->gens[slot], __ATOMIC_ACQUIRE) != gen)
+		return NULL;
+
+	return obj;
+}
 
 struct wayca_thread {
 	/* Wayca thread id which is identity to this thread */
@@ -62,10 +168,11 @@ struct wayca_thread {
 	/* Wayca thread attribute */
 	wayca_sc_thread_attr_t attribute;
 	size_t target_pos;
-	cpu_set_t cur_set;
-	cpu_set_t allowed_set;
-	/* Siblings of this wayca thread in the same group, NULL terminated */
-	struct wayca_thread *siblings;
+	/* cpumasks allocated along with this structure */
+	cpu_set_t *cur_set;
+	cpu_set_t *allowed_set;
+	/* Previous and next wayca threads in the same group */
+	struct wayca_thread *prev, *next;
 	/* Wayca group this thread directly belongs to */
 	struct wayca_sc_group *group;
 
@@ -88,28 +195,28 @@ struct wayca_thread {
 struct wayca_sc_group {
 	/* Wayca group id which is identity to this group */
 	wayca_sc_group_t id;
-	/* The threads list in this group */
-	struct wayca_thread *threads;
+	/* The threads list in this group, the first and the last */
+	struct wayca_thread *threads, *threads_tail;
 	/* The number of the threads in this group */
 	int nr_threads;
-	/* The sibling groups, NULL terminated */
-	struct wayca_sc_group *siblings;
+	/* Previous and next groups in the same father */
+	struct wayca_sc_group *prev, *next;
 	/* The father of this group, NULL means the toppest level */
 	struct wayca_sc_group *father;
-	/* The groups in this group */
-	struct wayca_sc_group *groups;
+	/* The groups in this group, the first and the last */
+	struct wayca_sc_group *groups, *groups_tail;
 	/* The number of the groups in this group */
 	int nr_groups;
 	/**
 	 * The cpuset of which has thread scheduled on.
 	 * The set bit means it's occupied.
 	 */
-	cpu_set_t used;
+	cpu_set_t *used;
 	/**
 	 * The cpuset this group owns.
 	 * The set bit means it canbe used by this group.
 	 */
-	cpu_set_t total;
+	cpu_set_t *total;
 	/* The attribute specify the arrangement strategy of this group */
 	wayca_sc_group_attr_t attribute;
 	/* The mutex to protect this data structure */
@@ -125,10 +232,10 @@ struct wayca_sc_group {
 };
 
 #define group_for_each_threads(thread, group)	\
-	for (thread = group->threads; thread != NULL; thread = thread->siblings)
+	for (thread = group->threads; thread != NULL; thread = thread->next)
 
 #define group_for_each_groups(group, father)	\
-	for (group = father->groups; group != NULL; group = group->siblings)
+	for (group = father->groups; group != NULL; group = group->next)
 
 /* Do the initialization work for a new create group */
 int wayca_group_init(struct wayca_sc_group *group);
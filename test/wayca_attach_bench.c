@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2021 HiSilicon Technologies Co., Ltd.
+ * Wayca scheduler is licensed under Mulan PSL v2.
+ * You can use this software according to the terms and conditions of the Mulan PSL v2.
+ * You may obtain a copy of Mulan PSL v2 at:
+ *          http://license.coscl.org.cn/MulanPSL2
+ * THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+ * EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+ * MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+ *
+ * See the Mulan PSL v2 for more details.
+ */
+
+/* wayca_attach_bench.c - throughput of the concurrent group attaching
+ *
+ * Each worker attaches itself as a wayca thread, then attaches it to and
+ * detaches it from a group of its own in a loop, so the workers only
+ * share the per-CPU load accounting and the topology. The number of the
+ * workers and the loops can be set by WAYCA_TEST_BENCH_THREADS and
+ * WAYCA_TEST_BENCH_LOOPS.
+ */
+
+#define _GNU_SOURCE
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <wayca-scheduler.h>
+
+static int bench_threads = 8;
+static int bench_loops = 10000;
+static pthread_barrier_t bench_barrier;
+
+static void read_env(const char *name, int *val)
+{
+	char *p = getenv(name);
+
+	if (p && atoi(p) > 0)
+		*val = atoi(p);
+}
+
+static double now_sec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *bench_worker(void *private)
+{
+	wayca_sc_group_t *group = private;
+	wayca_sc_thread_t wthread;
+	int i, ret;
+
+	ret = wayca_sc_pid_attach_thread(&wthread, 0);
+	assert(ret == 0);
+
+	pthread_barrier_wait(&bench_barrier);
+	for (i = 0; i < bench_loops; i++) {
+		ret = wayca_sc_thread_attach_group(wthread, *group);
+		assert(ret == 0);
+		ret = wayca_sc_thread_detach_group(wthread, *group);
+		assert(ret == 0);
+	}
+	pthread_barrier_wait(&bench_barrier);
+
+	ret = wayca_sc_pid_detach_thread(wthread);
+	assert(ret == 0);
+	return NULL;
+}
+
+int main(void)
+{
+	wayca_sc_group_t *groups;
+	pthread_t *workers;
+	double start, elapsed;
+	int i, ret;
+
+	read_env("WAYCA_TEST_BENCH_THREADS", &bench_threads);
+	read_env("WAYCA_TEST_BENCH_LOOPS", &bench_loops);
+
+	groups = calloc(bench_threads, sizeof(*groups));
+	workers = calloc(bench_threads, sizeof(*workers));
+	assert(groups && workers);
+
+	for (i = 0; i < bench_threads; i++) {
+		ret = wayca_sc_group_create(&groups[i]);
+		assert(ret == 0);
+	}
+
+	/* the main thread starts and stops the clock along with the workers */
+	ret = pthread_barrier_init(&bench_barrier, NULL, bench_threads + 1);
+	assert(ret == 0);
+	for (i = 0; i < bench_threads; i++) {
+		ret = pthread_create(&workers[i], NULL, bench_worker,
+				     &groups[i]);
+		assert(ret == 0);
+	}
+
+	pthread_barrier_wait(&bench_barrier);
+	start = now_sec();
+	pthread_barrier_wait(&bench_barrier);
+	elapsed = now_sec() - start;
+
+	for (i = 0; i < bench_threads; i++)
+		pthread_join(workers[i], NULL);
+
+	printf("%d threads x %d attach/detach: %.3f s, %.0f attaches/s\n",
+	       bench_threads, bench_loops, elapsed,
+	       (double)bench_threads * bench_loops / elapsed);
+
+	for (i = 0; i < bench_threads; i++) {
+		ret = wayca_sc_group_destroy(groups[i]);
+		assert(ret == 0);
+	}
+	pthread_barrier_destroy(&bench_barrier);
+	free(workers);
+	free(groups);
+	return 0;
+}
@@ -12,6 +12,7 @@
  */
 
 #define _GNU_SOURCE
+#include <assert.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -79,7 +80,7 @@ void *thread_func(void *private)
 }
 
 const char *topo_level[] = {
-	"CPU", "CCL", "NUMA", "PACKAGE",
+	"CPU", "CCL", "NUMA", "PACKAGE", "CORE",
 };
 
 void readEnv(void)
@@ -118,6 +119,8 @@ void readEnv(void)
 		perCcl_attr |= WT_GF_NUMA;
 	else if (!strcmp(p, topo_level[3]))
 		perCcl_attr |= WT_GF_PACKAGE;
+	else if (!strcmp(p, topo_level[4]))
+		perCcl_attr |= WT_GF_CORE;
 	else
 		perCcl_attr |= WT_GF_CCL;
 
@@ -128,7 +131,698 @@ void readEnv(void)
 	p = getenv("WAYCA_TEST_THREAD_COMPACT");
 	if (p)
 		perCcl_attr |= WT_GF_COMPACT;
+
+	p = getenv("WAYCA_TEST_THREAD_CORE_FIRST");
+	if (p)
+		perCcl_attr |= WT_GF_CORE_FIRST;
+}
+
+/* The id of a destroyed group must not reach the group reusing its slot */
+static void test_stale_group_id(void)
+{
+	wayca_sc_group_t stale, group;
+	wayca_sc_group_attr_t attr;
+
+	assert(!wayca_sc_group_create(&stale));
+	assert(!wayca_sc_group_destroy(stale));
+	assert(!wayca_sc_group_create(&group));
+
+	assert(group != stale);
+	assert(wayca_sc_group_get_attr(stale, &attr) == -EINVAL);
+	assert(wayca_sc_group_destroy(stale) == -EINVAL);
+	assert(!wayca_sc_group_get_attr(group, &attr));
+	assert(!wayca_sc_group_destroy(group));
+}
+
+#ifdef WAYCA_SC_DEBUG
+static volatile bool test_quit;
+
+static void *test_thread_func(void *private)
+{
+	while (!test_quit)
+		usleep(1000);
+
+	return NULL;
+}
+
+/* Create a thread and attach it to @group, where it's placed at once */
+static wayca_sc_thread_t test_thread_start(wayca_sc_group_t group)
+{
+	wayca_sc_thread_t thread;
+
+	assert(!wayca_sc_thread_create(&thread, NULL, test_thread_func, NULL));
+	assert(!wayca_sc_thread_attach_group(thread, group));
+	return thread;
+}
+
+static void test_group_stop(wayca_sc_group_t group,
+			    wayca_sc_thread_t *members, int n)
+{
+	test_quit = true;
+	for (int i = 0; i < n; i++) {
+		assert(!wayca_sc_thread_detach_group(members[i], group));
+		assert(!wayca_sc_thread_join(members[i], NULL));
+	}
+	assert(!wayca_sc_group_destroy(group));
+	test_quit = false;
+}
+
+/*
+ * The cpus of the topology set at the level of @attr that @cpu is in,
+ * or the @cpu itself if it has no topology, e.g. it's offline
+ */
+static void test_topo_set(wayca_sc_group_attr_t attr, int cpu, size_t setsize,
+			  cpu_set_t *set)
+{
+	int ret;
+
+	switch (attr & 0xffff) {
+	case WT_GF_CORE:
+		ret = wayca_sc_core_cpu_mask(wayca_sc_get_core_id(cpu),
+					     setsize, set);
+		break;
+	case WT_GF_CCL:
+		ret = wayca_sc_ccl_cpu_mask(wayca_sc_get_ccl_id(cpu),
+					    setsize, set);
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	if (ret || !CPU_ISSET_S(cpu, setsize, set)) {
+		CPU_ZERO_S(setsize, set);
+		CPU_SET_S(cpu, setsize, set);
+	}
+}
+
+/*
+ * The order a compact group takes the cpus of @total in: the sets in
+ * the order of their first cpu, each of them filled in cpu order.
+ */
+static int test_compact_order(wayca_sc_group_attr_t attr, size_t setsize,
+			      cpu_set_t *total, int *order)
+{
+	int nr_cpus = wayca_sc_cpus_in_total();
+	cpu_set_t *visited = CPU_ALLOC(nr_cpus);
+	cpu_set_t *tset = CPU_ALLOC(nr_cpus);
+	int cpu, i, n = 0;
+
+	CPU_ZERO_S(setsize, visited);
+	for (cpu = 0; cpu < nr_cpus; cpu++) {
+		if (!CPU_ISSET_S(cpu, setsize, total) ||
+		    CPU_ISSET_S(cpu, setsize, visited))
+			continue;
+
+		test_topo_set(attr, cpu, setsize, tset);
+		CPU_AND_S(setsize, tset, tset, total);
+		CPU_OR_S(setsize, visited, visited, tset);
+		for (i = cpu; i < nr_cpus; i++)
+			if (CPU_ISSET_S(i, setsize, tset))
+				order[n++] = i;
+	}
+
+	CPU_FREE(visited);
+	CPU_FREE(tset);
+	return n;
+}
+
+/*
+ * Place the threads one by one in a group of @attr, and check that the
+ * i-th of them lands on @order[i], or on its set if not bound per-CPU.
+ */
+static void test_group_order(wayca_sc_group_attr_t attr, const int *order,
+			     int n)
+{
+	int nr_cpus = wayca_sc_cpus_in_total();
+	size_t setsize = CPU_ALLOC_SIZE(nr_cpus);
+	cpu_set_t *set = CPU_ALLOC(nr_cpus);
+	cpu_set_t *expect = CPU_ALLOC(nr_cpus);
+	wayca_sc_thread_t *members;
+	wayca_sc_group_t group;
+
+	members = calloc(n, sizeof(*members));
+	assert(members);
+	assert(!wayca_sc_group_create(&group));
+	assert(!wayca_sc_group_set_attr(group, &attr));
+
+	for (int i = 0; i < n; i++) {
+		members[i] = test_thread_start(group);
+		assert(!wayca_sc_thread_get_cpuset(members[i], setsize, set));
+
+		if (attr & WT_GF_PERCPU)
+			test_topo_set(WT_GF_CPU, order[i], setsize, expect);
+		else
+			test_topo_set(attr, order[i], setsize, expect);
+		assert(CPU_EQUAL_S(setsize, set, expect));
+	}
+
+	test_group_stop(group, members, n);
+	free(members);
+	CPU_FREE(set);
+	CPU_FREE(expect);
+}
+
+/*
+ * The compact groups fill a set before moving to the next one, as the
+ * table of the group attributes in wayca-scheduler.h shows. The check
+ * needs a fake topology, as the placement follows the load on the host.
+ */
+static void test_compact_placement(void)
+{
+	wayca_sc_group_attr_t attrs[] = {
+		WT_GF_CPU | WT_GF_PERCPU | WT_GF_COMPACT,
+		WT_GF_CORE | WT_GF_COMPACT,
+		WT_GF_CCL | WT_GF_COMPACT,
+		WT_GF_CCL | WT_GF_PERCPU | WT_GF_COMPACT,
+	};
+	int nr_cpus = wayca_sc_cpus_in_total();
+	size_t setsize = CPU_ALLOC_SIZE(nr_cpus);
+	cpu_set_t *total = CPU_ALLOC(nr_cpus);
+	int *order = calloc(nr_cpus, sizeof(*order));
+	wayca_sc_group_t group;
+	int n;
+
+	if (!getenv("WAYCA_SC_SYSFS_ROOT"))
+		goto out;
+
+	assert(order);
+	for (size_t i = 0; i < sizeof(attrs) / sizeof(attrs[0]); i++) {
+		assert(!wayca_sc_group_create(&group));
+		assert(!wayca_sc_group_set_attr(group, &attrs[i]));
+		assert(!wayca_sc_group_get_cpuset(group, setsize, total));
+		assert(!wayca_sc_group_destroy(group));
+
+		n = test_compact_order(attrs[i], setsize, total, order);
+		test_group_order(attrs[i], order, n < 24 ? n : 24);
+	}
+
+out:
+	free(order);
+	CPU_FREE(total);
+}
+
+/*
+ * The order a compact group with WT_GF_CORE_FIRST takes the cpus of
+ * @total in: one cpu of each core in cpu order, then the next one of
+ * each core, and so on, so the SMT siblings are taken at last.
+ */
+static int test_core_first_order(size_t setsize, cpu_set_t *total, int *order)
+{
+	int nr_cpus = wayca_sc_cpus_in_total();
+	cpu_set_t *taken = CPU_ALLOC(nr_cpus);
+	cpu_set_t *cores = CPU_ALLOC(nr_cpus);
+	cpu_set_t *tset = CPU_ALLOC(nr_cpus);
+	int cpu, n = 0;
+
+	CPU_ZERO_S(setsize, taken);
+	while (n < CPU_COUNT_S(setsize, total)) {
+		CPU_ZERO_S(setsize, cores);
+		for (cpu = 0; cpu < nr_cpus; cpu++) {
+			if (!CPU_ISSET_S(cpu, setsize, total) ||
+			    CPU_ISSET_S(cpu, setsize, taken) ||
+			    CPU_ISSET_S(cpu, setsize, cores))
+				continue;
+
+			test_topo_set(WT_GF_CORE, cpu, setsize, tset);
+			CPU_OR_S(setsize, cores, cores, tset);
+			CPU_SET_S(cpu, setsize, taken);
+			order[n++] = cpu;
+		}
+	}
+
+	CPU_FREE(taken);
+	CPU_FREE(cores);
+	CPU_FREE(tset);
+	return n;
+}
+
+/*
+ * WT_GF_CORE_FIRST takes a cpu of each physical core before any SMT
+ * sibling, as the example in wayca-scheduler.h shows. The threads go
+ * on past the last core, if there're not too many, to take the siblings.
+ */
+static void test_core_first_placement(void)
+{
+	wayca_sc_group_attr_t attr = WT_GF_CPU | WT_GF_PERCPU | WT_GF_COMPACT |
+				     WT_GF_CORE_FIRST;
+	int nr_cpus = wayca_sc_cpus_in_total();
+	size_t setsize = CPU_ALLOC_SIZE(nr_cpus);
+	cpu_set_t *total = CPU_ALLOC(nr_cpus);
+	int *order = calloc(nr_cpus, sizeof(*order));
+	wayca_sc_group_t group;
+	int n;
+
+	if (!getenv("WAYCA_SC_SYSFS_ROOT"))
+		goto out;
+
+	assert(order);
+	assert(!wayca_sc_group_create(&group));
+	assert(!wayca_sc_group_set_attr(group, &attr));
+	assert(!wayca_sc_group_get_cpuset(group, setsize, total));
+	assert(!wayca_sc_group_destroy(group));
+
+	n = test_core_first_order(setsize, total, order);
+	if (n > wayca_sc_cores_in_total() + 2)
+		n = wayca_sc_cores_in_total() + 2;
+	test_group_order(attr, order, n < 160 ? n : 160);
+
+out:
+	free(order);
+	CPU_FREE(total);
+}
+
+/* Set the online cpus of the fake sysfs at @root to @mask */
+static void test_write_online(const char *root, int nr_cpus, size_t setsize,
+			      const cpu_set_t *mask)
+{
+	char path[4096];
+	int cpu, last;
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/devices/system/cpu/online", root);
+	fp = fopen(path, "w");
+	assert(fp);
+	for (cpu = 0; cpu < nr_cpus; cpu++) {
+		if (!CPU_ISSET_S(cpu, setsize, mask))
+			continue;
+		for (last = cpu; last + 1 < nr_cpus &&
+		     CPU_ISSET_S(last + 1, setsize, mask); last++)
+			;
+		fprintf(fp, "%s%d-%d", ftell(fp) ? "," : "", cpu, last);
+		cpu = last;
+	}
+	fprintf(fp, "\n");
+	assert(!fclose(fp));
+}
+
+/*
+ * The load of the set of @cpu at the level of @attr, as the linear search
+ * of the library sums it up: the threads on its cpus over their capacity.
+ */
+static void test_set_load(wayca_sc_group_attr_t attr, int cpu,
+			  const int *nr_threads, size_t setsize, cpu_set_t *tset,
+			  long long *load, long long *capacity)
+{
+	int nr_cpus = wayca_sc_cpus_in_total();
+
+	test_topo_set(attr, cpu, setsize, tset);
+	*load = *capacity = 0;
+	for (int i = 0; i < nr_cpus; i++) {
+		if (!CPU_ISSET_S(i, setsize, tset))
+			continue;
+		*load += nr_threads[i];
+		*capacity += wayca_sc_get_cpu_capacity(i) > 0 ?
+			     wayca_sc_get_cpu_capacity(i) : 1024;
+	}
+}
+
+/*
+ * A scattered group takes the sets by the load tree now. Whatever set it
+ * spreads to must be as idle as the one the linear search would take,
+ * among the sets not taken in this round. A cpu goes offline and back in
+ * the middle, so the tree is rebuilt and must keep the loads.
+ */
+static void test_tree_placement(void)
+{
+	wayca_sc_group_attr_t attr = WT_GF_CCL | WT_GF_PERCPU;
+	wayca_sc_group_attr_t preload_attr = WT_GF_CPU | WT_GF_PERCPU |
+					     WT_GF_COMPACT;
+	int nr_cpus = wayca_sc_cpus_in_total();
+	size_t setsize = CPU_ALLOC_SIZE(nr_cpus);
+	cpu_set_t *total = CPU_ALLOC(nr_cpus);
+	cpu_set_t *used = CPU_ALLOC(nr_cpus);
+	cpu_set_t *tset = CPU_ALLOC(nr_cpus);
+	cpu_set_t *online = CPU_ALLOC(nr_cpus);
+	int *nr_threads = calloc(nr_cpus, sizeof(*nr_threads));
+	wayca_sc_thread_t preload[2], *members;
+	long long load, capacity, min_load, min_capacity;
+	wayca_sc_group_t group, preload_group;
+	unsigned long generation;
+	const char *root;
+	int i, cpu, n;
+
+	root = getenv("WAYCA_SC_SYSFS_ROOT");
+	members = calloc(2 * nr_cpus, sizeof(*members));
+	if (!root)
+		goto out;
+
+	/* some threads packed in the first set make the loads uneven */
+	assert(nr_threads && members);
+	assert(!wayca_sc_group_create(&preload_group));
+	assert(!wayca_sc_group_set_attr(preload_group, &preload_attr));
+	for (i = 0; i < 2; i++) {
+		preload[i] = test_thread_start(preload_group);
+		assert(!wayca_sc_thread_get_cpuset(preload[i], setsize, tset));
+		for (cpu = 0; cpu < nr_cpus; cpu++)
+			if (CPU_ISSET_S(cpu, setsize, tset))
+				nr_threads[cpu]++;
+	}
+
+	assert(!wayca_sc_group_create(&group));
+	assert(!wayca_sc_group_set_attr(group, &attr));
+	assert(!wayca_sc_group_get_cpuset(group, setsize, total));
+	CPU_ZERO_S(setsize, used);
+
+	/* each set twice, so the second round sees the loads of the first */
+	n = 2 * wayca_sc_ccls_in_total();
+	if (n <= 0 || n > 2 * nr_cpus)
+		n = 2;
+	for (i = 0; i < n; i++) {
+		assert(!wayca_sc_total_online_cpu_mask(setsize, online));
+		if (i == n / 2 && CPU_COUNT_S(setsize, online) > 1) {
+			for (cpu = nr_cpus - 1; cpu > 0 &&
+			     !CPU_ISSET_S(cpu, setsize, online); cpu--)
+				;
+			generation = wayca_sc_topo_generation();
+			CPU_CLR_S(cpu, setsize, online);
+			test_write_online(root, nr_cpus, setsize, online);
+			assert(wayca_sc_topo_generation() != generation);
+			CPU_SET_S(cpu, setsize, online);
+			test_write_online(root, nr_cpus, setsize, online);
+		}
+
+		/* the idlest of the sets not taken in this round */
+		min_load = -1;
+		min_capacity = 1;
+		for (cpu = 0; cpu < nr_cpus; cpu++) {
+			if (!CPU_ISSET_S(cpu, setsize, total) ||
+			    CPU_ISSET_S(cpu, setsize, used))
+				continue;
+			test_set_load(attr, cpu, nr_threads, setsize, tset,
+				      &load, &capacity);
+			if (min_load < 0 ||
+			    load * min_capacity < min_load * capacity) {
+				min_load = load;
+				min_capacity = capacity;
+			}
+		}
+
+		members[i] = test_thread_start(group);
+		assert(!wayca_sc_thread_get_cpuset(members[i], setsize, tset));
+		assert(CPU_COUNT_S(setsize, tset) == 1);
+		for (cpu = 0; !CPU_ISSET_S(cpu, setsize, tset); cpu++)
+			;
+		assert(!CPU_ISSET_S(cpu, setsize, used));
+
+		test_set_load(attr, cpu, nr_threads, setsize, tset, &load,
+			      &capacity);
+		assert(load * min_capacity == min_load * capacity);
+		nr_threads[cpu]++;
+
+		/* the round is over once all the sets are taken */
+		CPU_AND_S(setsize, tset, tset, total);
+		CPU_OR_S(setsize, used, used, tset);
+		if (CPU_EQUAL_S(setsize, used, total))
+			CPU_ZERO_S(setsize, used);
+	}
+
+	test_group_stop(group, members, n);
+	test_group_stop(preload_group, preload, 2);
+
+out:
+	free(members);
+	free(nr_threads);
+	CPU_FREE(total);
+	CPU_FREE(used);
+	CPU_FREE(tset);
+	CPU_FREE(online);
+}
+
+/* Place @n threads in a new group of @attr, each on the cpu in @cpus */
+static void test_group_place(wayca_sc_group_attr_t attr, int *cpus, int n)
+{
+	int nr_cpus = wayca_sc_cpus_in_total();
+	size_t setsize = CPU_ALLOC_SIZE(nr_cpus);
+	cpu_set_t *set = CPU_ALLOC(nr_cpus);
+	wayca_sc_thread_t *members;
+	wayca_sc_group_t group;
+
+	members = calloc(n, sizeof(*members));
+	assert(members);
+	assert(!wayca_sc_group_create(&group));
+	assert(!wayca_sc_group_set_attr(group, &attr));
+
+	for (int i = 0; i < n; i++) {
+		members[i] = test_thread_start(group);
+		assert(!wayca_sc_thread_get_cpuset(members[i], setsize, set));
+		assert(CPU_COUNT_S(setsize, set) == 1);
+		for (cpus[i] = 0; !CPU_ISSET_S(cpus[i], setsize, set);
+		     cpus[i]++)
+			;
+	}
+
+	test_group_stop(group, members, n);
+	free(members);
+	CPU_FREE(set);
+}
+
+/*
+ * Write the /proc/stat of the fake procfs at @root, in which the cpus of
+ * @busy have been busy since the last one, and the others idle.
+ */
+static void test_write_stat(const char *root, int nr_cpus, size_t setsize,
+			    const cpu_set_t *busy)
+{
+	static unsigned long long *user, *idle;
+	char path[4096];
+	FILE *fp;
+
+	if (!user) {
+		user = calloc(nr_cpus, sizeof(*user));
+		idle = calloc(nr_cpus, sizeof(*idle));
+		assert(user && idle);
+	}
+
+	snprintf(path, sizeof(path), "%s/stat", root);
+	fp = fopen(path, "w");
+	assert(fp);
+	fprintf(fp, "cpu  0 0 0 0 0 0 0 0 0 0\n");
+	for (int cpu = 0; cpu < nr_cpus; cpu++) {
+		if (CPU_ISSET_S(cpu, setsize, busy))
+			user[cpu] += 100;
+		else
+			idle[cpu] += 100;
+		fprintf(fp, "cpu%d %llu 0 0 %llu 0 0 0 0 0 0\n", cpu,
+			user[cpu], idle[cpu]);
+	}
+	assert(!fclose(fp));
+}
+
+/*
+ * The cpus busy with other tasks in /proc/stat are avoided by the new
+ * threads, while an idle /proc/stat places them as if it's not sampled.
+ * The next placement samples it once a period has passed since the last.
+ */
+static void test_util_placement(void)
+{
+	wayca_sc_group_attr_t attr = WT_GF_CPU | WT_GF_PERCPU;
+	int nr_cpus = wayca_sc_cpus_in_total();
+	size_t setsize = CPU_ALLOC_SIZE(nr_cpus);
+	cpu_set_t *total = CPU_ALLOC(nr_cpus);
+	cpu_set_t *busy = CPU_ALLOC(nr_cpus);
+	int *before = calloc(nr_cpus, sizeof(*before));
+	int *after = calloc(nr_cpus, sizeof(*after));
+	const char *root = getenv("WAYCA_SC_PROCFS_ROOT");
+	const char *p = getenv("WAYCA_SC_UTIL_PERIOD_MS");
+	long period = p ? atol(p) : 100;
+	char path[4096], *saved = NULL;
+	wayca_sc_group_t group;
+	size_t len = 0;
+	FILE *fp;
+	int i, n;
+
+	if (!getenv("WAYCA_SC_SYSFS_ROOT") || !root || period <= 0)
+		goto out;
+
+	/* the sampling is disabled without /proc/stat */
+	snprintf(path, sizeof(path), "%s/stat", root);
+	fp = fopen(path, "r");
+	if (!fp)
+		goto out;
+	assert(!fseek(fp, 0, SEEK_END));
+	len = ftell(fp);
+	rewind(fp);
+	saved = malloc(len + 1);
+	assert(saved && before && after);
+	assert(fread(saved, 1, len, fp) == len);
+	fclose(fp);
+
+	assert(!wayca_sc_group_create(&group));
+	assert(!wayca_sc_group_set_attr(group, &attr));
+	assert(!wayca_sc_group_get_cpuset(group, setsize, total));
+	assert(!wayca_sc_group_destroy(group));
+
+	/* half of the cpus at most, so there are idle ones for all of them */
+	n = CPU_COUNT_S(setsize, total) / 2;
+	if (n > 16)
+		n = 16;
+	test_group_place(attr, before, n);
+
+	CPU_ZERO_S(setsize, busy);
+	test_write_stat(root, nr_cpus, setsize, busy);
+	usleep((period + 50) * 1000);
+	test_group_place(attr, after, n);
+	for (i = 0; i < n; i++)
+		assert(after[i] == before[i]);
+
+	/* the cpus taken first are busy now */
+	for (i = 0; i < n; i++)
+		CPU_SET_S(before[i], setsize, busy);
+	test_write_stat(root, nr_cpus, setsize, busy);
+	usleep((period + 50) * 1000);
+	test_group_place(attr, after, n);
+	for (i = 0; i < n; i++)
+		assert(!CPU_ISSET_S(after[i], setsize, busy));
+
+	fp = fopen(path, "w");
+	assert(fp);
+	assert(fwrite(saved, 1, len, fp) == len);
+	assert(!fclose(fp));
+
+out:
+	free(saved);
+	free(before);
+	free(after);
+	CPU_FREE(total);
+	CPU_FREE(busy);
+}
+
+/* The cpus of each of @n members, as threads or as groups */
+static void test_member_cpus(const wayca_sc_thread_t *wthreads,
+			     const wayca_sc_group_t *wgroups, int n,
+			     size_t setsize, cpu_set_t **cpus)
+{
+	for (int i = 0; i < n; i++) {
+		if (wthreads)
+			assert(!wayca_sc_thread_get_cpuset(wthreads[i], setsize,
+							   cpus[i]));
+		else
+			assert(!wayca_sc_group_get_cpuset(wgroups[i], setsize,
+							  cpus[i]));
+	}
+}
+
+/*
+ * Detach the head, the middle and the tail of the members of a group, and
+ * attach them back, the members are threads or groups. The others keep
+ * their cpus meanwhile. The members are walked in the list to rearrange
+ * them, so they must all be there and take the cpus of their own. And the
+ * count of them must be right, or the group can't be destroyed at last.
+ */
+static void test_detach_members(bool threads_member)
+{
+	wayca_sc_group_attr_t attr = WT_GF_CPU | WT_GF_PERCPU;
+	wayca_sc_group_attr_t father_attr = WT_GF_CCL;
+	int nr_cpus = wayca_sc_cpus_in_total();
+	size_t setsize = CPU_ALLOC_SIZE(nr_cpus);
+	wayca_sc_thread_t members[5];
+	wayca_sc_group_t children[5];
+	cpu_set_t *before[5], *after[5], *shared;
+	bool detached[5] = { true, false, true, false, true };
+	wayca_sc_group_t group;
+	int i, j, n = 5;
+
+	/* the members must take the cpus or the clusters of their own */
+	if (threads_member && nr_cpus < n)
+		return;
+	if (!threads_member && (wayca_sc_ccls_in_total() < n ||
+				wayca_sc_cpus_in_ccl() < 2))
+		return;
+
+	shared = CPU_ALLOC(nr_cpus);
+	for (i = 0; i < n; i++) {
+		before[i] = CPU_ALLOC(nr_cpus);
+		after[i] = CPU_ALLOC(nr_cpus);
+	}
+
+	assert(!wayca_sc_group_create(&group));
+	if (threads_member) {
+		assert(!wayca_sc_group_set_attr(group, &attr));
+		for (i = 0; i < n; i++)
+			members[i] = test_thread_start(group);
+	} else {
+		assert(!wayca_sc_group_set_attr(group, &father_attr));
+		for (i = 0; i < n; i++) {
+			assert(!wayca_sc_group_create(&children[i]));
+			assert(!wayca_sc_group_set_attr(children[i], &attr));
+			assert(!wayca_sc_group_attach_group(children[i],
+							    group));
+		}
+	}
+	test_member_cpus(threads_member ? members : NULL, children, n,
+			 setsize, before);
+
+	for (i = 0; i < n; i++) {
+		if (!detached[i])
+			continue;
+		if (threads_member)
+			assert(!wayca_sc_thread_detach_group(members[i], group));
+		else
+			assert(!wayca_sc_group_detach_group(children[i], group));
+	}
+
+	for (i = 0; i < n; i++) {
+		if (threads_member)
+			assert(wayca_sc_is_thread_in_group(members[i], group) ==
+			       !detached[i]);
+		else
+			assert(wayca_sc_is_group_in_group(children[i], group) ==
+			       !detached[i]);
+	}
+	assert(wayca_sc_group_destroy(group) == -EBUSY);
+
+	for (i = 0; i < n; i++) {
+		if (!detached[i])
+			continue;
+		if (threads_member)
+			assert(!wayca_sc_thread_attach_group(members[i], group));
+		else
+			assert(!wayca_sc_group_attach_group(children[i], group));
+	}
+
+	/* the members left in the group are not moved */
+	test_member_cpus(threads_member ? members : NULL, children, n,
+			 setsize, after);
+	for (i = 0; i < n; i++)
+		assert(detached[i] ||
+		       CPU_EQUAL_S(setsize, before[i], after[i]));
+
+	/* all of them are rearranged, each to the cpus of its own */
+	assert(!wayca_sc_group_set_attr(group, threads_member ? &attr :
+							    &father_attr));
+	test_member_cpus(threads_member ? members : NULL, children, n,
+			 setsize, after);
+	for (i = 0; i < n; i++) {
+		if (threads_member)
+			assert(wayca_sc_is_thread_in_group(members[i], group) ==
+			       1);
+		else
+			assert(wayca_sc_is_group_in_group(children[i], group) ==
+			       1);
+		for (j = 0; j < i; j++) {
+			CPU_AND_S(setsize, shared, after[i], after[j]);
+			assert(!CPU_COUNT_S(setsize, shared));
+		}
+	}
+
+	if (threads_member) {
+		test_group_stop(group, members, n);
+	} else {
+		for (i = 0; i < n; i++) {
+			assert(!wayca_sc_group_detach_group(children[i], group));
+			assert(!wayca_sc_group_destroy(children[i]));
+		}
+		assert(!wayca_sc_group_destroy(group));
+	}
+
+	for (i = 0; i < n; i++) {
+		CPU_FREE(before[i]);
+		CPU_FREE(after[i]);
+	}
+	CPU_FREE(shared);
 }
+#endif /* WAYCA_SC_DEBUG */
 
 int main()
 {
@@ -136,6 +830,15 @@ int main()
 	wayca_sc_group_attr_t group_attr;
 
 	readEnv();
+	test_stale_group_id();
+#ifdef WAYCA_SC_DEBUG
+	test_compact_placement();
+	test_core_first_placement();
+	test_tree_placement();
+	test_util_placement();
+	test_detach_members(true);
+	test_detach_members(false);
+#endif
 
 	perCcl = malloc(group_num * sizeof(wayca_sc_group_t));
 	threads = malloc(group_num * sizeof(wayca_sc_thread_t *));
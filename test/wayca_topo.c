@@ -21,8 +21,15 @@
 #include <assert.h>
 #include <sched.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <sys/wait.h>
 #include "wayca-scheduler.h"
+#ifdef WAYCA_SC_DEBUG
+/* the sysfs syscall counter is only exported by the debug build */
+#include "../lib/topo.h"
+#endif
 
 #define TEST_INVALID_ID -1
 static void test_entity_number()
@@ -114,6 +121,306 @@ static void test_get_entity_id()
 	printf("core logic id of cpu 0: %d\n", ret);
 }
 
+static void test_get_cpu_ids(void)
+{
+	int n_cpus = wayca_sc_cpus_in_total();
+	struct wayca_sc_cpu_ids *ids;
+	cpu_set_t *cpu_set;
+	size_t setsize;
+	int i, ret;
+
+	setsize = CPU_ALLOC_SIZE(n_cpus);
+	cpu_set = CPU_ALLOC(n_cpus);
+	ids = calloc(n_cpus, sizeof(*ids));
+	assert(cpu_set != NULL && ids != NULL);
+
+	ret = wayca_sc_total_cpu_mask(setsize, cpu_set);
+	assert(ret == 0);
+	ret = wayca_sc_get_cpu_ids(setsize, cpu_set, ids, n_cpus);
+	assert(ret == CPU_COUNT_S(setsize, cpu_set));
+
+	/* the batch agrees with the lookups of a single cpu */
+	for (i = 0; i < ret; i++) {
+		assert(ids[i].core_id == wayca_sc_get_core_id(ids[i].cpu));
+		assert(ids[i].ccl_id == wayca_sc_get_ccl_id(ids[i].cpu));
+		assert(ids[i].node_id == wayca_sc_get_node_id(ids[i].cpu));
+		assert(ids[i].package_id ==
+		       wayca_sc_get_package_id(ids[i].cpu));
+	}
+	printf("L2 domain of cpu 0: %d, L3 domain of cpu 0: %d\n",
+	       ids[0].l2_id, ids[0].l3_id);
+
+	/* too small array */
+	if (ret > 1) {
+		ret = wayca_sc_get_cpu_ids(setsize, cpu_set, ids, 1);
+		assert(ret < 0);
+	}
+
+	free(ids);
+	CPU_FREE(cpu_set);
+}
+
+static void test_cpu_capacity(void)
+{
+	int n_cpus = wayca_sc_cpus_in_total();
+	cpu_set_t *mask;
+	size_t setsize;
+	int node, i, ret;
+
+	mask = CPU_ALLOC(n_cpus);
+	assert(mask);
+	setsize = CPU_ALLOC_SIZE(n_cpus);
+
+	for (i = 0; i < n_cpus; i++) {
+		ret = wayca_sc_get_cpu_capacity(i);
+		assert(ret > 0 && ret <= WAYCA_SC_CPU_CAPACITY_SCALE);
+
+		/* the node of a cpu is a logical id whose mask has the cpu */
+		node = wayca_sc_get_node_id(i);
+		assert(node >= 0 && node < wayca_sc_nodes_in_total());
+		ret = wayca_sc_node_cpu_mask(node, setsize, mask);
+		assert(ret == 0 && CPU_ISSET_S(i, setsize, mask));
+	}
+	CPU_FREE(mask);
+
+	ret = wayca_sc_get_cpu_capacity(-1);
+	assert(ret < 0);
+	ret = wayca_sc_get_cpu_capacity(n_cpus);
+	assert(ret < 0);
+}
+
+static void test_cache_domain(void)
+{
+	int n_cpus = wayca_sc_cpus_in_total();
+	struct wayca_sc_cache_info info;
+	cpu_set_t *cpu_set;
+	size_t setsize;
+	int level, domain, ret;
+
+	ret = wayca_sc_get_cache_domain_id(0, 1);
+	assert(ret == -EINVAL);
+
+	setsize = CPU_ALLOC_SIZE(n_cpus);
+	cpu_set = CPU_ALLOC(n_cpus);
+	assert(cpu_set != NULL);
+
+	for (level = 2; level <= 3; level++) {
+		ret = wayca_sc_cache_domains_in_total(level);
+		if (ret < 0)
+			continue;
+		printf("L%d cache domains: %d\n", level, ret);
+
+		domain = wayca_sc_get_cache_domain_id(0, level);
+		assert(domain >= 0 && domain < ret);
+		ret = wayca_sc_cache_domain_cpu_mask(level, domain, setsize,
+						     cpu_set);
+		assert(ret == 0 && CPU_ISSET_S(0, setsize, cpu_set));
+		ret = wayca_sc_get_cache_domain_info(level, domain, &info);
+		assert(ret == 0 && info.level == level);
+		assert(info.n_cpus == CPU_COUNT_S(setsize, cpu_set));
+		printf("\tcpu 0: domain %d, %uK, %u sets, %u ways, line %u\n",
+		       domain, info.size, info.sets, info.ways,
+		       info.line_size);
+	}
+
+	CPU_FREE(cpu_set);
+}
+
+/* the bulk masks are the same as the per-domain ones */
+static void test_domain_masks(void)
+{
+	int n_cpus = wayca_sc_cpus_in_total();
+	enum wayca_sc_topo_level level;
+	unsigned long generation;
+	cpu_set_t *masks, *mask;
+	size_t setsize;
+	int n, i, ret;
+
+	setsize = CPU_ALLOC_SIZE(n_cpus);
+	mask = CPU_ALLOC(n_cpus);
+	assert(mask);
+
+	for (level = 0; level < WAYCA_SC_TOPO_LEVEL_MAX; level++) {
+		n = wayca_sc_topo_domain_masks(level, setsize, NULL, 0,
+					       &generation);
+		if (n <= 0)
+			continue;
+
+		masks = calloc(n, setsize);
+		assert(masks);
+		ret = wayca_sc_topo_domain_masks(level, setsize, masks, n - 1,
+						 NULL);
+		assert(ret == -EINVAL);
+		ret = wayca_sc_topo_domain_masks(level, setsize, masks, n,
+						 &generation);
+		assert(ret == n);
+
+		for (i = 0; i < n; i++) {
+			switch (level) {
+			case WAYCA_SC_TOPO_LEVEL_CORE:
+				ret = wayca_sc_core_cpu_mask(i, setsize, mask);
+				break;
+			case WAYCA_SC_TOPO_LEVEL_CCL:
+				ret = wayca_sc_ccl_cpu_mask(i, setsize, mask);
+				break;
+			case WAYCA_SC_TOPO_LEVEL_NODE:
+				ret = wayca_sc_node_cpu_mask(i, setsize, mask);
+				break;
+			case WAYCA_SC_TOPO_LEVEL_PACKAGE:
+				ret = wayca_sc_package_cpu_mask(i, setsize,
+								mask);
+				break;
+			case WAYCA_SC_TOPO_LEVEL_L2:
+				ret = wayca_sc_cache_domain_cpu_mask(2, i,
+								     setsize,
+								     mask);
+				break;
+			default:
+				ret = wayca_sc_cache_domain_cpu_mask(
+					level == WAYCA_SC_TOPO_LEVEL_L3 ||
+					wayca_sc_cache_domains_in_total(3) > 0 ?
+					3 : 2, i, setsize, mask);
+				break;
+			}
+			assert(ret == 0);
+			assert(CPU_EQUAL_S(setsize, mask,
+					   (cpu_set_t *)((char *)masks +
+							 i * setsize)));
+		}
+		free(masks);
+		printf("%d domains at level %d\n", n, level);
+	}
+
+	/* abnormal case */
+	ret = wayca_sc_topo_domain_masks(WAYCA_SC_TOPO_LEVEL_MAX, setsize,
+					 NULL, 0, NULL);
+	assert(ret == -EINVAL);
+
+	CPU_FREE(mask);
+	printf("domain masks of topology generation %lu successful.\n",
+	       generation);
+}
+
+static void test_node_distance(void)
+{
+	int *matrix, *nodes;
+	size_t num;
+	int i, ret;
+
+	ret = wayca_sc_node_distance(0, TEST_INVALID_ID);
+	assert(ret < 0);
+	ret = wayca_sc_node_distance_matrix(&num, NULL);
+	assert(ret == 0 && num > 0);
+
+	matrix = calloc(num * num, sizeof(int));
+	nodes = calloc(num, sizeof(int));
+	assert(matrix != NULL && nodes != NULL);
+	ret = wayca_sc_node_distance_matrix(&num, matrix);
+	assert(ret == 0);
+	for (i = 0; i < num * num; i++)
+		assert(matrix[i] == wayca_sc_node_distance(i / num, i % num));
+
+	/* the node itself is the nearest one */
+	ret = wayca_sc_nearest_nodes(0, num, nodes);
+	assert(ret == num && nodes[0] == 0);
+	for (i = 1; i < ret; i++)
+		assert(matrix[nodes[i - 1]] <= matrix[nodes[i]]);
+	ret = wayca_sc_cpu_nearest_nodes(0, 1, nodes);
+	assert(ret == 1 && nodes[0] == wayca_sc_get_node_id(0));
+	printf("distance of node 0 to itself: %d\n", matrix[0]);
+
+	free(nodes);
+	free(matrix);
+}
+
+static void test_mem_nodes(void)
+{
+	struct wayca_sc_mem_node_info info, prev;
+	unsigned long size;
+	int n_mem_nodes;
+	int *mem_nodes;
+	int i, ret;
+
+	n_mem_nodes = wayca_sc_mem_nodes_in_total();
+	assert(n_mem_nodes > 0);
+	ret = wayca_sc_get_mem_node_info(n_mem_nodes, &info);
+	assert(ret < 0);
+
+	for (i = 0; i < n_mem_nodes; i++) {
+		ret = wayca_sc_get_mem_node_info(i, &info);
+		assert(ret == 0 && info.phys_node >= 0);
+		assert(info.initiator >= 0 &&
+		       info.initiator < wayca_sc_nodes_in_total());
+		if (info.node_id >= 0) {
+			/* a node of cpus is its own initiator */
+			assert(info.initiator == info.node_id);
+			ret = wayca_sc_get_node_mem_size(info.node_id, &size);
+			assert(ret == 0 && size == info.size);
+			assert(wayca_sc_mem_node_distance(info.node_id, i) ==
+			       wayca_sc_node_distance(info.node_id,
+						      info.node_id));
+		}
+		assert(wayca_sc_mem_node_distance(info.initiator, i) > 0);
+		printf("memory node %d: node %d, initiator %d, tier %d, "
+		       "read %u MB/s %u ns\n", info.phys_node, info.node_id,
+		       info.initiator, info.tier, info.read_bandwidth,
+		       info.read_latency);
+	}
+
+	mem_nodes = calloc(n_mem_nodes, sizeof(int));
+	assert(mem_nodes != NULL);
+	ret = wayca_sc_mem_nodes_by_attr(-1, n_mem_nodes, mem_nodes);
+	assert(ret < 0);
+
+	/* the known bandwidth comes first, the highest first */
+	ret = wayca_sc_mem_nodes_by_attr(WAYCA_SC_MEM_READ_BANDWIDTH,
+					 n_mem_nodes, mem_nodes);
+	assert(ret == n_mem_nodes);
+	for (i = 1; i < ret; i++) {
+		wayca_sc_get_mem_node_info(mem_nodes[i - 1], &prev);
+		wayca_sc_get_mem_node_info(mem_nodes[i], &info);
+		assert(!info.read_bandwidth ||
+		       prev.read_bandwidth >= info.read_bandwidth);
+	}
+
+	ret = wayca_sc_mem_nodes_by_attr(WAYCA_SC_MEM_TIER, 1, mem_nodes);
+	assert(ret == 1);
+
+	free(mem_nodes);
+}
+
+static void test_node_mem_stat(void)
+{
+	struct wayca_sc_node_mem_stat stat, cached;
+	unsigned long size;
+	int i, ret;
+
+	ret = wayca_sc_get_node_mem_stat(TEST_INVALID_ID, 0, &stat);
+	assert(ret < 0);
+
+	ret = wayca_sc_get_node_mem_stat(0, 0, &stat);
+	assert(ret == 0);
+	ret = wayca_sc_get_node_mem_size(0, &size);
+	assert(ret == 0 && stat.total == size && stat.free <= stat.total);
+
+	/* the values just read are taken from the cache without syscalls */
+#ifdef WAYCA_SC_DEBUG
+	unsigned long syscalls = wayca_sc_topo_sysfs_syscalls();
+#endif
+	for (i = 0; i < 100; i++) {
+		ret = wayca_sc_get_node_mem_stat(0, 60000, &cached);
+		assert(ret == 0 && cached.total == stat.total);
+	}
+#ifdef WAYCA_SC_DEBUG
+	assert(wayca_sc_topo_sysfs_syscalls() == syscalls);
+#endif
+
+	ret = wayca_sc_get_mem_node_stat(0, 1000, &stat);
+	assert(ret == 0 && stat.total > 0);
+	printf("node 0: %lu kB free, %lu kB file, %lu kB anon\n", cached.free,
+	       cached.file, cached.anon);
+}
+
 static void print_cpumask(const char *topo, size_t setsize, cpu_set_t *mask)
 {
 
@@ -231,8 +538,9 @@ static void test_get_cache_info()
 static void test_get_device_info(void)
 {
 	struct wayca_sc_device_info dev_info = {0};
+	struct wayca_sc_device_info *dev_list;
+	size_t num, list_num, i;
 	const char **dev_name;
-	size_t num;
 	int ret;
 
 	/* normal case */
@@ -255,21 +563,201 @@ static void test_get_device_info(void)
 	ret = wayca_sc_get_device_info(dev_name[0], &dev_info);
 	assert(ret == 0);
 
+	/* the bulk query returns the same as the lookups by name */
+	ret = wayca_sc_get_device_info_list(-1, &list_num, NULL);
+	assert(ret == 0 && list_num == num);
+	dev_list = calloc(num, sizeof(*dev_list));
+	assert(dev_list != NULL);
+	ret = wayca_sc_get_device_info_list(-1, &list_num, dev_list);
+	assert(ret == 0 && list_num == num);
+	for (i = 0; i < num; i++) {
+		ret = wayca_sc_get_device_info(dev_name[i], &dev_info);
+		assert(ret == 0);
+		assert(!strcmp(dev_info.name, dev_name[i]));
+		assert(dev_list[i].name == dev_info.name);
+		assert(dev_list[i].dev_type == dev_info.dev_type);
+		assert(dev_list[i].numa_node == dev_info.numa_node);
+		if (dev_info.dev_type == WAYCA_SC_TOPO_DEV_TYPE_PCI) {
+			assert(dev_list[i].nb_irq == dev_info.nb_irq);
+			assert(dev_list[i].irq_numbers == dev_info.irq_numbers);
+		}
+	}
+	free(dev_list);
+
 	/* abnormal case */
 	ret = wayca_sc_get_device_info(NULL, &dev_info);
 	assert(ret < 0);
 	ret = wayca_sc_get_device_info(dev_name[0], NULL);
 	assert(ret < 0);
+	ret = wayca_sc_get_device_info("0000:ff:ff.7-none", &dev_info);
+	assert(ret == -ENOENT);
+	ret = wayca_sc_get_device_info_list(-1, NULL, NULL);
+	assert(ret < 0);
 	free(dev_name);
 	printf("get device info successful.\n");
 }
 
+static void test_device_near_cpus(void)
+{
+	struct wayca_sc_device_info dev_info;
+	int n_cpus = wayca_sc_cpus_in_total();
+	cpu_set_t *mask, *online, *loaded;
+	const char **dev_name;
+	int ret, i, n_online;
+	size_t setsize, num;
+
+	ret = wayca_sc_get_device_list(-1, &num, NULL);
+	assert(ret == 0);
+	if (!num)
+		return;
+	dev_name = calloc(num, sizeof(char *));
+	assert(dev_name != NULL);
+	ret = wayca_sc_get_device_list(-1, &num, dev_name);
+	assert(ret == 0);
+
+	setsize = CPU_ALLOC_SIZE(n_cpus);
+	mask = CPU_ALLOC(n_cpus);
+	online = CPU_ALLOC(n_cpus);
+	loaded = CPU_ALLOC(n_cpus);
+	assert(mask && online && loaded);
+	ret = wayca_sc_total_online_cpu_mask(setsize, online);
+	assert(ret == 0);
+	n_online = CPU_COUNT_S(setsize, online);
+
+	/* normal case */
+	ret = wayca_sc_get_device_info(dev_name[0], &dev_info);
+	assert(ret == 0);
+	ret = wayca_sc_device_near_cpus(dev_name[0], 1, 0, setsize, mask);
+	assert(ret == 1 && CPU_COUNT_S(setsize, mask) == 1);
+	printf("nearest CPU of %s on node %d:", dev_name[0],
+	       dev_info.numa_node);
+	for (i = 0; i < n_cpus; i++)
+		if (CPU_ISSET_S(i, setsize, mask))
+			printf(" %d\n", i);
+
+	/* all the online CPUs are ranked */
+	ret = wayca_sc_device_near_cpus(dev_name[0], n_cpus + 1, 0, setsize,
+					mask);
+	assert(ret == n_online && CPU_EQUAL_S(setsize, mask, online));
+
+	/* no wayca thread runs here */
+	ret = wayca_sc_device_near_cpus(dev_name[0], n_cpus,
+					WAYCA_SC_NEAR_EXCLUDE_LOADED, setsize,
+					loaded);
+	assert(ret == n_online && CPU_EQUAL_S(setsize, loaded, online));
+
+	/* abnormal case */
+	ret = wayca_sc_device_near_cpus(NULL, 1, 0, setsize, mask);
+	assert(ret == -EINVAL);
+	ret = wayca_sc_device_near_cpus(dev_name[0], 0, 0, setsize, mask);
+	assert(ret == -EINVAL);
+	ret = wayca_sc_device_near_cpus(dev_name[0], 1, 0x80, setsize, mask);
+	assert(ret == -EINVAL);
+	ret = wayca_sc_device_near_cpus(dev_name[0], 1, 0, 0, mask);
+	assert(ret == -EINVAL);
+	ret = wayca_sc_device_near_cpus("0000:ff:ff.7-none", 1, 0, setsize,
+					mask);
+	assert(ret == -ENOENT);
+
+	CPU_FREE(loaded);
+	CPU_FREE(online);
+	CPU_FREE(mask);
+	free(dev_name);
+}
+
+struct pci_walk_ctx {
+	const struct wayca_sc_device_info *visited;
+	size_t n_visited;
+	size_t max_visited;
+};
+
+static int pci_walk_visit(const struct wayca_sc_device_info *dev_info,
+			  void *data)
+{
+	struct pci_walk_ctx *ctx = data;
+	struct wayca_sc_device_info *visited;
+	size_t i;
+
+	assert(dev_info->dev_type == WAYCA_SC_TOPO_DEV_TYPE_PCI);
+	assert(dev_info->root != NULL);
+	assert(dev_info->link_speed >= 0 && dev_info->link_width >= 0);
+
+	/* a bridge is visited before the devices below it */
+	if (dev_info->parent && ctx->n_visited) {
+		for (i = 0; i < ctx->n_visited; i++)
+			if (!strcmp(ctx->visited[i].name, dev_info->parent))
+				break;
+		if (i < ctx->n_visited)
+			assert(ctx->visited[i].depth + 1 == dev_info->depth);
+	}
+
+	if (ctx->n_visited == ctx->max_visited)
+		return 1;
+	visited = (struct wayca_sc_device_info *)ctx->visited;
+	visited[ctx->n_visited++] = *dev_info;
+	return 0;
+}
+
+static void test_pci_walk(void)
+{
+	struct wayca_sc_device_info *dev_list;
+	struct pci_walk_ctx ctx = { 0 };
+	size_t num, n_pci = 0, i;
+	int ret;
+
+	ret = wayca_sc_get_device_info_list(-1, &num, NULL);
+	assert(ret == 0);
+	dev_list = calloc(num + 1, sizeof(*dev_list));
+	assert(dev_list != NULL);
+	ret = wayca_sc_get_device_info_list(-1, &num, dev_list);
+	assert(ret == 0);
+	for (i = 0; i < num; i++)
+		n_pci += dev_list[i].dev_type == WAYCA_SC_TOPO_DEV_TYPE_PCI;
+
+	/* every PCI device is visited once */
+	ctx.visited = calloc(n_pci + 1, sizeof(*ctx.visited));
+	assert(ctx.visited != NULL);
+	ctx.max_visited = n_pci;
+	ret = wayca_sc_pci_walk(NULL, pci_walk_visit, &ctx);
+	assert(ret == 0 && ctx.n_visited == n_pci);
+	for (i = 0; i < ctx.n_visited; i++)
+		printf("%*s%s %d MT/s x%d\n", ctx.visited[i].depth * 2, "",
+		       ctx.visited[i].name, ctx.visited[i].link_speed,
+		       ctx.visited[i].link_width);
+
+	/* the subtree of a device starts with the device itself */
+	if (n_pci) {
+		const char *name = ctx.visited[0].name;
+
+		ctx.n_visited = 0;
+		ret = wayca_sc_pci_walk(name, pci_walk_visit, &ctx);
+		assert(ret == 0 && ctx.n_visited >= 1);
+		assert(!strcmp(ctx.visited[0].name, name));
+
+		/* the walk stops on the non-zero return */
+		ctx.n_visited = 0;
+		ctx.max_visited = 0;
+		ret = wayca_sc_pci_walk(NULL, pci_walk_visit, &ctx);
+		assert(ret == 1);
+	}
+
+	/* abnormal case */
+	ret = wayca_sc_pci_walk(NULL, NULL, &ctx);
+	assert(ret == -EINVAL);
+	ret = wayca_sc_pci_walk("0000:ff:ff.7-none", pci_walk_visit, &ctx);
+	assert(ret == -ENOENT);
+
+	free((void *)ctx.visited);
+	free(dev_list);
+	printf("PCI walk successful.\n");
+}
+
 static void test_get_irq_info(void)
 {
 #define TEST_INVALID_IRQ 100000
 	struct wayca_sc_irq_info irq_info = {0};
 	uint32_t *irq;
-	size_t num;
+	size_t num, i;
 	int ret;
 
 	/* normal case */
@@ -289,6 +777,10 @@ static void test_get_irq_info(void)
 	/* normal case */
 	ret = wayca_sc_get_irq_info(irq[0], &irq_info);
 	assert(ret == 0);
+	for (i = 0; i < num; i++) {
+		ret = wayca_sc_get_irq_info(irq[i], &irq_info);
+		assert(ret == 0 && irq_info.irq_num == irq[i]);
+	}
 
 	/* abnormal case */
 	ret = wayca_sc_get_irq_info(irq[0], NULL);
@@ -300,17 +792,598 @@ static void test_get_irq_info(void)
 	printf("get IRQ info successful.\n");
 }
 
-int main()
+static unsigned int notified_event;
+static int notified_id = -1;
+
+static void topo_notifier(unsigned int event, int id, void *data)
 {
+	(void)data;
+	notified_id = id;
+	__atomic_store_n(&notified_event, event, __ATOMIC_RELEASE);
+}
+
+/* wait up to 2s for the notifier, which runs in a thread of the library */
+static unsigned int wait_notified(void)
+{
+	unsigned int event = 0;
+	int i;
+
+	for (i = 0; i < 200 && !event; i++) {
+		event = __atomic_exchange_n(&notified_event, 0, __ATOMIC_ACQUIRE);
+		if (!event)
+			usleep(10000);
+	}
+	return event;
+}
+
+static int read_cpu_online(const char *root, char *content, size_t len)
+{
+	char path[4096];
+	FILE *fp;
+	int ret = 0;
+
+	snprintf(path, sizeof(path), "%s/devices/system/cpu/online", root);
+	fp = fopen(path, "r");
+	if (!fp)
+		return -errno;
+	if (!fgets(content, len, fp))
+		ret = -EIO;
+	fclose(fp);
+	return ret;
+}
+
+static int write_cpu_online(const char *root, const char *content)
+{
+	char path[4096];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/devices/system/cpu/online", root);
+	fp = fopen(path, "w");
+	if (!fp)
+		return -errno;
+	fputs(content, fp);
+	return fclose(fp) ? -errno : 0;
+}
+
+/* format the CPUs in @mask as a CPU list, e.g. "0-3,5\n" */
+static void format_cpulist(char *content, size_t len, int n_cpus,
+			   size_t setsize, const cpu_set_t *mask)
+{
+	size_t pos = 0;
+	int cpu, last;
+
+	content[0] = '\0';
+	for (cpu = 0; cpu < n_cpus; cpu++) {
+		if (!CPU_ISSET_S(cpu, setsize, mask))
+			continue;
+		for (last = cpu; last + 1 < n_cpus &&
+		     CPU_ISSET_S(last + 1, setsize, mask); last++)
+			;
+		if (last == cpu)
+			pos += snprintf(content + pos, len - pos, "%s%d",
+					pos ? "," : "", cpu);
+		else
+			pos += snprintf(content + pos, len - pos, "%s%d-%d",
+					pos ? "," : "", cpu, last);
+		assert(pos < len);
+		cpu = last;
+	}
+	snprintf(content + pos, len - pos, "\n");
+}
+
+static void test_topo_notifier(void)
+{
+	int n_cpus = wayca_sc_cpus_in_total();
+	wayca_sc_group_attr_t attr;
+	char content[4096], saved[4096];
+	const char *root;
+	cpu_set_t *mask;
+	size_t setsize;
+	wayca_sc_group_t group;
+	int cpu, ret;
+
+	/* abnormal case */
+	ret = wayca_sc_topo_register_notifier(NULL,
+					      WAYCA_SC_TOPO_EV_CPU_OFFLINE, NULL);
+	assert(ret == -EINVAL);
+	ret = wayca_sc_topo_register_notifier(topo_notifier, 0, NULL);
+	assert(ret == -EINVAL);
+	ret = wayca_sc_topo_register_notifier(topo_notifier, 0x100, NULL);
+	assert(ret == -EINVAL);
+	ret = wayca_sc_topo_unregister_notifier(topo_notifier, NULL);
+	assert(ret == -ENOENT);
+
+	ret = wayca_sc_topo_register_notifier(topo_notifier,
+					      WAYCA_SC_TOPO_EV_ALL, NULL);
+	assert(ret == 0);
+
+	/*
+	 * Only a synthetic sysfs can be changed here, take its highest online
+	 * CPU offline and back, along with a group following the hotplug.
+	 * cpu/online is restored as it was found.
+	 */
+	root = getenv("WAYCA_SC_SYSFS_ROOT");
+	setsize = CPU_ALLOC_SIZE(n_cpus);
+	mask = CPU_ALLOC(n_cpus);
+	assert(mask);
+	ret = wayca_sc_total_online_cpu_mask(setsize, mask);
+	assert(ret == 0);
+	if (root && CPU_COUNT_S(setsize, mask) < 2)
+		printf("skip the CPU hotplug, only one CPU is online.\n");
+	if (root && CPU_COUNT_S(setsize, mask) > 1) {
+		assert(read_cpu_online(root, saved, sizeof(saved)) == 0);
+		for (cpu = n_cpus - 1; !CPU_ISSET_S(cpu, setsize, mask); cpu--)
+			;
+
+		ret = wayca_sc_group_create(&group);
+		assert(ret == 0);
+		attr = WT_GF_CPU | WT_GF_COMPACT | WT_GF_PERCPU |
+		       WT_GF_REARRANGE;
+		ret = wayca_sc_group_set_attr(group, &attr);
+		assert(ret == 0);
+
+		CPU_CLR_S(cpu, setsize, mask);
+		format_cpulist(content, sizeof(content), n_cpus, setsize, mask);
+		assert(write_cpu_online(root, content) == 0);
+		ret = wayca_sc_total_online_cpu_mask(setsize, mask);
+		assert(ret == 0 && !CPU_ISSET_S(cpu, setsize, mask));
+		assert(wait_notified() == WAYCA_SC_TOPO_EV_CPU_OFFLINE);
+		assert(notified_id == cpu);
+
+		assert(write_cpu_online(root, saved) == 0);
+		ret = wayca_sc_total_online_cpu_mask(setsize, mask);
+		assert(ret == 0 && CPU_ISSET_S(cpu, setsize, mask));
+		assert(wait_notified() == WAYCA_SC_TOPO_EV_CPU_ONLINE);
+		assert(notified_id == cpu);
+
+		ret = wayca_sc_group_destroy(group);
+		assert(ret == 0);
+	}
+	CPU_FREE(mask);
+
+	ret = wayca_sc_topo_unregister_notifier(topo_notifier, NULL);
+	assert(ret == 0);
+	printf("topology notifier successful.\n");
+}
+
+#ifdef WAYCA_SC_DEBUG
+/* the mask getters don't read sysfs once the hotplug listener runs */
+static void test_cpu_mask_syscalls(void)
+{
+	int n_cpus = wayca_sc_cpus_in_total();
+	unsigned long syscalls;
+	cpu_set_t *cpu_set;
+	size_t setsize;
+	int i, ret;
+
+	setsize = CPU_ALLOC_SIZE(n_cpus);
+	cpu_set = CPU_ALLOC(n_cpus);
+	assert(cpu_set != NULL);
+
+	syscalls = wayca_sc_topo_sysfs_syscalls();
+	for (i = 0; i < 100; i++) {
+		ret = wayca_sc_core_cpu_mask(0, setsize, cpu_set);
+		assert(ret == 0);
+		ret = wayca_sc_node_cpu_mask(0, setsize, cpu_set);
+		assert(ret == 0);
+	}
+	printf("sysfs syscalls of 200 mask queries: %lu\n",
+	       wayca_sc_topo_sysfs_syscalls() - syscalls);
+	CPU_FREE(cpu_set);
+}
+#endif /* WAYCA_SC_DEBUG */
+
+/* each change of the online CPUs makes one new version of the topology */
+static void test_topo_generation(void)
+{
+	unsigned long generation = wayca_sc_topo_generation();
+	int n_cpus = wayca_sc_cpus_in_total();
+	char content[4096], saved[4096];
+	const char *root;
+	cpu_set_t *mask;
+	size_t setsize;
+	int cpu, ret;
+
+	/* the queries read the topology, they never make a new version */
+	ret = wayca_sc_cpus_in_total();
+	assert(ret > 0);
+	ret = wayca_sc_get_core_id(0);
+	assert(ret >= 0);
+	assert(wayca_sc_topo_generation() == generation);
+
+	/* only a synthetic sysfs can be changed, as in test_topo_notifier() */
+	root = getenv("WAYCA_SC_SYSFS_ROOT");
+	setsize = CPU_ALLOC_SIZE(n_cpus);
+	mask = CPU_ALLOC(n_cpus);
+	assert(mask);
+	ret = wayca_sc_total_online_cpu_mask(setsize, mask);
+	assert(ret == 0);
+	if (root && CPU_COUNT_S(setsize, mask) > 1) {
+		assert(read_cpu_online(root, saved, sizeof(saved)) == 0);
+		for (cpu = n_cpus - 1; !CPU_ISSET_S(cpu, setsize, mask); cpu--)
+			;
+
+		CPU_CLR_S(cpu, setsize, mask);
+		format_cpulist(content, sizeof(content), n_cpus, setsize, mask);
+		assert(write_cpu_online(root, content) == 0);
+		assert(wayca_sc_topo_generation() == generation + 1);
+		assert(wayca_sc_topo_generation() == generation + 1);
+
+		assert(write_cpu_online(root, saved) == 0);
+		assert(wayca_sc_topo_generation() == generation + 2);
+		generation += 2;
+	}
+	CPU_FREE(mask);
+	printf("topology generation: %lu\n", generation);
+}
+
+/*
+ * a CPU offline since the init needs the topology rebuilt to come online,
+ * which doesn't hold up the changes of the other CPUs even if it fails
+ */
+static void test_topo_unparsed_cpu(void)
+{
+	unsigned long generation = wayca_sc_topo_generation();
+	int n_cpus = wayca_sc_cpus_in_total();
+	char content[4096], saved[4096];
+	int cpu, offline = -1;
+	const char *root;
+	cpu_set_t *mask;
+	size_t setsize;
+	int ret;
+
+	/* only a synthetic sysfs can be changed, as in test_topo_notifier() */
+	root = getenv("WAYCA_SC_SYSFS_ROOT");
+	setsize = CPU_ALLOC_SIZE(n_cpus);
+	mask = CPU_ALLOC(n_cpus);
+	assert(mask);
+	ret = wayca_sc_total_online_cpu_mask(setsize, mask);
+	assert(ret == 0);
+	for (cpu = 0; cpu < n_cpus; cpu++)
+		if (!CPU_ISSET_S(cpu, setsize, mask))
+			offline = cpu;
+	if (!root || offline < 0 || CPU_COUNT_S(setsize, mask) < 2) {
+		printf("skip the unparsed CPU, no CPU offline since the init.\n");
+		CPU_FREE(mask);
+		return;
+	}
+
+	assert(read_cpu_online(root, saved, sizeof(saved)) == 0);
+	for (cpu = n_cpus - 1; !CPU_ISSET_S(cpu, setsize, mask); cpu--)
+		;
+	CPU_CLR_S(cpu, setsize, mask);
+	CPU_SET_S(offline, setsize, mask);
+	format_cpulist(content, sizeof(content), n_cpus, setsize, mask);
+	assert(write_cpu_online(root, content) == 0);
+
+	/* @offline is online unless its sysfs is incomplete, @cpu is offline */
+	assert(wayca_sc_topo_generation() == generation + 1);
+	ret = wayca_sc_total_online_cpu_mask(setsize, mask);
+	assert(ret == 0);
+	assert(!CPU_ISSET_S(cpu, setsize, mask));
+	printf("CPU%d offline since the init is %s\n", offline,
+	       CPU_ISSET_S(offline, setsize, mask) ? "online" : "kept offline");
+
+	/* a failed rebuild isn't retried by each query */
+	assert(wayca_sc_topo_generation() == generation + 1);
+
+	assert(write_cpu_online(root, saved) == 0);
+	assert(wayca_sc_topo_generation() == generation + 2);
+	ret = wayca_sc_total_online_cpu_mask(setsize, mask);
+	assert(ret == 0);
+	assert(CPU_ISSET_S(cpu, setsize, mask));
+	assert(!CPU_ISSET_S(offline, setsize, mask));
+	CPU_FREE(mask);
+	printf("unparsed CPU successful.\n");
+}
+
+/* dump @mask, or the error of getting it */
+static void dump_mask(FILE *fp, const char *name, int ret, int n_cpus,
+		      size_t setsize, const cpu_set_t *mask)
+{
+	static char content[65536];
+
+	if (ret) {
+		fprintf(fp, " %s:%d", name, ret);
+		return;
+	}
+	format_cpulist(content, sizeof(content), n_cpus, setsize, mask);
+	content[strcspn(content, "\n")] = '\0';
+	fprintf(fp, " %s:%s", name, content);
+}
+
+/* dump the ids, the cpu masks and the caches the topology tells */
+static void dump_topo(FILE *fp)
+{
+	int n_cpus = wayca_sc_cpus_in_total();
+	int n_nodes = wayca_sc_nodes_in_total();
+	size_t setsize = CPU_ALLOC_SIZE(n_cpus);
+	struct wayca_sc_cache_info info;
+	unsigned long mem_size;
+	int cpu, id, level, i, j, ret;
+	cpu_set_t *mask;
+
+	mask = CPU_ALLOC(n_cpus);
+	assert(mask);
+	fprintf(fp, "cpus %d cores %d ccls %d nodes %d packages %d\n", n_cpus,
+		wayca_sc_cores_in_total(), wayca_sc_ccls_in_total(), n_nodes,
+		wayca_sc_packages_in_total());
+	ret = wayca_sc_total_cpu_mask(setsize, mask);
+	dump_mask(fp, "total", ret, n_cpus, setsize, mask);
+	ret = wayca_sc_total_online_cpu_mask(setsize, mask);
+	dump_mask(fp, "online", ret, n_cpus, setsize, mask);
+	fprintf(fp, "\n");
+
+	for (cpu = 0; cpu < n_cpus; cpu++) {
+		fprintf(fp, "cpu%d capacity %d caches %d %d %d %d", cpu,
+			wayca_sc_get_cpu_capacity(cpu),
+			wayca_sc_get_l1d_size(cpu), wayca_sc_get_l1i_size(cpu),
+			wayca_sc_get_l2_size(cpu), wayca_sc_get_l3_size(cpu));
+		id = wayca_sc_get_core_id(cpu);
+		ret = wayca_sc_core_cpu_mask(id, setsize, mask);
+		fprintf(fp, " core %d", id);
+		dump_mask(fp, "cpus", ret, n_cpus, setsize, mask);
+		id = wayca_sc_get_ccl_id(cpu);
+		ret = wayca_sc_ccl_cpu_mask(id, setsize, mask);
+		fprintf(fp, " ccl %d", id);
+		dump_mask(fp, "cpus", ret, n_cpus, setsize, mask);
+		id = wayca_sc_get_node_id(cpu);
+		ret = wayca_sc_node_cpu_mask(id, setsize, mask);
+		fprintf(fp, " node %d", id);
+		dump_mask(fp, "cpus", ret, n_cpus, setsize, mask);
+		id = wayca_sc_get_package_id(cpu);
+		ret = wayca_sc_package_cpu_mask(id, setsize, mask);
+		fprintf(fp, " package %d", id);
+		dump_mask(fp, "cpus", ret, n_cpus, setsize, mask);
+		fprintf(fp, "\n");
+	}
+
+	for (level = 2; level <= 3; level++) {
+		ret = wayca_sc_cache_domains_in_total(level);
+		fprintf(fp, "L%d domains %d\n", level, ret);
+		for (id = 0; id < ret; id++) {
+			memset(&info, 0, sizeof(info));
+			i = wayca_sc_get_cache_domain_info(level, id, &info);
+			fprintf(fp, "L%d domain %d: %d %d %u %u %u %u %u", level,
+				id, i, info.level, info.size, info.line_size,
+				info.ways, info.sets, info.n_cpus);
+			i = wayca_sc_cache_domain_cpu_mask(level, id, setsize,
+							   mask);
+			dump_mask(fp, "cpus", i, n_cpus, setsize, mask);
+			fprintf(fp, "\n");
+		}
+	}
+
+	for (i = 0; i < n_nodes; i++) {
+		mem_size = 0;
+		ret = wayca_sc_get_node_mem_size(i, &mem_size);
+		fprintf(fp, "node%d mem %d %lu distance", i, ret, mem_size);
+		for (j = 0; j < n_nodes; j++)
+			fprintf(fp, " %d", wayca_sc_node_distance(i, j));
+		fprintf(fp, "\n");
+	}
+	CPU_FREE(mask);
+}
+
+/*
+ * Run this test in another process to dump the topology into @file, with
+ * the snapshot in the cache directory @dir. The first line is the count of
+ * the sysfs syscalls to load the topology, 0 if not counted.
+ */
+static void run_dump_topo(const char *dir, const char *file)
+{
+	pid_t pid;
+	int status;
+
+	pid = fork();
+	assert(pid >= 0);
+	if (!pid) {
+		setenv("WAYCA_SC_TOPO_CACHE_DIR", dir, 1);
+		unsetenv("WAYCA_SC_TOPO_CACHE");
+		execl("/proc/self/exe", "wayca_sc_test_topo", "--dump", file,
+		      (char *)NULL);
+		_exit(127);
+	}
+
+	assert(waitpid(pid, &status, 0) == pid);
+	assert(WIFEXITED(status) && !WEXITSTATUS(status));
+}
+
+/* read @file into a new buffer, with the first line returned apart */
+static char *read_dump_topo(const char *file, unsigned long *syscalls)
+{
+	size_t len = 0, cap = 65536;
+	char *buf = malloc(cap);
+	FILE *fp;
+
+	fp = fopen(file, "r");
+	assert(fp && buf);
+	assert(fscanf(fp, "%lu\n", syscalls) == 1);
+	while (!feof(fp)) {
+		if (len + 1 >= cap) {
+			cap *= 2;
+			buf = realloc(buf, cap);
+			assert(buf);
+		}
+		len += fread(buf + len, 1, cap - len - 1, fp);
+		assert(!ferror(fp));
+	}
+	buf[len] = '\0';
+	fclose(fp);
+	return buf;
+}
+
+/*
+ * the topology loaded from the snapshot is the one walked from sysfs: two
+ * processes share an empty cache directory, the first one walks sysfs and
+ * stores the snapshot, which the second one loads
+ */
+static void test_topo_snapshot(void)
+{
+	char dir[] = "/tmp/wayca-topo-XXXXXX";
+	char walked[64], loaded[64], path[512];
+	unsigned long walk_syscalls, load_syscalls;
+	char *walk_dump, *load_dump;
+	struct dirent *ent;
+	int n_snapshots = 0;
+	DIR *dp;
+
+	assert(mkdtemp(dir));
+	snprintf(walked, sizeof(walked), "%s/walked", dir);
+	snprintf(loaded, sizeof(loaded), "%s/loaded", dir);
+
+	run_dump_topo(dir, walked);
+	run_dump_topo(dir, loaded);
+	walk_dump = read_dump_topo(walked, &walk_syscalls);
+	load_dump = read_dump_topo(loaded, &load_syscalls);
+	assert(!strcmp(walk_dump, load_dump));
+	/* the sysfs is walked only once */
+	assert(load_syscalls <= walk_syscalls);
+#ifdef WAYCA_SC_DEBUG
+	assert(load_syscalls < walk_syscalls);
+#endif
+
+	dp = opendir(dir);
+	assert(dp);
+	while ((ent = readdir(dp))) {
+		if (ent->d_name[0] == '.')
+			continue;
+		if (!strncmp(ent->d_name, "topo-", 5))
+			n_snapshots++;
+		snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+		assert(!unlink(path));
+	}
+	closedir(dp);
+	assert(!rmdir(dir));
+	assert(n_snapshots == 1);
+
+	printf("topology snapshot: %lu sysfs syscalls walked, %lu loaded\n",
+	       walk_syscalls, load_syscalls);
+	free(walk_dump);
+	free(load_dump);
+}
+
+#ifdef WAYCA_SC_DEBUG
+/*
+ * the replaced versions of the topology are freed, and the device names
+ * returned stay valid across the versions
+ */
+static void test_topo_reclaim(void)
+{
+	int n_cpus = wayca_sc_cpus_in_total();
+	char content[4096], saved[4096];
+	const char **names, **names_after;
+	size_t num = 0, i;
+	const char *root;
+	cpu_set_t *mask;
+	size_t setsize;
+	int cpu, ret;
+
+	/* only a synthetic sysfs can be changed, as in test_topo_notifier() */
+	root = getenv("WAYCA_SC_SYSFS_ROOT");
+	setsize = CPU_ALLOC_SIZE(n_cpus);
+	mask = CPU_ALLOC(n_cpus);
+	assert(mask);
+	ret = wayca_sc_total_online_cpu_mask(setsize, mask);
+	assert(ret == 0);
+	if (!root || CPU_COUNT_S(setsize, mask) < 2) {
+		printf("skip the topology reclaim, no CPU to hotplug.\n");
+		CPU_FREE(mask);
+		return;
+	}
+
+	ret = wayca_sc_get_device_list(-1, &num, NULL);
+	assert(ret == 0);
+	names = calloc(num + 1, sizeof(*names));
+	names_after = calloc(num + 1, sizeof(*names_after));
+	assert(names && names_after);
+	ret = wayca_sc_get_device_list(-1, &num, names);
+	assert(ret == 0);
+
+	assert(read_cpu_online(root, saved, sizeof(saved)) == 0);
+	for (cpu = n_cpus - 1; !CPU_ISSET_S(cpu, setsize, mask); cpu--)
+		;
+	CPU_CLR_S(cpu, setsize, mask);
+	format_cpulist(content, sizeof(content), n_cpus, setsize, mask);
+
+	for (i = 0; i < 50; i++) {
+		assert(write_cpu_online(root, content) == 0);
+		wayca_sc_topo_generation();
+		assert(write_cpu_online(root, saved) == 0);
+		wayca_sc_topo_generation();
+		assert(wayca_sc_topo_nr_retired() <= 2);
+	}
+
+	ret = wayca_sc_get_device_list(-1, &num, names_after);
+	assert(ret == 0);
+	for (i = 0; i < num; i++)
+		assert(names_after[i] == names[i]);
+
+	free(names);
+	free(names_after);
+	CPU_FREE(mask);
+	printf("topology reclaim successful, %lu versions retired.\n",
+	       wayca_sc_topo_nr_retired());
+}
+
+/* report the cost of reading sysfs, to make regressions visible */
+static void test_sysfs_syscalls(unsigned long init_syscalls)
+{
+	unsigned long syscalls = wayca_sc_topo_sysfs_syscalls();
+
+	assert(syscalls >= init_syscalls);
+	printf("sysfs syscalls: %lu on init, %lu in total\n",
+	       init_syscalls, syscalls);
+}
+#endif /* WAYCA_SC_DEBUG */
+
+int main(int argc, char *argv[])
+{
+	unsigned long init_syscalls = 0;
+	FILE *fp;
+
+#ifdef WAYCA_SC_DEBUG
+	init_syscalls = wayca_sc_topo_sysfs_syscalls();
+#endif
+	/* dump the topology for test_topo_snapshot() */
+	if (argc == 3 && !strcmp(argv[1], "--dump")) {
+		fp = fopen(argv[2], "w");
+		assert(fp);
+		fprintf(fp, "%lu\n", init_syscalls);
+		dump_topo(fp);
+		assert(!fclose(fp));
+		return 0;
+	}
+
 	wayca_sc_topo_print();
 
 	test_entity_number();
 	test_get_entity_id();
+	test_get_cpu_ids();
 	test_get_cpu_list();
 	test_get_cache_info();
+	test_cpu_capacity();
+	test_cache_domain();
+	test_domain_masks();
+	test_node_distance();
+	test_mem_nodes();
+	test_node_mem_stat();
 	test_get_io_info();
 	test_get_device_info();
 	test_get_irq_info();
+	test_device_near_cpus();
+	test_pci_walk();
+	test_topo_notifier();
+#ifdef WAYCA_SC_DEBUG
+	test_cpu_mask_syscalls();
+#endif
+	test_topo_generation();
+	test_topo_unparsed_cpu();
+	test_topo_snapshot();
+#ifdef WAYCA_SC_DEBUG
+	test_topo_reclaim();
+	test_sysfs_syscalls(init_syscalls);
+#endif
 
 	return 0;
 }
@@ -0,0 +1,404 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+#
+# Copyright (c) 2022 HiSilicon Technologies Co., Ltd.
+# Wayca scheduler is licensed under Mulan PSL v2.
+# You can use this software according to the terms and conditions of the Mulan PSL v2.
+# You may obtain a copy of Mulan PSL v2 at:
+# http://license.coscl.org.cn/MulanPSL2
+# THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+# EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+# MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+#
+# See the Mulan PSL v2 for more details.
+#
+
+"""
+generate a synthetic sysfs and procfs tree of an arbitrary machine
+
+The tree holds the attributes wayca-scheduler reads to build its topology,
+so the library can be loaded with a simulated topology by:
+
+    WAYCA_SC_SYSFS_ROOT=<output>/sys WAYCA_SC_PROCFS_ROOT=<output>/proc
+"""
+
+import argparse
+import os
+import shutil
+import sys
+import uuid
+
+CPU_CAPACITY_SCALE = 1024
+NODE_MEM_KB = 64 * 1024 * 1024
+MEM_NODE_MEM_KB = 256 * 1024 * 1024
+
+# memory tiers of the kernel, MEMTIER_ADISTANCE_DRAM and a slower one
+DRAM_TIER = 4
+SLOW_TIER = 22
+
+# HMAT read/write bandwidth in MB/s and latency in ns from the initiator
+DRAM_ACCESS = (120000, 100000, 90, 100)
+MEM_NODE_ACCESS = (40000, 30000, 250, 280)
+MEM_NODE_CACHE = 4 * 1024 * 1024 * 1024
+# current link speed in GT/s and width of the root ports and the devices
+PCI_PORT_LINK = ('16.0', 16)
+PCI_DEVICE_LINK = ('8.0', 8)
+
+
+def cpulist(cpus):
+    """format a sorted list of ids in the sysfs list format, e.g. 0-3,8"""
+    ranges = []
+    for cpu in sorted(cpus):
+        if ranges and ranges[-1][1] == cpu - 1:
+            ranges[-1][1] = cpu
+        else:
+            ranges.append([cpu, cpu])
+    return ','.join(str(a) if a == b else '%d-%d' % (a, b) for a, b in ranges)
+
+
+def cpumask(cpus):
+    """format a list of ids in the sysfs mask format, e.g. 00000000,0000000f"""
+    mask = 0
+    for cpu in cpus:
+        mask |= 1 << cpu
+    words = []
+    while True:
+        words.append('%08x' % (mask & 0xffffffff))
+        mask >>= 32
+        if not mask:
+            break
+    return ','.join(reversed(words))
+
+
+def write(path, content):
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, 'w') as f:
+        f.write('%s\n' % content)
+
+
+class Machine:
+    """the CPUs of the machine, numbered as the firmware would"""
+
+    def __init__(self, args):
+        self.args = args
+        self.cpus = []          # (package, node, ccl, core, thread) of each CPU
+        self.n_nodes = args.packages * args.nodes
+        # the CPU-less memory nodes are numbered after the nodes of CPUs
+        self.n_mem_nodes = args.packages * args.mem_nodes
+        self.n_ccls = self.n_nodes * args.ccls
+        self.n_cores = self.n_ccls * args.cores
+
+        # SMT siblings are numbered either adjacently or one core set apart
+        if args.interleave_smt:
+            order = [(core, thread) for thread in range(args.smt)
+                     for core in range(self.n_cores)]
+        else:
+            order = [(core, thread) for core in range(self.n_cores)
+                     for thread in range(args.smt)]
+        for core, thread in order:
+            ccl = core // args.cores
+            node = ccl // args.ccls
+            package = node // args.nodes
+            self.cpus.append((package, node, ccl, core, thread))
+
+        self.offline = set()
+        for item in args.offline.split(',') if args.offline else []:
+            a, _, b = item.partition('-')
+            self.offline.update(range(int(a), int(b or a) + 1))
+
+        # the online CPUs of each (level, id), as the sibling lists show
+        self.domains = {}
+        for cpu, ids in enumerate(self.cpus):
+            if cpu in self.offline:
+                continue
+            for index, value in enumerate(ids[:4]):
+                self.domains.setdefault((index, value), []).append(cpu)
+
+    def select(self, index, value):
+        return self.domains.get((index, value), [])
+
+    def capacity(self, cpu):
+        ccl = self.cpus[cpu][2]
+        if ccl % self.args.ccls < self.args.little_ccls:
+            return self.args.little_capacity
+        return CPU_CAPACITY_SCALE
+
+    def node_package(self, node):
+        if node < self.n_nodes:
+            return node // self.args.nodes
+        return (node - self.n_nodes) // self.args.mem_nodes
+
+    def distance(self, a, b):
+        if a == b:
+            return 10
+        hops = abs(self.node_package(a) - self.node_package(b))
+        # a memory node is a bit farther than a node of CPUs
+        extra = 4 * ((a >= self.n_nodes) + (b >= self.n_nodes))
+        if not hops:
+            return 12 + extra
+        return 20 + 10 * hops + extra
+
+
+def gen_cpus(sysfs, machine):
+    args = machine.args
+    cpu_dir = os.path.join(sysfs, 'devices/system/cpu')
+    n_cpus = len(machine.cpus)
+    online = [cpu for cpu in range(n_cpus) if cpu not in machine.offline]
+
+    write(os.path.join(cpu_dir, 'kernel_max'), max(args.kernel_max, n_cpus) - 1)
+    write(os.path.join(cpu_dir, 'possible'), cpulist(range(n_cpus)))
+    write(os.path.join(cpu_dir, 'present'), cpulist(range(n_cpus)))
+    write(os.path.join(cpu_dir, 'online'), cpulist(online))
+
+    for cpu, (package, node, ccl, core, _) in enumerate(machine.cpus):
+        d = os.path.join(cpu_dir, 'cpu%d' % cpu)
+        os.makedirs(d, exist_ok=True)
+        os.symlink('../../node/node%d' % node, os.path.join(d, 'node%d' % node))
+        if cpu:
+            write(os.path.join(d, 'online'), int(cpu not in machine.offline))
+        if args.little_ccls:
+            write(os.path.join(d, 'cpu_capacity'), machine.capacity(cpu))
+
+        if cpu in machine.offline:
+            continue
+
+        core_cpus = machine.select(3, core)
+        ccl_cpus = machine.select(2, ccl)
+        node_cpus = machine.select(1, node)
+        package_cpus = machine.select(0, package)
+
+        topo = os.path.join(d, 'topology')
+        write(os.path.join(topo, 'core_id'), core)
+        write(os.path.join(topo, 'core_cpus_list'), cpulist(core_cpus))
+        write(os.path.join(topo, 'core_cpus'), cpumask(core_cpus))
+        write(os.path.join(topo, 'thread_siblings_list'), cpulist(core_cpus))
+        if args.ccls > 1:
+            write(os.path.join(topo, 'cluster_id'), ccl)
+            write(os.path.join(topo, 'cluster_cpus_list'), cpulist(ccl_cpus))
+            write(os.path.join(topo, 'cluster_cpus'), cpumask(ccl_cpus))
+        write(os.path.join(topo, 'physical_package_id'), package)
+        write(os.path.join(topo, 'package_cpus_list'), cpulist(package_cpus))
+        write(os.path.join(topo, 'package_cpus'), cpumask(package_cpus))
+
+        # L1d, L1i and L2 private to the core, L3 shared in the node
+        caches = [
+            (1, 'Data', '64K', 4, 256, core, core_cpus),
+            (1, 'Instruction', '64K', 4, 256, core, core_cpus),
+            (2, 'Unified', '512K', 8, 1024, core, core_cpus),
+            (3, 'Unified', '32768K', 16, 32768, node, node_cpus),
+        ]
+        for index, (level, ctype, size, ways, sets, cid, cpus) in \
+                enumerate(caches):
+            c = os.path.join(d, 'cache/index%d' % index)
+            write(os.path.join(c, 'id'), cid)
+            write(os.path.join(c, 'level'), level)
+            write(os.path.join(c, 'type'), ctype)
+            write(os.path.join(c, 'size'), size)
+            write(os.path.join(c, 'ways_of_associativity'), ways)
+            write(os.path.join(c, 'number_of_sets'), sets)
+            write(os.path.join(c, 'coherency_line_size'), 64)
+            write(os.path.join(c, 'physical_line_partition'), 1)
+            write(os.path.join(c, 'allocation_policy'), 'ReadWriteAllocate')
+            write(os.path.join(c, 'write_policy'), 'WriteBack')
+            write(os.path.join(c, 'shared_cpu_list'), cpulist(cpus))
+            write(os.path.join(c, 'shared_cpu_map'), cpumask(cpus))
+
+
+def gen_access(d, initiator, access):
+    """the HMAT attributes of node directory d from its best initiator"""
+    for cls in ['access0', 'access1']:
+        a = os.path.join(d, cls, 'initiators')
+        os.makedirs(a, exist_ok=True)
+        os.symlink('../../../node%d' % initiator,
+                   os.path.join(a, 'node%d' % initiator))
+        for name, value in zip(['read_bandwidth', 'write_bandwidth',
+                                'read_latency', 'write_latency'], access):
+            write(os.path.join(a, name), value)
+
+
+def gen_nodes(sysfs, machine):
+    args = machine.args
+    node_dir = os.path.join(sysfs, 'devices/system/node')
+    cpu_nodes = range(machine.n_nodes)
+    nodes = range(machine.n_nodes + machine.n_mem_nodes)
+
+    write(os.path.join(node_dir, 'possible'), cpulist(nodes))
+    write(os.path.join(node_dir, 'online'), cpulist(nodes))
+    write(os.path.join(node_dir, 'has_cpu'), cpulist(cpu_nodes))
+    write(os.path.join(node_dir, 'has_memory'), cpulist(nodes))
+
+    for node in nodes:
+        d = os.path.join(node_dir, 'node%d' % node)
+        cpus = machine.select(1, node) if node in cpu_nodes else []
+        mem_kb = NODE_MEM_KB if node in cpu_nodes else MEM_NODE_MEM_KB
+        write(os.path.join(d, 'cpulist'), cpulist(cpus))
+        write(os.path.join(d, 'cpumap'), cpumask(cpus))
+        write(os.path.join(d, 'distance'),
+              ' '.join(str(machine.distance(node, n)) for n in nodes))
+        write(os.path.join(d, 'meminfo'), '\n'.join([
+            'Node %d MemTotal:       %8d kB' % (node, mem_kb),
+            'Node %d MemFree:        %8d kB' % (node, mem_kb // 2),
+            'Node %d MemUsed:        %8d kB' % (node, mem_kb // 2),
+            'Node %d FilePages:      %8d kB' % (node, mem_kb // 8),
+            'Node %d HugePages_Total: %7d' % (node, 0),
+            'Node %d HugePages_Free:  %7d' % (node, 0)]))
+
+        if not args.hmat:
+            continue
+        if node in cpu_nodes:
+            gen_access(d, node, DRAM_ACCESS)
+            continue
+        # the first node of the package is the best initiator
+        gen_access(d, machine.node_package(node) * args.nodes,
+                   MEM_NODE_ACCESS)
+        c = os.path.join(d, 'memory_side_cache/index1')
+        write(os.path.join(c, 'size'), MEM_NODE_CACHE)
+        write(os.path.join(c, 'line_size'), 64)
+        write(os.path.join(c, 'indexing'), 0)
+        write(os.path.join(c, 'write_policy'), 0)
+
+    tiers = os.path.join(sysfs, 'devices/virtual/memory_tiering')
+    write(os.path.join(tiers, 'memory_tier%d/nodelist' % DRAM_TIER),
+          cpulist(cpu_nodes))
+    if machine.n_mem_nodes:
+        write(os.path.join(tiers, 'memory_tier%d/nodelist' % SLOW_TIER),
+              cpulist(range(machine.n_nodes, len(nodes))))
+
+
+def gen_pci_function(sysfs, d, pci_class, node, cpus, link):
+    """the attributes of a PCI function at @d, below sysfs/devices"""
+    os.makedirs(d, exist_ok=True)
+    up = os.path.relpath(os.path.join(sysfs, 'bus/pci'), d)
+    os.symlink(up, os.path.join(d, 'subsystem'))
+    write(os.path.join(d, 'class'), pci_class)
+    write(os.path.join(d, 'vendor'), '0x19e5')
+    write(os.path.join(d, 'device'), '0xa222')
+    write(os.path.join(d, 'numa_node'), node)
+    write(os.path.join(d, 'local_cpulist'), cpulist(cpus))
+    write(os.path.join(d, 'enable'), 1)
+    write(os.path.join(d, 'current_link_speed'), '%s GT/s PCIe' % link[0])
+    write(os.path.join(d, 'current_link_width'), link[1])
+
+
+def gen_devices(sysfs, procfs, machine):
+    """
+    a host bridge of each node with a root port, and the PCI devices below
+    the port, each with one MSI interrupt
+    """
+    args = machine.args
+    irq = 32
+
+    os.makedirs(os.path.join(sysfs, 'bus/pci/devices'), exist_ok=True)
+    for node in range(machine.n_nodes):
+        cpus = machine.select(1, node)
+        bus = node * 0x10
+        root = os.path.join(sysfs, 'devices/pci0000:%02x' % bus)
+        port = os.path.join(root, '0000:%02x:00.0' % bus)
+        gen_pci_function(sysfs, port, '0x060400', node, cpus,
+                         PCI_PORT_LINK)
+        for dev in range(args.pci):
+            name = '0000:%02x:%02x.0' % (bus + 1, dev)
+            d = os.path.join(port, name)
+            gen_pci_function(sysfs, d, '0x020000', node, cpus,
+                             PCI_DEVICE_LINK)
+            write(os.path.join(d, 'irq'), irq)
+            write(os.path.join(d, 'msi_irqs/%d' % irq), 'msi')
+
+            write(os.path.join(sysfs, 'kernel/irq/%d/actions' % irq), name)
+            write(os.path.join(sysfs, 'kernel/irq/%d/chip_name' % irq),
+                  'ITS-MSI')
+            write(os.path.join(sysfs, 'kernel/irq/%d/type' % irq), 'edge')
+            write(os.path.join(procfs, 'irq/%d/smp_affinity' % irq),
+                  cpumask(cpus))
+            # the kernel handles the IRQ on one of the CPUs it may use
+            write(os.path.join(procfs,
+                               'irq/%d/effective_affinity_list' % irq),
+                  cpulist([cpus[-1 - dev % len(cpus)]]))
+            irq += 1
+
+
+def gen_procfs(procfs, machine):
+    write(os.path.join(procfs, 'sys/kernel/random/boot_id'), uuid.uuid4())
+    os.makedirs(os.path.join(procfs, 'irq'), exist_ok=True)
+
+    # the online CPUs, idle so far
+    stat = ['cpu  0 0 0 0 0 0 0 0 0 0']
+    stat += ['cpu%d 0 0 0 0 0 0 0 0 0 0' % cpu
+             for cpu in range(len(machine.cpus)) if cpu not in machine.offline]
+    write(os.path.join(procfs, 'stat'), '\n'.join(stat))
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Generate a synthetic sysfs/procfs tree for wayca-scheduler')
+    parser.add_argument('output', help='directory to create sys/ and proc/ in')
+    parser.add_argument('-p', '--packages', type=int, default=2,
+                        help='number of packages (default: %(default)s)')
+    parser.add_argument('-n', '--nodes', type=int, default=2,
+                        help='NUMA nodes per package (default: %(default)s)')
+    parser.add_argument('-c', '--ccls', type=int, default=8,
+                        help='clusters per node, 1 for no cluster '
+                        '(default: %(default)s)')
+    parser.add_argument('-k', '--cores', type=int, default=4,
+                        help='cores per cluster (default: %(default)s)')
+    parser.add_argument('-t', '--smt', type=int, default=1,
+                        help='threads per core (default: %(default)s)')
+    parser.add_argument('--interleave-smt', action='store_true',
+                        help='number the SMT siblings one core set apart, '
+                        'as x86 firmware does')
+    parser.add_argument('--little-ccls', type=int, default=0,
+                        help='little clusters at the start of each node')
+    parser.add_argument('--little-capacity', type=int, default=512,
+                        help='cpu_capacity of the little clusters '
+                        '(default: %(default)s)')
+    parser.add_argument('--offline', default='',
+                        help='CPUs offline, in the list format, e.g. 4-7,9')
+    parser.add_argument('--mem-nodes', type=int, default=0,
+                        help='CPU-less memory nodes per package, like CXL '
+                        'memory (default: %(default)s)')
+    parser.add_argument('--hmat', action='store_true',
+                        help='describe the memory access performance '
+                        'and the memory-side caches as the HMAT does')
+    parser.add_argument('--pci', type=int, default=2,
+                        help='PCI devices per node, below a root port (default: %(default)s)')
+    parser.add_argument('--kernel-max', type=int, default=4096,
+                        help='NR_CPUS of the kernel (default: %(default)s)')
+    parser.add_argument('-f', '--force', action='store_true',
+                        help='remove the output directory if it exists')
+    args = parser.parse_args()
+
+    for name in ['packages', 'nodes', 'ccls', 'cores', 'smt']:
+        if getattr(args, name) < 1:
+            parser.error('--%s must be positive' % name)
+    if args.mem_nodes < 0:
+        parser.error('--mem-nodes must not be negative')
+    if not 0 <= args.little_ccls <= args.ccls:
+        parser.error('--little-ccls must be within --ccls')
+
+    sysfs = os.path.join(args.output, 'sys')
+    procfs = os.path.join(args.output, 'proc')
+    if os.path.exists(args.output):
+        if not args.force:
+            parser.error('%s exists, use -f to overwrite' % args.output)
+        shutil.rmtree(args.output)
+
+    machine = Machine(args)
+    if 0 in machine.offline:
+        parser.error('CPU 0 can not be offline')
+
+    gen_cpus(sysfs, machine)
+    gen_nodes(sysfs, machine)
+    gen_devices(sysfs, procfs, machine)
+    gen_procfs(procfs, machine)
+
+    print('%d CPUs in %d packages, %d nodes and %d clusters' %
+          (len(machine.cpus), args.packages, machine.n_nodes, machine.n_ccls))
+    if machine.n_mem_nodes:
+        print('%d CPU-less memory nodes' % machine.n_mem_nodes)
+    print('export WAYCA_SC_SYSFS_ROOT=%s' % os.path.abspath(sysfs))
+    print('export WAYCA_SC_PROCFS_ROOT=%s' % os.path.abspath(procfs))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -37,9 +37,6 @@ static int output_dev;
 static bool numa_mem_error;
 static bool core_mem_error;
 
-#define ccl_set_t cpu_set_t
-#define core_set_t cpu_set_t
-
 static int numa_prop_print(xmlNodePtr node);
 static int numa_prop_verify(xmlNodePtr node);
 static int numa_format(xmlDocPtr doc, xmlValidCtxtPtr ctxt, xmlDtdPtr topo_dtd);
@@ -349,13 +346,18 @@ static int topo_build_single_elem(xmlNodePtr node, int index,
 	return 0;
 }
 
-static int topo_build_next_elem(xmlNodePtr node, cpu_set_t mask, int elem_nr,
-				const xmlChar *next_elem)
+/*
+ * The masks of the elements are sized by the number of them, which can be
+ * more than a cpu_set_t holds, so @mask is of CPU_ALLOC_SIZE(@elem_nr).
+ */
+static int topo_build_next_elem(xmlNodePtr node, const cpu_set_t *mask,
+				int elem_nr, const xmlChar *next_elem)
 {
+	size_t setsize = CPU_ALLOC_SIZE(elem_nr);
 	int ret, i;
 
 	for (i = 0; i < elem_nr; i++) {
-		ret = CPU_ISSET(i, &mask);
+		ret = CPU_ISSET_S(i, setsize, mask);
 		if (!ret)
 			continue;
 
@@ -497,7 +499,7 @@ static int core_prop_verify(xmlNodePtr node)
 static int core_elem_build(xmlNodePtr node)
 {
 	const xmlChar *next_elem = BAD_CAST topo_elem[TOPO_CPU].name;
-	cpu_set_t mask;
+	cpu_set_t *mask;
 	int c_nr = 1;
 	int core_id;
 	int ret, i;
@@ -506,22 +508,25 @@ static int core_elem_build(xmlNodePtr node)
 	if (ret)
 		return ret;
 
-	ret = wayca_sc_core_cpu_mask(core_id, sizeof(cpu_set_t),
-				     &mask);
-	if (ret < 0) {
-		topo_err("fail to get core cpu mask.");
-		return ret;
-	}
-
 	c_nr = wayca_sc_cpus_in_total();
 	if (c_nr < 0) {
 		topo_err("number of cpu is wrong.");
 		return c_nr;
 	}
 
+	mask = CPU_ALLOC(c_nr);
+	if (!mask)
+		return -ENOMEM;
+
+	ret = wayca_sc_core_cpu_mask(core_id, CPU_ALLOC_SIZE(c_nr), mask);
+	if (ret < 0) {
+		topo_err("fail to get core cpu mask.");
+		goto mask_free;
+	}
+
 	/* find one online CPU in this core, i corresponds to CPU id */
 	for (i = 0; i < c_nr; i++) {
-		ret = CPU_ISSET(i, &mask);
+		ret = CPU_ISSET_S(i, CPU_ALLOC_SIZE(c_nr), mask);
 		if (!ret)
 			continue;
 		break;
@@ -529,12 +534,15 @@ static int core_elem_build(xmlNodePtr node)
 	ret = core_prop_build(node, i);
 	if (ret) {
 		topo_err("build core properties fail, ret = %d.", ret);
-		return ret;
+		goto mask_free;
 	}
 
 	ret = topo_build_next_elem(node, mask, c_nr, next_elem);
 	if (ret)
 		topo_err("fail to create core node.");
+
+mask_free:
+	CPU_FREE(mask);
 	return ret;
 }
 
@@ -557,7 +565,7 @@ static int ccl_format(xmlDocPtr doc, xmlValidCtxtPtr ctxt, xmlDtdPtr topo_dtd)
 static int ccl_elem_build(xmlNodePtr node)
 {
 	const xmlChar *next_elem = BAD_CAST topo_elem[TOPO_CORE].name;
-	core_set_t mask;
+	cpu_set_t *mask;
 	int c_nr = 1;
 	int ccl_id;
 	int ret;
@@ -566,23 +574,28 @@ static int ccl_elem_build(xmlNodePtr node)
 	if (ret)
 		return ret;
 
-	ret = wayca_sc_ccl_core_mask(ccl_id, sizeof(core_set_t),
-				     &mask);
-	if (ret < 0) {
-		topo_err("fail to get cluster core mask.");
-		return ret;
-	}
-
 	c_nr = wayca_sc_cores_in_total();
 	if (c_nr < 0) {
 		topo_err("number of core is wrong, ret = %d.", c_nr);
 		return c_nr;
 	}
 
+	mask = CPU_ALLOC(c_nr);
+	if (!mask)
+		return -ENOMEM;
+
+	ret = wayca_sc_ccl_core_mask(ccl_id, CPU_ALLOC_SIZE(c_nr), mask);
+	if (ret < 0) {
+		topo_err("fail to get cluster core mask.");
+		goto mask_free;
+	}
+
 	ret = topo_build_next_elem(node, mask, c_nr, next_elem);
 	if (ret)
 		topo_err("fail to create core node.");
 
+mask_free:
+	CPU_FREE(mask);
 	return ret;
 }
 
@@ -619,7 +632,7 @@ static int numa_prop_build(xmlNodePtr numa_node, int numa_id)
 	xmlAttrPtr prop;
 	int cache_size = -1;
 	int num_cpu, i;
-	cpu_set_t mask;
+	cpu_set_t *mask;
 	int ret;
 
 	ret = wayca_sc_get_node_mem_size(numa_id, &mem_size);
@@ -634,21 +647,26 @@ static int numa_prop_build(xmlNodePtr numa_node, int numa_id)
 	if (!prop)
 		return -ENOMEM;
 
-	ret = wayca_sc_node_cpu_mask(numa_id, sizeof(cpu_set_t),
-				     &mask);
+	num_cpu = wayca_sc_cpus_in_total();
+	if (num_cpu < 0) {
+		topo_err("number of cpu is wrong.");
+		return num_cpu;
+	}
+
+	mask = CPU_ALLOC(num_cpu);
+	if (!mask)
+		return -ENOMEM;
+
+	ret = wayca_sc_node_cpu_mask(numa_id, CPU_ALLOC_SIZE(num_cpu), mask);
 	if (ret < 0) {
 		topo_err("fail to get node cpu mask.");
+		CPU_FREE(mask);
 		return ret;
 	}
 
 	/* read this node's L3_cache from node's online cpus */
-	num_cpu = wayca_sc_cpus_in_total();
-	if (num_cpu < 0) {
-		topo_err("number of cpu is wrong.");
-		return num_cpu;
-	}
 	for (i = 0; i < num_cpu; i++) {
-		ret = CPU_ISSET(i, &mask);
+		ret = CPU_ISSET_S(i, CPU_ALLOC_SIZE(num_cpu), mask);
 		if (!ret)
 			continue;
 
@@ -658,6 +676,7 @@ static int numa_prop_build(xmlNodePtr numa_node, int numa_id)
 		if (cache_size > 0)
 			break;
 	}
+	CPU_FREE(mask);
 
 	snprintf(content, sizeof(content), "%dKB", cache_size);
 	prop = xmlNewProp(numa_node, BAD_CAST"L3_cache", BAD_CAST content);
@@ -742,8 +761,7 @@ buffer_free:
 static int numa_elem_build(xmlNodePtr node)
 {
 	const xmlChar *next_elem = BAD_CAST topo_elem[TOPO_CCL].name;
-	core_set_t core_mask;
-	ccl_set_t ccl_mask;
+	cpu_set_t *mask;
 	int numa_id;
 	int c_nr;
 	int ret;
@@ -768,32 +786,41 @@ static int numa_elem_build(xmlNodePtr node)
 		}
 		next_elem = BAD_CAST topo_elem[TOPO_CORE].name;
 
-		ret = wayca_sc_node_core_mask(numa_id, sizeof(core_set_t),
-					      &core_mask);
+		mask = CPU_ALLOC(c_nr);
+		if (!mask)
+			return -ENOMEM;
+
+		ret = wayca_sc_node_core_mask(numa_id, CPU_ALLOC_SIZE(c_nr),
+					      mask);
 		if (ret < 0) {
 			topo_err("fail to get node core mask.");
-			return ret;
+			goto mask_free;
 		}
 
-		ret = topo_build_next_elem(node, core_mask, c_nr, next_elem);
+		ret = topo_build_next_elem(node, mask, c_nr, next_elem);
 		if (ret) {
 			topo_err("fail to create core node.");
-			return ret;
+			goto mask_free;
 		}
 	} else {
-		ret = wayca_sc_node_ccl_mask(numa_id, sizeof(ccl_set_t),
-					     &ccl_mask);
+		mask = CPU_ALLOC(c_nr);
+		if (!mask)
+			return -ENOMEM;
+
+		ret = wayca_sc_node_ccl_mask(numa_id, CPU_ALLOC_SIZE(c_nr),
+					     mask);
 		if (ret < 0) {
 			topo_err("fail to get node cluster mask.");
-			return ret;
+			goto mask_free;
 		}
 
-		ret = topo_build_next_elem(node, ccl_mask, c_nr, next_elem);
+		ret = topo_build_next_elem(node, mask, c_nr, next_elem);
 		if (ret) {
 			topo_err("fail to create cluster node.");
-			return ret;
+			goto mask_free;
 		}
 	}
+	CPU_FREE(mask);
 
 	if (!output_dev)
 		return ret;
@@ -803,6 +830,10 @@ static int numa_elem_build(xmlNodePtr node)
 		topo_err("fail to create device node in numa.");
 
 	return ret;
+
+mask_free:
+	CPU_FREE(mask);
+	return ret;
 }
 
 static int pkg_format(xmlDocPtr doc, xmlValidCtxtPtr ctxt,
@@ -825,7 +856,7 @@ static int pkg_format(xmlDocPtr doc, xmlValidCtxtPtr ctxt,
 static int package_elem_build(xmlNodePtr node)
 {
 	const xmlChar *next_elem = BAD_CAST topo_elem[TOPO_NUMA].name;
-	node_set_t mask;
+	node_set_t *mask;
 	int package_id;
 	int numa_nr;
 	int ret;
@@ -834,23 +865,29 @@ static int package_elem_build(xmlNodePtr node)
 	if (ret)
 		return ret;
 
-	ret = wayca_sc_package_node_mask(package_id, sizeof(node_set_t),
-					 &mask);
-	if (ret < 0) {
-		topo_err("fail to get package node mask.");
-		return ret;
-	}
-
 	numa_nr = wayca_sc_nodes_in_total();
 	if (numa_nr < 0) {
 		topo_err("number of numa is wrong.");
 		return numa_nr;
 	}
 
+	mask = CPU_ALLOC(numa_nr);
+	if (!mask)
+		return -ENOMEM;
+
+	ret = wayca_sc_package_node_mask(package_id, CPU_ALLOC_SIZE(numa_nr),
+					 mask);
+	if (ret < 0) {
+		topo_err("fail to get package node mask.");
+		goto mask_free;
+	}
+
 	ret = topo_build_next_elem(node, mask, numa_nr, next_elem);
 	if (ret)
 		topo_err("fail to create numa node.");
 
+mask_free:
+	CPU_FREE(mask);
 	return ret;
 }
 
@@ -1446,6 +1483,25 @@ static int pci_dev_elem_build(xmlNodePtr pci_node)
 	if (!prop)
 		return -ENOMEM;
 
+	prop = xmlNewProp(pci_node, BAD_CAST"root", BAD_CAST dev_info.root);
+	if (!prop)
+		return -ENOMEM;
+
+	prop = xmlNewProp(pci_node, BAD_CAST"parent",
+			  BAD_CAST (dev_info.parent ? dev_info.parent : "none"));
+	if (!prop)
+		return -ENOMEM;
+
+	snprintf(content, sizeof(content), "%d", dev_info.link_speed);
+	prop = xmlNewProp(pci_node, BAD_CAST"link_speed", BAD_CAST content);
+	if (!prop)
+		return -ENOMEM;
+
+	snprintf(content, sizeof(content), "%d", dev_info.link_width);
+	prop = xmlNewProp(pci_node, BAD_CAST"link_width", BAD_CAST content);
+	if (!prop)
+		return -ENOMEM;
+
 	return 0;
 }
 
@@ -1603,7 +1659,11 @@ static int pci_dev_format(xmlDocPtr doc, xmlValidCtxtPtr ctxt,
 		"class_id",
 		"vendor_id",
 		"device_id",
-		"irq_nr"
+		"irq_nr",
+		"root",
+		"parent",
+		"link_speed",
+		"link_width"
 	};
 	int ret;
 
@@ -1709,7 +1769,11 @@ static int pci_prop_print(xmlNodePtr node)
 		"class_id",
 		"vendor_id",
 		"device_id",
-		"irq_nr"
+		"irq_nr",
+		"root",
+		"parent",
+		"link_speed",
+		"link_width"
 	};
 	int ret;
 
@@ -1761,23 +1825,36 @@ prop_free:
 
 static int pci_prop_verify(xmlNodePtr node)
 {
+	static const struct {
+		const char *name;
+		long min;
+		long max;
+	} pci_num_props[] = {
+		{ "smmu_idx", -1, UINT8_MAX },
+		{ "link_speed", 0, INT32_MAX },
+		{ "link_width", 0, UINT8_MAX },
+	};
 	char *prop;
 	int ret = 0;
+	int i;
 
-	prop = (char *)xmlGetProp(node, BAD_CAST "smmu_idx");
-	if (!prop) {
-		topo_err("get %s prop %s failed.", node->name, "smmu_idx");
-		return -ENOENT;
-	}
+	for (i = 0; i < ARRAY_SIZE(pci_num_props) && !ret; i++) {
+		prop = (char *)xmlGetProp(node, BAD_CAST pci_num_props[i].name);
+		if (!prop) {
+			topo_err("get %s prop %s failed.", node->name,
+				 pci_num_props[i].name);
+			return -ENOENT;
+		}
 
-	if (!is_valid_num(prop, WAYCA_SC_INFO_DEC_BASE, -1, UINT8_MAX)) {
-		topo_err("get %s prop %s failed.", node->name, "smmu_idx");
-		ret = -EINVAL;
-		goto prop_free;
+		if (!is_valid_num(prop, WAYCA_SC_INFO_DEC_BASE,
+				  pci_num_props[i].min, pci_num_props[i].max)) {
+			topo_err("get %s prop %s failed.", node->name,
+				 pci_num_props[i].name);
+			ret = -EINVAL;
+		}
+		xmlFree(prop);
 	}
 
-prop_free:
-	xmlFree(prop);
 	return ret;
 }
 